@@ -79,14 +79,15 @@ string fullHelpMessage(void) {
 }
 
 
-AtomicGroup calcAverage(const vector<AtomicGroup>& ensemble, const uint size) {
+AtomicGroup calcAverage(const CoordinateEnsemble& ensemble, const uint size) {
 
-  vector<AtomicGroup> subsample(size);
-  for (uint i=0; i<size; ++i)
-    subsample[i] = ensemble[i];
+  CoordinateEnsemble subsample = ensemble.frames(0, size);
 
-  if (locally_optimal)
+  // Aligning modifies the coordinates, so work on a copy
+  if (locally_optimal) {
+    subsample = subsample.copy();
     (void)iterativeAlignment(subsample);
+  }
 
   AtomicGroup avg = averageStructure(subsample);
   return(avg);
@@ -130,7 +131,7 @@ int main(int argc, char *argv[]) {
   
   AtomicGroup subset = selectAtoms(model, sel);
   cout << boost::format("# Subset has %d atoms\n") % subset.size();
-  vector<AtomicGroup> ensemble;
+  CoordinateEnsemble ensemble;
   readTrajectory(ensemble, subset, traj);
   cout << boost::format("# Trajectory has %d frames\n") % ensemble.size();
 
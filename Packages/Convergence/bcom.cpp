@@ -44,7 +44,6 @@ namespace opts = loos::OptionsFramework;
 namespace po = loos::OptionsFramework::po;
 
 
-typedef vector<AtomicGroup>                               vGroup;
 typedef boost::tuple<RealMatrix, RealMatrix, RealMatrix>  SVDResult;
 
 
@@ -65,6 +64,7 @@ uint ntries;
 vector<uint> blocksizes;
 uint seed;
 string gold_standard_trajectory_name;
+string scratch_dir;
 
 string fullHelpMessage() {
 
@@ -147,7 +147,8 @@ public:
       ("zscore,Z", po::value<bool>(&use_zscore)->default_value(false), "Use Z-score rather than covariance overlap")
       ("ntries,N", po::value<uint>(&ntries)->default_value(20), "Number of tries for Z-score")
       ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
-      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead");
+      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead")
+      ("scratch", po::value<string>(&scratch_dir)->default_value(""), "Keep the trajectory in a file in this directory rather than in memory");
 
   }
 
@@ -161,12 +162,13 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', zscore=%d, ntries=%d, local=%d, gold='%s'")
+    oss << boost::format("blocks='%s', zscore=%d, ntries=%d, local=%d, gold='%s', scratch='%s'")
       % blocks_spec
       % use_zscore
       % ntries
       % local_average
-      % gold_standard_trajectory_name;
+      % gold_standard_trajectory_name
+      % scratch_dir;
     return(oss.str());
   }
 
@@ -191,27 +193,17 @@ struct Datum {
 
 
 
-vGroup subgroup(const vGroup& A, const uint a, const uint b) {
-  vGroup B;
-
-  for (uint i=a; i<b; ++i)
-    B.push_back(A[i]);
-
-  return(B);
-}
-
-
 // Breaks the ensemble up into blocks and computes the PCA for each
 // block and the statistics for the covariance overlaps...
 
 template<class ExtractPolicy>
-Datum blocker(const RealMatrix& Ua, const RealMatrix sa, vGroup& ensemble, const uint blocksize, ExtractPolicy& policy) {
+Datum blocker(const RealMatrix& Ua, const RealMatrix sa, CoordinateEnsemble& ensemble, const uint blocksize, ExtractPolicy& policy) {
 
 
   TimeSeries<double> coverlaps;
 
   for (uint i=0; i<ensemble.size() - blocksize; i += blocksize) {
-    vGroup subset = subgroup(ensemble, i, i+blocksize);
+    CoordinateEnsemble subset = ensemble.frames(i, i+blocksize);
     boost::tuple<RealMatrix, RealMatrix> pca_result = pca(subset, policy);
     RealMatrix s = boost::get<0>(pca_result);
     RealMatrix U = boost::get<1>(pca_result);
@@ -275,7 +267,7 @@ int main(int argc, char *argv[]) {
 
   AtomicGroup subset = selectAtoms(model, sopts->selection);
 
-  vector<AtomicGroup> ensemble;
+  CoordinateEnsemble ensemble(scratch_dir);
   readTrajectory(ensemble, subset, traj);
  
   // First, align the input trajectory...
@@ -302,7 +294,7 @@ int main(int argc, char *argv[]) {
   } else {
     // Must read in another trajectory, process it, and get the PCA
     pTraj gold = createTrajectory(gold_standard_trajectory_name, model);
-    vector<AtomicGroup> gold_ensemble;
+    CoordinateEnsemble gold_ensemble(scratch_dir);
     readTrajectory(gold_ensemble, subset, gold);
     boost::tuple<vector<XForm>, greal, int> bres = iterativeAlignment(gold_ensemble);
     cout << "# Gold Alignment converged to " << boost::get<1>(bres) << " in " << boost::get<2>(bres) << " iterations\n";
@@ -88,9 +88,9 @@ namespace Convergence {
   /*
    * Various policies that determine how blocks are extracted and
    * averaged/aligned.  The idea is that they are really functors
-   * which, given a vector<AtomicGroup> ensemble, will extract a
-   * RealMatrix of coordinates where each AtomicGroup is a column
-   * vector.  The appropriate processing (i.e. average subtraction) is
+   * which, given a vector<AtomicGroup> (or a CoordinateEnsemble)
+   * ensemble, will extract a RealMatrix of coordinates where each
+   * structure is a column vector.  The appropriate processing (i.e. average subtraction) is
    * also performed by the functor.
    *
    * local_average, when set, means that the average of the ensemble
@@ -129,7 +129,8 @@ namespace Convergence {
     NoAlignPolicy(const loos::AtomicGroup& avg_) : avg(avg_), local_average(false) { }
     NoAlignPolicy(const loos::AtomicGroup& avg_, const bool flag) : avg(avg_), local_average(flag) { }
 
-    loos::RealMatrix operator()(std::vector<loos::AtomicGroup>& ensemble) {
+    template<class Ensemble>
+    loos::RealMatrix operator()(Ensemble& ensemble) {
 
       loos::RealMatrix M = loos::extractCoords(ensemble);
       if (local_average) {
@@ -152,8 +153,8 @@ namespace Convergence {
   // extraction policy...
   //
 
-  template<class ExtractPolicy>
-  boost::tuple<loos::RealMatrix, loos::RealMatrix> pca(std::vector<loos::AtomicGroup>& ensemble, ExtractPolicy& extractor) {
+  template<class Ensemble, class ExtractPolicy>
+  boost::tuple<loos::RealMatrix, loos::RealMatrix> pca(Ensemble& ensemble, ExtractPolicy& extractor) {
 
     loos::RealMatrix M = extractor(ensemble);
     loos::RealMatrix C = loos::Math::MMMultiply(M, M, false, true);
@@ -198,8 +199,8 @@ namespace Convergence {
   // given an extraction policy...
   //
 
-  template<class ExtractPolicy>
-  loos::RealMatrix rsv(std::vector<loos::AtomicGroup>& ensemble, ExtractPolicy& extractor) {
+  template<class Ensemble, class ExtractPolicy>
+  loos::RealMatrix rsv(Ensemble& ensemble, ExtractPolicy& extractor) {
 
     loos::RealMatrix M = extractor(ensemble);
     loos::RealMatrix C = loos::Math::MMMultiply(M, M, false, true);
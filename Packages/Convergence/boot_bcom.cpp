@@ -43,7 +43,6 @@ namespace po = boost::program_options;
 const bool debug = false;
 
 
-typedef vector<AtomicGroup>                               vGroup;
 typedef boost::tuple<RealMatrix, RealMatrix, RealMatrix>  SVDResult;
 
 
@@ -58,6 +57,7 @@ vector<uint> blocksizes;
 bool local_average;
 uint nreps;
 string gold_standard_trajectory_name;
+string scratch_dir;
 
 
 string fullHelpMessage() {
@@ -155,7 +155,8 @@ public:
       ("steps", po::value<uint>(&nsteps)->default_value(25), "Max number of blocks for auto-ranging")
       ("reps", po::value<uint>(&nreps)->default_value(20), "Number of replicates for bootstrap")
       ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
-      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead");
+      ("gold", po::value<string>(&gold_standard_trajectory_name)->default_value(""), "Use this trajectory for the gold-standard instead")
+      ("scratch", po::value<string>(&scratch_dir)->default_value(""), "Keep the trajectory in a file in this directory rather than in memory");
 
 
   }
@@ -169,11 +170,12 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', local=%d, reps=%d, gold='%s'")
+    oss << boost::format("blocks='%s', local=%d, reps=%d, gold='%s', scratch='%s'")
       % blocks_spec
       % local_average
       % nreps
-      % gold_standard_trajectory_name;
+      % gold_standard_trajectory_name
+      % scratch_dir;
     return(oss.str());
   }
 
@@ -215,23 +217,11 @@ void dumpPicks(const vector<uint>& picks) {
 }
 
 
-// Extract a subgroup of the vector<AtomicGroup> given the indices in picks...
-vGroup subgroup(const vGroup& A, const vector<uint>& picks) {
-  vGroup B;
-  
-  for (vector<uint>::const_iterator ci = picks.begin(); ci != picks.end(); ++ci)
-    B.push_back(A[*ci]);
-
-  return(B);
-}
-
-
-
 // Breaks the ensemble up into blocks and computes the PCA for each
 // block and the statistics for the covariance overlaps...
 
 template<class ExtractPolicy>
-Datum blocker(const RealMatrix& Ua, const RealMatrix sa, const vGroup& ensemble, const uint blocksize, uint repeats, ExtractPolicy& policy) {
+Datum blocker(const RealMatrix& Ua, const RealMatrix sa, const CoordinateEnsemble& ensemble, const uint blocksize, uint repeats, ExtractPolicy& policy) {
 
 
   
@@ -245,7 +235,7 @@ Datum blocker(const RealMatrix& Ua, const RealMatrix sa, const vGroup& ensemble,
       dumpPicks(picks);
     }
     
-    vGroup subset = subgroup(ensemble, picks);
+    CoordinateEnsemble subset = ensemble.select(picks);
     boost::tuple<RealMatrix, RealMatrix> pca_result = pca(subset, policy);
     RealMatrix s = boost::get<0>(pca_result);
     RealMatrix U = boost::get<1>(pca_result);
@@ -303,7 +293,7 @@ int main(int argc, char *argv[]) {
   AtomicGroup subset = selectAtoms(model, sopts->selection);
 
 
-  vector<AtomicGroup> ensemble;
+  CoordinateEnsemble ensemble(scratch_dir);
   readTrajectory(ensemble, subset, traj);
 
   // First, align the input trajectory...
@@ -330,7 +320,7 @@ int main(int argc, char *argv[]) {
   } else {
     // Must read in another trajectory, process it, and get the PCA
     pTraj gold = createTrajectory(gold_standard_trajectory_name, model);
-    vector<AtomicGroup> gold_ensemble;
+    CoordinateEnsemble gold_ensemble(scratch_dir);
     readTrajectory(gold_ensemble, subset, gold);
     boost::tuple<vector<XForm>, greal, int> bres = iterativeAlignment(gold_ensemble);
     cout << "# Gold Alignment converged to " << boost::get<1>(bres) << " in " << boost::get<2>(bres) << " iterations\n";
@@ -47,10 +47,6 @@ namespace po = loos::OptionsFramework::po;
 
 // @cond TOOLS_INTERNAL
 
-typedef vector<AtomicGroup>                               vGroup;
-
-
-
 // Convenience structure for aggregating results
 struct Datum {
   Datum(const double avg, const double var, const uint nblks) : avg_cosine(avg),
@@ -152,6 +148,7 @@ bool local_average;
 vector<uint> blocksizes;
 string model_name, traj_name, selection;
 uint principal_component;
+string scratch_dir;
 
 
 // @cond TOOLS_INTERAL
@@ -162,7 +159,8 @@ public:
     o.add_options()
       ("pc", po::value<uint>(&principal_component)->default_value(0), "Which principal component to use")
       ("blocks", po::value<string>(&blocks_spec), "Block sizes (MATLAB style range)")
-      ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global");
+      ("local", po::value<bool>(&local_average)->default_value(true), "Use local avg in block PCA rather than global")
+      ("scratch", po::value<string>(&scratch_dir)->default_value(""), "Keep the trajectory in a file in this directory rather than in memory");
 
   }
 
@@ -180,10 +178,11 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("blocks='%s', local=%d, pc=%d")
+    oss << boost::format("blocks='%s', local=%d, pc=%d, scratch='%s'")
       % blocks_spec
       % local_average
-      % principal_component;
+      % principal_component
+      % scratch_dir;
     return(oss.str());
   }
 
@@ -197,28 +196,17 @@ public:
 
 
 
-vGroup subgroup(const vGroup& A, const uint a, const uint b) {
-  vGroup B;
-
-  for (uint i=a; i<b; ++i)
-    B.push_back(A[i]);
-
-  return(B);
-}
-
-
-
 // Breaks the ensemble up into blocks and computes the RSV for each
 // block and the statistics for the cosine content...
 
 template<class ExtractPolicy>
-Datum blocker(const uint pc, vGroup& ensemble, const uint blocksize, ExtractPolicy& policy) {
+Datum blocker(const uint pc, CoordinateEnsemble& ensemble, const uint blocksize, ExtractPolicy& policy) {
 
 
   TimeSeries<double> cosines;
 
   for (uint i=0; i<ensemble.size() - blocksize; i += blocksize) {
-    vGroup subset = subgroup(ensemble, i, i+blocksize);
+    CoordinateEnsemble subset = ensemble.frames(i, i+blocksize);
     RealMatrix V = rsv(subset, policy);
 
     double val = cosineContent(V, pc);
@@ -266,7 +254,7 @@ int main(int argc, char *argv[]) {
   AtomicGroup subset = selectAtoms(model, sopts->selection);
 
 
-  vector<AtomicGroup> ensemble;
+  CoordinateEnsemble ensemble(scratch_dir);
   readTrajectory(ensemble, subset, traj);
  
   // First, read in and align trajectory
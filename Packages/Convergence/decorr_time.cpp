@@ -305,9 +305,10 @@ int main(int argc, char *argv[]) {
   opts::BasicConvergence *copts = new opts::BasicConvergence;
   ToolOptions* topts = new ToolOptions;
   opts::RequiredArguments* ropts = new opts::RequiredArguments("trange", "T-range");
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
   
   opts::AggregateOptions options;
-  options.add(bopts).add(sopts).add(tropts).add(copts).add(topts).add(ropts);
+  options.add(bopts).add(sopts).add(tropts).add(copts).add(topts).add(ropts).add(mopts);
 
   if (!options.parse(argc, argv))
     exit(-1);
@@ -349,6 +350,6 @@ int main(int argc, char *argv[]) {
   }
 
   DoubleMatrix M = statistics(results);
-  writeAsciiMatrix(cout, M, "");
+  writeMatrix(cout, M, "", mopts->binary);
 }
 
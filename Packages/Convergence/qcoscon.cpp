@@ -50,6 +50,7 @@ typedef vector<AtomicGroup>                               vGroup;
 
 
 uint nmodes;
+string scratch_dir;
 
 string fullHelpMessage() {
 
@@ -102,12 +103,13 @@ class ToolOptions : public opts::OptionsPackage {
 public:
   void addGeneric(po::options_description& o) {
     o.add_options()
-      ("modes", po::value<uint>(&nmodes)->default_value(10), "Compute cosine content for first N modes");
+      ("modes", po::value<uint>(&nmodes)->default_value(10), "Compute cosine content for first N modes")
+      ("scratch", po::value<string>(&scratch_dir)->default_value(""), "Keep the trajectory in a file in this directory rather than in memory");
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("modes=%d") % nmodes;
+    oss << boost::format("modes=%d, scratch='%s'") % nmodes % scratch_dir;
     return(oss.str());
   }
 
@@ -138,7 +140,7 @@ int main(int argc, char *argv[]) {
     cerr << "Warning: --skip option ignored\n";
 
   AtomicGroup subset = selectAtoms(model, sopts->selection);
-  vector<AtomicGroup> ensemble;
+  CoordinateEnsemble ensemble(scratch_dir);
   readTrajectory(ensemble, subset, traj);
  
   // Read in and align...
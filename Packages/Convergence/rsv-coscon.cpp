@@ -143,7 +143,7 @@ int main(int argc, char *argv[]) {
   cout << "# " << vectorAsStringWithCommas<string>(options.print()) << endl;
 
   RealMatrix V;
-  readAsciiMatrix(ropts->value("rsv"), V);
+  readMatrix(ropts->value("rsv"), V);
 
   cout << "# n\tcoscon\n";
   for (uint i=0; i<nmodes; ++i)
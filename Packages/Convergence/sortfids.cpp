@@ -105,7 +105,7 @@ int main(int argc, char *argv[]) {
   readTrajectory(fiducials, subset, fids);
 
   Matrix M;
-  readAsciiMatrix(argv[opti++], M);
+  readMatrix(argv[opti++], M);
   vector<uint> indices = sortedIndex<Adapter, DescendingSort<Adapter> >(Adapter(M));
 
   vGroup sorted;
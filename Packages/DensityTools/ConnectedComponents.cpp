@@ -0,0 +1,327 @@
+/*
+  Connected-component labeling of LOOS grids
+*/
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <ConnectedComponents.hpp>
+
+
+namespace loos {
+  namespace DensityTools {
+
+    namespace {
+
+      // Union-find table, where each set's root is its smallest label
+      struct EquivalenceTable {
+        int find(int l) {
+          while (parent[l] != l) {
+            parent[l] = parent[parent[l]];
+            l = parent[l];
+          }
+          return(l);
+        }
+
+        int unite(const int a, const int b) {
+          int ra = find(a);
+          int rb = find(b);
+          if (ra < rb) {
+            parent[rb] = ra;
+            return(ra);
+          }
+          parent[ra] = rb;
+          return(rb);
+        }
+
+        int add() {
+          int l = parent.size();
+          parent.push_back(l);
+          return(l);
+        }
+
+        std::vector<int> parent;
+      };
+
+
+      // First pass over the z-slab [z0, z1).  Each point is joined to
+      // its neighbors that come before it in the scan (and are in the
+      // same slab), so labels are local to the slab and start at 1.
+      struct SlabLabeler {
+        SlabLabeler(const unsigned char* mask, int* labels, const DensityGridpoint& dims, const int z0, const int z1,
+                    EquivalenceTable* table)
+          : mask(mask), labels(labels), nx(dims.x()), ny(dims.y()), z0(z0), z1(z1), table(table) { }
+
+        void operator()() {
+          table->parent.assign(1, 0);
+
+          for (int z=z0; z<z1; ++z)
+            for (int y=0; y<ny; ++y)
+              for (int x=0; x<nx; ++x) {
+                long idx = (static_cast<long>(z) * ny + y) * nx + x;
+                if (!mask[idx]) {
+                  labels[idx] = 0;
+                  continue;
+                }
+
+                int label = 0;
+                for (int dz=-1; dz<=0; ++dz) {
+                  if (z + dz < z0)
+                    continue;
+                  for (int dy=-1; dy<=1; ++dy) {
+                    if (dz == 0 && dy > 0)
+                      break;
+                    if (y + dy < 0 || y + dy >= ny)
+                      continue;
+                    for (int dx=-1; dx<=1; ++dx) {
+                      if (dz == 0 && dy == 0 && dx >= 0)
+                        break;
+                      if (x + dx < 0 || x + dx >= nx)
+                        continue;
+                      int l = labels[(static_cast<long>(z + dz) * ny + y + dy) * nx + x + dx];
+                      if (l)
+                        label = label ? table->unite(label, l) : table->find(l);
+                    }
+                  }
+                }
+
+                labels[idx] = label ? label : table->add();
+              }
+        }
+
+        const unsigned char* mask;
+        int* labels;
+        int nx, ny, z0, z1;
+        EquivalenceTable* table;
+      };
+
+
+      // Second pass, replacing the slab-local labels with blob ids
+      struct SlabRelabeler {
+        SlabRelabeler(int* labels, const long begin, const long end, const int* ids)
+          : labels(labels), begin(begin), end(end), ids(ids) { }
+
+        void operator()() {
+          for (long i=begin; i<end; ++i)
+            if (labels[i])
+              labels[i] = ids[labels[i]];
+        }
+
+        int* labels;
+        long begin, end;
+        const int* ids;
+      };
+
+    }
+
+
+
+    int labelBlobs(const std::vector<unsigned char>& mask, DensityGrid<int>& blobs, const uint nthreads) {
+      if (static_cast<long>(mask.size()) != blobs.size())
+        throw(std::runtime_error("Blob mask and grid must be the same size"));
+      if (blobs.empty())
+        return(0);
+
+      DensityGridpoint dims = blobs.gridDims();
+      long plane = static_cast<long>(dims.x()) * dims.y();
+      int* labels = &blobs(0L);
+
+      uint n = (nthreads == 0) ? boost::thread::hardware_concurrency() : nthreads;
+      if (n == 0)
+        n = 1;
+      if (n > static_cast<uint>(dims.z()))
+        n = dims.z();
+
+      std::vector<int> zstart(n+1);
+      for (uint s=0; s<=n; ++s)
+        zstart[s] = static_cast<int>(static_cast<long>(dims.z()) * s / n);
+
+      std::vector<EquivalenceTable> tables(n);
+      if (n == 1)
+        SlabLabeler(&mask[0], labels, dims, 0, dims.z(), &tables[0])();
+      else {
+        boost::thread_group threads;
+        for (uint s=0; s<n; ++s)
+          threads.create_thread(SlabLabeler(&mask[0], labels, dims, zstart[s], zstart[s+1], &tables[s]));
+        threads.join_all();
+      }
+
+      // Joins the slab tables into one, with the labels for slab s
+      // offset by the number of labels in the slabs before it
+      std::vector<int> offset(n+1, 0);
+      for (uint s=0; s<n; ++s)
+        offset[s+1] = offset[s] + static_cast<int>(tables[s].parent.size()) - 1;
+
+      EquivalenceTable global;
+      global.parent.resize(offset[n] + 1);
+      global.parent[0] = 0;
+      for (uint s=0; s<n; ++s)
+        for (uint l=1; l<tables[s].parent.size(); ++l)
+          global.parent[offset[s] + l] = offset[s] + tables[s].parent[l];
+
+      // Merges the blobs that touch across each slab boundary
+      for (uint s=1; s<n; ++s) {
+        int z = zstart[s];
+        for (int y=0; y<dims.y(); ++y)
+          for (int x=0; x<dims.x(); ++x) {
+            long idx = z * plane + static_cast<long>(y) * dims.x() + x;
+            if (!labels[idx])
+              continue;
+            int label = offset[s] + labels[idx];
+
+            for (int dy=-1; dy<=1; ++dy) {
+              if (y + dy < 0 || y + dy >= dims.y())
+                continue;
+              for (int dx=-1; dx<=1; ++dx) {
+                if (x + dx < 0 || x + dx >= dims.x())
+                  continue;
+                int l = labels[idx - plane + dy * dims.x() + dx];
+                if (l)
+                  global.unite(label, offset[s-1] + l);
+              }
+            }
+          }
+      }
+
+      // Since each set's root is its first label in scan order,
+      // numbering the roots in order gives the flood-fill numbering
+      int nblobs = 0;
+      std::vector<int> ids(offset[n] + 1, 0);
+      for (int l=1; l<=offset[n]; ++l) {
+        int r = global.find(l);
+        ids[l] = (r == l) ? ++nblobs : ids[r];
+      }
+
+      if (n == 1)
+        SlabRelabeler(labels, 0, blobs.size(), &ids[0])();
+      else {
+        boost::thread_group threads;
+        for (uint s=0; s<n; ++s)
+          threads.create_thread(SlabRelabeler(labels, zstart[s] * plane, zstart[s+1] * plane, &ids[offset[s]]));
+        threads.join_all();
+      }
+
+      return(nblobs);
+    }
+
+
+
+    std::vector<BlobInfo> blobTable(const DensityGrid<int>& blobs) {
+      int maxid = 0;
+      for (long i=0; i<blobs.size(); ++i)
+        maxid = std::max(maxid, blobs(i));
+
+      std::vector<BlobInfo> table(maxid);
+      DensityGridpoint dims = blobs.gridDims();
+      for (int k=0; k<dims.z(); ++k)
+        for (int j=0; j<dims.y(); ++j)
+          for (int i=0; i<dims.x(); ++i) {
+            int id = blobs(k, j, i);
+            if (id <= 0)
+              continue;
+
+            BlobInfo& b = table[id-1];
+            DensityGridpoint p(i, j, k);
+            if (b.voxels == 0) {
+              b.bmin = p;
+              b.bmax = p;
+            } else
+              for (int n=0; n<3; ++n) {
+                b.bmin[n] = std::min(b.bmin[n], p[n]);
+                b.bmax[n] = std::max(b.bmax[n], p[n]);
+              }
+            b.centroid += blobs.gridToWorld(p);
+            ++b.voxels;
+          }
+
+      for (int i=0; i<maxid; ++i) {
+        BlobInfo& b = table[i];
+        b.id = i + 1;
+        if (b.voxels) {
+          b.centroid /= b.voxels;
+          b.extents = blobs.gridToWorld(b.bmax) - blobs.gridToWorld(b.bmin);
+        }
+      }
+
+      return(table);
+    }
+
+
+    void writeBlobTable(std::ostream& os, const std::vector<BlobInfo>& table, const std::string& meta,
+                        const double voxel_volume) {
+      os << "# " << meta << std::endl;
+      os << "# id voxels volume centroid(x y z) min(i j k) max(i j k) extents(x y z)\n";
+      for (std::vector<BlobInfo>::const_iterator i = table.begin(); i != table.end(); ++i)
+        os << boost::format("%d %d %.6g %.6f %.6f %.6f %d %d %d %d %d %d %.6f %.6f %.6f\n")
+          % i->id % i->voxels % (i->voxels * voxel_volume)
+          % i->centroid.x() % i->centroid.y() % i->centroid.z()
+          % i->bmin.x() % i->bmin.y() % i->bmin.z()
+          % i->bmax.x() % i->bmax.y() % i->bmax.z()
+          % i->extents.x() % i->extents.y() % i->extents.z();
+    }
+
+
+    std::vector<BlobInfo> readBlobTable(std::istream& is) {
+      std::vector<BlobInfo> table;
+      std::string line;
+      while (std::getline(is, line)) {
+        if (line.empty() || line[0] == '#')
+          continue;
+
+        std::istringstream iss(line);
+        BlobInfo b;
+        double volume;
+        if (!(iss >> b.id >> b.voxels >> volume
+              >> b.centroid[0] >> b.centroid[1] >> b.centroid[2]
+              >> b.bmin[0] >> b.bmin[1] >> b.bmin[2]
+              >> b.bmax[0] >> b.bmax[1] >> b.bmax[2]
+              >> b.extents[0] >> b.extents[1] >> b.extents[2]))
+          throw(std::runtime_error("Cannot parse blob table line: " + line));
+        table.push_back(b);
+      }
+
+      return(table);
+    }
+
+
+    double boundingBoxDistance2(const BlobInfo& blob, const DensityGridpoint& p) {
+      double d2 = 0.0;
+      for (int n=0; n<3; ++n) {
+        int d = 0;
+        if (p[n] < blob.bmin[n])
+          d = blob.bmin[n] - p[n];
+        else if (p[n] > blob.bmax[n])
+          d = p[n] - blob.bmax[n];
+        d2 += static_cast<double>(d) * d;
+      }
+      return(d2);
+    }
+
+  };
+};
@@ -0,0 +1,120 @@
+/*
+  Connected-component labeling of LOOS grids
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#if !defined(LOOS_CONNECTED_COMPONENTS_HPP)
+#define LOOS_CONNECTED_COMPONENTS_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <DensityGrid.hpp>
+
+
+namespace loos {
+
+  namespace DensityTools {
+
+
+    //! Labels the connected regions (blobs) of a mask
+    /**
+     * \a mask has one element per grid point of \a blobs, in the same
+     * order as the grid's linear index, and is non-zero for the points
+     * that belong to some blob.  Points are connected to all 26 of
+     * their neighbors.  Every point of \a blobs is overwritten, with 0
+     * for points not in a blob and the blob id (starting at 1) for the
+     * rest.  Blobs are numbered in the order of their first point in
+     * the grid (i.e. by z, then y, then x), which is the same
+     * numbering a flood-fill started from each unlabeled point in turn
+     * gives.  Returns the number of blobs.
+     *
+     * The grid is divided into slabs along z, one per thread (0 = one
+     * per core).  Each slab is labeled with a single raster scan,
+     * recording the labels found to be equivalent in a union-find
+     * table.  The tables are then joined, the labels that touch across
+     * slab boundaries merged, and a second parallel pass replaces each
+     * label with its final blob id.
+     */
+    int labelBlobs(const std::vector<unsigned char>& mask, DensityGrid<int>& blobs, const uint nthreads = 0);
+
+
+    //! Labels the blobs of grid points in \a data for which \a op is true
+    /**
+     * \a blobs is resized to match \a data.  See labelBlobs() above.
+     */
+    template<typename T, class Functor>
+    int labelBlobs(const DensityGrid<T>& data, DensityGrid<int>& blobs, const Functor& op, const uint nthreads = 0) {
+      std::vector<unsigned char> mask(data.size());
+      for (long i=0; i<data.size(); ++i)
+        mask[i] = op(data(i));
+
+      if (blobs.gridDims() != data.gridDims() || blobs.minCoord() != data.minCoord()
+          || blobs.maxCoord() != data.maxCoord())
+        blobs.resize(data.minCoord(), data.maxCoord(), data.gridDims());
+
+      return(labelBlobs(mask, blobs, nthreads));
+    }
+
+
+
+    //! Summary of a single blob
+    struct BlobInfo {
+      BlobInfo() : id(0), voxels(0), bmin(0,0,0), bmax(0,0,0), centroid(0,0,0), extents(0,0,0) { }
+
+      int id;
+      long voxels;
+      DensityGridpoint bmin, bmax;     // Bounding box (in grid coords, inclusive)
+      GCoord centroid;                 // Unweighted center (in real-space)
+      GCoord extents;                  // Size of the bounding box (in real-space)
+    };
+
+
+    //! Summarizes every blob in a grid of blob ids (such as from labelBlobs()) in a single pass
+    /**
+     * Element i is blob i+1.  Ids missing from the grid have zero voxels.
+     */
+    std::vector<BlobInfo> blobTable(const DensityGrid<int>& blobs);
+
+    //! Writes a blob table as text, one blob per line
+    void writeBlobTable(std::ostream& os, const std::vector<BlobInfo>& table, const std::string& meta,
+                        const double voxel_volume);
+
+    //! Reads a blob table written by writeBlobTable()
+    std::vector<BlobInfo> readBlobTable(std::istream& is);
+
+
+    //! Squared distance (in grid units) from \a p to the closest point of a blob's bounding box
+    double boundingBoxDistance2(const BlobInfo& blob, const DensityGridpoint& p);
+
+  };
+
+};
+
+
+#endif
@@ -519,6 +519,10 @@ namespace loos {
        * \a u.  The functor take two parameters: the value at the gid
        * point and the distance from that grid point to the center of
        * the sphere (in real-space units)
+       *
+       * The bounding cube is clipped to the grid and the squared
+       * distance along each axis is computed once, so the inner loop
+       * only sums them and walks along a row of the grid.
        */
       template<typename Func>
       void applyWithinRadius(const double r, const loos::GCoord& u, const Func& f) {
@@ -526,27 +530,34 @@ namespace loos {
         DensityGridpoint b = gridpoint(u + r);
         double r2 = r * r;
 
-        std::vector<DensityGridpoint> res;
+        std::vector<double> d2[3];
+        for (int n=0; n<3; ++n) {
+          if (a[n] < 0)
+            a[n] = 0;
+          if (b[n] >= dims[n])
+            b[n] = dims[n] - 1;
+          if (a[n] > b[n])
+            return;
+
+          for (int i=a[n]; i<=b[n]; ++i) {
+            double d = (static_cast<loos::greal>(i) / delta[n] + _gridmin[n]) - u[n];
+            d2[n].push_back(d * d);
+          }
+        }
+
         for (int k=a[2]; k <= b[2]; k++) {
-          if (k < 0 || k >= dims[2])
-            continue;
+          double dz = d2[2][k - a[2]];
           for (int j=a[1]; j <= b[1]; j++) {
-            if (j < 0 || j >= dims[1])
-              continue;
-            for (int i=a[0];i <= b[0]; i++) {
-              if (i < 0 || i >= dims[0])
-                continue;
-	    
-              DensityGridpoint point(i, j, k);
-              loos::GCoord v = gridToWorld(point);
-              double d = u.distance2(v);
+            double dy = d2[1][j - a[1]];
+            T* row = ptr + (static_cast<long>(k) * dims.y() + j) * dims.x();
+            for (int i=a[0]; i <= b[0]; i++) {
+              double d = d2[0][i - a[0]] + dy + dz;
               if (d <= r2)
-                f(operator()(v), d);
+                f(row[i], d);
             }
           }
         }
 
-
       }
 
 
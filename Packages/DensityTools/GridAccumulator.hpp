@@ -0,0 +1,582 @@
+/*
+  Threaded accumulation of points into a DensityGrid
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_GRID_ACCUMULATOR_HPP)
+#define LOOS_GRID_ACCUMULATOR_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <DensityGrid.hpp>
+
+
+namespace loos {
+
+  namespace DensityTools {
+
+
+    //! Accumulates points (e.g. waters) from many frames into a DensityGrid
+    /**
+     * Each frame is a set of points and a weight.  Every point adds
+     * its weight to the grid, spread over the nearby grid points by
+     * the chosen kernel:
+     *
+     * - Nearest adds it all to the nearest grid point (as water-hist
+     *   has always done)
+     * - Trilinear divides it among the 8 surrounding grid points
+     * - Gaussian spreads it with a Gaussian of width sigma, out to a
+     *   cutoff along each axis.  The kernel is normalized so the
+     *   weights add up to the point's weight (less whatever falls
+     *   outside the grid).  The kernel is separable, so the innermost
+     *   loop just scales a precomputed row of weights, which the
+     *   compiler vectorizes.
+     *
+     * A point whose nearest grid point is outside the grid is counted
+     * as out of bounds and not added.
+     *
+     * With more than one thread, a pool of worker threads is started
+     * that lasts as long as the accumulator (or until the number of
+     * threads is changed).  Frames are buffered as they are added, and
+     * once the buffer holds enough points (points_per_thread for each
+     * thread) it is handed to the workers while the next batch is
+     * filled.  Each worker accumulates a contiguous share of the batch,
+     * split by number of points, into its own private grid, so there
+     * is no contention.  The private grids are summed when the grid is
+     * requested, with each thread taking a slab of the grid and adding
+     * the private grids pairwise (0+1, 2+3, ..., then 0+2, ...).  The
+     * order of the sums never depends on how the threads are
+     * scheduled, so the result is the same from run to run.  Note that
+     * each thread needs its own full-size grid.
+     *
+     * Since adding a point with the Nearest kernel costs only a few
+     * nanoseconds, the extra threads mostly help with the Trilinear
+     * and (especially) Gaussian kernels, where each point touches many
+     * grid points.
+     *
+     * Example:
+     * \code
+     *   GridAccumulator<double> accum(grid);
+     *   accum.threads(8);
+     *   accum.kernel(GridAccumulator<double>::Gaussian, 1.0);
+     *   for (uint t=0; t<frames.size(); ++t) {
+     *     traj->readFrame(frames[t]);
+     *     traj->updateGroupCoords(water);
+     *     accum.addFrame(water.getTransformedCoords(XForm()), 1.0 / frames.size());
+     *   }
+     *   DensityGrid<double> density = accum.grid();
+     * \endcode
+     */
+    template<typename T>
+    class GridAccumulator {
+    public:
+      enum Kernel { Nearest, Trilinear, Gaussian };
+
+      //! Accumulator for an empty grid (see resize())
+      GridAccumulator()
+        : _nthreads(0), _kernel(Nearest), _sigma(0.0), _cutoff(0.0),
+          _npending(0), _pending_points(0), _nactive(0), _generation(0), _busy(0), _shutdown(false)
+      {
+        threads(1);
+      }
+
+      //! Accumulates into a grid with the same location and size as \a g
+      explicit GridAccumulator(const DensityGrid<T>& g)
+        : _nthreads(0), _kernel(Nearest), _sigma(0.0), _cutoff(0.0),
+          _npending(0), _pending_points(0), _nactive(0), _generation(0), _busy(0), _shutdown(false)
+      {
+        _gmin = g.minCoord();
+        _gmax = g.maxCoord();
+        _dims = g.gridDims();
+        threads(1);
+      }
+
+      ~GridAccumulator() {
+        stopThreads();
+        for (uint i=0; i<_workers.size(); ++i)
+          delete _workers[i];
+      }
+
+
+      //! Changes the location and size of the grid, discarding anything accumulated
+      void resize(const loos::GCoord& gmin, const loos::GCoord& gmax, const DensityGridpoint& griddims) {
+        wait();
+        _npending = 0;
+        _pending_points = 0;
+        _gmin = gmin;
+        _gmax = gmax;
+        _dims = griddims;
+        for (uint i=0; i<_workers.size(); ++i) {
+          _workers[i]->grid.resize(gmin, gmax, griddims);
+          _workers[i]->out_of_bounds = 0;
+        }
+      }
+
+
+      //! Use \a n threads (0 = one per core)
+      void threads(const uint n) {
+        flush();
+        stopThreads();
+
+        uint m = (n == 0) ? boost::thread::hardware_concurrency() : n;
+        if (m == 0)
+          m = 1;
+
+        // Workers that are removed have their grids folded into the
+        // first one, so changing the number of threads doesn't lose
+        // anything
+        while (_workers.size() < m)
+          _workers.push_back(new Worker(this));
+        while (_workers.size() > m) {
+          Worker* w = _workers.back();
+          _workers.pop_back();
+          _workers[0]->add(*w);
+          delete w;
+        }
+
+        _nthreads = m;
+        if (m > 1)
+          startThreads();
+      }
+
+      uint threads() const { return(_nthreads); }
+
+
+      //! Selects the kernel.  \a sigma and \a cutoff (in sigmas) are only used by Gaussian
+      void kernel(const Kernel k, const double sigma = 1.0, const double cutoff = 3.0) {
+        if (k == Gaussian && !(sigma > 0.0 && cutoff > 0.0))
+          throw(std::runtime_error("The gaussian kernel needs a positive sigma and cutoff"));
+
+        flush();
+        _kernel = k;
+        _sigma = sigma;
+        _cutoff = sigma * cutoff;
+      }
+
+      Kernel kernel() const { return(_kernel); }
+
+
+      //! Adds \a weight at each of \a points
+      void addFrame(const std::vector<loos::GCoord>& points, const T weight) {
+        if (_nthreads == 1) {
+          _workers[0]->frame(points, weight);
+          return;
+        }
+
+        if (_npending == _pending.size())
+          _pending.push_back(Frame());
+        Frame& f = _pending[_npending++];
+        f.points = points;
+        f.weight = weight;
+
+        _pending_points += cost(f);
+        if (_pending_points >= static_cast<long>(points_per_thread) * _nthreads)
+          dispatch();
+      }
+
+
+      //! Finishes any frames that are waiting to be accumulated
+      void flush() {
+        if (_npending)
+          dispatch();
+        wait();
+      }
+
+
+      //! The accumulated grid
+      DensityGrid<T> grid() {
+        flush();
+        merge();
+        DensityGrid<T> result(_workers[0]->grid);
+        return(result);
+      }
+
+      //! Number of points that fell outside the grid
+      long outOfBounds() {
+        flush();
+        long n = 0;
+        for (uint i=0; i<_workers.size(); ++i)
+          n += _workers[i]->out_of_bounds;
+        return(n);
+      }
+
+      //! Zeroes the grid (discarding any frames not yet accumulated)
+      void clear() {
+        wait();
+        _npending = 0;
+        _pending_points = 0;
+        for (uint i=0; i<_workers.size(); ++i) {
+          _workers[i]->grid.zero();
+          _workers[i]->out_of_bounds = 0;
+        }
+      }
+
+
+      //! Converts the name of a kernel ("nearest", "trilinear", or "gaussian")
+      static Kernel parseKernel(const std::string& s) {
+        if (s == "nearest")
+          return(Nearest);
+        else if (s == "trilinear")
+          return(Trilinear);
+        else if (s == "gaussian")
+          return(Gaussian);
+
+        throw(std::runtime_error("Unknown grid kernel '" + s + "'"));
+      }
+
+
+    private:
+
+      // Number of points buffered per thread before the batch is
+      // handed to the workers.  This is large enough that waking the
+      // workers is cheap compared with adding the points, even with
+      // the Nearest kernel.
+      static const uint points_per_thread = 32768;
+
+      struct Frame {
+        std::vector<loos::GCoord> points;
+        T weight;
+      };
+
+
+      // Each worker has its own private grid, along with scratch space
+      // for the gaussian weights
+      struct Worker {
+        Worker(const GridAccumulator* p)
+          : grid(p->_gmin, p->_gmax, p->_dims), out_of_bounds(0), parent(p) { }
+
+        void add(const Worker& w) {
+          for (long i=0; i<grid.size(); ++i)
+            grid(i) += w.grid(i);
+          out_of_bounds += w.out_of_bounds;
+        }
+
+
+        void frame(const std::vector<loos::GCoord>& points, const T weight) {
+          for (std::vector<loos::GCoord>::const_iterator i = points.begin(); i != points.end(); ++i) {
+            DensityGridpoint p = grid.gridpoint(*i);
+            if (!grid.inRange(p)) {
+              ++out_of_bounds;
+              continue;
+            }
+
+            switch(parent->_kernel) {
+            case Nearest: grid(p) += weight; break;
+            case Trilinear: trilinear(*i, weight); break;
+            case Gaussian: gaussian(*i, weight); break;
+            }
+          }
+        }
+
+
+        void trilinear(const loos::GCoord& c, const T weight) {
+          loos::GCoord gmin = grid.minCoord();
+          loos::GCoord delta = grid.gridDelta();
+          DensityGridpoint dims = grid.gridDims();
+
+          int a[3];
+          double f[3][2];
+          for (int n=0; n<3; ++n) {
+            double x = (c[n] - gmin[n]) * delta[n];
+            a[n] = static_cast<int>(floor(x));
+            f[n][1] = x - a[n];
+            f[n][0] = 1.0 - f[n][1];
+          }
+
+          for (int k=0; k<2; ++k) {
+            if (a[2]+k < 0 || a[2]+k >= dims[2])
+              continue;
+            for (int j=0; j<2; ++j) {
+              if (a[1]+j < 0 || a[1]+j >= dims[1])
+                continue;
+              double wzy = f[2][k] * f[1][j];
+              for (int i=0; i<2; ++i)
+                if (a[0]+i >= 0 && a[0]+i < dims[0])
+                  grid(a[2]+k, a[1]+j, a[0]+i) += weight * wzy * f[0][i];
+            }
+          }
+        }
+
+
+        // The weights along each axis are computed over the whole
+        // cutoff (for the normalization), then clipped to the grid
+        void gaussian(const loos::GCoord& c, const T weight) {
+          loos::GCoord gmin = grid.minCoord();
+          loos::GCoord delta = grid.gridDelta();
+          DensityGridpoint dims = grid.gridDims();
+          double r = parent->_cutoff;
+          double g = -0.5 / (parent->_sigma * parent->_sigma);
+
+          int lo[3], hi[3];
+          double norm = 1.0;
+          for (int n=0; n<3; ++n) {
+            int a = static_cast<int>(ceil((c[n] - r - gmin[n]) * delta[n]));
+            int b = static_cast<int>(floor((c[n] + r - gmin[n]) * delta[n]));
+
+            double sum = 0.0;
+            _w[n].clear();
+            for (int i=a; i<=b; ++i) {
+              double d = i / delta[n] + gmin[n] - c[n];
+              double w = exp(g * d * d);
+              sum += w;
+              if (i >= 0 && i < dims[n])
+                _w[n].push_back(w);
+            }
+            norm *= sum;
+
+            lo[n] = std::max(a, 0);
+            hi[n] = std::min(b, dims[n] - 1);
+            if (lo[n] > hi[n])
+              return;
+          }
+
+          double s = weight / norm;
+          const double* wx = &(_w[0][0]);
+          int nx = hi[0] - lo[0] + 1;
+          for (int k=lo[2]; k<=hi[2]; ++k) {
+            double sz = s * _w[2][k - lo[2]];
+            for (int j=lo[1]; j<=hi[1]; ++j) {
+              double szy = sz * _w[1][j - lo[1]];
+              T* row = &grid(k, j, lo[0]);
+              for (int i=0; i<nx; ++i)
+                row[i] += szy * wx[i];
+            }
+          }
+        }
+
+
+        DensityGrid<T> grid;
+        long out_of_bounds;
+        const GridAccumulator* parent;
+        std::vector<double> _w[3];
+      };
+
+
+      // Body of each pooled thread.  It waits for a new batch, adds
+      // its share of the frames, then reports back.  The loop starts
+      // from the generation current when the thread was created, so a
+      // restarted pool doesn't rerun the last batch.
+      struct WorkerLoop {
+        WorkerLoop(GridAccumulator* p, const uint i, const uint g) : parent(p), index(i), seen(g) { }
+
+        void operator()() {
+          while (true) {
+            {
+              boost::unique_lock<boost::mutex> lock(parent->_mutex);
+              while (parent->_generation == seen && !parent->_shutdown)
+                parent->_work_cond.wait(lock);
+              if (parent->_shutdown)
+                return;
+              seen = parent->_generation;
+            }
+
+            Worker* w = parent->_workers[index];
+            for (uint k=parent->_bounds[index]; k<parent->_bounds[index+1]; ++k)
+              w->frame(parent->_active[k].points, parent->_active[k].weight);
+
+            boost::unique_lock<boost::mutex> lock(parent->_mutex);
+            if (--parent->_busy == 0)
+              parent->_done_cond.notify_one();
+          }
+        }
+
+        GridAccumulator* parent;
+        uint index;
+        uint seen;
+      };
+
+
+      // Sums the private grids pairwise over elements begin through
+      // end-1, leaving the total in the first grid and zeroing the rest
+      struct MergeJob {
+        MergeJob(std::vector<Worker*>* w, const long begin, const long end)
+          : workers(w), begin(begin), end(end) { }
+
+        void operator()() {
+          std::vector<Worker*>& w = *workers;
+          uint n = w.size();
+          for (uint stride = 1; stride < n; stride *= 2)
+            for (uint i=0; i+stride < n; i += 2*stride) {
+              T* dst = &(w[i]->grid(begin));
+              const T* src = &(w[i+stride]->grid(begin));
+              for (long k=0; k<end-begin; ++k)
+                dst[k] += src[k];
+            }
+
+          for (uint i=1; i<n; ++i)
+            std::fill(&(w[i]->grid(begin)), &(w[i]->grid(begin)) + (end - begin), T(0));
+        }
+
+        std::vector<Worker*>* workers;
+        long begin, end;
+      };
+
+
+      // Empty frames still count for something, so a long run of them
+      // is eventually dispatched
+      static long cost(const Frame& f) {
+        return(std::max(static_cast<long>(f.points.size()), 1L));
+      }
+
+
+      // Hands the pending frames to the workers (waiting for them to
+      // finish the previous batch first).  Each worker gets a
+      // contiguous block of frames with about the same number of
+      // points.  The blocks only depend on the frames, so the result
+      // doesn't depend on scheduling.
+      void dispatch() {
+        wait();
+
+        _pending.swap(_active);
+        _nactive = _npending;
+        long total = _pending_points;
+        _npending = 0;
+        _pending_points = 0;
+
+        uint n = _nthreads;
+        _bounds.assign(n + 1, _nactive);
+        _bounds[0] = 0;
+        uint b = 1;
+        long sum = 0;
+        for (uint k=0; k<_nactive && b<n; ++k) {
+          sum += cost(_active[k]);
+          while (b < n && sum * n >= total * b)
+            _bounds[b++] = k + 1;
+        }
+
+        {
+          boost::unique_lock<boost::mutex> lock(_mutex);
+          _busy = n;
+          ++_generation;
+        }
+        _work_cond.notify_all();
+      }
+
+
+      // Waits for the workers to finish the current batch
+      void wait() {
+        if (_threads.empty())
+          return;
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        while (_busy)
+          _done_cond.wait(lock);
+      }
+
+
+      void startThreads() {
+        _shutdown = false;
+        _busy = 0;
+        for (uint i=0; i<_nthreads; ++i)
+          _threads.push_back(new boost::thread(WorkerLoop(this, i, _generation)));
+      }
+
+
+      void stopThreads() {
+        if (_threads.empty())
+          return;
+
+        wait();
+        {
+          boost::unique_lock<boost::mutex> lock(_mutex);
+          _shutdown = true;
+        }
+        _work_cond.notify_all();
+
+        for (uint i=0; i<_threads.size(); ++i) {
+          _threads[i]->join();
+          delete _threads[i];
+        }
+        _threads.clear();
+      }
+
+
+      // Each thread gets a contiguous slab of the grid
+      void merge() {
+        uint n = _workers.size();
+        long m = _workers[0]->grid.size();
+        if (n <= 1 || m == 0)
+          return;
+
+        boost::thread_group threads;
+        long block = m / n;
+        long extra = m % n;
+        long begin = 0;
+        for (uint i=0; i<n; ++i) {
+          long end = begin + block + (i < extra ? 1 : 0);
+          if (end > begin)
+            threads.create_thread(MergeJob(&_workers, begin, end));
+          begin = end;
+        }
+        threads.join_all();
+
+        for (uint i=1; i<n; ++i) {
+          _workers[0]->out_of_bounds += _workers[i]->out_of_bounds;
+          _workers[i]->out_of_bounds = 0;
+        }
+      }
+
+
+      GridAccumulator(const GridAccumulator&);
+      GridAccumulator& operator=(const GridAccumulator&);
+
+    private:
+      uint _nthreads;
+      Kernel _kernel;
+      double _sigma, _cutoff;
+
+      loos::GCoord _gmin, _gmax;
+      DensityGridpoint _dims;
+      std::vector<Worker*> _workers;
+
+      std::vector<Frame> _pending;      // Frames being filled by addFrame()
+      uint _npending;
+      long _pending_points;
+      std::vector<Frame> _active;       // Frames being added by the workers
+      uint _nactive;
+      std::vector<uint> _bounds;        // Worker i adds frames _bounds[i] through _bounds[i+1]-1
+
+      std::vector<boost::thread*> _threads;
+      boost::mutex _mutex;
+      boost::condition_variable _work_cond, _done_cond;
+      uint _generation;
+      uint _busy;
+      bool _shutdown;
+    };
+
+
+  };
+
+};
+
+
+#endif
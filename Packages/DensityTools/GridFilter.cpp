@@ -0,0 +1,295 @@
+/*
+  Separable and FFT filtering of LOOS grids
+*/
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+
+#include <GridFilter.hpp>
+#include <Correlation.hpp>
+
+
+namespace loos {
+  namespace DensityTools {
+
+    namespace {
+
+      typedef std::complex<double>    Complex;
+
+      // Number of neighboring lines convolved together by the direct sum
+      const long lines_per_block = 64;
+
+
+      // Layout of the lines along one axis of a grid.  Element t of
+      // line c in block o is at (o * n + t) * inner + c
+      struct AxisLayout {
+        AxisLayout(const DensityGridpoint& dims, const int axis) {
+          n = dims[axis];
+          inner = 1;
+          for (int i=0; i<axis; ++i)
+            inner *= dims[i];
+          outer = 1;
+          for (int i=axis+1; i<3; ++i)
+            outer *= dims[i];
+        }
+
+        long n, inner, outer;
+      };
+
+
+      // Index into a line for element s of the padded copy, or -1 if it
+      // is beyond the edge of a grid with zero boundaries
+      long paddedIndex(const long s, const long lo, const long n, const GridBoundary boundary) {
+        long i = s + lo;
+        if (i >= 0 && i < n)
+          return(i);
+        if (boundary == ZeroBoundary)
+          return(-1);
+        i %= n;
+        return(i < 0 ? i + n : i);
+      }
+
+
+      long fftSize(const long n) {
+        long m = 1;
+        while (m < n)
+          m <<= 1;
+        return(m);
+      }
+
+
+      // Start of line l (numbering the lines with the fastest-varying
+      // index first)
+      double* lineStart(double* data, const AxisLayout& L, const long l) {
+        return(data + (l / L.inner) * L.n * L.inner + l % L.inner);
+      }
+
+
+      void directConvolve(double* data, const AxisLayout& L, const std::vector<double>& kernel,
+                          const GridBoundary boundary) {
+        long len = kernel.size();
+        long lo = -(len / 2);
+        long npad = L.n + len - 1;
+
+        std::vector<long> index(npad);
+        for (long s=0; s<npad; ++s)
+          index[s] = paddedIndex(s, lo, L.n, boundary);
+
+        long nlines = L.outer * L.inner;
+        std::vector<double> pad, out;
+        std::vector<double*> x(lines_per_block);
+
+        for (long l0=0; l0<nlines; l0 += lines_per_block) {
+          long nb = std::min(lines_per_block, nlines - l0);
+          for (long b=0; b<nb; ++b)
+            x[b] = lineStart(data, L, l0 + b);
+
+          // Padded copy of nb lines, interleaved so the sums below are
+          // over contiguous memory.  Neighboring lines along y and z
+          // are usually next to each other in the grid, so whole rows
+          // are copied at once.
+          bool contiguous = (x[nb-1] - x[0] == nb - 1);
+          pad.assign(npad * nb, 0.0);
+          for (long s=0; s<npad; ++s)
+            if (index[s] >= 0) {
+              double* p = &pad[s * nb];
+              long offset = index[s] * L.inner;
+              if (contiguous)
+                std::copy(x[0] + offset, x[0] + offset + nb, p);
+              else
+                for (long b=0; b<nb; ++b)
+                  p[b] = x[b][offset];
+            }
+
+          out.assign(L.n * nb, 0.0);
+          for (long t=0; t<L.n; ++t) {
+            double* y = &out[t * nb];
+            for (long m=0; m<len; ++m) {
+              const double* q = &pad[(t + m) * nb];
+              double w = kernel[m];
+              for (long b=0; b<nb; ++b)
+                y[b] += w * q[b];
+            }
+          }
+
+          for (long t=0; t<L.n; ++t) {
+            const double* y = &out[t * nb];
+            long offset = t * L.inner;
+            if (contiguous)
+              std::copy(y, y + nb, x[0] + offset);
+            else
+              for (long b=0; b<nb; ++b)
+                x[b][offset] = y[b];
+          }
+        }
+      }
+
+
+      // The kernel is correlated with the padded lines by multiplying
+      // by the conjugate of its transform.  Since the kernel is real,
+      // the real and imaginary parts of the packed lines don't mix.
+      void fftConvolve(double* data, const AxisLayout& L, const std::vector<double>& kernel,
+                       const GridBoundary boundary) {
+        long len = kernel.size();
+        long lo = -(len / 2);
+        long npad = L.n + len - 1;
+        long m = fftSize(npad);
+
+        std::vector<long> index(npad);
+        for (long s=0; s<npad; ++s)
+          index[s] = paddedIndex(s, lo, L.n, boundary);
+
+        std::vector<Complex> K(m, Complex(0.0, 0.0));
+        for (long i=0; i<len; ++i)
+          K[i] = Complex(kernel[i], 0.0);
+        loos::correlation::fft(K);
+        double scale = 1.0 / m;
+        for (long i=0; i<m; ++i)
+          K[i] = std::conj(K[i]) * scale;
+
+        long nlines = L.outer * L.inner;
+        std::vector<Complex> a(m);
+        for (long l=0; l<nlines; l += 2) {
+          double* x1 = lineStart(data, L, l);
+          double* x2 = (l + 1 < nlines) ? lineStart(data, L, l + 1) : 0;
+
+          std::fill(a.begin(), a.end(), Complex(0.0, 0.0));
+          for (long s=0; s<npad; ++s)
+            if (index[s] >= 0)
+              a[s] = Complex(x1[index[s] * L.inner], x2 ? x2[index[s] * L.inner] : 0.0);
+
+          loos::correlation::fft(a);
+          for (long i=0; i<m; ++i)
+            a[i] *= K[i];
+          loos::correlation::fft(a, true);
+
+          for (long t=0; t<L.n; ++t) {
+            x1[t * L.inner] = a[t].real();
+            if (x2)
+              x2[t * L.inner] = a[t].imag();
+          }
+        }
+      }
+
+
+      // Rough costs per line, in units of one multiply-add of the
+      // direct sum (each FFT handles two lines)
+      bool useFFT(const AxisLayout& L, const long len) {
+        double m = fftSize(L.n + len - 1);
+        double direct_cost = static_cast<double>(L.n) * len;
+        double fft_cost = 4.0 * m * log(m) / log(2.0);
+        return(fft_cost < direct_cost);
+      }
+
+    }
+
+
+
+    void convolveAxis(DensityGrid<double>& grid, const int axis, const std::vector<double>& kernel,
+                      const GridBoundary boundary, const GridFilterMethod method) {
+      if (axis < 0 || axis > 2)
+        throw(std::runtime_error("Grid axis must be 0, 1, or 2"));
+      if (kernel.empty())
+        throw(std::runtime_error("Cannot convolve a grid with an empty kernel"));
+      if (grid.empty())
+        return;
+
+      AxisLayout L(grid.gridDims(), axis);
+      double* data = &grid(0L);
+
+      if (method == FFTFilter || (method == AutoFilter && useFFT(L, kernel.size())))
+        fftConvolve(data, L, kernel, boundary);
+      else
+        directConvolve(data, L, kernel, boundary);
+    }
+
+
+    void separableConvolve(DensityGrid<double>& grid, const std::vector<double>& kernel,
+                           const GridBoundary boundary, const GridFilterMethod method) {
+      separableConvolve(grid, kernel, kernel, kernel, boundary, method);
+    }
+
+
+    void separableConvolve(DensityGrid<double>& grid, const std::vector<double>& xkernel,
+                           const std::vector<double>& ykernel, const std::vector<double>& zkernel,
+                           const GridBoundary boundary, const GridFilterMethod method) {
+      convolveAxis(grid, 2, zkernel, boundary, method);
+      convolveAxis(grid, 1, ykernel, boundary, method);
+      convolveAxis(grid, 0, xkernel, boundary, method);
+    }
+
+
+    std::vector<double> gaussianKernel(const double sigma, const double cutoff) {
+      if (sigma < 0.0 || cutoff < 0.0)
+        throw(std::runtime_error("Gaussian width and cutoff cannot be negative"));
+      if (sigma == 0.0)
+        return(std::vector<double>(1, 1.0));
+
+      int r = static_cast<int>(ceil(cutoff * sigma));
+      std::vector<double> kernel;
+      double sum = 0.0;
+      for (int i=-r; i<=r; ++i) {
+        double x = i / sigma;
+        double f = exp(-0.5 * x * x);
+        sum += f;
+        kernel.push_back(f);
+      }
+
+      for (uint i=0; i<kernel.size(); ++i)
+        kernel[i] /= sum;
+
+      return(kernel);
+    }
+
+
+    // The width along each axis is converted into grid units, since
+    // the resolution can differ between axes
+    void gaussianSmooth(DensityGrid<double>& grid, const double sigma, const double cutoff,
+                        const GridBoundary boundary, const GridFilterMethod method) {
+      if (!(sigma > 0.0))
+        throw(std::runtime_error("Gaussian width must be positive"));
+
+      GCoord delta = grid.gridDelta();
+      separableConvolve(grid,
+                        gaussianKernel(sigma * delta[0], cutoff),
+                        gaussianKernel(sigma * delta[1], cutoff),
+                        gaussianKernel(sigma * delta[2], cutoff),
+                        boundary, method);
+    }
+
+
+    GridBoundary parseGridBoundary(const std::string& s) {
+      if (s == "zero")
+        return(ZeroBoundary);
+      else if (s == "periodic")
+        return(PeriodicBoundary);
+
+      throw(std::runtime_error("Unknown grid boundary '" + s + "'"));
+    }
+
+  };
+};
@@ -0,0 +1,103 @@
+/*
+  Separable and FFT filtering of LOOS grids
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#if !defined(LOOS_GRID_FILTER_HPP)
+#define LOOS_GRID_FILTER_HPP
+
+#include <string>
+#include <vector>
+
+#include <DensityGrid.hpp>
+
+
+namespace loos {
+
+  namespace DensityTools {
+
+    //! How values beyond the edges of a grid are treated when filtering
+    enum GridBoundary { ZeroBoundary, PeriodicBoundary };
+
+    //! How each 1D convolution is done
+    /**
+     * AutoFilter picks whichever of the direct sum and the FFT should
+     * be faster for the size of the kernel and the grid.
+     */
+    enum GridFilterMethod { AutoFilter, DirectFilter, FFTFilter };
+
+
+    //! Convolves a grid in place along one axis (0 = x, 1 = y, 2 = z)
+    /**
+     * The new value at t is sum_m kernel[m] * grid[t + m - kernel.size()/2],
+     * i.e. the kernel is centered on its middle element.  With
+     * ZeroBoundary the grid is taken as zero beyond its edges, and with
+     * PeriodicBoundary it wraps around (a kernel wider than the grid
+     * wraps more than once).
+     *
+     * The grid is handled in blocks of lines along the axis, which are
+     * copied out (padded for the boundary), convolved, and copied back.
+     * With the direct sum, the lines in a block are interleaved so the
+     * inner loop runs across them through contiguous memory.  With the
+     * FFT, two lines are transformed at once, as the real and
+     * imaginary parts of a single complex FFT.
+     */
+    void convolveAxis(DensityGrid<double>& grid, const int axis, const std::vector<double>& kernel,
+                      const GridBoundary boundary = ZeroBoundary, const GridFilterMethod method = AutoFilter);
+
+    //! Convolves a grid in place with the same 1D kernel along each axis in turn
+    void separableConvolve(DensityGrid<double>& grid, const std::vector<double>& kernel,
+                           const GridBoundary boundary = ZeroBoundary, const GridFilterMethod method = AutoFilter);
+
+    //! Convolves a grid in place with a different 1D kernel along each axis
+    void separableConvolve(DensityGrid<double>& grid, const std::vector<double>& xkernel,
+                           const std::vector<double>& ykernel, const std::vector<double>& zkernel,
+                           const GridBoundary boundary = ZeroBoundary, const GridFilterMethod method = AutoFilter);
+
+
+    //! Normalized 1D gaussian with width \a sigma (in grid units), out to \a cutoff sigmas on either side
+    std::vector<double> gaussianKernel(const double sigma, const double cutoff = 3.0);
+
+    //! Smooths a grid in place with a 3D gaussian of width \a sigma (in real-space units, e.g. Angstroms)
+    /**
+     * The gaussian is normalized, so the total density is unchanged
+     * (except for what is lost past the edges with ZeroBoundary).
+     */
+    void gaussianSmooth(DensityGrid<double>& grid, const double sigma, const double cutoff = 3.0,
+                        const GridBoundary boundary = ZeroBoundary, const GridFilterMethod method = AutoFilter);
+
+
+    //! Converts "zero" or "periodic" into a GridBoundary (throws a std::runtime_error if unrecognized)
+    GridBoundary parseGridBoundary(const std::string& s);
+
+  };
+
+};
+
+
+
+#endif
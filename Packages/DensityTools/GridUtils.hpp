@@ -31,6 +31,7 @@
 #define LOOS_GRID_UTILS_HPP
 
 #include <DensityGrid.hpp>
+#include <ConnectedComponents.hpp>
 
 namespace loos {
 
@@ -93,7 +94,7 @@ namespace loos {
         for (int k=-1; k<=1; ++k)
           for (int j=-1; j<=1; ++j)
             for (int i=-1; i<=1; ++i) {
-              if (i == j && j == k)
+              if (i == 0 && j == 0 && k == 0)
                 continue;
               DensityGridpoint probe = point + DensityGridpoint(i, j, k);
               if (!data_grid.inRange(probe))
@@ -122,7 +123,7 @@ namespace loos {
 
     //! Find peaks in a grid given the criteria defined by the passed functor
     /**
-     * Requires a data-grid, a grid to contain the flood-filled
+     * Requires a data-grid, a grid to contain the blob
      * assignments, and a functor that determines what points in the
      * data-grid to operate on.
      *
@@ -134,30 +135,25 @@ namespace loos {
     
     template<typename T, class Functor>
     std::vector<loos::GCoord> findPeaks(const DensityGrid<T>& grid, DensityGrid<int>& blobs, const Functor& op) {
-      std::vector<loos::GCoord> peaks;
+      int nblobs = labelBlobs(grid, blobs, op);
+      std::vector<loos::GCoord> peaks(nblobs, loos::GCoord(0,0,0));
+      std::vector<double> masses(nblobs, 0.0);
 
       DensityGridpoint dims = grid.gridDims();
-
-      int id = 0;
       for (int k=0; k<dims.z(); ++k)
         for (int j=0; j<dims.y(); ++j)
           for (int i=0; i<dims.x(); ++i) {
             DensityGridpoint p (i, j, k);
-            if (!blobs(p) && op(grid(p))) {
-              std::vector<DensityGridpoint> points = floodFill(p, grid, ++id, blobs, op);
-              if (!points.empty()) {
-                loos::GCoord center(0,0,0);
-                double mass = 0.0;
-                for (std::vector<DensityGridpoint>::iterator i = points.begin(); i != points.end(); ++i) {
-                  double m = grid(*i);
-                  center += m * grid.gridToWorld(*i);
-                  mass += m;
-                }
-                center /= mass;
-                peaks.push_back(center);
-              }
+            int id = blobs(p);
+            if (id) {
+              double m = grid(p);
+              peaks[id-1] += m * grid.gridToWorld(p);
+              masses[id-1] += m;
             }
           }
+
+      for (int i=0; i<nblobs; ++i)
+        peaks[i] /= masses[i];
     
       return(peaks);
     }
@@ -36,6 +36,8 @@
 #include <DensityTools.hpp>
 #include <DensityGrid.hpp>
 #include <GridUtils.hpp>
+#include <GridFilter.hpp>
+#include <ConnectedComponents.hpp>
 
 namespace opts = loos::OptionsFramework;
 namespace po = loos::OptionsFramework::po;
@@ -45,6 +47,10 @@ using namespace loos;
 using namespace loos::DensityTools;
 
 double lower, upper;
+double smooth_sigma;
+GridBoundary boundary;
+string table_name;
+uint nthreads;
 
 // @cond TOOLS_INTERNAL
 
@@ -60,9 +66,10 @@ string fullHelpMessage(void) {
     "\n"
     "\tblobid identifies blobs by density values either in a range or above a threshold.\n"
     "An edm grid (see for example water-hist) is expected for input.\n"
-    "Blobid then uses a flood-fill to determine how many separate blobs\n"
-    "meet the threshold/range criteria.  A new grid is then written out\n"
-    "which identifies the separate blobs.\n"
+    "Blobid then determines how many separate (connected) blobs meet\n"
+    "the threshold/range criteria.  A new grid is then written out\n"
+    "which identifies the separate blobs.  A table giving the size,\n"
+    "centroid, and bounding box of each blob may also be written.\n"
     "\nEXAMPLES\n"
     "\tblobid --threshold 1 <foo.grid >foo_id.grid\n"
     "Here we include all blobs above the threshold 1.  foo_grid is a density\n"
@@ -71,6 +78,11 @@ string fullHelpMessage(void) {
     "\twater-hist --radius=15 --bulk=25 --scale=1 b2ar.pdb b2ar.dcd |\\\n"
     "\t  grid2gauss 4 2 > foo_grid\n"
     "The resulting blobs are then written to the grid \"foo_id\"\n"
+    "\n\tblobid --threshold 1 --smooth 1.5 <foo.grid >foo_id.grid\n"
+    "Here the grid is smoothed with a gaussian (sigma = 1.5 Angstroms) before\n"
+    "the blobs are found, in place of a separate gridgauss step.\n"
+    "\n\tblobid --threshold 1 --table foo_blobs.txt <foo.grid >foo_id.grid\n"
+    "As the first example, but also writes a summary of each blob to foo_blobs.txt\n"
     "\n\n";
 
   return(msg);
@@ -82,10 +94,22 @@ class ToolOptions : public opts::OptionsPackage {
     o.add_options()
       ("lower", po::value<double>(), "Sets the lower threshold for segmenting the grid")
       ("upper", po::value<double>(), "Sets the upper threshold for segmenting the grid")
-      ("threshold", po::value<double>(), "Sets the threshold for segmenting the grid.");
+      ("threshold", po::value<double>(), "Sets the threshold for segmenting the grid.")
+      ("smooth", po::value<double>(&smooth_sigma)->default_value(0.0), "Smooth the grid with a gaussian of this width (in Angstroms) first")
+      ("boundary", po::value<string>(&boundary_name)->default_value("zero"), "Boundary for smoothing (zero|periodic)")
+      ("table", po::value<string>(&table_name)->default_value(""), "Write a table of blob sizes, centroids, and bounding boxes to this file")
+      ("threads", po::value<uint>(&nthreads)->default_value(0), "Number of threads to use for labeling (0 = one per core)");
   }
 
   bool postConditions(po::variables_map& vm) {
+    try {
+      boundary = parseGridBoundary(boundary_name);
+    }
+    catch (std::runtime_error& e) {
+      cerr << "Error- " << e.what() << endl;
+      return(false);
+    }
+
     if (vm.count("threshold")) {
       lower = vm["threshold"].as<double>();
       upper = numeric_limits<double>::max();
@@ -104,47 +128,34 @@ class ToolOptions : public opts::OptionsPackage {
   string print() const {
     ostringstream oss;
 
-    oss << boost::format("lower=%f, upper=%f") % lower % upper;
+    oss << boost::format("lower=%f, upper=%f, smooth=%f, boundary=%s, table='%s', threads=%d") % lower % upper % smooth_sigma % boundary_name % table_name % nthreads;
     return(oss.str());
   }
 
+  string boundary_name;
+
 };
 // @endcond
 
 
 
 
-int fill(const DensityGridpoint seed, const int val, DensityGrid<double>& data_grid, DensityGrid<int>& blob_grid, const double low, const double high) {
-  vector<DensityGridpoint> blob = floodFill(seed, data_grid, val, blob_grid, ThresholdRange<double>(low, high));
-  return(blob.size());
-}
-
-
-boost::tuple<int, int, int, double> findBlobs(DensityGrid<double>& data_grid, DensityGrid<int>& blob_grid, const double low, const double high) {
-  DensityGridpoint dims = data_grid.gridDims();
-
-  int id = 1;
+boost::tuple<int, int, int, double> blobStats(const vector<BlobInfo>& table) {
   int min = numeric_limits<int>::max();
   int max = numeric_limits<int>::min();
   double avg = 0.0;
 
-  for (int k=0; k<dims[2]; k++) {
-    for (int j=0; j<dims[1]; j++)
-      for (int i=0; i<dims[0]; i++) {
-	DensityGridpoint point(i,j,k);
-	if (blob_grid(point) == 0 && (data_grid(point) >= low && data_grid(point) <= high)) {
-	  int n = fill(point, id++, data_grid, blob_grid, low, high);
-	  if (n < min)
-	    min = n;
-	  if (n > max)
-	    max = n;
-	  avg += n;
-	}
-      }
+  for (vector<BlobInfo>::const_iterator i = table.begin(); i != table.end(); ++i) {
+    int n = i->voxels;
+    if (n < min)
+      min = n;
+    if (n > max)
+      max = n;
+    avg += n;
   }
 
-  avg /= (id-1);
-  boost::tuple<int, int, int, double> res(id-1, min, max, avg);
+  avg /= table.size();
+  boost::tuple<int, int, int, double> res(table.size(), min, max, avg);
   return(res);
 }
 
@@ -166,15 +177,29 @@ int main(int argc, char *argv[]) {
   cin >> data;
 
   cerr << "Read in grid with size " << data.gridDims() << endl;
+  if (smooth_sigma > 0.0)
+    gaussianSmooth(data, smooth_sigma, 3.0, boundary);
 
   DensityGrid<int> blobs(data.minCoord(), data.maxCoord(), data.gridDims());
-  boost::tuple<int, int, int, double> stats = findBlobs(data, blobs, lower, upper);
+  labelBlobs(data, blobs, ThresholdRange<double>(lower, upper), nthreads);
+  vector<BlobInfo> table = blobTable(blobs);
+  boost::tuple<int, int, int, double> stats = blobStats(table);
   cerr << boost::format("Found %d blobs in range %6.4g to %6.4g\n") % boost::get<0>(stats) % lower % upper;
   cerr << boost::format("Min blob size = %d, max blob size = %d, avg blob size = %6.4f\n")
     % boost::get<1>(stats)
     % boost::get<2>(stats)
     % boost::get<3>(stats);
 
+  if (!table_name.empty()) {
+    ofstream ofs(table_name.c_str());
+    if (!ofs) {
+      cerr << "Error- cannot open " << table_name << " for writing\n";
+      exit(-1);
+    }
+
+    GCoord delta = data.gridDelta();
+    writeBlobTable(ofs, table, header, 1.0 / (delta[0] * delta[1] * delta[2]));
+  }
 
   cout << blobs;
 }
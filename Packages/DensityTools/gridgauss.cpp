@@ -31,6 +31,7 @@
 #include <boost/format.hpp>
 #include <DensityGrid.hpp>
 #include <GridUtils.hpp>
+#include <GridFilter.hpp>
 
 using namespace std;
 using namespace loos;
@@ -39,15 +40,17 @@ using namespace loos::DensityTools;
 
 int main(int argc, char *argv[]) {
 
-  if (argc != 5) {
+  if (argc != 5 && argc != 6) {
     cerr << 
       "DESCRIPTION\n\tApply a gaussian kernel convolution with a grid\n"
-      "\nUSAGE\n\tgridgauss width size scaling sigma <grid >output\n"
+      "\nUSAGE\n\tgridgauss width size scaling sigma [zero|periodic] <grid >output\n"
       "Width controls the size (in grid units) of the kernel.  Size\n"
       "determines how the gaussian is mapped onto the kernel, i.e.\n"
       "-size <= x < size.  The gaussian is f(x) = exp(-0.5*(x/sigma)^2)\n"
       "and is normalized so the sum of f(x) is one, then multiplied by\n"
       "the scaling factor.\n"
+      "The grid is taken to be zero beyond its edges, unless 'periodic' is\n"
+      "given, in which case it wraps around.  Wide kernels are applied by FFT.\n"
       "\nEXAMPLES\n\tgridgauss 10 3 1 1 <foo.grid >foo_smoothed.grid\n"
       "This convolves the grid with a 10x10 kernel with sigma=1, and is a good\n"
       "starting point for smoothing out water density grid.\n";
@@ -61,6 +64,16 @@ int main(int argc, char *argv[]) {
   double scaling = strtod(argv[k++], 0);
   double normalization = strtod(argv[k++], 0);
   double sigma = strtod(argv[k++], 0);
+  GridBoundary boundary = ZeroBoundary;
+  if (argc == 6) {
+    try {
+      boundary = parseGridBoundary(argv[k++]);
+    }
+    catch (std::runtime_error& e) {
+      cerr << "Error- " << e.what() << endl;
+      exit(-1);
+    }
+  }
 
 
   vector<double> kernel;
@@ -85,7 +98,7 @@ int main(int argc, char *argv[]) {
 
   DensityGrid<double> grid;
   cin >> grid;
-  gridConvolve(grid, kernel);
+  separableConvolve(grid, kernel, boundary);
 
   grid.addMetadata(hdr);
   cout << grid;
@@ -88,19 +88,7 @@ namespace loos {
 
     vector<int> WaterFilterRadius::filter(const AtomicGroup& solv, const AtomicGroup& prot) {
       bdd_ = boundingBox(prot);
-      vector<int> result(solv.size());
-
-      double r2 = radius_ * radius_;
-      for (uint j=0; j<solv.size(); ++j) {
-        GCoord sc = solv[j]->coords();
-        for (uint i=0; i<prot.size(); ++i)
-          if (sc.distance2(prot[i]->coords()) <= r2) {
-            result[j] = 1;
-            break;
-          }
-      }
-      
-      return(result);
+      return(batch::anyWithinCutoff(PackedCoords(solv), PackedCoords(prot), radius_));
     }
 
 
@@ -120,6 +108,15 @@ namespace loos {
 
 
     // --------------------------------------------------------------------------------
+    namespace {
+      struct ContactCounter {
+	ContactCounter() : count(0) { }
+	void operator()(const uint, const double) { ++count; }
+	uint count;
+      };
+    }
+
+
     string WaterFilterContacts::name(void) const {
       stringstream s;
       s << boost::format("WaterFilterContacts(radius=%f,contacts=%u)") % radius_ % threshold_;
@@ -131,18 +128,18 @@ namespace loos {
       bdd_ = boundingBox(prot);
       vector<int> result(solv.size());
 
-      double r2 = radius_ * radius_;
+      // Only the protein atoms near each solvent are checked
+      vector<GCoord> coords(prot.size());
+      for (uint i=0; i<prot.size(); ++i)
+	coords[i] = prot[i]->coords();
+      cells_.build(coords);
+
+      ContactCounter counter;
       for (uint j=0; j<solv.size(); ++j) {
-	uint count = 0;
-	for (uint i=0; i<prot.size(); ++i) {
-	  if (solv[j]->coords().distance2(prot[i]->coords()) <= r2) {
-	    ++count;
-	    if (count >= threshold_) {
-	      result[j] = 1;
-	      break;
-	    }
-	  }
-	}
+	counter.count = 0;
+	cells_.forEachNeighbor(solv[j]->coords(), counter);
+	if (counter.count > 0 && counter.count >= threshold_)
+	  result[j] = 1;
       }
 
       return(result);
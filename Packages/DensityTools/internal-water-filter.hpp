@@ -121,7 +121,7 @@ namespace loos {
      */
     class WaterFilterContacts : public WaterFilterBase {
     public:
-      WaterFilterContacts(const double radius, const uint mincontacts) : radius_(radius), threshold_(mincontacts) { }
+      WaterFilterContacts(const double radius, const uint mincontacts) : radius_(radius), threshold_(mincontacts), cells_(radius) { }
       virtual ~WaterFilterContacts() { }
 
       virtual std::vector<int> filter(const loos::AtomicGroup&, const loos::AtomicGroup&);
@@ -133,6 +133,7 @@ namespace loos {
     private:
       double radius_;
       uint threshold_;
+      loos::CellList cells_;      // Protein atoms, rebuilt for each filter() call
     };
 
 
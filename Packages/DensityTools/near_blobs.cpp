@@ -32,6 +32,7 @@
 
 #include <DensityGrid.hpp>
 #include <DensityTools.hpp>
+#include <ConnectedComponents.hpp>
 
 using namespace std;
 using namespace loos;
@@ -44,15 +45,11 @@ typedef vector<AtomicGroup>    vGroup;
 
 
 
-vvCoords separateBlobs(const DensityGrid<int>& grid) {
+vvCoords separateBlobs(const DensityGrid<int>& grid, const vector<BlobInfo>& table) {
 
-  int max_blobid = 0;
-
-  for (long i = 0; i < grid.size(); ++i)
-    if (grid(i) > max_blobid)
-      max_blobid = grid(i);
-
-  vvCoords blobs(max_blobid);
+  vvCoords blobs(table.size());
+  for (uint i=0; i<table.size(); ++i)
+    blobs[i].reserve(table[i].voxels);
 
   DensityGridpoint dims = grid.gridDims();
   for (int k=0; k<dims.z(); ++k)
@@ -70,8 +67,25 @@ vvCoords separateBlobs(const DensityGrid<int>& grid) {
 }
 
 
+// Squared distance from c to the closest point of a blob's bounding box (in real-space)
+double boxDistance2(const GCoord& c, const GCoord& lo, const GCoord& hi) {
+  double d2 = 0.0;
+  for (int i=0; i<3; ++i) {
+    double d = 0.0;
+    if (c[i] < lo[i])
+      d = lo[i] - c[i];
+    else if (c[i] > hi[i])
+      d = c[i] - hi[i];
+    d2 += d * d;
+  }
+  return(d2);
+}
 
-vector<uint> findBlobsNearResidue(const vvCoords& blobs, const AtomicGroup& residue, const double dist) {
+
+// Blobs whose bounding boxes are too far from every atom are skipped
+// without looking at their grid points
+vector<uint> findBlobsNearResidue(const vvCoords& blobs, const vCoords& lo, const vCoords& hi,
+                                  const AtomicGroup& residue, const double dist) {
   vector<uint> blobids;
 
   double d2 = dist * dist;
@@ -80,6 +94,8 @@ vector<uint> findBlobsNearResidue(const vvCoords& blobs, const AtomicGroup& resi
 
     for (uint j=0; j<residue.size() && flag; ++j) {
       GCoord c = residue[j]->coords();
+      if (blobs[k].empty() || boxDistance2(c, lo[k], hi[k]) > d2)
+        continue;
 
       for (uint i=0; i<blobs[k].size() && flag; ++i)
         if (c.distance2(blobs[k][i]) <= d2)
@@ -116,13 +132,25 @@ int main(int argc, char *argv[]) {
   DensityGrid<int> the_grid;
   cin >> the_grid;
 
-  vvCoords blobs = separateBlobs(the_grid);
+  vector<BlobInfo> table = blobTable(the_grid);
+  vvCoords blobs = separateBlobs(the_grid, table);
+  vCoords lo, hi;
+  for (uint i=0; i<table.size(); ++i) {
+    GCoord a = the_grid.gridToWorld(table[i].bmin);
+    GCoord b = the_grid.gridToWorld(table[i].bmax);
+    for (int j=0; j<3; ++j)
+      if (a[j] > b[j])
+        swap(a[j], b[j]);
+    lo.push_back(a);
+    hi.push_back(b);
+  }
+
   vGroup residues = subset.splitByResidue();
 
   cout << "# " << hdr << endl;
   cout << "# Atomid Resid Resname Segid Bloblist...\n";
   for (uint i=0; i<residues.size(); ++i) {
-    vector<uint> ids = findBlobsNearResidue(blobs, residues[i], distance);
+    vector<uint> ids = findBlobsNearResidue(blobs, lo, hi, residues[i], distance);
     if (ids.size() == 0)
       continue;
     cout << boost::format("%d\t%d\t%s\t%s\t")
@@ -32,6 +32,7 @@
 #include <loos.hpp>
 #include <DensityGrid.hpp>
 #include <GridUtils.hpp>
+#include <GridFilter.hpp>
 
 using namespace std;
 using namespace loos;
@@ -39,9 +40,9 @@ using namespace loos::DensityTools;
 
 
 int main(int argc, char *argv[]) {
-  if (argc != 2) {
+  if (argc < 2 || argc > 4) {
     cerr <<
-      "Usage- peakify threshold <foo.grid >peaks.pdb\n"
+      "Usage- peakify threshold [sigma [zero|periodic]] <foo.grid >peaks.pdb\n"
       "\n"
       "Given a double-precision floating point grid of density values\n"
       "and a threshold, this tool writes out a PDB representing the density\n"
@@ -49,17 +50,32 @@ int main(int argc, char *argv[]) {
       "unique blobs of density.  For each blob, the center of mass becomes a\n"
       "pseudo-atom in the output PDB (with atom name \"UNK\" and residue name \"GRD\").\n"
       "Note that these are really blob centers, as opposed to the point of maximum\n"
-      "density within a blob.\n";
+      "density within a blob.\n"
+      "If sigma is given, the grid is first smoothed with a gaussian of that width\n"
+      "(in Angstroms), treating the grid as zero beyond its edges unless 'periodic'\n"
+      "is given.\n";
     exit(-1);
   }
 
   double thresh = strtod(argv[1], 0);
+  double sigma = (argc > 2) ? strtod(argv[2], 0) : 0.0;
+  GridBoundary boundary = ZeroBoundary;
+  try {
+    if (argc > 3)
+      boundary = parseGridBoundary(argv[3]);
+  }
+  catch (std::runtime_error& e) {
+    cerr << "Error- " << e.what() << endl;
+    exit(-1);
+  }
 
   string hdr = invocationHeader(argc, argv);
   DensityGrid<double> grid;
   cin >> grid;
 
   cerr << "Read in grid " << grid.gridDims() << "\n";
+  if (sigma > 0.0)
+    gaussianSmooth(grid, sigma, 3.0, boundary);
 
   DensityGrid<int> blobs(grid.minCoord(), grid.maxCoord(), grid.gridDims());
 
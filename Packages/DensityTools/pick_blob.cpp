@@ -33,6 +33,7 @@
 #include <limits>
 
 #include <DensityGrid.hpp>
+#include <ConnectedComponents.hpp>
 
 using namespace std;
 using namespace loos;
@@ -167,19 +168,11 @@ void zapGrid(DensityGrid<int>& grid, const vector<int>& vals) {
 }
 
 
-int maxBlobId(const DensityGrid<int>& grid) {
-  DensityGridpoint dims = grid.gridDims();
-  long k = dims[0] * dims[1] * dims[2];
-  int maxid = 0;
-
-  for (long i=0; i<k; i++)
-    if (grid(i) > maxid)
-      maxid = grid(i);
-
-  return(maxid);
-}
-
-
+// Only the points whose distance to a blob's bounding box is no more
+// than the farthest any one of them can be from the box need to be
+// checked against that blob's grid points.  Only the points in each
+// box are scanned, in the same order as the whole grid would be, so
+// ties are broken the same way.
 vector<Blob> pickBlob(const DensityGrid<int>& grid, const vector<GCoord>& points) {
   vector<DensityGridpoint> gridded;
   vector<GCoord>::const_iterator ci;
@@ -187,35 +180,56 @@ vector<Blob> pickBlob(const DensityGrid<int>& grid, const vector<GCoord>& points
   for (ci = points.begin(); ci != points.end(); ++ci)
     gridded.push_back(grid.gridpoint(*ci));
 
-  int maxid = maxBlobId(grid);
+  vector<BlobInfo> table = blobTable(grid);
+  int maxid = table.size();
 
   if (debug >= 1)
     cerr << boost::format("Found %d total blobs in grid.\n") % maxid;
   
   vector<Blob> blobs(maxid+1, Blob());
 
-  DensityGridpoint dims = grid.gridDims();
-  for (int k=0; k<dims[2]; k++)
-    for (int j=0; j<dims[1]; j++)
-      for (int i=0; i<dims[0]; i++) {
-	DensityGridpoint point(i,j,k);
-	int id = grid(point);
-	if (!id)
-	  continue;
-
-	vector<DensityGridpoint>::iterator cj;
-	for (cj = gridded.begin(); cj != gridded.end(); ++cj) {
-	  double d = point.distance2(*cj);
-	  if (d < blobs[id].grid_dist) {
-	    blobs[id].id = id;
-	    blobs[id].grid_dist = d;
-	    blobs[id].closest_point = point;
-	    GCoord a = grid.gridToWorld(point);
-	    GCoord b = grid.gridToWorld(*cj);
-	    blobs[id].real_dist = a.distance2(b);
-	  }
-	}
+  vector<DensityGridpoint> candidates;
+  for (vector<BlobInfo>::const_iterator bi = table.begin(); bi != table.end(); ++bi) {
+    if (!bi->voxels)
+      continue;
+
+    double bound = numeric_limits<double>::max();
+    for (vector<DensityGridpoint>::iterator cj = gridded.begin(); cj != gridded.end(); ++cj) {
+      double far = 0.0;
+      for (int n=0; n<3; ++n) {
+        double d = max(abs((*cj)[n] - bi->bmin[n]), abs((*cj)[n] - bi->bmax[n]));
+        far += d * d;
       }
+      bound = min(bound, far);
+    }
+
+    candidates.clear();
+    for (vector<DensityGridpoint>::iterator cj = gridded.begin(); cj != gridded.end(); ++cj)
+      if (boundingBoxDistance2(*bi, *cj) <= bound)
+        candidates.push_back(*cj);
+
+    int id = bi->id;
+    for (int k=bi->bmin[2]; k<=bi->bmax[2]; k++)
+      for (int j=bi->bmin[1]; j<=bi->bmax[1]; j++)
+        for (int i=bi->bmin[0]; i<=bi->bmax[0]; i++) {
+          DensityGridpoint point(i,j,k);
+          if (grid(point) != id)
+            continue;
+
+          vector<DensityGridpoint>::iterator cj;
+          for (cj = candidates.begin(); cj != candidates.end(); ++cj) {
+            double d = point.distance2(*cj);
+            if (d < blobs[id].grid_dist) {
+              blobs[id].id = id;
+              blobs[id].grid_dist = d;
+              blobs[id].closest_point = point;
+              GCoord a = grid.gridToWorld(point);
+              GCoord b = grid.gridToWorld(*cj);
+              blobs[id].real_dist = a.distance2(b);
+            }
+          }
+        }
+  }
 
   if (debug > 1) {
     cerr << "* DEBUG: Blob list dump *\n";
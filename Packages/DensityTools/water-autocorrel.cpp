@@ -41,9 +41,8 @@ int main(int argc, char *argv[]) {
   if (k != argc)
     max_t = strtoul(argv[k++], 0, 10);
   
-  Math::Matrix<int> M;
   cerr << "Reading matrix...\n";
-  readAsciiMatrix(matname, M);
+  OccupancyMatrix M = readOccupancyMatrix(matname);
   uint m = M.rows();
   uint n = M.cols();
 
@@ -52,23 +51,20 @@ int main(int argc, char *argv[]) {
 
   cerr << boost::format("Water matrix is %d x %d\n") % m % n;
   cerr << "Processing- ";
-  vector< TimeSeries<double> > waters;
+  vector< TimeSeries<double> > series;
   for (uint j=0; j<m; ++j) {
     if (j % 250 == 0)
       cerr << '.';
 
+    if (M.count(j) == 0)
+      continue;
+
     vector<double> tmp(n, 0);
-    bool flag = false;
-    for (uint i=0; i<n; ++i) {
+    for (uint i=0; i<n; ++i)
       tmp[i] = M(j, i);
-      if (tmp[i])
-	flag = true;
-    }
-    if (flag) {
-      TimeSeries<double> wtmp(tmp);
-      waters.push_back(wtmp.correl(max_t));
-    }
+    series.push_back(TimeSeries<double>(tmp));
   }
+  vector< TimeSeries<double> > waters = TimeSeries<double>::batch_correl(series, max_t);
 
   uint nwaters = waters.size();
   cerr << boost::format(" done\nFound %d unique waters inside\n") % nwaters;
@@ -59,12 +59,15 @@ int main(int argc, char *argv[]) {
 
   string prefix(argv[1]);
 
+  // water-inside writes either prefix.asc and prefix.vol, or
+  // prefix.lmat and prefix_vol.lmat
+  string matname = findMatrixFile(prefix);
+  bool binary = (matname != prefix + ".asc");
+
   Math::Matrix<double> V;
-  readAsciiMatrix(prefix + ".vol", V);
+  readMatrix(binary ? prefix + "_vol.lmat" : prefix + ".vol", V);
 
-  Math::Matrix<int> M;
-  readAsciiMatrix(prefix + ".asc", M);
-  uint m = M.rows();
+  OccupancyMatrix M = readOccupancyMatrix(matname);
   uint n = M.cols();
 
   if (V.rows() != M.cols()) {
@@ -74,10 +77,7 @@ int main(int argc, char *argv[]) {
 
   cout << "# " << hdr << endl;
   cout << "# frame\tcount\tvolume\n";
-  for (uint i=0; i<n; ++i) {
-    long cnt = 0;
-    for (uint j=0; j<m; ++j)
-      cnt += M(j,i);
-    cout << i << "\t" << cnt << "\t" << V(i,0) << endl;
-  }
+  vector<uint> counts = M.columnCounts();
+  for (uint i=0; i<n; ++i)
+    cout << i << "\t" << counts[i] << "\t" << V(i,0) << endl;
 }
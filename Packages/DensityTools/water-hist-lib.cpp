@@ -153,7 +153,7 @@ namespace loos {
       for (int i=0; i<3; ++i)
         dims[i] = static_cast<int>(floor(gridsize[i] + 0.5));
       
-      grid_.resize(min, max, dims);
+      accum_.resize(min, max, dims);
     }
 
 
@@ -179,15 +179,12 @@ namespace loos {
     
       void WaterHistogrammer::accumulate(const double density) {
         std::vector<int> picks = the_filter->filter(water_, protein_);
+        std::vector<GCoord> points;
         for (uint i = 0; i<picks.size(); ++i)
-          if (picks[i]) {
-            GCoord c = water_[i]->coords();
+          if (picks[i])
+            points.push_back(water_[i]->coords());
 
-            if (!grid_.inRange(grid_.gridpoint(c)))
-              ++out_of_bounds;
-            else
-              grid_(c) += density;
-          }
+        accum_.addFrame(points, density);
         (*estimator_)(density);
       }
 
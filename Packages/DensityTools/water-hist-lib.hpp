@@ -32,6 +32,7 @@
 #include <iostream>
 
 #include <DensityGrid.hpp>
+#include <GridAccumulator.hpp>
 #include <GridUtils.hpp>
 #include <water-lib.hpp>
 #include <internal-water-filter.hpp>
@@ -138,20 +139,35 @@ namespace loos {
 
 
 
+    //! Histograms the filtered waters from a trajectory
+    /**
+     * Frames are read and filtered in order, but the waters that pass
+     * the filter are gridded by a GridAccumulator, which can spread
+     * them over threads and use a smoother kernel than the nearest
+     * grid point.
+     */
     class WaterHistogrammer {
     public:
       WaterHistogrammer(const AtomicGroup& protein, const AtomicGroup& water, BulkEstimator* est, WaterFilterBase* filter) :
-        protein_(protein), water_(water), estimator_(est), the_filter(filter), out_of_bounds(0) { }
+        protein_(protein), water_(water), estimator_(est), the_filter(filter) { }
 
-      void clear() { grid_.clear(); out_of_bounds = 0; }
+      void clear() { accum_.clear(); }
+
+      //! Number of threads to grid with (0 = one per core)
+      void threads(const uint n) { accum_.threads(n); }
+
+      //! Kernel used to grid each water (see GridAccumulator::kernel())
+      void kernel(const GridAccumulator<double>::Kernel k, const double sigma = 1.0, const double cutoff = 3.0) {
+        accum_.kernel(k, sigma, cutoff);
+      }
 
       void setGrid(const GCoord& min, const GCoord& max, const double resolution);
       void setGrid(pTraj& traj, const std::vector<uint>& frames, const double resolution, const double pad = 0.0);
 
       void accumulate(const double density);
       void accumulate(pTraj& traj, const std::vector<uint>& frames);
-      DensityGrid<double> grid() const { return(grid_); }
-      long outOfBounds() const { return(out_of_bounds); }
+      DensityGrid<double> grid() { return(accum_.grid()); }
+      long outOfBounds() { return(accum_.outOfBounds()); }
 
 
 
@@ -159,8 +175,7 @@ namespace loos {
       AtomicGroup protein_, water_;
       BulkEstimator* estimator_;
       WaterFilterBase* the_filter;
-      long out_of_bounds;
-      DensityGrid<double> grid_;
+      GridAccumulator<double> accum_;
     };
 
 
@@ -88,7 +88,10 @@ string fullHelpMessage(void) {
     "multiple grid-points based on the grid resolution and water radius,\n"
     "only one grid point will be used.  For visualization then, the\n"
     "grid should be smoothed out.  This can be done via the \"gridgauss\"\n"
-    "tool which convolves the grid with a gaussian kernel.  Finally,\n"
+    "tool which convolves the grid with a gaussian kernel.  Alternatively,\n"
+    "each atom can be spread over the neighboring grid points as it is\n"
+    "added, either by linear interpolation (--kernel=trilinear) or with a\n"
+    "gaussian (--kernel=gaussian --sigma=1).  Finally,\n"
     "the grid needs to be converted to an X-Plor electron density format\n"
     "using \"grid2xplor\".  This can then be read into PyMol, VMD, or other\n"
     "visualization tools.\n"
@@ -120,6 +123,10 @@ string fullHelpMessage(void) {
     "\t  grid2xplor >b2ar_water.xplor\n"
     "Higher resolution grid, converted to Xplor EDM.\n"
     "\n"
+    "\twater-hist --threads=8 --kernel=gaussian --sigma=1.5 b2ar.pdb b2ar.dcd |\\\n"
+    "\t  grid2xplor >b2ar_water.xplor\n"
+    "Each water is spread out with a gaussian as it is added, using 8 threads.\n"
+    "\n"
     "\twater-hist --prot='resname == \"PEGL\"' --water='resname === \"PEGL\"'\\\n"
     "\t  --mode=box membrane.pdb membrane.dcd >membrane.grid\n"
     "All lipid head-group density, written as LOOS grid.\n"
@@ -151,7 +158,11 @@ public:
     count_empty_voxels(false),
     rescale_density(false),
     bulk_zclip(0.0),
-    bulk_zmin(0.0), bulk_zmax(0.0)
+    bulk_zmin(0.0), bulk_zmax(0.0),
+    nthreads(1),
+    kernel_name("nearest"),
+    sigma(1.0),
+    kernel(GridAccumulator<double>::Nearest)
   { }
 
   void addGeneric(po::options_description& opts) {
@@ -161,11 +172,26 @@ public:
       ("bulk", po::value<double>(&bulk_zclip)->default_value(bulk_zclip), "Bulk water is defined as |Z| >= k")
       ("brange", po::value<string>(), "Bulk water (--brange a,b) is defined as a <= z < b")
       ("scale", po::value<bool>(&rescale_density)->default_value(rescale_density), "Scale density by bulk estimate")
-      ("clamp", po::value<string>(), "Clamp the bounding box [(x,y,z),(x,y,z)]");
+      ("clamp", po::value<string>(), "Clamp the bounding box [(x,y,z),(x,y,z)]")
+      ("threads", po::value<uint>(&nthreads)->default_value(nthreads), "Number of threads to use for gridding (0=all available; only helps with the trilinear and gaussian kernels)")
+      ("kernel", po::value<string>(&kernel_name)->default_value(kernel_name), "How to add each atom to the grid (nearest|trilinear|gaussian)")
+      ("sigma", po::value<double>(&sigma)->default_value(sigma), "Width of the gaussian kernel (in Angstroms)");
   }
 
 
   bool postConditions(po::variables_map& map) {
+    try {
+      kernel = GridAccumulator<double>::parseKernel(kernel_name);
+    }
+    catch (std::runtime_error& e) {
+      cerr << "Error- " << e.what() << endl;
+      return(false);
+    }
+    if (kernel == GridAccumulator<double>::Gaussian && !(sigma > 0.0)) {
+      cerr << "Error- sigma must be positive\n";
+      return(false);
+    }
+
     if (map.count("clamp")) {
       GCoord clamp_min, clamp_max;
       string s = map["clamp"].as<string>();
@@ -213,13 +239,16 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("gridres=%f, empty=%d, bulk_zclip=%d, scale=%d, bulk_zmin=%d, bulk_zmax=%d")
+    oss << boost::format("gridres=%f, empty=%d, bulk_zclip=%d, scale=%d, bulk_zmin=%d, bulk_zmax=%d, threads=%d, kernel=%s, sigma=%f")
       % grid_resolution
       % count_empty_voxels
       % bulk_zclip
       % rescale_density
       % bulk_zmin
-      % bulk_zmax;
+      % bulk_zmax
+      % nthreads
+      % kernel_name
+      % sigma;
 
     if (!clamped_box.empty())
       oss << boost::format(", clamp=[%s,%s]")
@@ -236,6 +265,10 @@ public:
   double bulk_zclip;
   double bulk_zmin, bulk_zmax;
   vector<GCoord> clamped_box;
+  uint nthreads;
+  string kernel_name;
+  double sigma;
+  GridAccumulator<double>::Kernel kernel;
 };
 
 // @endcond
@@ -298,6 +331,8 @@ int main(int argc, char *argv[]) {
   cerr << *est << endl;
 
   WaterHistogrammer wh(protein, water, est, watopts->filter_func);
+  wh.threads(xopts->nthreads);
+  wh.kernel(xopts->kernel, xopts->sigma);
   if (!xopts->clamped_box.empty()) {
     wh.setGrid(xopts->clamped_box[0]-watopts->pad, xopts->clamped_box[1]+watopts->pad, xopts->grid_resolution);
   } else
@@ -37,7 +37,6 @@ using namespace loos::DensityTools;
 
 
 
-typedef Math::Matrix<int, Math::ColMajor>    Matrix;
 
 
 string fullHelpMessage(void) {
@@ -73,6 +72,10 @@ string fullHelpMessage(void) {
     "NOTES\n"
     "\tLOOS does not care what is called a protein or water.  You can use any selection,\n"
     "for example, to track ligands, or lipids, etc.\n"
+    "\tWith --binary=1, the matrices are written in binary as 'water.lmat' and\n"
+    "'water_vol.lmat' instead.  water-count will find either.  The binary water\n"
+    "matrix is stored with one bit per element, so it is 32 times smaller than\n"
+    "a regular binary matrix.\n"
     "\n"
     "SEE ALSO\n"
     "\twater-hist\n"
@@ -104,9 +107,10 @@ int main(int argc, char *argv[]) {
   opts::OutputPrefix* prefopts = new opts::OutputPrefix;
   opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
   opts::BasicWater* watopts = new opts::BasicWater;
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
 
   opts::AggregateOptions options;
-  options.add(basopts).add(prefopts).add(tropts).add(watopts);
+  options.add(basopts).add(prefopts).add(tropts).add(watopts).add(mopts);
   if (!options.parse(argc, argv))
     exit(-1);
 
@@ -121,7 +125,7 @@ int main(int argc, char *argv[]) {
 
   uint m = waters.size();
   uint n = traj->nframes();
-  Matrix M(m,n);
+  OccupancyMatrix M(m,n);
   Math::Matrix<double> V(n, 1);
   cerr << boost::format("Water matrix is %d x %d.\n") % m % n;
 
@@ -142,14 +146,14 @@ int main(int argc, char *argv[]) {
     }
 
     for (uint j=0; j<m; ++j)
-      M(j,i) = mask[j];
+      M.set(j, i, mask[j]);
 
     V(i,0) = watopts->filter_func->volume();
     ++i;
   }
 
   cerr << " done\n";
-  writeAsciiMatrix(prefopts->prefix + ".asc", M, hdr);
-  writeAsciiMatrix(prefopts->prefix + ".vol", V, hdr);
+  writeOccupancyMatrix(prefopts->prefix + mopts->suffix(), M, hdr, mopts->binary);
+  writeMatrix(prefopts->prefix + (mopts->binary ? "_vol.lmat" : ".vol"), V, hdr, mopts->binary);
   writeAtomIds(prefopts->prefix + ".atoms", waters, hdr);
 }
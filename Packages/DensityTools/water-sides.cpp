@@ -131,9 +131,10 @@ int main(int argc, char *argv[]) {
   opts::BasicSelection *basic_selection = new opts::BasicSelection("name == 'OH2'");
   opts::TrajectoryWithFrameIndices *basic_traj = new opts::TrajectoryWithFrameIndices;
   WaterSidesOptions *my_opts = new WaterSidesOptions;
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
 
   opts::AggregateOptions options;
-  options.add(basic_opts).add(basic_selection).add(basic_traj).add(my_opts);
+  options.add(basic_opts).add(basic_selection).add(basic_traj).add(my_opts).add(mopts);
   if (!options.parse(argc, argv)) {
     exit(0);
   }
@@ -164,5 +165,5 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  writeAsciiMatrix(cout, M, hdr);
+  writeMatrix(cout, M, hdr, mopts->binary);
 }
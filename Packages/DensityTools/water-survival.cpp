@@ -23,9 +23,8 @@ int main(int argc, char *argv[]) {
   if (k != argc)
     max_t = strtoul(argv[k++], 0, 10);
   
-  Math::Matrix<int> M;
   cerr << "Reading matrix...\n";
-  readAsciiMatrix(matname, M);
+  OccupancyMatrix M = readOccupancyMatrix(matname);
   uint m = M.rows();
   uint n = M.cols();
 
@@ -38,30 +37,10 @@ int main(int argc, char *argv[]) {
   cout << "# tau\tavg\tstdev\tsterr\n";
   
   cerr << "Processing- ";
-  
 
-  for (uint tau=0; tau<max_t; ++tau) {
-    vector<double> survivals;
-    if (tau % 100 == 0)
-      cerr << '.';
-    
-    for (uint j=0; j<m; ++j) {
-      uint inside = 0;
-      uint pairs = 0;
-      
-      for (uint t=0; t<n-tau-1; ++t)
-	if (M(j, t))
-	{
-	  ++pairs;
-	  if (M(j, t+tau))
-	    ++inside;
-	}
-      if (pairs)
-	survivals.push_back(static_cast<double>(inside) / (pairs));
-    }
-    dTimeSeries ts(survivals);
-    cout << tau << '\t' << ts.average() << '\t' << ts.stdev() << '\t' << ts.sterr() << endl;
-  }
+  correlation::SurvivalFunction sf = correlation::survival(M, max_t);
+  for (uint tau=0; tau<max_t; ++tau)
+    cout << tau << '\t' << sf.avg[tau] << '\t' << sf.stdev[tau] << '\t' << sf.sterr[tau] << endl;
   
   cerr << " Done\n";
 
@@ -38,6 +38,11 @@ namespace ENM {
 
     void solve() {
 
+      if (modes_ != 0) {
+        solveLowestModes();
+        return;
+      }
+
       if (verbosity_ > 2)
         std::cerr << "Building hessian...\n";
       buildHessian();
@@ -67,8 +72,22 @@ namespace ENM {
 
 
     //! Return the inverted hessian matrix
+    /**
+     * When only the lowest modes were computed (see modes()), this is
+     * the pseudo-inverse using just those modes.
+     */
     loos::DoubleMatrix inverseHessian() {
 
+      if (modes_ != 0 && eigenvecs_.cols() != 0) {
+        loos::DoubleMatrix Us = eigenvecs_.copy();
+        for (uint i=0; i<Us.cols(); ++i) {
+          double s = i < 6 ? 0.0 : 1.0 / eigenvals_[i];
+          for (uint j=0; j<Us.rows(); ++j)
+            Us(j, i) *= s;
+        }
+        return(loos::Math::MMMultiply(Us, eigenvecs_, false, true));
+      }
+
       if (rsv_.rows() == 0)
         throw(std::logic_error("ANM::inverseHessian() called before ANM::solve()"));
 
@@ -85,6 +104,22 @@ namespace ENM {
 
 
   private:
+
+    void solveLowestModes() {
+      if (verbosity_ > 2)
+        std::cerr << "Building sparse hessian...\n";
+
+      boost::shared_ptr<HessianOperator> H;
+      if (matrix_free_)
+        H.reset(new MatrixFreeHessian(blocker_, cutoff_));
+      else
+        H.reset(new SparseHessian(blocker_, cutoff_));
+
+      solveSparse(*H, rigidBodyModes(blocker_->nodeList()));
+      rsv_.reset();
+    }
+
+
     loos::DoubleMatrix rsv_;
 
   };
@@ -84,6 +84,10 @@ bool debug;
 string spring_desc;
 string bound_spring_desc;
 
+uint modes;
+double cutoff;
+bool matrix_free;
+
 string fullHelpMessage() {
 
   string s = 
@@ -132,6 +136,19 @@ string fullHelpMessage() {
     "--bound option.  In this case the other or \"non-bound\" spring is\n"
     "chosen with the --spring option.\n"
     "\n"
+    "\n"
+    "* Large Networks *\n"
+    "Building the full hessian and computing its SVD takes memory that\n"
+    "grows with the square, and time that grows with the cube, of the\n"
+    "number of nodes.  When only the lowest modes are needed, the --modes\n"
+    "option computes just those using a sparse hessian, where only pairs\n"
+    "of nodes within a cutoff distance are stored.  The cutoff is taken\n"
+    "from the distance spring function, but must be given with --cutoff\n"
+    "for spring functions that never reach zero (springs beyond it are\n"
+    "ignored).  The 6 zero modes are still written first.  With\n"
+    "--matrixfree, the springs are recomputed as needed rather than\n"
+    "stored, using even less memory.  The pseudo-inverse (foo_Hi.asc)\n"
+    "is not written when using --modes.\n"
     "\n\n"
     "EXAMPLES\n\n"
     "anm --selection 'resid >= 10 && resid <= 50 && name == \"CA\"' foo.pdb foo\n"
@@ -151,6 +168,10 @@ string fullHelpMessage() {
     "\tsprings with a constant stiffness of \"100\" and all other\n"
     "\tresidues are connected by springs that decay exponentially\n"
     "\twith distance\n"
+    "\n"
+    "anm --modes 20 'name == \"CA\"' capsid.pdb capsid\n"
+    "\tCompute only the lowest 20 nonzero modes of a large structure\n"
+    "\tusing a sparse hessian\n"
     "\n";
 
   return(s);
@@ -164,12 +185,25 @@ public:
     o.add_options()
       ("debug", po::value<bool>(&debug)->default_value(false), "Turn on debugging (output intermediate matrices)")
       ("spring,S", po::value<string>(&spring_desc)->default_value("distance"),"Spring function to use")
-      ("bound", po::value<string>(&bound_spring_desc), "Bound spring");
+      ("bound", po::value<string>(&bound_spring_desc), "Bound spring")
+      ("modes", po::value<uint>(&modes)->default_value(0), "Only compute the lowest modes using a sparse hessian (0 = all)")
+      ("cutoff", po::value<double>(&cutoff)->default_value(0.0), "Cutoff for the sparse hessian (0 = use the spring function's)")
+      ("matrixfree", po::value<bool>(&matrix_free)->default_value(false), "Do not store the sparse hessian");
+  }
+
+  bool postConditions(po::variables_map&) {
+    return(modes == 0 || validSparseCutoff(spring_desc, cutoff));
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("debug=%d, spring='%s', bound='%s'") % debug % spring_desc % bound_spring_desc;
+    oss << boost::format("debug=%d, spring='%s', bound='%s', modes=%d, cutoff=%f, matrixfree=%d")
+      % debug
+      % spring_desc
+      % bound_spring_desc
+      % modes
+      % cutoff
+      % matrix_free;
     return(oss.str());
   }
 };
@@ -206,8 +240,10 @@ int main(int argc, char *argv[]) {
   ToolOptions* topts = new ToolOptions;
   opts::RequiredArguments* ropts = new opts::RequiredArguments("prefix", "output-prefix");
 
+  opts::MatrixOutputOptions* matopts = new opts::MatrixOutputOptions;
+
   opts::AggregateOptions options;
-  options.add(bopts).add(sopts).add(mopts).add(topts).add(ropts);
+  options.add(bopts).add(sopts).add(mopts).add(topts).add(ropts).add(matopts);
   if (!options.parse(argc, argv))
     exit(-1);
 
@@ -254,15 +290,19 @@ int main(int argc, char *argv[]) {
   anm.prefix(prefix);
   anm.meta(header);
   anm.verbosity(verbosity);
+  anm.modes(modes);
+  anm.cutoff(cutoff);
+  anm.matrixFree(matrix_free);
 
   anm.solve();
 
 
   // Write out the LSVs (or eigenvectors)
-  writeAsciiMatrix(prefix + "_U.asc", anm.eigenvectors(), header, false);
-  writeAsciiMatrix(prefix + "_s.asc", anm.eigenvalues(), header, false);
+  writeMatrix(prefix + "_U" + matopts->suffix(), anm.eigenvectors(), header, matopts->binary);
+  writeMatrix(prefix + "_s" + matopts->suffix(), anm.eigenvalues(), header, matopts->binary);
 
-  writeAsciiMatrix(prefix + "_Hi.asc", anm.inverseHessian(), header, false);
+  if (modes == 0)
+    writeMatrix(prefix + "_Hi" + matopts->suffix(), anm.inverseHessian(), header, matopts->binary);
 
   for (vector<SuperBlock*>::iterator i = blocks.begin(); i != blocks.end(); ++i)
     delete *i;
@@ -173,10 +173,10 @@ int main(int argc, char *argv[]) {
   parseArgs(argc, argv);
 
   DoubleMatrix eigvals;
-  readAsciiMatrix(eigvals_name, eigvals);
+  readMatrix(eigvals_name, eigvals);
 
   DoubleMatrix eigvecs;
-  readAsciiMatrix(eigvecs_name, eigvecs);
+  readMatrix(eigvecs_name, eigvecs);
 
   if (modes.empty())
     for (uint i=0; i<eigvals.rows(); ++i)
@@ -76,6 +76,54 @@ namespace ENM {
   }
 
 
+  // Build the 3n x 6 matrix of rigid-body motions for a group
+  DoubleMatrix rigidBodyModes(const AtomicGroup& grp) {
+    uint n = grp.size();
+    GCoord c = grp.centroid();
+
+    DoubleMatrix R(3*n, 6);
+    for (uint i=0; i<n; ++i) {
+      GCoord u = grp[i]->coords() - c;
+      for (uint k=0; k<3; ++k)
+        R(3*i+k, k) = 1.0;
+
+      // Rotations about x, y, and z
+      R(3*i+1, 3) = -u.z();
+      R(3*i+2, 3) = u.y();
+      R(3*i, 4) = u.z();
+      R(3*i+2, 4) = -u.x();
+      R(3*i, 5) = -u.y();
+      R(3*i+1, 5) = u.x();
+    }
+
+    return(R);
+  }
+
+
+  bool validSparseCutoff(const string& spring_desc, const double cutoff) {
+    if (cutoff > 0.0)
+      return(true);
+
+    double r = 0.0;
+    try {
+      SpringFunction* spring = springFactory(spring_desc);
+      r = spring->cutoff();
+      delete spring;
+    }
+    catch(std::runtime_error& e) {
+      cerr << "Error- " << e.what() << endl;
+      return(false);
+    }
+
+    if (r <= 0.0) {
+      cerr << "Error- the spring function '" << spring_desc << "' has no cutoff, so --modes also requires --cutoff\n";
+      return(false);
+    }
+
+    return(true);
+  }
+
+
 
 
 
@@ -118,4 +166,41 @@ namespace ENM {
 
 
 
+  void ElasticNetworkModel::solveSparse(HessianOperator& H, const DoubleMatrix& nullspace, HessianOperator* M) {
+    LOBPCG solver(&H, M);
+    solver.verbosity(verbosity_);
+    solver.nullspace(nullspace);
+
+    loos::Timer<> t;
+    if (verbosity_ > 1)
+      std::cerr << "Computing lowest " << modes_ << " modes with sparse eigensolver...\n";
+    t.start();
+
+    boost::tuple<DoubleMatrix, DoubleMatrix> result = solver.solve(modes_);
+
+    t.stop();
+    if (verbosity_ > 1)
+      std::cerr << "Sparse eigensolver took " << loos::timeAsString(t.elapsed()) << " (" << solver.iterations() << " iterations)\n";
+
+    DoubleMatrix W = boost::get<0>(result);
+    DoubleMatrix Z = boost::get<1>(result);
+    const DoubleMatrix& Y = solver.nullspace();
+    uint n = Z.rows();
+    uint p = Y.cols();
+    uint k = Z.cols();
+
+    eigenvals_ = DoubleMatrix(p + k, 1);
+    eigenvecs_ = DoubleMatrix(n, p + k);
+    for (uint j=0; j<p; ++j)
+      for (uint i=0; i<n; ++i)
+        eigenvecs_(i, j) = Y(i, j);
+    for (uint j=0; j<k; ++j) {
+      eigenvals_[p+j] = W[j];
+      for (uint i=0; i<n; ++i)
+        eigenvecs_(i, p+j) = Z(i, j);
+    }
+  }
+
+
+
 };
@@ -31,6 +31,7 @@
 
 #include <loos.hpp>
 #include "hessian.hpp"
+#include "lobpcg.hpp"
 
 //! Namespace to encapsulate Elastic Network Model routines
 namespace ENM {
@@ -54,6 +55,24 @@ namespace ENM {
   //! Build the 3n x 3n diagonal mass matrix for a group
   loos::DoubleMatrix getMasses(const loos::AtomicGroup& grp);
 
+  //! Build the 3n x 6 matrix of rigid-body translations and rotations for a group
+  /**
+   * These span the zero modes of an ANM Hessian, and are used as the
+   * nullspace for the sparse eigensolver.  The columns are not
+   * normalized.
+   */
+  loos::DoubleMatrix rigidBodyModes(const loos::AtomicGroup& grp);
+
+
+  //! Checks that a sparse hessian can be built for \a spring_desc with \a cutoff
+  /**
+   * The sparse hessian needs a cutoff, either given explicitly (\a
+   * cutoff > 0) or from the spring function itself.  Problems are
+   * reported on stderr and false is returned, so this can be used
+   * directly in a tool's option checks.
+   */
+  bool validSparseCutoff(const std::string& spring_desc, const double cutoff);
+
 
   // -------------------------------------
 
@@ -72,7 +91,7 @@ namespace ENM {
      constructed, i.e. what nodes are used and how the spring function
      between them is calculated.
     */
-    ElasticNetworkModel(SuperBlock* blocker) : blocker_(blocker), name_("ENM"), prefix_(""), meta_(""), debugging_(false), verbosity_(0) { }
+    ElasticNetworkModel(SuperBlock* blocker) : blocker_(blocker), name_("ENM"), prefix_(""), meta_(""), debugging_(false), verbosity_(0), modes_(0), cutoff_(0.0), matrix_free_(false) { }
     virtual ~ElasticNetworkModel() { }
 
     // Should we allow this?
@@ -97,6 +116,25 @@ namespace ENM {
     void verbosity(const int i) { verbosity_ = i; }
     int verbosity() const { return(verbosity_); }
 
+    //! Only find the lowest \a n nonzero modes, using a sparse Hessian (0 = all modes, dense)
+    /**
+     * The dense Hessian and its decomposition take memory that grows
+     * with the square and time that grows with the cube of the number
+     * of nodes.  When only the lowest modes are needed, a SparseHessian
+     * and the LOBPCG eigensolver are used instead.  The zero modes are
+     * still included (first) in eigenvectors() and eigenvalues().
+     */
+    void modes(const uint n) { modes_ = n; }
+    uint modes() const { return(modes_); }
+
+    //! Cutoff for building the sparse Hessian (0 = use the spring function's)
+    void cutoff(const double d) { cutoff_ = d; }
+    double cutoff() const { return(cutoff_); }
+
+    //! Recompute the superblocks for every product rather than storing the sparse Hessian
+    void matrixFree(const bool b) { matrix_free_ = b; }
+    bool matrixFree() const { return(matrix_free_); }
+
     // -----------------------------------------------------
     //! Forwards to contained superblock
     SpringFunction::Params setParams(const SpringFunction::Params& v) {
@@ -131,6 +169,14 @@ namespace ENM {
      * Uses the contained SuperBlock to build a hessian
      */
     void buildHessian();
+
+    //! Find the lowest modes() nonzero eigenpairs of \a H (with respect to \a M, if given)
+    /**
+     * The (orthonormalized) \a nullspace is prepended to the
+     * eigenvectors with eigenvalues of zero, as the dense solvers
+     * return them.
+     */
+    void solveSparse(HessianOperator& H, const loos::DoubleMatrix& nullspace, HessianOperator* M = 0);
   
 
   protected:
@@ -144,6 +190,10 @@ namespace ENM {
     bool debugging_;
     int verbosity_;
 
+    uint modes_;
+    double cutoff_;
+    bool matrix_free_;
+
     loos::DoubleMatrix eigenvecs_;
     loos::DoubleMatrix eigenvals_;
 
@@ -58,6 +58,9 @@
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
 
+#include "sparse-hessian.hpp"
+#include "lobpcg.hpp"
+
 using namespace std;
 using namespace loos;
 namespace po = boost::program_options;
@@ -71,6 +74,8 @@ string selection;
 string model_name;
 string prefix;
 double cutoff;
+uint modes;
+bool binary;
 
 void fullHelp() {
   //string msg = 
@@ -97,6 +102,10 @@ void fullHelp() {
     "Notes:\n"
     "- The default selection (if none is specified) is to pick CA's\n"
     "- The output is ASCII format suitable for use with Matlab/Octave/Gnuplot\n"
+    "- With --binary, the matrices are written in binary with a .lmat suffix\n"
+    "- With --modes, only the lowest modes are computed using a sparse Kirchoff\n"
+    "  matrix, so large networks can be used.  The zero mode is still written\n"
+    "  first, but foo_K.asc, foo_V.asc, and foo_Ki.asc are not written.\n"
     //
     "\n"
     "EXAMPLES\n"
@@ -128,7 +137,9 @@ void parseOptions(int argc, char *argv[]) {
       ("help", "Produce this help message")
       ("fullhelp", "Get extended help")
       ("selection,s", po::value<string>(&selection)->default_value("name == 'CA'"), "Which atoms to use for the network")
-      ("cutoff,c", po::value<double>(&cutoff)->default_value(7.0), "Cutoff distance for node contact");
+      ("cutoff,c", po::value<double>(&cutoff)->default_value(7.0), "Cutoff distance for node contact")
+      ("modes,m", po::value<uint>(&modes)->default_value(0), "Only compute the lowest modes using a sparse matrix (0 = all)")
+      ("binary", po::value<bool>(&binary)->default_value(false), "Write matrices in binary (.lmat) format");
 
     po::options_description hidden("Hidden options");
     hidden.add_options()
@@ -154,6 +165,11 @@ void parseOptions(int argc, char *argv[]) {
         fullHelp();
       exit(-1);
     }
+
+    if (modes && cutoff <= 0.0) {
+      cerr << "Error- --modes requires a positive --cutoff\n";
+      exit(-1);
+    }
   }
   catch(exception& e) {
     cerr << "Error - " << e.what() << endl;
@@ -192,6 +208,48 @@ Matrix kirchoff(AtomicGroup& group, const double cutoff) {
 
 
 
+// Lowest modes only, using the sparse Kirchoff matrix.  The constant
+// vector is the zero mode, so it is projected out and written first.
+void lowestModes(AtomicGroup& group, const string& header) {
+  Timer<WallTimer> timer;
+  cerr << "Computing sparse Kirchoff matrix - ";
+  timer.start();
+  ENM::SparseHessian K = ENM::SparseHessian::kirchoff(group, cutoff, normalization);
+  timer.stop();
+  cerr << "done.\n" << timer << endl;
+
+  uint n = group.size();
+  Matrix ones(n, 1);
+  for (uint i=0; i<n; ++i)
+    ones[i] = 1.0;
+
+  ENM::LOBPCG solver(&K);
+  solver.nullspace(ones);
+
+  cerr << "Computing lowest " << modes << " modes - ";
+  timer.start();
+  boost::tuple<DoubleMatrix, DoubleMatrix> result = solver.solve(modes);
+  timer.stop();
+  cerr << "done.\n" << timer << endl;
+
+  Matrix W = boost::get<0>(result);
+  Matrix Z = boost::get<1>(result);
+  Matrix U(n, modes + 1);
+  Matrix S(modes + 1, 1);
+  for (uint i=0; i<n; ++i)
+    U(i, 0) = solver.nullspace()[i];
+  for (uint j=0; j<modes; ++j) {
+    S[j+1] = W[j];
+    for (uint i=0; i<n; ++i)
+      U(i, j+1) = Z(i, j);
+  }
+
+  writeMatrix(prefix + "_U" + matrixSuffix(binary), U, header, binary);
+  writeMatrix(prefix + "_s" + matrixSuffix(binary), S, header, binary);
+}
+
+
+
 int main(int argc, char *argv[]) {
 
   string header = invocationHeader(argc, argv);
@@ -201,6 +259,11 @@ int main(int argc, char *argv[]) {
   AtomicGroup subset = selectAtoms(model, selection);
 
   cout << boost::format("Selected %d atoms from %s\n") % subset.size() % model_name;
+  if (modes) {
+    lowestModes(subset, header);
+    exit(0);
+  }
+
   Timer<WallTimer> timer;
   cerr << "Computing Kirchoff matrix - ";
   timer.start();
@@ -209,7 +272,7 @@ int main(int argc, char *argv[]) {
   cerr << "done.\n" << timer << endl;
   
 
-  writeAsciiMatrix(prefix + "_K.asc", K, header);
+  writeMatrix(prefix + "_K" + matrixSuffix(binary), K, header, binary);
 
   boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> result = svd(K);
   Matrix U = boost::get<0>(result);
@@ -223,8 +286,8 @@ int main(int argc, char *argv[]) {
   reverseRows(Vt);
 
   // Write out the LSV (or eigenvectors)
-  writeAsciiMatrix(prefix + "_U.asc", U, header);
-  writeAsciiMatrix(prefix + "_s.asc", S, header);
+  writeMatrix(prefix + "_U" + matrixSuffix(binary), U, header, binary);
+  writeMatrix(prefix + "_s" + matrixSuffix(binary), S, header, binary);
 
   // Now go ahead and compute the pseudo-inverse...
 
@@ -240,5 +303,5 @@ int main(int argc, char *argv[]) {
   }
   
   Matrix Ki = MMMultiply(Vt, U, true, true);
-  writeAsciiMatrix(prefix + "_Ki.asc", Ki, header);
+  writeMatrix(prefix + "_Ki" + matrixSuffix(binary), Ki, header, binary);
 }
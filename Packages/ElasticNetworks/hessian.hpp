@@ -71,6 +71,9 @@ namespace ENM {
 
     uint size() const { return(static_cast<uint>(nodes.size())); }
 
+    //! The nodes the Hessian is built from
+    const loos::AtomicGroup& nodeList() const { return(nodes); }
+
     // ------------------------------------------------------
     //! Forwards to the contained SpringFunction...
     virtual SpringFunction::Params setParams(const SpringFunction::Params& v) {
@@ -82,6 +85,9 @@ namespace ENM {
 
     //! Forwards to the contained SpringFunction...
     virtual uint paramSize() const { return(springs->paramSize()); }
+
+    //! Distance beyond which blocks are always zero (0 = none)
+    virtual double cutoff() const { return(springs == 0 ? 0.0 : springs->cutoff()); }
     // ------------------------------------------------------
 
     //! Returns a 3x3 matrix representing a superblock in the Hessian for the two nodes
@@ -218,6 +224,9 @@ namespace ENM {
     //! Returns the aggregate parameter size
     uint paramSize() const { return(bound_spring->paramSize() + decorated->paramSize()); }
 
+    //! Bound nodes are assumed to be within the cutoff of the decorated superblock
+    double cutoff() const { return(decorated->cutoff()); }
+
   private:
     SpringFunction* bound_spring;
     loos::Math::Matrix<int> connectivity;
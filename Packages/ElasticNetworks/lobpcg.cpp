@@ -0,0 +1,299 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "lobpcg.hpp"
+
+#include <algorithm>
+
+
+using namespace std;
+using namespace loos;
+
+
+namespace ENM {
+
+  namespace {
+
+    // Concatenates the columns of A, B, and C (any of which may be empty)
+    DoubleMatrix hcat(const DoubleMatrix& A, const DoubleMatrix& B, const DoubleMatrix& C) {
+      uint m = A.rows();
+      DoubleMatrix S(m, A.cols() + B.cols() + C.cols());
+      double* p = S.get();
+      p = std::copy(A.get(), A.get() + A.size(), p);
+      p = std::copy(B.get(), B.get() + B.size(), p);
+      std::copy(C.get(), C.get() + C.size(), p);
+      return(S);
+    }
+
+
+    DoubleMatrix columns(const DoubleMatrix& A, const vector<uint>& cols) {
+      DoubleMatrix B(A.rows(), cols.size());
+      for (uint i=0; i<cols.size(); ++i)
+        std::copy(A.get() + static_cast<ulong>(cols[i]) * A.rows(), A.get() + static_cast<ulong>(cols[i] + 1) * A.rows(), B.get() + static_cast<ulong>(i) * A.rows());
+      return(B);
+    }
+
+
+    // A - B * diag(s)
+    DoubleMatrix subtractScaled(const DoubleMatrix& A, const DoubleMatrix& B, const DoubleMatrix& s) {
+      DoubleMatrix C(A.rows(), A.cols());
+      for (uint j=0; j<A.cols(); ++j)
+        for (uint i=0; i<A.rows(); ++i)
+          C(i, j) = A(i, j) - B(i, j) * s[j];
+      return(C);
+    }
+
+
+    DoubleMatrix gaussianMatrix(const uint m, const uint n) {
+      base_generator_type& rng = rng_singleton();
+      boost::normal_distribution<> rngmap(0.0, 1.0);
+      boost::variate_generator<base_generator_type&, boost::normal_distribution<> > rnd(rng, rngmap);
+
+      DoubleMatrix G(m, n);
+      for (ulong i=0; i<G.size(); ++i)
+        G[i] = rnd();
+
+      return(G);
+    }
+
+
+    // Makes the columns of S orthonormal with respect to B (with BS =
+    // B*S) using the eigendecomposition of the Gram matrix (Stathopoulos
+    // & Wu, SIAM J Sci Comput 23:2165-2182, 2002).  Directions that are
+    // numerically dependent are dropped.  AS and BS are transformed
+    // along with S, so no new products are needed.  Returns false if
+    // nothing is left.
+    bool orthonormalize(DoubleMatrix& S, DoubleMatrix& AS, DoubleMatrix& BS, const bool have_a) {
+      uint q = S.cols();
+      DoubleMatrix G = Math::MMMultiply(S, BS, true, false);
+
+      vector<double> scale(q);
+      for (uint i=0; i<q; ++i)
+        scale[i] = G(i, i) > 0.0 ? 1.0 / sqrt(G(i, i)) : 0.0;
+      for (uint j=0; j<q; ++j)
+        for (uint i=0; i<q; ++i)
+          G(i, j) = 0.5 * (G(i, j) + G(j, i)) * scale[i] * scale[j];
+
+      DoubleMatrix W = Math::eigenDecomp(G);
+      double limit = W[q-1] * 1e-10;
+      vector<uint> keep;
+      for (uint i=0; i<q; ++i)
+        if (W[i] > limit)
+          keep.push_back(i);
+      if (keep.empty())
+        return(false);
+
+      DoubleMatrix T(q, keep.size());
+      for (uint j=0; j<keep.size(); ++j) {
+        double s = 1.0 / sqrt(W[keep[j]]);
+        for (uint i=0; i<q; ++i)
+          T(i, j) = G(i, keep[j]) * scale[i] * s;
+      }
+
+      bool shared = (BS.get() == S.get());
+      S = Math::MMMultiply(S, T);
+      BS = shared ? S : Math::MMMultiply(BS, T);
+      if (have_a)
+        AS = Math::MMMultiply(AS, T);
+
+      return(true);
+    }
+
+  }
+
+
+
+  LOBPCG::LOBPCG(HessianOperator* A, HessianOperator* B) :
+    A_(A), B_(B), tolerance_(1e-6), maxiter_(1000), verbosity_(0), iterations_(0), converged_(false)
+  {
+    if (B_ != 0 && B_->size() != A_->size())
+      throw(std::runtime_error("Operators for the generalized eigenproblem have different sizes"));
+  }
+
+
+  DoubleMatrix LOBPCG::applyB(const DoubleMatrix& X) {
+    return(B_ == 0 ? X : B_->multiply(X));
+  }
+
+
+  void LOBPCG::nullspace(const DoubleMatrix& Y) {
+    if (Y.rows() != A_->size())
+      throw(std::runtime_error("Nullspace does not match the size of the Hessian"));
+
+    DoubleMatrix S = Y.copy();
+    DoubleMatrix BS = applyB(S);
+    DoubleMatrix AS;
+    if (!orthonormalize(S, AS, BS, false))
+      throw(std::runtime_error("Nullspace for the sparse eigensolver is empty"));
+
+    nullspace_ = S;
+    Bnullspace_ = BS;
+  }
+
+
+  // Projects out the nullspace
+  DoubleMatrix LOBPCG::deflate(const DoubleMatrix& X) {
+    if (nullspace_.cols() == 0)
+      return(X);
+
+    DoubleMatrix C = Math::MMMultiply(Bnullspace_, X, true, false);
+    return(X - nullspace_ * C);
+  }
+
+
+  void LOBPCG::preconditioner(const DoubleMatrix& blocks) {
+    if (blocks.rows() != A_->blockSize() || blocks.cols() != A_->size())
+      throw(std::runtime_error("Preconditioner blocks do not match the Hessian"));
+    precond_ = BlockJacobi(blocks);
+  }
+
+
+
+  boost::tuple<DoubleMatrix, DoubleMatrix> LOBPCG::solve(const uint k) {
+    uint n = A_->size();
+    uint avail = n - nullspace_.cols();
+
+    // The search space is three times the block size, so use a few
+    // extra vectors (to speed convergence of the last modes) only if
+    // there's room...
+    if (k == 0 || 3 * k > avail)
+      throw(std::runtime_error("Too many modes requested for the sparse eigensolver (use the dense solver instead)"));
+    uint m = std::min(k + std::max(k / 2, 4u), avail / 3);
+
+    if (precond_.size() == 0)
+      preconditioner(A_->diagonalBlocks());
+
+    DoubleMatrix X = deflate(gaussianMatrix(n, m));
+    DoubleMatrix AX = A_->multiply(X);
+    DoubleMatrix BX = applyB(X);
+    DoubleMatrix P, AP, BP;
+    DoubleMatrix lambda;
+    double anorm = 0.0;
+
+    converged_ = false;
+    iterations_ = 0;
+    bool first = true;
+
+    while (true) {
+      DoubleMatrix S, AS, BS;
+      if (first) {
+        S = X;
+        AS = AX;
+        BS = BX;
+      } else {
+        // Residuals for the current Ritz pairs, R = AX - BX * lambda
+        DoubleMatrix R = subtractScaled(AX, BX, lambda);
+
+        vector<uint> active;
+        uint nconv = 0;
+        double worst = 0.0;
+        for (uint j=0; j<m; ++j) {
+          double r = 0.0;
+          for (uint i=0; i<n; ++i)
+            r += R(i, j) * R(i, j);
+          r = sqrt(r) / std::max(fabs(lambda[j]), 1e-10 * anorm);
+          if (r <= tolerance_) {
+            if (j < k)
+              ++nconv;
+          } else
+            active.push_back(j);
+          if (j < k)
+            worst = std::max(worst, r);
+        }
+
+        if (verbosity_ > 2)
+          cerr << boost::format("LOBPCG iteration %d: %d of %d modes converged, largest residual %g\n") % iterations_ % nconv % k % worst;
+
+        if (nconv == k) {
+          converged_ = true;
+          break;
+        }
+        if (iterations_ >= maxiter_)
+          break;
+        ++iterations_;
+
+        DoubleMatrix W = deflate(precond_.apply(columns(R, active)));
+        DoubleMatrix AW = A_->multiply(W);
+        DoubleMatrix BW = applyB(W);
+
+        S = hcat(X, W, P);
+        AS = hcat(AX, AW, AP);
+        BS = (B_ == 0) ? S : hcat(BX, BW, BP);
+      }
+
+      // Roundoff leaves a little of the nullspace in the basis, which
+      // Rayleigh-Ritz would amplify (it has lower eigenvalues), so it
+      // is projected out every iteration.  A * nullspace is zero, so AS
+      // is unchanged.
+      if (nullspace_.cols() != 0) {
+        DoubleMatrix C = Math::MMMultiply(Bnullspace_, S, true, false);
+        S = S - nullspace_ * C;
+        BS = (B_ == 0) ? S : BS - Bnullspace_ * C;
+      }
+
+      if (!orthonormalize(S, AS, BS, true))
+        throw(std::runtime_error("Search space collapsed in the sparse eigensolver"));
+
+      // Rayleigh-Ritz: the best m vectors within the search space
+      DoubleMatrix G = Math::MMMultiply(S, AS, true, false);
+      uint q = G.rows();
+      if (q < k)
+        throw(std::runtime_error("Search space collapsed in the sparse eigensolver"));
+      for (uint j=0; j<q; ++j)
+        for (uint i=0; i<j; ++i)
+          G(i, j) = G(j, i) = 0.5 * (G(i, j) + G(j, i));
+      DoubleMatrix theta = Math::eigenDecomp(G);
+      anorm = std::max(anorm, fabs(theta[q-1]));
+
+      uint mm = std::min(m, q);
+      DoubleMatrix C = Math::submatrix(G, Math::Range(0, q), Math::Range(0, mm));
+      DoubleMatrix Xn = Math::MMMultiply(S, C);
+      DoubleMatrix AXn = Math::MMMultiply(AS, C);
+      DoubleMatrix BXn = (B_ == 0) ? Xn : Math::MMMultiply(BS, C);
+
+      // The new search direction is the part of the update outside of
+      // the old X
+      if (!first) {
+        DoubleMatrix D = Math::MMMultiply(BX, Xn, true, false);
+        P = Xn - X * D;
+        AP = AXn - AX * D;
+        BP = (B_ == 0) ? P : BXn - BX * D;
+      }
+
+      X = Xn;
+      AX = AXn;
+      BX = BXn;
+      lambda = Math::submatrix(theta, Math::Range(0, mm), Math::Range(0, 1));
+      m = mm;
+      first = false;
+    }
+
+    if (!converged_)
+      cerr << boost::format("Warning- sparse eigensolver did not converge after %d iterations\n") % iterations_;
+
+    return(boost::tuple<DoubleMatrix, DoubleMatrix>(Math::submatrix(lambda, Math::Range(0, k), Math::Range(0, 1)),
+                                                    Math::submatrix(X, Math::Range(0, n), Math::Range(0, k))));
+  }
+
+
+};
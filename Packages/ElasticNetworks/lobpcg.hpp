@@ -0,0 +1,125 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/** \addtogroup ENM
+ *@{
+ */
+
+
+#if !defined(LOOS_LOBPCG_HPP)
+#define LOOS_LOBPCG_HPP
+
+#include <loos.hpp>
+#include "sparse-hessian.hpp"
+
+
+namespace ENM {
+
+
+  //! Finds the lowest eigenpairs of a sparse (or matrix-free) Hessian
+  /**
+   * Solves H x = lambda x, or the generalized problem H x = lambda M x
+   * when a second operator is given, using the locally optimal block
+   * preconditioned conjugate gradient method (Knyazev, SIAM J Sci
+   * Comput 23:517-541, 2001).  Each iteration only needs one product of
+   * the operators with a block of vectors, so the cost scales with the
+   * number of stored blocks rather than the cube of the number of
+   * nodes.  The preconditioner inverts the diagonal blocks of H.
+   *
+   * The zero modes of an ENM (the rigid-body motions) are known in
+   * advance, so they are passed as the nullspace and projected out of
+   * the search space.  The eigenpairs returned are then the lowest
+   * \a k nonzero modes.
+   *
+   * Example:
+   * \code
+   *   SparseHessian H(blocker);
+   *   LOBPCG solver(&H);
+   *   solver.nullspace(rigidBodyModes(nodes));
+   *   boost::tuple<DoubleMatrix, DoubleMatrix> res = solver.solve(20);
+   *   DoubleMatrix eigenvalues = boost::get<0>(res);
+   *   DoubleMatrix eigenvectors = boost::get<1>(res);
+   * \endcode
+   */
+  class LOBPCG {
+  public:
+    //! Solve for the eigenpairs of \a A (with respect to \a B, if given)
+    LOBPCG(HessianOperator* A, HessianOperator* B = 0);
+
+    //! Eigenvectors will be orthogonal (with respect to B) to the columns of \a Y
+    void nullspace(const loos::DoubleMatrix& Y);
+
+    //! The orthonormalized nullspace
+    const loos::DoubleMatrix& nullspace() const { return(nullspace_); }
+
+    //! Use the inverse of these diagonal blocks (d x size()) rather than A's to precondition
+    void preconditioner(const loos::DoubleMatrix& blocks);
+
+    //! Residual norm (relative to the eigenvalue) for an eigenpair to be converged
+    void tolerance(const double d) { tolerance_ = d; }
+    double tolerance() const { return(tolerance_); }
+
+    void maxIterations(const uint n) { maxiter_ = n; }
+    uint maxIterations() const { return(maxiter_); }
+
+    void verbosity(const int i) { verbosity_ = i; }
+    int verbosity() const { return(verbosity_); }
+
+    //! Returns the lowest \a k eigenvalues (k x 1) and their eigenvectors (size() x k)
+    /**
+     * If the eigenpairs have not converged after maxIterations(), a
+     * warning is printed and the current estimates are returned.
+     */
+    boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> solve(const uint k);
+
+    //! Number of iterations taken by the last solve()
+    uint iterations() const { return(iterations_); }
+
+    //! Did all of the eigenpairs converge in the last solve()?
+    bool converged() const { return(converged_); }
+
+  private:
+    loos::DoubleMatrix applyB(const loos::DoubleMatrix& X);
+    loos::DoubleMatrix deflate(const loos::DoubleMatrix& X);
+
+  private:
+    HessianOperator* A_;
+    HessianOperator* B_;
+    double tolerance_;
+    uint maxiter_;
+    int verbosity_;
+    uint iterations_;
+    bool converged_;
+
+    loos::DoubleMatrix nullspace_, Bnullspace_;
+    BlockJacobi precond_;
+  };
+
+
+};
+
+
+#endif
+
+
+/** @} */
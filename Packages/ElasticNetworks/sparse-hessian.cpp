@@ -0,0 +1,391 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "sparse-hessian.hpp"
+
+
+using namespace std;
+using namespace loos;
+
+
+namespace ENM {
+
+  namespace {
+
+    double pairCutoff(SuperBlock* blocker, const double cutoff) {
+      double r = cutoff > 0.0 ? cutoff : blocker->cutoff();
+      if (r <= 0.0)
+        throw(std::runtime_error("The spring function has no cutoff, so one must be given to build a sparse Hessian"));
+      return(r);
+    }
+
+
+    // Cell lists are built from a plain coordinate list so that any
+    // periodic box in the model is ignored, as with the dense Hessian
+    vector<GCoord> nodeCoords(const AtomicGroup& nodes) {
+      vector<GCoord> coords(nodes.size());
+      for (uint i=0; i<nodes.size(); ++i)
+        coords[i] = nodes[i]->coords();
+      return(coords);
+    }
+
+
+    bool isZero(const DoubleMatrix& B) {
+      for (uint i=0; i<B.size(); ++i)
+        if (B[i] != 0.0)
+          return(false);
+      return(true);
+    }
+
+
+    struct ListPairs {
+      ListPairs(vector<uint>& p) : pairs(p) { }
+      void operator()(const uint i, const uint j, const double) {
+        pairs.push_back(i);
+        pairs.push_back(j);
+      }
+      vector<uint>& pairs;
+    };
+
+
+    // Inverts a d x d block (d is 1 or 3).  Singular blocks (such as for
+    // a node with no springs) fall back to the inverse of their mean
+    // diagonal, or the identity.
+    void invertBlock(const double* b, double* bi, const uint d) {
+      if (d == 1) {
+        bi[0] = b[0] > 0.0 ? 1.0 / b[0] : 1.0;
+        return;
+      }
+
+      double c[9];
+      c[0] = b[4]*b[8] - b[5]*b[7];
+      c[1] = b[2]*b[7] - b[1]*b[8];
+      c[2] = b[1]*b[5] - b[2]*b[4];
+      c[3] = b[5]*b[6] - b[3]*b[8];
+      c[4] = b[0]*b[8] - b[2]*b[6];
+      c[5] = b[2]*b[3] - b[0]*b[5];
+      c[6] = b[3]*b[7] - b[4]*b[6];
+      c[7] = b[1]*b[6] - b[0]*b[7];
+      c[8] = b[0]*b[4] - b[1]*b[3];
+
+      double det = b[0]*c[0] + b[1]*c[3] + b[2]*c[6];
+      double trace = (b[0] + b[4] + b[8]) / 3.0;
+      if (fabs(det) > 1e-8 * fabs(trace * trace * trace)) {
+        for (uint i=0; i<9; ++i)
+          bi[i] = c[i] / det;
+        return;
+      }
+
+      double s = trace > 0.0 ? 1.0 / trace : 1.0;
+      for (uint i=0; i<9; ++i)
+        bi[i] = (i % 4 == 0) ? s : 0.0;
+    }
+
+
+    // Collects the pairs of nodes with a nonzero superblock, along with
+    // the sum of the superblocks for each node (the diagonal)
+    struct CollectPairs {
+      CollectPairs(SuperBlock* b, vector<uint>& p, DoubleMatrix& d) : blocker(b), pairs(p), diagonal(d) { }
+
+      void operator()(uint i, uint j, const double) {
+        if (i > j)
+          std::swap(i, j);
+        DoubleMatrix B = blocker->block(i, j);
+        if (isZero(B))
+          return;
+
+        pairs.push_back(i);
+        pairs.push_back(j);
+        for (uint x=0; x<3; ++x)
+          for (uint y=0; y<3; ++y) {
+            diagonal(y, 3*i+x) += B(y, x);
+            diagonal(y, 3*j+x) += B(y, x);
+          }
+      }
+
+      SuperBlock* blocker;
+      vector<uint>& pairs;
+      DoubleMatrix& diagonal;
+    };
+
+  }
+
+
+  // -------------------------------------------------------------------------
+  // Storage
+
+
+  // Sizes the rows for the diagonal plus both blocks of each pair
+  void SparseHessian::allocate(const vector<uint>& pairs) {
+    vector<ulong> counts(n_, 1);
+    for (ulong p=0; p<pairs.size(); ++p)
+      ++counts[pairs[p]];
+
+    row_start_.resize(n_);
+    row_size_.assign(n_, 1);
+
+    ulong total = 0;
+    for (uint i=0; i<n_; ++i) {
+      row_start_[i] = total;
+      total += counts[i];
+    }
+
+    columns_.resize(total);
+    blocks_.assign(total * d_ * d_, 0.0);
+    for (uint i=0; i<n_; ++i)
+      columns_[row_start_[i]] = i;
+  }
+
+
+
+  // -------------------------------------------------------------------------
+  // Construction
+
+
+  SparseHessian::SparseHessian(SuperBlock* blocker, const double cutoff) : n_(blocker->size()), d_(3) {
+    CellList cells(pairCutoff(blocker, cutoff));
+    cells.build(nodeCoords(blocker->nodeList()));
+
+    vector<uint> pairs;
+    DoubleMatrix diagonal(3, 3*n_);
+    CollectPairs collector(blocker, pairs, diagonal);
+    cells.forEachPair(collector);
+    allocate(pairs);
+
+    // Off-diagonal superblocks are the negative of the SuperBlock,
+    // and the diagonal is the sum of the superblocks for the node...
+    for (ulong p=0; p<pairs.size(); p += 2) {
+      uint i = pairs[p];
+      uint j = pairs[p+1];
+      DoubleMatrix B = blocker->block(i, j);
+
+      ulong a = row_start_[i] + row_size_[i]++;
+      ulong b = row_start_[j] + row_size_[j]++;
+      columns_[a] = j;
+      columns_[b] = i;
+      for (uint k=0; k<9; ++k) {
+        blocks_[a*9 + k] = -B[k];
+        blocks_[b*9 + k] = -B[k];
+      }
+    }
+
+    for (uint i=0; i<n_; ++i)
+      for (uint k=0; k<9; ++k)
+        blocks_[row_start_[i]*9 + k] = diagonal[i*9 + k];
+  }
+
+
+  SparseHessian SparseHessian::kirchoff(const AtomicGroup& nodes, const double cutoff, const double normalization) {
+    SparseHessian K(nodes.size(), 1);
+
+    CellList cells(cutoff);
+    cells.build(nodeCoords(nodes));
+
+    vector<uint> pairs;
+    ListPairs lister(pairs);
+    cells.forEachPair(lister);
+    K.allocate(pairs);
+
+    for (ulong p=0; p<pairs.size(); p += 2) {
+      uint i = pairs[p];
+      uint j = pairs[p+1];
+      ulong a = K.row_start_[i] + K.row_size_[i]++;
+      ulong b = K.row_start_[j] + K.row_size_[j]++;
+      K.columns_[a] = j;
+      K.columns_[b] = i;
+      K.blocks_[a] = K.blocks_[b] = -normalization;
+      K.blocks_[K.row_start_[i]] += normalization;
+      K.blocks_[K.row_start_[j]] += normalization;
+    }
+
+    return(K);
+  }
+
+
+
+  // -------------------------------------------------------------------------
+  // Products
+
+
+  DoubleMatrix SparseHessian::multiply(const DoubleMatrix& X) {
+    if (X.rows() != size())
+      throw(std::runtime_error("Vectors do not match the size of the sparse Hessian"));
+    return(multiply(X, Math::Range(0, n_), Math::Range(0, n_)));
+  }
+
+
+  DoubleMatrix SparseHessian::multiply(const DoubleMatrix& X, const Math::Range& rows, const Math::Range& cols) const {
+    if (rows.first > rows.second || rows.second > n_ || cols.first > cols.second || cols.second > n_)
+      throw(std::runtime_error("Invalid node range for sparse Hessian product"));
+    if (X.rows() != d_ * (cols.second - cols.first))
+      throw(std::runtime_error("Vectors do not match the size of the sparse Hessian"));
+
+    uint dd = d_ * d_;
+    DoubleMatrix Y(d_ * (rows.second - rows.first), X.cols());
+
+    for (uint c=0; c<X.cols(); ++c) {
+      const double* x = X.get() + static_cast<ulong>(c) * X.rows();
+      double* y = Y.get() + static_cast<ulong>(c) * Y.rows();
+
+      for (uint i=rows.first; i<rows.second; ++i, y += d_) {
+        ulong end = row_start_[i] + row_size_[i];
+        for (ulong k=row_start_[i]; k<end; ++k) {
+          uint j = columns_[k];
+          if (j < cols.first || j >= cols.second)
+            continue;
+
+          const double* b = &blocks_[k * dd];
+          const double* xj = x + d_ * (j - cols.first);
+          for (uint u=0; u<d_; ++u)
+            for (uint v=0; v<d_; ++v)
+              y[v] += b[u*d_ + v] * xj[u];
+        }
+      }
+    }
+
+    return(Y);
+  }
+
+
+  DoubleMatrix SparseHessian::diagonalBlocks() {
+    return(diagonalBlocks(Math::Range(0, n_)));
+  }
+
+
+  DoubleMatrix SparseHessian::diagonalBlocks(const Math::Range& rows) const {
+    uint dd = d_ * d_;
+    DoubleMatrix D(d_, d_ * (rows.second - rows.first));
+    for (uint i=rows.first; i<rows.second; ++i)
+      for (uint k=0; k<dd; ++k)
+        D[(i - rows.first) * dd + k] = blocks_[row_start_[i] * dd + k];
+    return(D);
+  }
+
+
+  DoubleMatrix SparseHessian::dense() const {
+    uint dd = d_ * d_;
+    DoubleMatrix H(size(), size());
+
+    for (uint i=0; i<n_; ++i)
+      for (ulong k=row_start_[i]; k<row_start_[i] + row_size_[i]; ++k)
+        for (uint u=0; u<d_; ++u)
+          for (uint v=0; v<d_; ++v)
+            H(i*d_ + v, columns_[k]*d_ + u) = blocks_[k*dd + u*d_ + v];
+
+    return(H);
+  }
+
+
+
+  // -------------------------------------------------------------------------
+  // Preconditioning
+
+
+  BlockJacobi::BlockJacobi(const DoubleMatrix& blocks) : inverse_(blocks.rows(), blocks.cols()) {
+    uint d = blocks.rows();
+    if (d != 1 && d != 3)
+      throw(std::runtime_error("Only 1x1 and 3x3 blocks are supported by BlockJacobi"));
+
+    for (uint i=0; i<blocks.cols(); i += d)
+      invertBlock(blocks.get() + i*d, inverse_.get() + i*d, d);
+  }
+
+
+  DoubleMatrix BlockJacobi::apply(const DoubleMatrix& R) const {
+    if (R.rows() != size())
+      throw(std::runtime_error("Vectors do not match the size of the preconditioner"));
+
+    uint d = inverse_.rows();
+    DoubleMatrix W(R.rows(), R.cols());
+
+    for (uint c=0; c<R.cols(); ++c)
+      for (uint i=0; i<R.rows(); i += d) {
+        const double* b = inverse_.get() + i*d;
+        for (uint u=0; u<d; ++u)
+          for (uint v=0; v<d; ++v)
+            W(i+v, c) += b[u*d + v] * R(i+u, c);
+      }
+
+    return(W);
+  }
+
+
+
+  // -------------------------------------------------------------------------
+  // Matrix-free
+
+
+  MatrixFreeHessian::MatrixFreeHessian(SuperBlock* blocker, const double cutoff)
+    : blocker_(blocker), diagonal_(3, 3*blocker->size())
+  {
+    CellList cells(pairCutoff(blocker, cutoff));
+    cells.build(nodeCoords(blocker->nodeList()));
+
+    CollectPairs collector(blocker, pairs_, diagonal_);
+    cells.forEachPair(collector);
+  }
+
+
+  DoubleMatrix MatrixFreeHessian::multiply(const DoubleMatrix& X) {
+    if (X.rows() != size())
+      throw(std::runtime_error("Vectors do not match the size of the Hessian"));
+
+    uint n = blocker_->size();
+    uint m = X.cols();
+    ulong ld = X.rows();
+    DoubleMatrix Y(X.rows(), m);
+
+    for (uint i=0; i<n; ++i) {
+      const double* b = diagonal_.get() + 9*i;
+      for (uint c=0; c<m; ++c) {
+        const double* x = X.get() + c*ld + 3*i;
+        double* y = Y.get() + c*ld + 3*i;
+        for (uint u=0; u<3; ++u)
+          for (uint v=0; v<3; ++v)
+            y[v] += b[u*3 + v] * x[u];
+      }
+    }
+
+    // Each superblock is computed once and applied to all vectors
+    for (ulong p=0; p<pairs_.size(); p += 2) {
+      uint i = pairs_[p];
+      uint j = pairs_[p+1];
+      DoubleMatrix B = blocker_->block(i, j);
+      const double* b = B.get();
+
+      for (uint c=0; c<m; ++c) {
+        const double* x = X.get() + c*ld;
+        double* y = Y.get() + c*ld;
+        for (uint u=0; u<3; ++u)
+          for (uint v=0; v<3; ++v) {
+            y[3*i + v] -= b[u*3 + v] * x[3*j + u];
+            y[3*j + v] -= b[u*3 + v] * x[3*i + u];
+          }
+      }
+    }
+
+    return(Y);
+  }
+
+
+};
@@ -0,0 +1,199 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/** \addtogroup ENM
+ *@{
+ */
+
+
+#if !defined(LOOS_SPARSE_HESSIAN_HPP)
+#define LOOS_SPARSE_HESSIAN_HPP
+
+#include <vector>
+
+#include <loos.hpp>
+#include "hessian.hpp"
+
+
+namespace ENM {
+
+
+  //! A Hessian that is only used through its product with a block of vectors
+  /**
+   * The Hessian is made of d x d blocks (3 x 3 for an ANM, 1 x 1 for
+   * the Kirchoff matrix of a GNM), one per pair of nodes.  The sparse
+   * eigensolver (see LOBPCG) only needs to multiply the Hessian with a
+   * few vectors at a time, so it never has to be stored densely.
+   */
+  class HessianOperator {
+  public:
+    virtual ~HessianOperator() { }
+
+    //! Number of rows (and columns) in the Hessian
+    virtual uint size() const =0;
+
+    //! Size of the blocks the Hessian is made of
+    virtual uint blockSize() const =0;
+
+    //! Returns H * X, where X is size() x m
+    virtual loos::DoubleMatrix multiply(const loos::DoubleMatrix& X) =0;
+
+    //! Returns the diagonal blocks (d x size()), for preconditioning
+    /**
+     * Columns [d*i, d*i+d) are the i'th diagonal block.
+     */
+    virtual loos::DoubleMatrix diagonalBlocks() =0;
+  };
+
+
+
+  //! Sparse Hessian stored as rows of d x d blocks
+  /**
+   * Only the blocks for nodes within a cutoff of each other are
+   * stored, in compressed sparse row (CSR) format.  The cutoff is
+   * taken from the SuperBlock (e.g. the radius of the distance spring
+   * function) unless one is given explicitly.  Spring functions that
+   * never reach zero (such as exponential or HCA) need an explicit
+   * cutoff, and all springs beyond it are ignored.  Finding the pairs
+   * uses a loos::CellList, so building the Hessian takes time
+   * proportional to the number of nodes rather than its square.
+   *
+   * Example:
+   * \code
+   *   SuperBlock* blocker = new SuperBlock(spring, nodes);
+   *   SparseHessian H(blocker, 15.0);
+   *   DoubleMatrix Y = H.multiply(X);
+   * \endcode
+   */
+  class SparseHessian : public HessianOperator {
+  public:
+    //! Builds the Hessian from \a blocker, using only nodes within \a cutoff (0 = the SuperBlock's)
+    SparseHessian(SuperBlock* blocker, const double cutoff = 0.0);
+
+    //! Builds the Kirchoff matrix for a GNM (1 x 1 blocks)
+    static SparseHessian kirchoff(const loos::AtomicGroup& nodes, const double cutoff, const double normalization = 1.0);
+
+    uint size() const { return(n_ * d_); }
+    uint blockSize() const { return(d_); }
+
+    //! Number of nodes
+    uint nodes() const { return(n_); }
+
+    //! Number of blocks stored (including the diagonal)
+    ulong storedBlocks() const { return(columns_.size()); }
+
+    loos::DoubleMatrix multiply(const loos::DoubleMatrix& X);
+
+    //! Multiply a submatrix of H (selected by node ranges) with X
+    /**
+     * Returns H(rows, cols) * X, i.e. only the blocks for rows in
+     * [rows.first, rows.second) and columns in [cols.first,
+     * cols.second) are used.  X must have d * (cols.second -
+     * cols.first) rows.
+     */
+    loos::DoubleMatrix multiply(const loos::DoubleMatrix& X, const loos::Math::Range& rows, const loos::Math::Range& cols) const;
+
+    loos::DoubleMatrix diagonalBlocks();
+
+    //! Diagonal blocks for the nodes in \a rows
+    loos::DoubleMatrix diagonalBlocks(const loos::Math::Range& rows) const;
+
+    //! Dense copy of the Hessian
+    loos::DoubleMatrix dense() const;
+
+  private:
+    SparseHessian(const uint n, const uint d) : n_(n), d_(d) { }
+
+    void allocate(const std::vector<uint>& pairs);
+
+  private:
+    uint n_, d_;
+
+    // Row i holds blocks row_start_[i] to row_start_[i]+row_size_[i]-1,
+    // and the first one is always the diagonal.  Each block is stored
+    // column-major, like a DoubleMatrix.
+    std::vector<ulong> row_start_;
+    std::vector<uint> row_size_;
+    std::vector<uint> columns_;
+    std::vector<double> blocks_;
+  };
+
+
+
+  //! Block-Jacobi preconditioner (the inverse of the diagonal blocks of a Hessian)
+  /**
+   * Blocks that are singular (e.g. for a node with no springs) are
+   * replaced by the inverse of their mean diagonal element.
+   */
+  class BlockJacobi {
+  public:
+    BlockJacobi() { }
+
+    //! Inverts the d x d diagonal  blocks (as returned by HessianOperator::diagonalBlocks())
+    explicit BlockJacobi(const loos::DoubleMatrix& blocks);
+
+    uint size() const { return(inverse_.cols()); }
+
+    //! Returns P * R, where P is the inverse of the block diagonal
+    loos::DoubleMatrix apply(const loos::DoubleMatrix& R) const;
+
+  private:
+    loos::DoubleMatrix inverse_;
+  };
+
+
+
+  //! Hessian whose blocks are recomputed by the SuperBlock for every product
+  /**
+   * Only the list of node pairs within the cutoff and the diagonal
+   * blocks are stored, so this needs a fraction of the memory of
+   * SparseHessian at the cost of calling SuperBlock::block() for
+   * every pair in every product.
+   */
+  class MatrixFreeHessian : public HessianOperator {
+  public:
+    MatrixFreeHessian(SuperBlock* blocker, const double cutoff = 0.0);
+
+    uint size() const { return(3 * blocker_->size()); }
+    uint blockSize() const { return(3); }
+
+    //! Number of node pairs within the cutoff
+    ulong pairs() const { return(pairs_.size() / 2); }
+
+    loos::DoubleMatrix multiply(const loos::DoubleMatrix& X);
+    loos::DoubleMatrix diagonalBlocks() { return(diagonal_.copy()); }
+
+  private:
+    SuperBlock* blocker_;
+    std::vector<uint> pairs_;
+    loos::DoubleMatrix diagonal_;
+  };
+
+
+};
+
+
+#endif
+
+
+/** @} */
@@ -91,6 +91,9 @@ namespace ENM {
     //! How many internal constants there are
     virtual uint paramSize() const =0;
 
+    //! Distance beyond which the spring constant is always zero (0 = none)
+    virtual double cutoff() const { return(0.0); }
+
 
   
     //! Actually compute the spring constant as a 3x3 matrix
@@ -184,6 +187,8 @@ namespace ENM {
 
     uint paramSize() const { return(1); }
 
+    double cutoff() const { return(sqrt(radius)); }
+
     double constantImpl(const loos::GCoord& u, const loos::GCoord& v, const loos::GCoord& d) {
       double s = d.length2();
       if (s <= radius)
@@ -24,12 +24,165 @@
 
 #include "vsa-lib.hpp"
 
+#include <algorithm>
+
 using namespace std;
 using namespace loos;
 
 
 namespace ENM {
 
+  namespace {
+
+    // Solves Hee X = B, where Hee is the environment part of the sparse
+    // Hessian, using block-Jacobi preconditioned conjugate gradients.
+    // All columns are iterated together so each iteration is a single
+    // sparse product.
+    class EnvironmentSolver {
+    public:
+      EnvironmentSolver(const SparseHessian& H, const Math::Range& env)
+        : H_(H), env_(env), precond_(H.diagonalBlocks(env)) { }
+
+      DoubleMatrix solve(const DoubleMatrix& B) const {
+        uint n = B.rows();
+        uint m = B.cols();
+        DoubleMatrix X(n, m);
+        if (n == 0)
+          return(X);
+
+        DoubleMatrix R = B.copy();
+        DoubleMatrix Z = precond_.apply(R);
+        DoubleMatrix P = Z.copy();
+
+        vector<double> bnorm(m), rz(m);
+        vector<bool> done(m);
+        for (uint c=0; c<m; ++c) {
+          bnorm[c] = sqrt(dot(B, B, c));
+          rz[c] = dot(R, Z, c);
+          done[c] = (bnorm[c] == 0.0);
+        }
+
+        uint iter;
+        for (iter = 0; iter < 10 * n; ++iter) {
+          if (std::find(done.begin(), done.end(), false) == done.end())
+            break;
+
+          DoubleMatrix Q = H_.multiply(P, env_, env_);
+          for (uint c=0; c<m; ++c) {
+            if (done[c])
+              continue;
+            double alpha = rz[c] / dot(P, Q, c);
+            for (uint i=0; i<n; ++i) {
+              X(i, c) += alpha * P(i, c);
+              R(i, c) -= alpha * Q(i, c);
+            }
+            done[c] = (sqrt(dot(R, R, c)) <= 1e-10 * bnorm[c]);
+          }
+
+          Z = precond_.apply(R);
+          for (uint c=0; c<m; ++c) {
+            if (done[c])
+              continue;
+            double rz_next = dot(R, Z, c);
+            double beta = rz_next / rz[c];
+            rz[c] = rz_next;
+            for (uint i=0; i<n; ++i)
+              P(i, c) = Z(i, c) + beta * P(i, c);
+          }
+        }
+
+        if (iter == 10 * n)
+          cerr << "Warning- solving for the environment did not converge\n";
+
+        return(X);
+      }
+
+    private:
+      static double dot(const DoubleMatrix& A, const DoubleMatrix& B, const uint c) {
+        double d = 0.0;
+        for (uint i=0; i<A.rows(); ++i)
+          d += A(i, c) * B(i, c);
+        return(d);
+      }
+
+      const SparseHessian& H_;
+      Math::Range env_;
+      BlockJacobi precond_;
+    };
+
+
+    // The effective subsystem Hessian, Hss - Hse * inv(Hee) * Hes
+    class EffectiveHessian : public HessianOperator {
+    public:
+      EffectiveHessian(const SparseHessian& H, const uint subn, const EnvironmentSolver& Hee)
+        : H_(H), sub_(0, subn), env_(subn, H.nodes()), Hee_(Hee) { }
+
+      uint size() const { return(3 * sub_.second); }
+      uint blockSize() const { return(3); }
+
+      DoubleMatrix multiply(const DoubleMatrix& X) {
+        DoubleMatrix Y = H_.multiply(X, sub_, sub_);
+        DoubleMatrix Z = Hee_.solve(H_.multiply(X, env_, sub_));
+        Y -= H_.multiply(Z, sub_, env_);
+        return(Y);
+      }
+
+      DoubleMatrix diagonalBlocks() { return(H_.diagonalBlocks(sub_)); }
+
+    private:
+      const SparseHessian& H_;
+      Math::Range sub_, env_;
+      const EnvironmentSolver& Hee_;
+    };
+
+
+    // The effective subsystem mass matrix,
+    // Ms + Hse * inv(Hee) * Me * inv(Hee) * Hes
+    class EffectiveMass : public HessianOperator {
+    public:
+      EffectiveMass(const SparseHessian& H, const uint subn, const vector<double>& masses, const EnvironmentSolver& Hee)
+        : H_(H), sub_(0, subn), env_(subn, H.nodes()), masses_(masses), Hee_(Hee) { }
+
+      uint size() const { return(3 * sub_.second); }
+      uint blockSize() const { return(3); }
+
+      DoubleMatrix multiply(const DoubleMatrix& X) {
+        DoubleMatrix Z = Hee_.solve(H_.multiply(X, env_, sub_));
+        scale(Z, env_.first);
+        DoubleMatrix Y = H_.multiply(Hee_.solve(Z), sub_, env_);
+
+        DoubleMatrix MX = X.copy();
+        scale(MX, 0);
+        Y += MX;
+        return(Y);
+      }
+
+      DoubleMatrix diagonalBlocks() {
+        DoubleMatrix D(3, size());
+        for (uint i=0; i<sub_.second; ++i)
+          for (uint k=0; k<3; ++k)
+            D(k, 3*i+k) = masses_[i];
+        return(D);
+      }
+
+    private:
+      // Multiplies by the masses of the nodes, starting with node offset
+      void scale(DoubleMatrix& X, const uint offset) const {
+        for (uint c=0; c<X.cols(); ++c)
+          for (uint i=0; i<X.rows(); ++i)
+            X(i, c) *= masses_[offset + i / 3];
+      }
+
+      const SparseHessian& H_;
+      Math::Range sub_, env_;
+      const vector<double>& masses_;
+      const EnvironmentSolver& Hee_;
+    };
+
+  }
+
+
+
   boost::tuple<DoubleMatrix, DoubleMatrix> VSA::eigenDecomp(DoubleMatrix& A, DoubleMatrix& B) {
 
     DoubleMatrix AA = A.copy();
@@ -141,8 +294,52 @@ namespace ENM {
 
 
 
+  // Only the lowest modes, without ever building a dense Hessian.  With
+  // masses, the eigenvectors are normalized rather than mass-weighted,
+  // since the effective mass matrix is never formed.  Either way, the
+  // rigid-body modes come first with zero eigenvalues, as with the
+  // dense solvers.
+  void VSA::solveLowestModes() {
+    if (verbosity_ > 1)
+      std::cerr << "Building sparse hessian...\n";
+
+    SparseHessian H(blocker_, cutoff_);
+    EnvironmentSolver Hee(H, Math::Range(subset_size_, H.nodes()));
+    EffectiveHessian Hssp(H, subset_size_, Hee);
+
+    const AtomicGroup& nodes = blocker_->nodeList();
+    AtomicGroup subsystem;
+    for (uint i=0; i<subset_size_; ++i)
+      subsystem.append(nodes[i]);
+    DoubleMatrix R = rigidBodyModes(subsystem);
+
+    vector<double> masses = node_masses_;
+    if (masses.empty() && masses_.rows() != 0)
+      for (uint i=0; i<masses_.rows(); i += 3)
+        masses.push_back(masses_(i, i));
+
+    if (masses.empty()) {
+      solveSparse(Hssp, R);
+      return;
+    }
+
+    if (masses.size() != H.nodes())
+      throw(std::runtime_error("Number of masses does not match the number of nodes in VSA"));
+
+    EffectiveMass Msp(H, subset_size_, masses, Hee);
+    solveSparse(Hssp, R, &Msp);
+    normalizeColumns(eigenvecs_);
+  }
+
+
+
   void VSA::solve() {
 
+    if (modes_ != 0) {
+      solveLowestModes();
+      return;
+    }
+
     if (verbosity_ > 1)
       std::cerr << "Building hessian...\n";
     buildHessian();
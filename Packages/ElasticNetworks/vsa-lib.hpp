@@ -102,9 +102,22 @@ namespace ENM {
     };
 
 
+    //! Sets the mass of each node, for the sparse solver
+    /**
+     * When only the lowest modes are computed (see modes()), the masses
+     * are only needed for each node rather than as a 3N x 3N matrix,
+     * so they can be set with this instead of setMasses().  An empty
+     * vector (and no mass matrix) gives the mass-less VSA.
+     */
+    void setNodeMasses(const std::vector<double>& m) {
+      node_masses_ = m;
+    }
+
+
     //! Free up internal storage...
     void free() {
       masses_.reset();
+      node_masses_.clear();
       Msp_.reset();
       Hssp_.reset();
     }
@@ -113,11 +126,13 @@ namespace ENM {
   private:
     boost::tuple<loos::DoubleMatrix, loos::DoubleMatrix> eigenDecomp(loos::DoubleMatrix& A, loos::DoubleMatrix& B);
     loos::DoubleMatrix massWeight(loos::DoubleMatrix& U, loos::DoubleMatrix& M);
+    void solveLowestModes();
 
   
   private:
     uint subset_size_;
     loos::DoubleMatrix masses_;
+    std::vector<double> node_masses_;
 
     loos::DoubleMatrix Msp_;
     loos::DoubleMatrix Hssp_;
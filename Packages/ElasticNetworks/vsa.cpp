@@ -67,6 +67,9 @@ string psf_file;
 string spring_desc;
 bool nomass;
 
+uint modes;
+double cutoff;
+
 
 string fullHelpMessage() {
 
@@ -135,6 +138,17 @@ string fullHelpMessage() {
     "To disable masses (i.e. use unit masses for the subsystem and\n"
     "zero masses for the environment), use the \"--nomass 1\" option.\n"
     "\n\n"
+    "* Large Networks *\n\n"
+    "The --modes option computes only the lowest modes, using a sparse\n"
+    "hessian where only pairs of nodes within a cutoff distance are\n"
+    "stored.  The environment is never inverted; instead, the effective\n"
+    "hessian is applied by solving for the environment iteratively.  The\n"
+    "cutoff is taken from the distance spring function, but must be given\n"
+    "with --cutoff for spring functions that never reach zero.  With\n"
+    "masses, the eigenvectors are normalized rather than mass-weighted\n"
+    "(since the effective mass matrix is never built), and debugging\n"
+    "matrices are not written.\n"
+    "\n\n"
     "EXAMPLES \n\n"
     "\n"
     "vsa --occupancies 1 foo.pdb 'segid == \"TRAN\" && name == \"CA\"'\\\n"
@@ -172,17 +186,25 @@ public:
       ("debug", po::value<bool>(&debug)->default_value(false), "Turn on debugging (output intermediate matrices)")
       ("occupancies", po::value<bool>(&occupancies_are_masses)->default_value(false), "Atom masses are stored in the PDB occupancy field")
       ("nomass", po::value<bool>(&nomass)->default_value(false), "Disable mass as part of the VSA solution")
-      ("spring,S", po::value<string>(&spring_desc)->default_value("distance"), "Spring method and arguments");
+      ("spring,S", po::value<string>(&spring_desc)->default_value("distance"), "Spring method and arguments")
+      ("modes", po::value<uint>(&modes)->default_value(0), "Only compute the lowest modes using a sparse hessian (0 = all)")
+      ("cutoff", po::value<double>(&cutoff)->default_value(0.0), "Cutoff for the sparse hessian (0 = use the spring function's)");
+  }
+
+  bool postConditions(po::variables_map&) {
+    return(modes == 0 || validSparseCutoff(spring_desc, cutoff));
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("psf='%s', debug=%d, occupancies=%d, nomass=%d, spring='%s'")
+    oss << boost::format("psf='%s', debug=%d, occupancies=%d, nomass=%d, spring='%s', modes=%d, cutoff=%f")
       % psf_file
       % debug
       % occupancies_are_masses
       % nomass
-      % spring_desc;
+      % spring_desc
+      % modes
+      % cutoff;
     return(oss.str());
   }
 
@@ -205,8 +227,10 @@ int main(int argc, char *argv[]) {
   ropts->addArgument("environment", "environment-selection");
   ropts->addArgument("prefix", "output-prefix");
 
+  opts::MatrixOutputOptions* matopts = new opts::MatrixOutputOptions;
+
   opts::AggregateOptions options;
-  options.add(bopts).add(mopts).add(topts).add(ropts);
+  options.add(bopts).add(mopts).add(topts).add(ropts).add(matopts);
   if (!options.parse(argc, argv))
     exit(-1);
 
@@ -252,16 +276,25 @@ int main(int argc, char *argv[]) {
   vsa.meta(hdr);
   vsa.debugging(debug);
   vsa.verbosity(verbosity);
+  vsa.modes(modes);
+  vsa.cutoff(cutoff);
 
   if (!nomass) {
-    DoubleMatrix M = getMasses(composite);
-    vsa.setMasses(M);
+    if (modes) {
+      vector<double> masses;
+      for (uint i=0; i<composite.size(); ++i)
+        masses.push_back(composite[i]->mass());
+      vsa.setNodeMasses(masses);
+    } else {
+      DoubleMatrix M = getMasses(composite);
+      vsa.setMasses(M);
+    }
   }
 
   vsa.solve();
   
-  writeAsciiMatrix(prefix + "_U.asc", vsa.eigenvectors(), hdr, false);
-  writeAsciiMatrix(prefix + "_s.asc", vsa.eigenvalues(), hdr, false);
+  writeMatrix(prefix + "_U" + matopts->suffix(), vsa.eigenvectors(), hdr, matopts->binary);
+  writeMatrix(prefix + "_s" + matopts->suffix(), vsa.eigenvalues(), hdr, matopts->binary);
 
   // Be good...
   delete spring;
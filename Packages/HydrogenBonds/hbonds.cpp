@@ -284,13 +284,20 @@ int main(int argc, char *argv[]) {
 
     BondMatrix B(m, donors.size());
 
+    // One cell list per acceptor group, so each donor only checks
+    // the acceptors near it
+    vector<CellList> cells(acceptors.size(), CellList(SimpleAtom::outerRadius()));
+
     for (uint t = skip; t<traj->nframes(); ++t) {
       traj->readFrame(t);
       traj->updateGroupCoords(model);
 
+      for (uint j=0; j<acceptors.size(); ++j)
+        SimpleAtom::buildCellList(cells[j], acceptors[j]);
+
       for (uint i=0; i<donors.size(); ++i) {
         for (uint j=0; j<acceptors.size(); ++j) {
-          AtomicGroup found = donors[i].findHydrogenBonds(acceptors[j], true);
+          AtomicGroup found = donors[i].findHydrogenBonds(acceptors[j], cells[j], true);
           if (! found.empty())
             B(j, i) += 1;
         }
@@ -274,9 +274,10 @@ int main(int argc, char *argv[]) {
   opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
   opts::BasicTrajectory* tropts = new opts::BasicTrajectory;
   ToolOptions* topts = new ToolOptions;
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
   
   opts::AggregateOptions options;
-  options.add(bopts).add(tropts).add(topts);
+  options.add(bopts).add(tropts).add(topts).add(mopts);
   if (! options.parse(argc, argv))
     exit(-1);
 
@@ -351,5 +352,5 @@ int main(int argc, char *argv[]) {
     ++j;
   }
 
-  writeAsciiMatrix(cout, M, oss.str());
+  writeMatrix(cout, M, oss.str(), mopts->binary);
 }
@@ -28,6 +28,7 @@
 
 
 
+#include <algorithm>
 #include <boost/format.hpp>
 
 #include "hcore.hpp"
@@ -170,6 +171,57 @@ loos::AtomicGroup SimpleAtom::findHydrogenBonds(const std::vector<SimpleAtom>& g
 
 
 
+// Collects the indices of atoms that may be within the outer radius
+namespace {
+  struct NearbyAtoms {
+    NearbyAtoms(std::vector<uint>& v) : indices(v) { }
+    void operator()(const uint i) { indices.push_back(i); }
+    std::vector<uint>& indices;
+  };
+}
+
+
+loos::AtomicGroup SimpleAtom::findHydrogenBonds(const std::vector<SimpleAtom>& group, const loos::CellList& cells, const bool findFirstOnly) {
+
+  // The cell list must search the same way distance2() measures...
+  if (cells.isPeriodic() != usePeriodicity || cells.cutoff() < outerRadius())
+    return(findHydrogenBonds(group, findFirstOnly));
+
+  std::vector<uint> nearby;
+  NearbyAtoms collect(nearby);
+  cells.forEachCandidate(atom->coords(), collect);
+
+  // Check in the same order as a search through the whole group
+  std::sort(nearby.begin(), nearby.end());
+
+  loos::AtomicGroup results;
+  for (std::vector<uint>::const_iterator i = nearby.begin(); i != nearby.end(); ++i)
+    if (hydrogenBond(group[*i])) {
+      results.append(group[*i].atom);
+      if (findFirstOnly)
+        break;
+    }
+
+  return(results);
+}
+
+
+void SimpleAtom::buildCellList(loos::CellList& cells, const std::vector<SimpleAtom>& group) {
+  if (cells.cutoff() < outerRadius())
+    throw(std::runtime_error("Cell list cutoff is smaller than the hydrogen bond outer radius"));
+
+  std::vector<loos::GCoord> coords(group.size());
+  for (uint i=0; i<group.size(); ++i)
+    coords[i] = group[i].atom->coords();
+
+  if (!group.empty() && group[0].usePeriodicity)
+    cells.build(coords, group[0].sbox.box());
+  else
+    cells.build(coords);
+}
+
+
+
 // Returns a vector of flags indicating which SimpleAtoms form a
 // hydrogen bond to self.
 
@@ -208,6 +260,29 @@ BondMatrix SimpleAtom::findHydrogenBondsMatrix(const std::vector<SimpleAtom>& gr
 }
 
 
+loos::OccupancyMatrix SimpleAtom::findHydrogenBondsOccupancy(const std::vector<SimpleAtom>& group, loos::pTraj& traj, loos::AtomicGroup& model, const uint maxt) const {
+
+  if (maxt > traj->nframes()) {
+    std::cerr << boost::format("Error- row clip (%d) exceeds trajectory size (%d)\n") % maxt % traj->nframes();
+    exit(-10);
+  }
+
+  loos::OccupancyMatrix bonds(group.size(), maxt);
+
+  for (uint t = 0; t < maxt; ++t) {
+    traj->readFrame(t);
+    traj->updateGroupCoords(model);
+
+    for (uint i = 0; i<group.size(); ++i)
+      if (hydrogenBond(group[i]))
+        bonds.set(i, t);
+
+  }
+
+  return(bonds);
+}
+
+
 
 
 bool SimpleAtom::divineHydrogen(const std::string& name) {
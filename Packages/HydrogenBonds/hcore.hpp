@@ -101,6 +101,16 @@ namespace loos {
       // to the current SimpleAtom
       loos::AtomicGroup findHydrogenBonds(const std::vector<SimpleAtom>& group, const bool findFirstOnly = true);
 
+      // As above, but only checks the atoms that the cell list (built
+      // over group with buildCellList()) puts within the outer radius.
+      // The results are the same as searching the whole group.
+      loos::AtomicGroup findHydrogenBonds(const std::vector<SimpleAtom>& group, const loos::CellList& cells, const bool findFirstOnly = true);
+
+      // Indexes the current coordinates of group for findHydrogenBonds().
+      // The cell list's cutoff must be at least the outer radius, and it
+      // must be rebuilt whenever the coordinates change.
+      static void buildCellList(loos::CellList& cells, const std::vector<SimpleAtom>& group);
+
       std::vector<uint> findHydrogenBondsVector(const std::vector<SimpleAtom>& group);
   
       // Returns a matrix where the rows represent time (frames in the
@@ -114,6 +124,13 @@ namespace loos {
         return(findHydrogenBondsMatrix(group, traj, model, traj->nframes()));
       }
 
+      // As above, but bit-packed and transposed, so each row is the
+      // time series for one acceptor and each column is a frame.
+      loos::OccupancyMatrix findHydrogenBondsOccupancy(const std::vector<SimpleAtom>& group, loos::pTraj& traj, loos::AtomicGroup& model, const uint maxt) const;
+      loos::OccupancyMatrix findHydrogenBondsOccupancy(const std::vector<SimpleAtom>& group, loos::pTraj& traj, loos::AtomicGroup& model) const {
+        return(findHydrogenBondsOccupancy(group, traj, model, traj->nframes()));
+      }
+
 
       // Converts an AtomicGroup into a vector of SimpleAtom's based on
       // the passed selection.  The use_periodicity is applied to all
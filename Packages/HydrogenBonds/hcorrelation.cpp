@@ -272,7 +272,7 @@ int main(int argc, char *argv[]) {
 
 
   vecvecDouble correlations;
-  back_insert_iterator<vecvecDouble> corr_appender(correlations);
+  vector< TimeSeries<double> > series;
 
 
   if (maxtime == 0)
@@ -289,43 +289,23 @@ int main(int argc, char *argv[]) {
       if (skip > 0)
         traj->readFrame(skip-1);
 
-      BondMatrix bonds = j->findHydrogenBondsMatrix(acceptors, traj, model);
+      // Each row of bonds is the time series for one acceptor
+      OccupancyMatrix bonds = j->findHydrogenBondsOccupancy(acceptors, traj, model);
       if (any_hydrogen) {
+        OccupancyMatrix any = bonds.orRows();
         TimeSeries<double> ts;
-        for (uint j=0; j<bonds.rows(); ++j) {
-          double val = 0.0;
-          for (uint i=0; i<bonds.cols(); ++i)
-            if (bonds(j, i) != 0) {
-              val = 1.0;
-              break;
-            }
-          ts.push_back(val);
-        }
-        TimeSeries<double> tcorr = ts.correl(maxtime);
-        vecDouble vtmp;
-        copy(tcorr.begin(), tcorr.end(), back_inserter(vtmp));
-        correlations.push_back(vtmp);
+        for (uint t=0; t<any.cols(); ++t)
+          ts.push_back(any(0, t));
+        series.push_back(ts);
             
       } else {
-        for (uint i=0; i<bonds.cols(); ++i) {
-          bool found = false;
-          for (uint j=0; j<bonds.rows(); ++j)
-            if (bonds(j, i) != 0) { 
-              found = true;
-              break;
-            }
-          
-          if (found) {
+        for (uint i=0; i<bonds.rows(); ++i)
+          if (bonds.count(i)) {
             TimeSeries<double> ts;
-            for (uint j=0; j<bonds.rows(); ++j)
-              ts.push_back(bonds(j, i));
-            TimeSeries<double> tcorr = ts.correl(maxtime);
-            vecDouble vtmp;
-            copy(tcorr.begin(), tcorr.end(), back_inserter(vtmp));
-            correlations.push_back(vtmp);
+            for (uint t=0; t<bonds.cols(); ++t)
+              ts.push_back(bonds(i, t));
+            series.push_back(ts);
           }
-          
-        }
         
       }
 
@@ -335,6 +315,12 @@ int main(int argc, char *argv[]) {
 
 
 
+  // All of the correlations are computed together, so they can be
+  // spread across threads
+  vector< TimeSeries<double> > tcorrs = TimeSeries<double>::batch_correl(series, maxtime);
+  for (uint i=0; i<tcorrs.size(); ++i)
+    correlations.push_back(vecDouble(tcorrs[i].begin(), tcorrs[i].end()));
+
   cerr << boost::format("Found %d time-correlations.\n") % correlations.size();
 
   vecDouble avg = average(correlations);
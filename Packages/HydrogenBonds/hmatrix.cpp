@@ -155,9 +155,10 @@ int main(int argc, char *argv[]) {
   opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
   opts::BasicTrajectory* tropts = new opts::BasicTrajectory;
   ToolOptions* topts = new ToolOptions;
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
   
   opts::AggregateOptions options;
-  options.add(bopts).add(tropts).add(topts);
+  options.add(bopts).add(tropts).add(topts).add(mopts);
   if (! options.parse(argc, argv))
     exit(-1);
 
@@ -181,7 +182,8 @@ int main(int argc, char *argv[]) {
   }
 
   SAGroup acceptors = SimpleAtom::processSelection(acceptor_selection, model, use_periodicity);
-  BondMatrix bonds = donors[0].findHydrogenBondsMatrix(acceptors, traj, model);
-  writeAsciiMatrix(cout, bonds, hdr);
+  // Rows are frames and columns are acceptors in the output
+  OccupancyMatrix bonds = donors[0].findHydrogenBondsOccupancy(acceptors, traj, model);
+  writeOccupancyMatrix(cout, bonds.transpose(), hdr, mopts->binary);
 }
 
@@ -52,6 +52,7 @@ namespace po = loos::OptionsFramework::po;
 
 double option1;
 int option2;
+uint nthreads;
 
 
 // The following conditional prevents this class from appearing in the
@@ -65,14 +66,15 @@ public:
   void addGeneric(po::options_description& o) {
     o.add_options()
       ("option1", po::value<double>(&option1)->default_value(0.0), "Tool Option #1")
-      ("option2", po::value<int>(&option2)->default_value(42), "Tool option #2");
+      ("option2", po::value<int>(&option2)->default_value(42), "Tool option #2")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)");
   }
 
   // The print() function returns a string that describes what all the
   // options are set to (for logging purposes)
   string print() const {
     ostringstream oss;
-    oss << boost::format("option1=%f, option2=%d") % option1 % option2;
+    oss << boost::format("option1=%f, option2=%d, threads=%d") % option1 % option2 % nthreads;
     return(oss.str());
   }
 
@@ -82,9 +84,23 @@ public:
 
 
 // ***EDIT***
-void calculate(const AtomicGroup& structure) {
-  // Do something here with an atom...
-}
+// The calculation is done by a functor that is called once per
+// frame.  Frames may be processed by several threads at once, so
+// each thread gets its own copy of this object (and of the
+// AtomicGroup).  Member variables can be used for scratch space, but
+// nothing shared between threads should be modified.
+//
+// The result_type typedef tells the driver what the calculation
+// returns for each frame.  The second argument is the frame number,
+// should the calculation need it.
+struct Calculation {
+  typedef double result_type;
+
+  result_type operator()(AtomicGroup& structure, const uint) {
+    // Do something here with the structure...
+    return(structure.radiusOfGyration());
+  }
+};
 
 
 
@@ -105,11 +121,10 @@ int main(int argc, char *argv[]) {
   // object provides the "--selection" option.
   opts::BasicSelection* sopts = new opts::BasicSelection;
 
-  // The BasicTrajectory object handles specifying a trajectory as
-  // well as a "--skip" option that lets the tool skip the first
-  // number of frames (i.e. equilibration).  It creates a pTraj object
-  // that is already primed for reading...
-  opts::BasicTrajectory* tropts = new opts::BasicTrajectory;
+  // The TrajectoryWithFrameIndices object handles specifying a
+  // trajectory as well as "--skip", "--stride", and "--range" options
+  // that let the tool choose which frames to use...
+  opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
 
   // ***EDIT***
   // Tool-specific options can be included here...
@@ -132,26 +147,28 @@ int main(int argc, char *argv[]) {
   // Pull the model from the options object (it will include coordinates)
   AtomicGroup model = tropts->model;
   
-  // Pull out the trajectory...
-  pTraj traj = tropts->trajectory;
+  // Which frames of the trajectory to use...
+  vector<uint> frames = tropts->frameList();
 
   // Select the desired atoms to operate over...
   AtomicGroup subset = selectAtoms(model, sopts->selection);
 
-  // Now iterate over all frames in the trajectory (excluding the skip
-  // region)
-  while (traj->readFrame()) {
+  // Each thread opens its own copy of the trajectory, so instead of
+  // the trajectory itself, we pass along how to open it (including
+  // any --prefetch).  The trajectory opened while parsing the options
+  // is no longer needed, so it is released here.
+  TrajectoryOpener opener(tropts->traj_name, tropts->traj_type, model);
+  opener.prefetch(tropts->prefetch);
+  tropts->trajectory.reset();
 
-    // Update the coordinates ONLY for the subset of atoms we're
-    // interested in...
-    traj->updateGroupCoords(subset);
-
-    // ***EDIT***
-    // Now calculate something with the AtomicGroup
-    calculate(subset);
-  }
+  // Now process the requested frames.  Only the coordinates of the
+  // subset are updated for each frame, and the results come back in
+  // the same order as the frames...
+  vector<Calculation::result_type> results = parallelFrameMap(opener, subset, frames, Calculation(), nthreads);
 
   // ***EDIT***
   // Output results...
-
+  cout << "# " << header << endl;
+  for (uint i=0; i<frames.size(); ++i)
+    cout << frames[i] << "\t" << results[i] << endl;
 }
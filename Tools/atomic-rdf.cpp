@@ -36,6 +36,34 @@ using namespace loos;
 namespace opts = loos::OptionsFramework;
 namespace po = loos::OptionsFramework::po;
 
+uint nthreads;
+string partition_by;
+
+
+// @cond TOOLS_INTERNAL
+class ToolOptions : public opts::OptionsPackage
+{
+public:
+
+  void addGeneric(po::options_description& o)
+  {
+    o.add_options()
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
+      ("partition", po::value<string>(&partition_by)->default_value("frames"), "How to divide the work between threads (frames, pairs)")
+      ;
+  }
+
+  string print() const
+  {
+    ostringstream oss;
+    oss << boost::format("threads=%d, partition='%s'")
+      % nthreads
+      % partition_by;
+    return(oss.str());
+  }
+};
+// @endcond
+
 
 
 void Usage()
@@ -79,16 +107,42 @@ string fullHelpMessage(void)
     "As with the other rdf tools (rdf, xy_rdf), histogram-min, histogram-max,\n"
     "and histogram-bins control the range over which the rdf is computed, and\n"
     "the number of bins used, in this case from 0 to 20 Angstroms, with 0.5\n"
-    "angstrom bins.\n";
+    "angstrom bins.\n"
+    "\n"
+    "The histogram can be computed using several threads with --threads.\n"
+    "By default, each thread handles a share of the frames (--partition=frames).\n"
+    "With --partition=pairs, each frame is divided among the threads instead,\n"
+    "which is better for very large selections with few frames.\n";
     return(s);
     }
 
+
+// For each atom in g1, the (sorted) indices of the same atom in g2, so
+// "self" pairs can be skipped
+vector< vector<uint> > findIdenticalAtoms(const AtomicGroup& g1, const AtomicGroup& g2)
+    {
+    map<pAtom, vector<uint> > where;
+    for (uint k = 0; k < g2.size(); k++)
+        where[g2[k]].push_back(k);
+
+    vector< vector<uint> > overlap(g1.size());
+    for (uint j = 0; j < g1.size(); j++)
+        {
+        map<pAtom, vector<uint> >::const_iterator i = where.find(g1[j]);
+        if (i != where.end())
+            overlap[j] = i->second;
+        }
+    return(overlap);
+    }
+
+
 int main (int argc, char *argv[])
 {
 
 // Build options
 opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
 opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
+ToolOptions* topts = new ToolOptions;
 opts::RequiredArguments* ropts = new opts::RequiredArguments;
 
 // These are required command-line arguments (non-optional options)
@@ -99,7 +153,7 @@ ropts->addArgument("max", "max radius");
 ropts->addArgument("num_bins", "number of bins");
 
 opts::AggregateOptions options;
-options.add(bopts).add(tropts).add(ropts);
+options.add(bopts).add(tropts).add(topts).add(ropts);
 if (!options.parse(argc, argv))
   exit(-1);
 
@@ -124,6 +178,17 @@ double hist_min = parseStringAs<double>(ropts->value("min")); // Lower edge of t
 double hist_max = parseStringAs<double>(ropts->value("max")); // Upper edge of the histogram
 int num_bins = parseStringAs<double>(ropts->value("num_bins")); // Number of bins in the histogram
 
+RDFEngine::Partition parallel_by;
+try
+    {
+    parallel_by = parseRDFPartition(partition_by);
+    }
+catch (LOOSError& e)
+    {
+    cerr << "Error- " << e.what() << endl;
+    exit(-1);
+    }
+
 
 double bin_width = (hist_max - hist_min)/num_bins;
 
@@ -144,13 +209,13 @@ if (group2.empty())
     exit(-1);
     }
 
-// Create the histogram and zero it out
-vector<double> hist;
-hist.reserve(num_bins);
-hist.insert(hist.begin(), num_bins, 0.0);
+// Pairs of atoms to skip, in case the selections overlap
+vector< vector<uint> > overlap = findIdenticalAtoms(group1, group2);
 
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
+RDFEngine engine(hist_min, hist_max, num_bins);
+engine.threads(nthreads, parallel_by);
+vector<GCoord> coords1(group1.size());
+vector<GCoord> coords2(group2.size());
 
 // loop over the frames of the trajectory
 vector<uint> framelist = tropts->frameList();
@@ -166,34 +231,16 @@ for (uint index = 0; index<framecnt; ++index)
     GCoord box = system.periodicBox(); 
     volume += box.x() * box.y() * box.z();
 
-    unique_pairs = 0;
-    // compute the distribution of g2 around g1 
     for (uint j = 0; j < group1.size(); j++)
-        {
-        pAtom a1 = group1[j];
-        GCoord p1 = a1->coords();
-        for (uint k = 0; k < group2.size(); k++)
-            {
-            pAtom a2 = group2[k];
-            // skip "self" pairs 
-            if (a1 == a2)
-                {
-                continue;
-                }
-            unique_pairs++;
-            GCoord p2 = a2->coords();
-            // Compute the distance squared, taking periodicity into account
-            double d2 = p1.distance2(p2, box);
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist[bin]++;
-                }
-            }
-        }
+        coords1[j] = group1[j]->coords();
+    for (uint k = 0; k < group2.size(); k++)
+        coords2[k] = group2[k]->coords();
+
+    // compute the distribution of g2 around g1 
+    unique_pairs = engine.addFrame(coords1, coords2, box, overlap);
     }
 
+vector<double> hist = engine.histogram();
 volume /= framecnt;
 
 
@@ -71,11 +71,22 @@ string fullHelpMessage(void) {
     "\tbig-svd --prefix b2ar --selection '!hydrogen' b2ar.pdb b2ar.dcd\n"
     "Computes an SVD using all non-hydrogen atoms.\n"
     "\n"
+    "\tbig-svd --prefix b2ar --modes 20 b2ar.pdb b2ar.dcd\n"
+    "Computes only the first 20 modes, reading the trajectory a block of frames\n"
+    "at a time rather than storing it.  This uses a randomized SVD, so it is much\n"
+    "faster when only the largest modes are needed.  See the svd tool for more\n"
+    "options.\n"
+    "\n"
     "\tbig-svd --prefix b2ar --source 1 --selection '!hydrogen' b2ar.pdb b2ar.dcd\n"
     "Computes an SVD using all non-hydrogen atoms.  The source matrix (trajectory)\n"
     "is written as b2ar_A.asc"
     "\n"
     "\n"
+    "\tbig-svd --prefix b2ar --binary 1 b2ar.pdb b2ar.dcd\n"
+    "As the first example, but the matrices are written in the LOOS binary matrix\n"
+    "format (b2ar_U.lmat, etc), which is much faster to write and read for large\n"
+    "systems.  Tools that read matrices will recognize either format.\n"
+    "\n"
     "SEE ALSO\n"
     "\tsvd, kurskew, phase-pdb\n";
 
@@ -128,22 +139,32 @@ struct TrackStorage {
 
 class ToolOptions : public opts::OptionsPackage {
 public:
-  ToolOptions() : write_source_matrix(false) { }
+  ToolOptions() : write_source_matrix(false), modes(0) { }
 
   void addGeneric(po::options_description& o) {
     o.add_options()
       ("source", po::value<bool>(&write_source_matrix)->default_value(write_source_matrix), "Write out source matrix")
-      ("rsv", po::value<uint>(&subset_rsv)->default_value(0), "Only write out n-columns or RSV (0 = all)");
+      ("rsv", po::value<uint>(&subset_rsv)->default_value(0), "Only write out n-columns or RSV (0 = all)")
+      ("modes", po::value<uint>(&modes)->default_value(modes), "Only calculate this many modes with a randomized SVD (0 = all)");
+  }
+
+  bool postConditions(po::variables_map&) {
+    if (modes && write_source_matrix) {
+      cerr << "Error- cannot write the source matrix when using --modes\n";
+      return(false);
+    }
+    return(true);
   }
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("source=%d") % write_source_matrix;
+    oss << boost::format("source=%d, modes=%d") % write_source_matrix % modes;
     return(oss.str());
   }
 
   bool write_source_matrix;
   uint subset_rsv;
+  uint modes;
   
 };
 // @endcond
@@ -229,9 +250,10 @@ int main(int argc, char *argv[]) {
   opts::OutputPrefix* popts = new opts::OutputPrefix;
   opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
   ToolOptions* topts = new ToolOptions;
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
 
   opts::AggregateOptions options;
-  options.add(bopts).add(sopts).add(popts).add(tropts).add(topts);
+  options.add(bopts).add(sopts).add(popts).add(tropts).add(topts).add(mopts);
   if (!options.parse(argc, argv))
     exit(-1);
 
@@ -246,13 +268,34 @@ int main(int argc, char *argv[]) {
 
   writeMap(prefix + ".map", subset);
 
+  if (topts->modes) {
+    // Stream the trajectory through a randomized SVD rather than
+    // building A and AA'
+    vector<XForm> xforms(indices.size());
+    TrajectoryMatrix A(subset, traj, indices);
+    A.average(averageStructure(subset, xforms, traj, indices));
+
+    cerr << boost::format("Calculating the first %d modes of a %d x %d matrix...\n") % topts->modes % A.rows() % A.cols();
+    boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> res = Math::svd(A, topts->modes);
+    cerr << "Done!\n";
+
+    writeMatrix(prefix + "_U" + mopts->suffix(), boost::get<0>(res), hdr, mopts->binary);
+    writeMatrix(prefix + "_s" + mopts->suffix(), boost::get<1>(res), hdr, mopts->binary);
+
+    DoubleMatrix Vt = boost::get<2>(res);
+    if (topts->subset_rsv && topts->subset_rsv < Vt.rows())
+      Vt = submatrix(Vt, loos::Math::Range(0, topts->subset_rsv), loos::Math::Range(0, Vt.cols()));
+    writeMatrix(prefix + "_V" + mopts->suffix(), Vt, hdr, mopts->binary, true);
+    exit(0);
+  }
+
   // Build AA'
 
   RealMatrix A = extractCoordinates(traj, subset, indices);
   cerr << boost::format("Coordinate matrix is %d x %d\n") % A.rows() % A.cols();
   store.allocate(A.rows() * A.cols());
   if (topts->write_source_matrix)
-    writeAsciiMatrix(prefix + "_A.asc", A, hdr);
+    writeMatrix(prefix + "_A" + mopts->suffix(), A, hdr, mopts->binary);
 
 
   store.allocate(A.rows() * A.rows());
@@ -293,7 +336,7 @@ int main(int argc, char *argv[]) {
   
   reverseColumns(C);
   cerr << "Writing LSVs...";
-  writeAsciiMatrix(prefix + "_U.asc", C, hdr);
+  writeMatrix(prefix + "_U" + mopts->suffix(), C, hdr, mopts->binary);
   cerr << "done.\n";
 
   // D = sqrt(D);  Scale eigenvalues...
@@ -301,7 +344,7 @@ int main(int argc, char *argv[]) {
     W[j] = W[j] < 0 ? 0.0 : sqrt(W[j]);
 
   reverseRows(W);
-  writeAsciiMatrix(prefix + "_s.asc", W, hdr);
+  writeMatrix(prefix + "_s" + mopts->suffix(), W, hdr, mopts->binary);
 
   // Multiply eigenvectors by inverse eigenvalues
   for (uint i=0; i<C.cols(); ++i) {
@@ -327,7 +370,7 @@ int main(int argc, char *argv[]) {
     Vt=Vts;
   }
   
-  writeAsciiMatrix(prefix + "_V.asc", Vt, hdr, true);
+  writeMatrix(prefix + "_V" + mopts->suffix(), Vt, hdr, mopts->binary, true);
   cerr << "done.\n";
   
 
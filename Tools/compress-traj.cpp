@@ -0,0 +1,112 @@
+/*
+  compress-traj.cpp
+
+  Compresses a trajectory so it can still be read with random access
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <loos.hpp>
+
+
+using namespace std;
+using namespace loos;
+
+
+string fullHelpMessage(void) {
+  string msg =
+    "\n"
+    "SYNOPSIS\n"
+    "\tCompress a trajectory (or any other file) in a seekable format\n"
+    "\n"
+    "DESCRIPTION\n"
+    "\n"
+    "\tLOOS reads gzip and zstd compressed files directly, without first\n"
+    "decompressing them to disk.  Files compressed by gzip or zstd themselves can\n"
+    "only be read in order, however, so jumping to a frame means decompressing\n"
+    "everything before it.  This tool compresses a file in independent chunks, with\n"
+    "enough information to find any chunk, so LOOS can seek to any frame by\n"
+    "decompressing only the chunk that holds it.\n"
+    "\n"
+    "\tGzip output is in the blocked gzip (BGZF) format used by bgzip.  Zstd\n"
+    "output is in the zstd seekable format, with 1MB chunks.  The files can still be\n"
+    "decompressed by gunzip or zstd.\n"
+    "\n"
+    "EXAMPLES\n"
+    "\n"
+    "\tcompress-traj gzip sim.dcd sim.dcd.gz\n"
+    "\tCompress sim.dcd with gzip.  Tools can then be run directly on sim.dcd.gz\n"
+    "\n"
+    "\tcompress-traj zstd sim.dcd sim.dcd.zst\n"
+    "\tCompress with zstd, which is much faster to decompress\n"
+    "\n"
+    "SEE ALSO\n"
+    "\ttrajinfo, subsetter\n";
+
+  return(msg);
+}
+
+
+
+int main(int argc, char *argv[]) {
+
+  if (argc != 4) {
+    cerr << "Usage- " << argv[0] << " gzip|zstd input output\n";
+    cerr << fullHelpMessage();
+    exit(-1);
+  }
+
+  Compression c;
+  string method(argv[1]);
+  if (method == "gzip")
+    c = Gzip;
+  else if (method == "zstd")
+    c = Zstd;
+  else {
+    cerr << "Error- unknown compression method '" << method << "'\n";
+    exit(-1);
+  }
+
+  // Already compressed input is decompressed first
+  boost::shared_ptr<istream> ifs = openInputStream(argv[2]);
+  ofstream ofs(argv[3], ios_base::out | ios_base::binary);
+  if (!ofs) {
+    cerr << "Error- cannot open " << argv[3] << " for writing\n";
+    exit(-2);
+  }
+
+  writeSeekableCompressed(*ifs, ofs, c);
+  ofs.close();
+  if (ofs.fail()) {
+    cerr << "Error- problem writing to " << argv[3] << endl;
+    exit(-2);
+  }
+
+  if (!isSeekableCompressed(argv[3])) {
+    cerr << "Error- " << argv[3] << " was not written correctly\n";
+    exit(-2);
+  }
+}
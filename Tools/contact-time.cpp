@@ -334,9 +334,10 @@ int main(int argc, char *argv[]) {
   opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
   opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices();
   ToolOptions* topts = new ToolOptions;
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
 
   opts::AggregateOptions options;
-  options.add(bopts).add(tropts).add(topts);
+  options.add(bopts).add(tropts).add(topts).add(mopts);
 
   if (!options.parse(argc, argv))
     exit(-1);
@@ -421,5 +422,5 @@ int main(int argc, char *argv[]) {
     if (bopts->verbosity)
       cerr << "No normalization.\n";
 
-  writeAsciiMatrix(cout, M, hdr);
+  writeMatrix(cout, M, hdr, mopts->binary);
 }
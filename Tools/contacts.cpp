@@ -31,6 +31,25 @@
 using namespace std;
 using namespace loos;
 
+// @cond TOOLS_INTERNAL
+// Counts the group2 centers of mass found within the cutoff
+struct ContactCounter
+    {
+    ContactCounter() : count(0), skip(0) { }
+
+    void operator()(const uint j, const double)
+        {
+        // exclude self pairs 
+        if (!binary_search(skip->begin(), skip->end(), j))
+            count++;
+        }
+
+    int count;
+    const vector<uint>* skip;   // group2 entries identical to the current group1 entry
+    };
+// @endcond
+
+
 string fullHelpMessage(void)
     {
     string s =
@@ -109,7 +128,6 @@ if (argc < 6)
   string selection1(argv[3]);
   string selection2(argv[4]);
   double max = strtod(argv[5], 0);
-  double max2 = max*max;
 
   AtomicGroup model = createSystem(model_filename);
   pTraj traj = createTrajectory(traj_filename, model);
@@ -129,6 +147,15 @@ if (argc < 6)
 
 
 
+  // Pairs of groups that are the same, so they can be excluded
+  vector< vector<uint> > self_pairs = findIdenticalGroups(group1, group2);
+
+  // group2 centers of mass are placed in a cell list each frame, so
+  // only the ones near each group1 center of mass are checked
+  CellList cells(max);
+  vector<GCoord> centers(group2.size());
+  ContactCounter counter;
+
   cout << "#Frame\tPairs\tPerGroup1\tPerGroup2" << endl;
 
   // loop over the frames of the dcd file
@@ -137,31 +164,23 @@ if (argc < 6)
     {
       // get the new coordinates
       traj->updateGroupCoords(model);
-      int count = 0;
+      counter.count = 0;
+
+      for (uint j=0; j<group2.size(); ++j)
+        centers[j] = group2[j].centerOfMass();
+      if (model.isPeriodic())
+        cells.build(centers, model.periodicBox());
+      else
+        cells.build(centers);
 
       // compute the number of contacts between group1 center of mass 
       // and group2 center of mass
-      vector<AtomicGroup>::iterator first;
-      for (first=group1.begin(); first!=group1.end(); first++)
+      for (uint i=0; i<group1.size(); ++i)
         {
-      GCoord com1 = first->centerOfMass();
-
-      vector<AtomicGroup>::iterator second;
-      for (second=group2.begin(); second!=group2.end(); second++)
-            {
-          // exclude self pairs 
-          if (*first == *second)
-                continue;
-
-          GCoord com2 = second->centerOfMass();
-
-          double d2 = com1.distance2(com2, model.periodicBox());
-          if ( (d2 <= max2) )
-                {
-                count++;
-                }
-            }
+          counter.skip = &self_pairs[i];
+          cells.forEachNeighbor(group1[i].centerOfMass(), counter);
         }
+      int count = counter.count;
     
       // Output the results
       double per_g1_atom = (double)count / group1.size();
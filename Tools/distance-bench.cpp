@@ -0,0 +1,267 @@
+/*
+  distance-bench.cpp
+
+  Micro-benchmark for the batched distance kernels
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <loos.hpp>
+
+#include <boost/random.hpp>
+
+
+using namespace std;
+using namespace loos;
+
+
+string fullHelpMessage(void) {
+  string msg =
+    "\n"
+    "SYNOPSIS\n"
+    "\tBenchmark and cross-check the batched distance kernels\n"
+    "\n"
+    "DESCRIPTION\n"
+    "\n"
+    "\tFills a periodic box with random points, then times the squared distances\n"
+    "from each point to all of the others (one-to-many), using each instruction set\n"
+    "the processor supports (scalar, AVX2, and AVX-512), for groups of increasing size.\n"
+    "Distances are computed both with and without the periodic box, and the rate is\n"
+    "reported as distances per second.  The naive loop over Coord::distance2() is\n"
+    "timed as well, for comparison.\n"
+    "\n"
+    "\tEvery kernel is checked against Coord::distance2(), and the within-cutoff\n"
+    "masks are checked against a direct count.  The largest difference is reported.\n"
+    "\n"
+    "\tThe default is groups of 16 to 16,384 points, with about 10^8 distances\n"
+    "computed for each size.\n"
+    "\n"
+    "EXAMPLES\n"
+    "\n"
+    "\tdistance-bench\n"
+    "\tBenchmark the default group sizes\n"
+    "\n"
+    "\tdistance-bench 100000 1e9\n"
+    "\tBenchmark groups of up to 100,000 points, with 10^9 distances per size\n"
+    "\n"
+    "SEE ALSO\n"
+    "\trdf, atomic-rdf, xy_rdf\n";
+
+  return(msg);
+}
+
+
+
+typedef boost::variate_generator<boost::mt19937&, boost::uniform_real<> >   Uniform;
+
+
+vector<GCoord> makePoints(const uint n, const GCoord& box, Uniform& rnd) {
+  vector<GCoord> points(n);
+  for (uint i=0; i<n; ++i)
+    for (uint k=0; k<3; ++k)
+      points[i][k] = (rnd() - 0.5) * box[k] * 1.5;   // Some points lie outside the box
+  return(points);
+}
+
+
+// Largest difference from Coord::distance2(), relative to the distance
+double maxDifference(const vector<GCoord>& points, const PackedCoords& packed, const GCoord& box,
+                     const bool periodic) {
+  vector<double> d2(packed.size());
+  double d = 0.0;
+
+  for (uint i=0; i<points.size(); ++i) {
+    if (periodic)
+      batch::distance2(points[i], packed, box, &d2[0]);
+    else
+      batch::distance2(points[i], packed, &d2[0]);
+    for (uint j=0; j<points.size(); ++j) {
+      double ref = periodic ? points[i].distance2(points[j], box) : points[i].distance2(points[j]);
+      d = max(d, fabs(ref - d2[j]) / max(1.0, ref));
+    }
+  }
+
+  return(d);
+}
+
+
+// Mismatches between the masks and a direct count
+uint checkMasks(const vector<GCoord>& points, const PackedCoords& packed, const GCoord& box, const double cutoff) {
+  double c2 = cutoff * cutoff;
+  uint nbad = 0;
+  vector<int> mask;
+
+  // Only the first point of each pair is compared with the second
+  // half, so anyWithinCutoff() is not trivially true
+  uint half = points.size() / 2;
+  vector<GCoord> first(points.begin(), points.begin() + half);
+  vector<GCoord> second(points.begin() + half, points.end());
+  vector<int> any = batch::anyWithinCutoff(PackedCoords(first), PackedCoords(second), cutoff, box);
+
+  for (uint i=0; i<half; ++i) {
+    uint n = batch::withinCutoff(points[i], packed, cutoff, box, mask);
+    uint count = 0;
+    int found = 0;
+    for (uint j=0; j<points.size(); ++j) {
+      double d2 = points[i].distance2(points[j], box);
+      bool within = (d2 <= c2);
+      count += within;
+      nbad += (within != static_cast<bool>(mask[j]));
+      if (j >= half && within)
+        found = 1;
+    }
+    nbad += (n != count) + (found != any[i]);
+  }
+
+  return(nbad);
+}
+
+
+// Distances per second for all-to-all, repeated to compute about
+// ndist distances
+double rate(const vector<GCoord>& points, const PackedCoords& packed, const GCoord& box, const bool periodic,
+            const double ndist) {
+  uint n = points.size();
+  uint reps = max(1.0, ndist / (static_cast<double>(n) * n));
+  vector<double> d2(n);
+  volatile double sink = 0.0;
+
+  Timer<WallTimer> timer;
+  timer.start();
+  for (uint r=0; r<reps; ++r)
+    for (uint i=0; i<n; ++i) {
+      if (periodic)
+        batch::distance2(points[i], packed, box, &d2[0]);
+      else
+        batch::distance2(points[i], packed, &d2[0]);
+      sink += d2[r % n];
+    }
+  double t = timer.stop();
+
+  return(static_cast<double>(reps) * n * n / t);
+}
+
+
+// The same, looping over Coord::distance2()
+double naiveRate(const vector<GCoord>& points, const GCoord& box, const bool periodic, const double ndist) {
+  uint n = points.size();
+  uint reps = max(1.0, ndist / (static_cast<double>(n) * n));
+  vector<double> d2(n);
+  volatile double sink = 0.0;
+
+  Timer<WallTimer> timer;
+  timer.start();
+  for (uint r=0; r<reps; ++r)
+    for (uint i=0; i<n; ++i) {
+      if (periodic)
+        for (uint j=0; j<n; ++j)
+          d2[j] = points[i].distance2(points[j], box);
+      else
+        for (uint j=0; j<n; ++j)
+          d2[j] = points[i].distance2(points[j]);
+      sink += d2[r % n];
+    }
+  double t = timer.stop();
+
+  return(static_cast<double>(reps) * n * n / t);
+}
+
+
+
+int main(int argc, char *argv[]) {
+
+  uint maxsize = 16384;
+  double ndist = 1e8;
+
+  if (argc <= 3) {
+    if (argc > 1)
+      maxsize = strtoul(argv[1], 0, 10);
+    if (argc > 2)
+      ndist = strtod(argv[2], 0);
+  }
+  if (argc > 3 || maxsize < 16 || ndist <= 0.0) {
+    cerr << "Usage- " << argv[0] << " [max-size [distances]]\n";
+    cerr << fullHelpMessage();
+    exit(-1);
+  }
+
+  boost::mt19937 rng(1234);
+  boost::uniform_real<> unit(0.0, 1.0);
+  Uniform rnd(rng, unit);
+
+  GCoord box(50.0, 60.0, 70.0);
+  double cutoff = 12.0;
+
+  vector<batch::InstructionSet> isas;
+  isas.push_back(batch::Scalar);
+  if (batch::bestInstructionSet() >= batch::AVX2)
+    isas.push_back(batch::AVX2);
+  if (batch::bestInstructionSet() >= batch::AVX512)
+    isas.push_back(batch::AVX512);
+  batch::InstructionSet best = batch::instructionSet();
+
+  cout << "# Default instruction set is " << batch::instructionSetName(best) << endl;
+  cout << "# Rates are distances per second\n";
+  cout << boost::format("# %-6s %-8s %12s") % "n" % "box" % "naive";
+  for (uint k=0; k<isas.size(); ++k)
+    cout << boost::format(" %12s") % batch::instructionSetName(isas[k]);
+  cout << endl;
+
+  double maxdiff = 0.0;
+  uint nbad = 0;
+
+  for (uint n = 16; n <= maxsize; n *= 4) {
+    vector<GCoord> points = makePoints(n, box, rnd);
+    PackedCoords packed(points);
+
+    for (uint periodic = 0; periodic < 2; ++periodic) {
+      cout << boost::format("  %-6d %-8s %12.4g") % n % (periodic ? "periodic" : "none")
+        % naiveRate(points, box, periodic, ndist);
+
+      for (uint k=0; k<isas.size(); ++k) {
+        batch::instructionSet(isas[k]);
+        cout << boost::format(" %12.4g") % rate(points, packed, box, periodic, ndist);
+        if (n <= 4096) {
+          maxdiff = max(maxdiff, maxDifference(points, packed, box, periodic));
+          if (periodic)
+            nbad += checkMasks(points, packed, box, cutoff);
+        }
+      }
+      cout << endl;
+    }
+  }
+
+  batch::instructionSet(best);
+
+  cout << boost::format("Max relative difference: %g\n") % maxdiff;
+  cout << boost::format("Mask mismatches:         %d\n") % nbad;
+
+  if (maxdiff > 1e-10 || nbad != 0) {
+    cout << "ERROR- batch distances differ from Coord::distance2()\n";
+    exit(-2);
+  }
+  cout << "Batch distances agree\n";
+}
@@ -317,9 +317,10 @@ int main(int argc, char *argv[]) {
     opts::BasicSelection* sopts = new opts::BasicSelection();
     opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices();
     ToolOptions* topts = new ToolOptions;
+    opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
 
     opts::AggregateOptions options;
-    options.add(bopts).add(sopts).add(tropts).add(topts);
+    options.add(bopts).add(sopts).add(tropts).add(topts).add(mopts);
 
     if (!options.parse(argc, argv))
         exit(-1);
@@ -433,5 +434,5 @@ int main(int argc, char *argv[]) {
     if (bopts->verbosity)
         slayer.finish();
 
-    writeAsciiMatrix(cout, M, hdr);
+    writeMatrix(cout, M, hdr, mopts->binary);
 }
@@ -104,7 +104,7 @@ int main(int argc, char *argv[]) {
   string hdr = invocationHeader(argc, argv);
 
   DoubleMatrix M;
-  readAsciiMatrix(argv[1], M);
+  readMatrix(argv[1], M);
 
   DoubleMatrix K(M.cols(), 3);
 
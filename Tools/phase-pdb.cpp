@@ -181,7 +181,7 @@ int main(int argc, char *argv[]) {
   string matrix_name = ropts->value("matrix");
 
   RealMatrix A;
-  readAsciiMatrix(matrix_name, A);
+  readMatrix(matrix_name, A);
   uint m = A.rows();
 
   if (rows.empty())
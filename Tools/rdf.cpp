@@ -45,6 +45,8 @@ string split_by, split_by2;
 double hist_min, hist_max;
 int num_bins;
 int skip;
+uint nthreads;
+string partition_by;
 
 // @cond TOOLS_INTERNAL
 class ToolOptions : public opts::OptionsPackage
@@ -56,6 +58,8 @@ public:
     o.add_options()
       ("split-mode",po::value<string>(&split_by)->default_value("by-molecule"), "how to split the selections (by-residue, molecule, segment, none)")
       ("split-mode2",po::value<string>(&split_by2)->default_value("by-molecule"), "how to split the second selection (by-residue, molecule, segment, none)")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
+      ("partition", po::value<string>(&partition_by)->default_value("frames"), "How to divide the work between threads (frames, pairs)")
       ;
   }
 
@@ -93,14 +97,16 @@ public:
   string print() const
   {
     ostringstream oss;
-    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, split-mode2='%'")
+    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, split-mode2='%', threads=%d, partition='%s'")
       % split_by
       % selection1
       % selection2
       % hist_min
       % hist_max
       % num_bins
-      % split_by2;
+      % split_by2
+      % nthreads
+      % partition_by;
     return(oss.str());
   }
 };
@@ -152,6 +158,12 @@ string s =
     "the tryptophan residues.  The program would use the center of mass of the\n"
     "carbon atoms to as the point from which to compute the RDF.\n"
     "\n"
+    "The histogram can be computed using several threads with --threads.\n"
+    "By default, each thread handles a share of the frames (--partition=frames),\n"
+    "which is best for long trajectories.  With --partition=pairs, each frame\n"
+    "is divided among the threads instead, which is better for very large\n"
+    "systems with few frames.\n"
+    "\n"
     "See also atomic-rdf and xy_rdf.\n"
     ;
 
@@ -215,13 +227,12 @@ uint doSplit(const AtomicGroup &system, const string selection,
         tmp.push_back(system);
         }
 
-    Parser parser(selection);
-    KernelSelector parsed_sel(parser.kernel());
+    CompiledSelection parsed_sel(selection);
     
     vector<AtomicGroup>::iterator t;
     for (t=tmp.begin(); t!=tmp.end(); ++t)
         {
-        AtomicGroup newgroup = t->select(parsed_sel);
+        AtomicGroup newgroup = parsed_sel.select(*t);
         if (newgroup.size() > 0)
             {
             grouping.push_back(newgroup);
@@ -249,6 +260,17 @@ if (!options.parse(argc, argv))
 split_mode split=parseSplit(split_by);
 split_mode split2=parseSplit(split_by2);
 
+RDFEngine::Partition parallel_by;
+try
+    {
+    parallel_by = parseRDFPartition(partition_by);
+    }
+catch (LOOSError& e)
+    {
+    cerr << "Error- " << e.what() << endl;
+    exit(-1);
+    }
+
 // Print the command line arguments
 cout << "# " << hdr << endl;
 
@@ -291,25 +313,23 @@ else if (split == BY_SEGMENT)
     }
 
 // Set up the selector to define group1 atoms
-Parser parser1(selection1);
-KernelSelector parsed_sel1(parser1.kernel());
+CompiledSelection parsed_sel1(selection1);
 
 // Set up the selector to define group2 atoms
-Parser parser2(selection2);
-KernelSelector parsed_sel2(parser2.kernel());
+CompiledSelection parsed_sel2(selection2);
 
 // Loop over the molecules and add them to group1 or group2
 vector<AtomicGroup> g1_mols, g2_mols;
 vector<AtomicGroup>::iterator g;
 for (g=grouping.begin(); g!=grouping.end(); g++)
     {
-    AtomicGroup tmp = g->select(parsed_sel1);
+    AtomicGroup tmp = parsed_sel1.select(*g);
     if (tmp.size() > 0)
         {
         g1_mols.push_back(tmp);
         }
 
-    AtomicGroup tmp2 = g->select(parsed_sel2);
+    AtomicGroup tmp2 = parsed_sel2.select(*g);
     if (tmp2.size() > 0)
         {
         g2_mols.push_back(tmp2);
@@ -339,38 +359,23 @@ vector<uint> framelist = tropts->frameList();
 traj->readFrame(framelist[0]);
 traj->updateGroupCoords(system);
 
-// Create the histogram and zero it out
-vector<double> hist;
-hist.reserve(num_bins);
-hist.insert(hist.begin(), num_bins, 0.0);
-
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
-
-// Precompute the overlap between the two groups (this can be an
-// expensive operation, so it's better to have it outside the
-// while-loop)
-
-unsigned long unique_pairs = 0;
-Math::Matrix<int, Math::RowMajor> group_overlap(g1_mols.size(), g2_mols.size());
+// Find the pairs of groups that are the same (in case selection1 and
+// selection2 overlap).  overlap[j] lists the g2 groups that match g1
+// group j.
+vector< vector<uint> > overlap = findIdenticalGroups(g1_mols, g2_mols);
 
-for (uint j=0; j<g1_mols.size(); ++j)
-    {
-    for (uint i=0; i<g2_mols.size(); ++i)
-      {
-      bool b = (g1_mols[j] == g2_mols[i]);
-      group_overlap(j, i) = b;
-      if ( !b )
-        {
-          ++unique_pairs;
-        }
-      }
-    }
+// Distances between the centers of mass are histogrammed by the
+// engine, which only checks nearby g2 groups against each g1 group
+RDFEngine engine(hist_min, hist_max, num_bins);
+engine.threads(nthreads, parallel_by);
+vector<GCoord> g1_centers(g1_mols.size());
+vector<GCoord> g2_centers(g2_mols.size());
 
 
 // loop over the frames of the trajectory
 uint framecount = framelist.size();
 double volume = 0.0;
+unsigned long unique_pairs = 0;
 for (uint index = 0; index<framecount; ++index)
     {
     traj->readFrame(framelist[index]);
@@ -380,31 +385,16 @@ for (uint index = 0; index<framecount; ++index)
     GCoord box = system.periodicBox(); 
     volume += box.x() * box.y() * box.z();
 
+    for (uint j = 0; j < g1_mols.size(); j++)
+        g1_centers[j] = g1_mols[j].centerOfMass();
+    for (uint k = 0; k < g2_mols.size(); k++)
+        g2_centers[k] = g2_mols[k].centerOfMass();
+
     // compute the distribution of g2 around g1 
-    for (unsigned int j = 0; j < g1_mols.size(); j++)
-        {
-        GCoord p1 = g1_mols[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_mols.size(); k++)
-            {
-            // skip "self" pairs -- in case selection1 and selection2 overlap
-            if (group_overlap(j, k))
-                {
-                continue;
-                }
-            GCoord p2 = g2_mols[k].centerOfMass();
-            
-            // Compute the distance squared, taking periodicity into account
-            double d2 = p1.distance2(p2, box);
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist[bin]++;
-                }
-            }
-        }
+    unique_pairs = engine.addFrame(g1_centers, g2_centers, box, overlap);
     }
 
+vector<double> hist = engine.histogram();
 volume /= framecount;
 
 
@@ -158,9 +158,10 @@ int main(int argc, char *argv[]) {
   opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
   ToolOptions* topts = new ToolOptions;
   opts::RequiredArguments* ropts = new opts::RequiredArguments("threshold", "Distance threshold for contacts");
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
 
   opts::AggregateOptions options;
-  options.add(bopts).add(sopts).add(tropts).add(topts).add(ropts);
+  options.add(bopts).add(sopts).add(tropts).add(topts).add(ropts).add(mopts);
   if (!options.parse(argc, argv))
     exit(-1);
 
@@ -187,5 +188,5 @@ int main(int argc, char *argv[]) {
   for (ulong i=0; i<residues.size() * residues.size(); ++i)
     M[i] /= indices.size();
 
-  writeAsciiMatrix(cout, M, hdr);
+  writeMatrix(cout, M, hdr, mopts->binary);
 }
@@ -127,8 +127,7 @@ else
     }
 
 // Set up the selector to define the selected group
-Parser parser(selection);
-KernelSelector parsed_sel(parser.kernel());
+CompiledSelection parsed_sel(selection);
 
 
 // Loop over the molecules and add them to selection
@@ -136,7 +135,7 @@ vector<AtomicGroup> molecule_groups;
 vector<AtomicGroup>::iterator m;
 for (m=molecules.begin(); m!=molecules.end(); m++)
     {
-    AtomicGroup tmp = m->select(parsed_sel);
+    AtomicGroup tmp = parsed_sel.select(*m);
     if (tmp.size() > 0)
         {
         molecule_groups.push_back(tmp);
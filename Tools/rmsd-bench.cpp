@@ -0,0 +1,357 @@
+/*
+  rmsd-bench.cpp
+
+  Micro-benchmark for the superposition methods (SVD, QCP, and the tiled all-to-all engine)
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <loos.hpp>
+
+#include <boost/random.hpp>
+#include <boost/thread/thread.hpp>
+
+
+using namespace std;
+using namespace loos;
+using namespace loos::alignment;
+
+
+string fullHelpMessage(void) {
+  string msg =
+    "\n"
+    "SYNOPSIS\n"
+    "\tBenchmark and cross-check the superposition methods\n"
+    "\n"
+    "DESCRIPTION\n"
+    "\n"
+    "\tBuilds a synthetic ensemble of randomly perturbed and rotated copies of\n"
+    "a chain, then times an all-to-all RMSD of the ensemble (as rmsds does) using\n"
+    "both the SVD-based Kabsch method and QCP.  The largest difference between the\n"
+    "two RMSD matrices is reported.  The rotations found by each method are also\n"
+    "compared by superimposing every structure onto the first one.  A few small\n"
+    "degenerate cases (collinear and 2-atom structures, and coordinates on a tiny\n"
+    "scale) are cross-checked the same way, along with a tiled all-to-all of\n"
+    "2-atom structures.\n"
+    "\n"
+    "\tThe tiled PairwiseRMSD engine (used by rmsds) is timed as well, with one\n"
+    "thread and then with one thread per core.  Its matrix is stored in single\n"
+    "precision, so it is compared against the SVD matrix at that precision.\n"
+    "\n"
+    "\tThe default is a 250 atom chain with 10,000 frames.\n"
+    "\n"
+    "EXAMPLES\n"
+    "\n"
+    "\trmsd-bench\n"
+    "\tBenchmark the default 250 atom, 10,000 frame ensemble\n"
+    "\n"
+    "\trmsd-bench 1000 2000\n"
+    "\tBenchmark a 1,000 atom chain with 2,000 frames\n"
+    "\n"
+    "SEE ALSO\n"
+    "\trmsds, rmsd2ref, aligner\n";
+
+  return(msg);
+}
+
+
+
+typedef boost::variate_generator<boost::mt19937&, boost::uniform_real<> >   Uniform;
+
+
+// Random walk with a CA-CA-like step length
+vecDouble makeChain(const uint natoms, Uniform& rnd) {
+  vecDouble chain(natoms * 3);
+  GCoord c;
+
+  for (uint i=0; i<natoms; ++i) {
+    GCoord step(rnd(), rnd(), rnd());
+    c += step * (3.8 / step.length());
+    for (uint k=0; k<3; ++k)
+      chain[i*3+k] = c[k];
+  }
+
+  return(chain);
+}
+
+
+vecMatrix makeEnsemble(const vecDouble& ref, const uint nframes, Uniform& rnd) {
+  vecMatrix ensemble(nframes);
+
+  for (uint j=0; j<nframes; ++j) {
+    XForm W;
+    W.translate(GCoord(rnd(), rnd(), rnd()) * 20.0);
+    W.rotate('x', rnd() * 180.0);
+    W.rotate('y', rnd() * 180.0);
+    W.rotate('z', rnd() * 180.0);
+
+    vecDouble frame(ref);
+    double scale = 0.5 + rnd();
+    for (uint i=0; i<frame.size(); ++i)
+      frame[i] += rnd() * scale;
+    applyTransform(W.current(), frame);
+
+    ensemble[j] = frame;
+  }
+
+  return(ensemble);
+}
+
+
+// Upper triangle of the all-to-all RMSD matrix, computed with the
+// currently selected superposition method
+vecDouble allToAll(const vecMatrix& ensemble) {
+  uint n = ensemble.size();
+  vecDouble R;
+  R.reserve(n * (n - 1) / 2);
+
+  for (uint i=0; i<n; ++i)
+    for (uint j=0; j<i; ++j)
+      R.push_back(centeredRMSD(ensemble[i], ensemble[j]));
+
+  return(R);
+}
+
+
+// Same pairs (and order) as allToAll(), but from the tiled engine
+vecDouble tiledAllToAll(const vecMatrix& ensemble, const uint nthreads) {
+  PairwiseRMSD engine(ensemble);
+  PairwiseRMSD::TriangularMatrix M = engine.allToAll(nthreads);
+
+  uint n = ensemble.size();
+  vecDouble R;
+  R.reserve(n * (n - 1) / 2);
+  for (uint i=0; i<n; ++i)
+    for (uint j=0; j<i; ++j)
+      R.push_back(M(i, j));
+
+  return(R);
+}
+
+
+// Superimposes each structure onto the first and returns the RMSD
+// after the fit
+vecDouble fitToFirst(const vecMatrix& ensemble) {
+  vecDouble R;
+
+  for (uint i=0; i<ensemble.size(); ++i) {
+    vecDouble frame(ensemble[i]);
+    applyTransform(kabsch(frame, ensemble[0]), frame);
+    R.push_back(rmsd(frame, ensemble[0]));
+  }
+
+  return(R);
+}
+
+
+// Small structures that QCP finds hard: collinear coordinates and
+// 2-atom selections (where the rotation is not unique), and
+// coordinates on a tiny scale.  Returns pairs of (U, V).
+vecMatrix degenerateCases(Uniform& rnd) {
+  vecMatrix cases;
+
+  XForm W;
+  W.translate(GCoord(3.0, -2.0, 1.0));
+  W.rotate('x', 30.0);
+  W.rotate('z', 70.0);
+
+  // Identical collinear structures
+  vecDouble line;
+  for (uint i=0; i<10; ++i) {
+    GCoord c = GCoord(1.0, 2.0, -0.5) * (i + 0.3 * rnd());
+    line.push_back(c.x());
+    line.push_back(c.y());
+    line.push_back(c.z());
+  }
+  cases.push_back(line);
+  cases.push_back(line);
+
+  // Collinear, but moved
+  vecDouble moved(line);
+  applyTransform(W.current(), moved);
+  cases.push_back(line);
+  cases.push_back(moved);
+
+  // Two atoms
+  vecDouble two(6), other(6);
+  for (uint i=0; i<6; ++i) {
+    two[i] = 5.0 * rnd();
+    other[i] = 5.0 * rnd();
+  }
+  cases.push_back(two);
+  cases.push_back(other);
+
+  // Two atoms, nearly in line
+  other = two;
+  other[3] += 1e-4;
+  applyTransform(W.current(), other);
+  cases.push_back(two);
+  cases.push_back(other);
+
+  // Ten atoms on a 0.01 Angstrom scale
+  vecDouble tiny(30);
+  for (uint i=0; i<30; ++i)
+    tiny[i] = 0.01 * rnd();
+  other = tiny;
+  applyTransform(W.current(), other);
+  cases.push_back(tiny);
+  cases.push_back(other);
+
+  return(cases);
+}
+
+
+// RMSDs and fit RMSDs of the degenerate cases with the currently
+// selected superposition method
+vecDouble checkDegenerate(const vecMatrix& cases) {
+  vecDouble R;
+
+  for (uint i=0; i<cases.size(); i += 2) {
+    R.push_back(alignedRMSD(cases[i], cases[i+1]));
+
+    vecDouble frame(cases[i]);
+    applyTransform(kabsch(frame, cases[i+1]), frame);
+    R.push_back(rmsd(frame, cases[i+1]));
+  }
+
+  return(R);
+}
+
+
+double maxDifference(const vecDouble& a, const vecDouble& b) {
+  double d = 0.0;
+  for (uint i=0; i<a.size(); ++i) {
+    double e = fabs(a[i] - b[i]);
+    if (!(e <= d))    // Let a NaN through
+      d = e;
+  }
+  return(d);
+}
+
+
+void report(const string& label, const ulong npairs, const double t) {
+  cout << boost::format("%-6s %10.3f s %14.4g pairs/s\n") % label % t % (npairs / t);
+}
+
+
+
+int main(int argc, char *argv[]) {
+
+  uint natoms = 250;
+  uint nframes = 10000;
+
+  if (argc <= 3) {
+    if (argc > 1)
+      natoms = strtoul(argv[1], 0, 10);
+    if (argc > 2)
+      nframes = strtoul(argv[2], 0, 10);
+  }
+  if (argc > 3 || natoms < 3 || nframes < 2) {
+    cerr << "Usage- " << argv[0] << " [natoms [nframes]]\n";
+    cerr << fullHelpMessage();
+    exit(-1);
+  }
+
+  boost::mt19937 rng(1234);
+  boost::uniform_real<> unit(-1.0, 1.0);
+  Uniform rnd(rng, unit);
+
+  vecDouble ref = makeChain(natoms, rnd);
+  vecMatrix ensemble = makeEnsemble(ref, nframes, rnd);
+
+  // The fit is checked on uncentered coordinates, so kabsch() has
+  // to handle the centering itself...
+  superpositionMethod(SVDSuperposition);
+  vecDouble fit_svd = fitToFirst(ensemble);
+  superpositionMethod(QCPSuperposition);
+  vecDouble fit_qcp = fitToFirst(ensemble);
+
+  vecMatrix cases = degenerateCases(rnd);
+  superpositionMethod(SVDSuperposition);
+  vecDouble degen_svd = checkDegenerate(cases);
+  superpositionMethod(QCPSuperposition);
+  vecDouble degen_qcp = checkDegenerate(cases);
+
+  // Every 2-atom structure is collinear, so check the tiled engine
+  // on a small ensemble of them too
+  vecMatrix pairs = makeEnsemble(makeChain(2, rnd), 50, rnd);
+  for (uint i=0; i<pairs.size(); ++i)
+    centerAtOrigin(pairs[i]);
+  superpositionMethod(SVDSuperposition);
+  vecDouble pairs_svd = allToAll(pairs);
+  vecDouble pairs_tiled = tiledAllToAll(pairs, 1);
+
+  for (uint i=0; i<nframes; ++i)
+    centerAtOrigin(ensemble[i]);
+
+  ulong npairs = static_cast<ulong>(nframes) * (nframes - 1) / 2;
+  cout << "# " << nframes << " frames, " << natoms << " atoms, " << npairs << " pairs\n";
+
+  Timer<WallTimer> timer;
+
+  superpositionMethod(SVDSuperposition);
+  timer.start();
+  vecDouble R_svd = allToAll(ensemble);
+  double t_svd = timer.stop();
+  report("svd", npairs, t_svd);
+
+  superpositionMethod(QCPSuperposition);
+  timer.start();
+  vecDouble R_qcp = allToAll(ensemble);
+  double t_qcp = timer.stop();
+  report("qcp", npairs, t_qcp);
+
+  timer.start();
+  vecDouble R_tiled = tiledAllToAll(ensemble, 1);
+  double t_tiled = timer.stop();
+  report("tiled", npairs, t_tiled);
+
+  uint ncores = boost::thread::hardware_concurrency();
+  timer.start();
+  tiledAllToAll(ensemble, 0);
+  double t_par = timer.stop();
+  report((boost::format("x%d") % ncores).str(), npairs, t_par);
+
+  cout << boost::format("Speedup: qcp %.2fx, tiled %.2fx, tiled+threads %.2fx\n")
+    % (t_svd / t_qcp) % (t_svd / t_tiled) % (t_svd / t_par);
+
+  double drmsd = maxDifference(R_svd, R_qcp);
+  double dtiled = maxDifference(R_svd, R_tiled);
+  double dfit = maxDifference(fit_svd, fit_qcp);
+  double ddegen = maxDifference(degen_svd, degen_qcp);
+  double dpairs = maxDifference(pairs_svd, pairs_tiled);
+  cout << boost::format("Max RMSD difference:  %g\n") % drmsd;
+  cout << boost::format("Max tiled difference: %g\n") % dtiled;
+  cout << boost::format("Max fit difference:   %g\n") % dfit;
+  cout << boost::format("Max degenerate difference: %g\n") % ddegen;
+  cout << boost::format("Max 2-atom tiled difference: %g\n") % dpairs;
+
+  if (!(drmsd <= 1e-6 && dfit <= 1e-6 && dtiled <= 1e-4 && ddegen <= 1e-6 && dpairs <= 1e-4)) {
+    cout << "ERROR- SVD and QCP superpositions differ\n";
+    exit(-2);
+  }
+  cout << "SVD and QCP agree\n";
+}
@@ -185,7 +185,7 @@ int main(int argc, char *argv[]) {
 
 
   vector<XForm> transforms;
-    
+  ptraj->setAtomSubset(subset);    // Only read the atoms that are used
 
 
   // handle aligning, if requested...
@@ -194,6 +194,7 @@ int main(int argc, char *argv[]) {
     // First, parse the alignment selection and extract the
     // appropriate bits from the trajectory model...
     AtomicGroup align_subset = selectAtoms(molecule, topts->alignment);
+    ptraj->setAtomSubset(subset + align_subset);
 
     // Iteratively align the trajectory...
     if (topts->target_name.empty()) {
@@ -91,6 +91,16 @@ string fullHelpMessage(void) {
     "then some care should be taken in how many threads are used for this tool, though it is unlikely\n"
     "that there will be a conflict.\n"
     "\n"
+    "\tThe superposition is found using the QCP method (quaternion characteristic polynomial),\n"
+    "which is faster than the SVD-based Kabsch method used by earlier versions of LOOS.  The\n"
+    "two give the same RMSD to within numerical precision.  The matrix is computed in cache-sized\n"
+    "tiles by the PairwiseRMSD engine and held in single precision.  The --svd option selects the\n"
+    "old method (and the old row-by-row calculation).\n"
+    "\n"
+    "\tLarge matrices are much faster to write (and read back) in binary.  With --binary=1,\n"
+    "the matrix is written in the LOOS binary matrix format instead of ASCII.  Tools that read\n"
+    "matrices will recognize either format.\n"
+    "\n"
     "EXAMPLES\n"
     "\n"
     "\trmsds model.pdb simulation.dcd >rmsd.asc\n"
@@ -100,6 +110,9 @@ string fullHelpMessage(void) {
     "This example uses all alpha-carbons and every frame in the trajectory, run\n"
     "in parallel with 8 threads of execution.\n"
     "\n"
+    "\trmsds --threads=8 --binary=1 model.pdb simulation.dcd >rmsd.lmat\n"
+    "As above, but the matrix is written in binary format.\n"
+    "\n"
     "\trmsds inactive.pdb inactive.dcd active.pdb active.dcd >rmsd.asc\n"
     "This example uses all alpha-carbons and compares the \"inactive\" simulation\n"
     "with the \"active\" one.\n"
@@ -141,7 +154,8 @@ public:
       ("sel2", po::value<string>(&sel2)->default_value("name == 'CA'"), "Atom selection for second system")
       ("skip2", po::value<uint>(&skip2)->default_value(0), "Skip n-frames of second trajectory")
       ("range2", po::value<string>(&range2), "Matlab-style range of frames to use from second trajectory")
-      ("stats", po::value<bool>(&stats)->default_value(false), "Show some statistics for matrix");
+      ("stats", po::value<bool>(&stats)->default_value(false), "Show some statistics for matrix")
+      ("svd", po::value<bool>(&svd)->default_value(false), "Use SVD (Kabsch) rather than QCP for the superposition");
 
   }
 
@@ -173,8 +187,9 @@ public:
 
   string print() const {
     ostringstream oss;
-    oss << boost::format("stats=%d,noout=%d,nthreads=%d,sel1='%s',skip1=%d,range1='%s',sel2='%s',skip2=%d,range2='%s',model1='%s',traj1='%s',model2='%s',traj2='%s'")
+    oss << boost::format("stats=%d,svd=%d,noout=%d,nthreads=%d,sel1='%s',skip1=%d,range1='%s',sel2='%s',skip2=%d,range2='%s',model1='%s',traj1='%s',model2='%s',traj2='%s'")
       % stats
+      % svd
       % noop
       % nthreads
       % sel1
@@ -193,6 +208,7 @@ public:
 
 
   bool stats;
+  bool svd;
   bool noop;
   uint skip1, skip2;
   uint nthreads;
@@ -419,7 +435,8 @@ public:
 // --------------------------------------------------------------------------------------
 
 
-void showStatsHalf(const RealMatrix& R) {
+template<class M>
+void showStatsHalf(const M& R) {
   uint total = (R.rows() * (R.rows()-1)) / 2; 
 
   double avg = 0.0;
@@ -454,6 +471,18 @@ void showStatsWhole(const RealMatrix& R) {
 
 
 
+template<class M>
+void writeMatrix(const M& R, const string& header, const bool binary) {
+  if (binary) {
+    writeBinaryMatrix(cout, R, header);
+    return;
+  }
+  cout << "# " << header << endl;
+  cout << setprecision(matrix_precision) << R;
+}
+
+
+
 void centerTrajectory(alignment::vecMatrix& U) {
   for (uint i=0; i<U.size(); ++i)
     alignment::centerAtOrigin(U[i]);
@@ -489,14 +518,18 @@ int main(int argc, char *argv[]) {
   
   opts::BasicOptions* bopts = new opts::BasicOptions(fullHelpMessage());
   ToolOptions* topts = new ToolOptions;
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
 
   opts::AggregateOptions options;
-  options.add(bopts).add(topts);
+  options.add(bopts).add(topts).add(mopts);
   if (!options.parse(argc, argv))
     exit(-1);
 
   verbosity = bopts->verbosity;
   report_stats = (verbosity || topts->noop);
+  if (topts->svd)
+    alignment::superpositionMethod(alignment::SVDSuperposition);
+
   AtomicGroup model = createSystem(topts->model1);
   pTraj traj = createTrajectory(topts->traj1, model);
   AtomicGroup subset = selectAtoms(model, topts->sel1);
@@ -509,28 +542,50 @@ int main(int argc, char *argv[]) {
     cerr << "Using " << nthreads << " threads\n";
     cerr << "Reading trajectory - " << topts->traj1 << endl;
   }
+  traj->setAtomSubset(subset);    // Only read the atoms that are used
   vMatrix T = readCoords(subset, traj, indices, verbosity > 1);
   used_memory += T.size() * T[0].size() * sizeof(vMatrix::value_type::value_type);   // Coords matrix
-  used_memory += T.size() * T.size() * sizeof(RealMatrix::element_type);             // RMSDS matrix
+  if (topts->model2.empty()) {
+    if (topts->svd)
+      used_memory += T.size() * T.size() * sizeof(RealMatrix::element_type);         // RMSDS matrix
+    else {
+      used_memory += T.size() * T[0].size() * sizeof(double);                        // Engine's packed coords
+      used_memory += T.size() * (T.size() + 1) / 2
+        * sizeof(PairwiseRMSD::TriangularMatrix::element_type);                       // Lower half of RMSDS matrix
+    }
+  }
   checkMemoryUsage(mem);
   centerTrajectory(T);
 
-  RealMatrix M;
   if (topts->model2.empty()) {
 
     if (verbosity > 1)
       cerr << "Calculating RMSD...\n";
-    M = RealMatrix(T.size(), T.size());
-    Master master(T.size(), true, verbosity);
-    SingleWorker worker(&M, &T, &master);
-    Threader<SingleWorker> threads(&worker, nthreads);
-    threads.join();
-    if (verbosity) 
-      master.updateStatus();
-    
-    if (verbosity || topts->noop || topts->stats)
-      showStatsHalf(M);
-    
+
+    if (topts->svd) {
+      RealMatrix M(T.size(), T.size());
+      Master master(T.size(), true, verbosity);
+      SingleWorker worker(&M, &T, &master);
+      Threader<SingleWorker> threads(&worker, nthreads);
+      threads.join();
+      if (verbosity) 
+        master.updateStatus();
+
+      if (verbosity || topts->noop || topts->stats)
+        showStatsHalf(M);
+      if (!topts->noop)
+        writeMatrix(M, header, mopts->binary);
+
+    } else {
+      PairwiseRMSD engine(T);
+      PairwiseRMSD::TriangularMatrix M = engine.allToAll(nthreads);
+
+      if (verbosity || topts->noop || topts->stats)
+        showStatsHalf(M);
+      if (!topts->noop)
+        writeMatrix(M, header, mopts->binary);
+    }
+
   } else {
     AtomicGroup model2 = createSystem(topts->model2);
     pTraj traj2 = createTrajectory(topts->traj2, model2);
@@ -539,33 +594,38 @@ int main(int argc, char *argv[]) {
 
     if (verbosity > 1)
       cerr << "Reading trajectory - " << topts->traj2 << endl;
+    traj2->setAtomSubset(subset2);
     vMatrix T2 = readCoords(subset2, traj2, indices2, verbosity > 1);
     used_memory += T2.size() * T2[0].size() * sizeof(double);
+    used_memory += T.size() * T2.size() * sizeof(RealMatrix::element_type);           // RMSDS matrix
+    if (!topts->svd)
+      used_memory += (T.size() * T[0].size() + T2.size() * T2[0].size()) * sizeof(double);   // Engines' packed coords
     checkMemoryUsage(mem);
     centerTrajectory(T2);
 
     if (verbosity > 1)
       cerr << "Calculating RMSD...\n";
-    M = RealMatrix(T.size(), T2.size());
-    Master master(T.size(), false, verbosity);
-    DualWorker worker(&M, &T, &T2, &master);
-    Threader<DualWorker> threads(&worker, nthreads);
-    threads.join();
 
-    if (verbosity)
-      master.updateStatus();
+    RealMatrix M;
+    if (topts->svd) {
+      M = RealMatrix(T.size(), T2.size());
+      Master master(T.size(), false, verbosity);
+      DualWorker worker(&M, &T, &T2, &master);
+      Threader<DualWorker> threads(&worker, nthreads);
+      threads.join();
+
+      if (verbosity)
+        master.updateStatus();
+    } else {
+      PairwiseRMSD engine1(T);
+      PairwiseRMSD engine2(T2);
+      M = engine1.allToAll(engine2, nthreads);
+    }
 
     if (verbosity || topts->noop || topts->stats)
       showStatsWhole(M);
-  }
-
-  if (!topts->noop) {
-    cout << "# " << header << endl;
-    cout << setprecision(matrix_precision) << M;
+    if (!topts->noop)
+      writeMatrix(M, header, mopts->binary);
   }
 
 }
-
-
-  
-
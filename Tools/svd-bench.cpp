@@ -0,0 +1,181 @@
+/*
+  svd-bench.cpp
+
+  Micro-benchmark for the full and truncated SVDs
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <loos.hpp>
+
+#include <boost/random.hpp>
+
+
+using namespace std;
+using namespace loos;
+
+
+string fullHelpMessage(void) {
+  string msg =
+    "\n"
+    "SYNOPSIS\n"
+    "\tBenchmark and cross-check the truncated SVDs\n"
+    "\n"
+    "DESCRIPTION\n"
+    "\n"
+    "\tBuilds a synthetic, mean-centered 3N x T \"trajectory\" matrix whose\n"
+    "variance falls off the way a protein's PCA typically does (a few large\n"
+    "collective modes on top of many small ones), then times the full SVD (as\n"
+    "svd uses) against the randomized and incremental truncated SVDs (as svd\n"
+    "--modes uses).  For each truncated SVD, the largest relative error in the\n"
+    "singular values and the smallest overlap between matching left singular\n"
+    "vectors are reported.\n"
+    "\n"
+    "\tThe default is 600 atoms, 4,000 frames, and 20 modes.\n"
+    "\n"
+    "EXAMPLES\n"
+    "\n"
+    "\tsvd-bench\n"
+    "\tBenchmark the default 600 atom, 4,000 frame matrix\n"
+    "\n"
+    "\tsvd-bench 2000 10000 50\n"
+    "\tBenchmark the first 50 modes of a 2,000 atom, 10,000 frame matrix\n"
+    "\n"
+    "SEE ALSO\n"
+    "\tsvd, big-svd\n";
+
+  return(msg);
+}
+
+
+
+typedef boost::variate_generator<boost::mt19937&, boost::normal_distribution<> >   Gaussian;
+
+
+// A = U0 * diag(s0) * V0' + noise, with s0 decaying as 1/i
+DoubleMatrix makeMatrix(const uint m, const uint n, Gaussian& rnd) {
+  uint r = min(200u, min(m, n));
+
+  DoubleMatrix U0(m, r);
+  for (ulong i=0; i<U0.size(); ++i)
+    U0[i] = rnd();
+  DoubleMatrix V0(r, n);
+  for (uint i=0; i<n; ++i)
+    for (uint j=0; j<r; ++j)
+      V0(j, i) = rnd() * 10.0 / (j + 1);
+
+  DoubleMatrix A = Math::MMMultiply(U0, V0);
+  for (ulong i=0; i<A.size(); ++i)
+    A[i] += rnd() * 0.05;
+
+  for (uint j=0; j<m; ++j) {
+    double avg = 0.0;
+    for (uint i=0; i<n; ++i)
+      avg += A(j, i);
+    avg /= n;
+    for (uint i=0; i<n; ++i)
+      A(j, i) -= avg;
+  }
+
+  return(A);
+}
+
+
+// Reports how closely the first k terms match the full SVD
+void compare(const string& label, const double t, const DoubleMatrix& U, const DoubleMatrix& S,
+             const DoubleMatrix& Uf, const DoubleMatrix& Sf, const uint k) {
+  double serr = 0.0;
+  double overlap = 1.0;
+
+  for (uint i=0; i<k; ++i) {
+    serr = max(serr, fabs(S[i] - Sf[i]) / Sf[i]);
+    double d = 0.0;
+    for (uint j=0; j<U.rows(); ++j)
+      d += U(j, i) * Uf(j, i);
+    overlap = min(overlap, fabs(d));
+  }
+
+  cout << boost::format("%-12s %10.3f s   max s error %10.4g   min U overlap %.8f\n") % label % t % serr % overlap;
+}
+
+
+
+int main(int argc, char *argv[]) {
+
+  uint natoms = 600;
+  uint nframes = 4000;
+  uint k = 20;
+
+  if (argc <= 4) {
+    if (argc > 1)
+      natoms = strtoul(argv[1], 0, 10);
+    if (argc > 2)
+      nframes = strtoul(argv[2], 0, 10);
+    if (argc > 3)
+      k = strtoul(argv[3], 0, 10);
+  }
+  if (argc > 4 || natoms < 1 || nframes < 2 || k < 1 || k > min(3 * natoms, nframes)) {
+    cerr << "Usage- " << argv[0] << " [natoms [nframes [modes]]]\n";
+    cerr << fullHelpMessage();
+    exit(-1);
+  }
+
+  boost::mt19937 rng(1234);
+  boost::normal_distribution<> unit(0.0, 1.0);
+  Gaussian rnd(rng, unit);
+  rng_singleton().seed(5678);
+
+  DoubleMatrix A = makeMatrix(3 * natoms, nframes, rnd);
+  cout << "# " << A.rows() << " x " << A.cols() << " matrix, " << k << " modes\n";
+
+  Timer<WallTimer> timer;
+
+  DoubleMatrix B = A.copy();
+  timer.start();
+  boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> full = Math::svd(B);
+  double t_full = timer.stop();
+  B.reset();
+  cout << boost::format("%-12s %10.3f s\n") % "full" % t_full;
+
+  DoubleMatrix Uf = boost::get<0>(full);
+  DoubleMatrix Sf = boost::get<1>(full);
+
+  timer.start();
+  boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> rsvd = Math::svd(A, k);
+  double t_rand = timer.stop();
+  compare("randomized", t_rand, boost::get<0>(rsvd), boost::get<1>(rsvd), Uf, Sf, k);
+
+  timer.start();
+  Math::IncrementalSVD isvd(k);
+  for (uint i=0; i<nframes; i += 1024)
+    isvd.update(Math::submatrix(A, Math::Range(0, A.rows()), Math::Range(i, min(i + 1024, nframes))));
+  DoubleMatrix Ui = isvd.U();
+  DoubleMatrix Si = isvd.S();
+  double t_inc = timer.stop();
+  compare("incremental", t_inc, Ui, Si, Uf, Sf, k);
+
+  cout << boost::format("Speedup: randomized %.2fx, incremental %.2fx\n") % (t_full / t_rand) % (t_full / t_inc);
+}
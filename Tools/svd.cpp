@@ -71,7 +71,11 @@ public:
     alignment_tol(1e-6),
     splitv(true),
     autoname(true),
-    terms(0)
+    terms(0),
+    modes(0),
+    incremental(false),
+    power_iterations(2),
+    blocksize(1024)
   { }
 
 
@@ -84,7 +88,11 @@ public:
       ("source", po::value<bool>(&include_source)->default_value(include_source), "Write out source conformation matrix")
       ("splitv", po::value<bool>(&splitv)->default_value(splitv), "Automatically split V matrix (when using multiple trajectories)")
       ("autoname", po::value<bool>(&autoname)->default_value(autoname), "Automatically name V files based on traj filename")
-      ("terms", po::value<uint>(&terms), "# of terms of the SVD to output");
+      ("terms", po::value<uint>(&terms), "# of terms of the SVD to output")
+      ("modes", po::value<uint>(&modes)->default_value(modes), "Only calculate this many modes, streaming the trajectory (0 = full SVD)")
+      ("incremental", po::value<bool>(&incremental)->default_value(incremental), "Use a single-pass incremental SVD for --modes")
+      ("power", po::value<uint>(&power_iterations)->default_value(power_iterations), "Power iterations for the randomized SVD used by --modes")
+      ("block", po::value<uint>(&blocksize)->default_value(blocksize), "Frames to read at a time for --modes");
   }
 
 
@@ -92,6 +100,22 @@ public:
     if (autoname)
       splitv = true;
 
+    if (modes) {
+      if (include_source) {
+        cerr << "Error- cannot write the source matrix when using --modes\n";
+        return(false);
+      }
+      if (terms && terms != modes) {
+        cerr << "Error- --terms and --modes must match\n";
+        return(false);
+      }
+      if (blocksize == 0) {
+        cerr << "Error- --block must be at least one frame\n";
+        return(false);
+      }
+      terms = modes;
+    }
+
     return(true);
   }
 
@@ -100,7 +124,7 @@ public:
   string print() const {
     ostringstream oss;
 
-    oss << boost::format("align='%s', svd='%s', tolerance=%f, noalign=%d, source=%d, splitv=%d, autoname=%d, terms=%d")
+    oss << boost::format("align='%s', svd='%s', tolerance=%f, noalign=%d, source=%d, splitv=%d, autoname=%d, terms=%d, modes=%d, incremental=%d, power=%d, block=%d")
       % alignment_string
       % svd_string
       % noalign
@@ -108,7 +132,11 @@ public:
       % alignment_tol
       % splitv
       % autoname
-      % terms;
+      % terms
+      % modes
+      % incremental
+      % power_iterations
+      % blocksize;
     return(oss.str());
   }
 
@@ -118,6 +146,9 @@ public:
   double alignment_tol;
   bool splitv, autoname;
   uint terms;
+  uint modes;
+  bool incremental;
+  uint power_iterations, blocksize;
 };
 
 // @endcond
@@ -171,6 +202,24 @@ string s =
   "The singular values are just the square roots of the PCA eigenvalues,\n"
   "and are in Angstroms.\n"
   "\n"
+  "LARGE TRAJECTORIES\n"
+  "\n"
+  "The full SVD needs the entire coordinate matrix in memory, and its cost\n"
+  "grows with the cube of the matrix size.  When only the first few modes\n"
+  "are needed, the --modes option computes just those, reading the trajectory\n"
+  "a block of frames (--block) at a time.  By default, a randomized SVD is\n"
+  "used.  This makes a few passes through the trajectory (2 plus the number of\n"
+  "--power iterations), and is very accurate for the leading modes.  With\n"
+  "--incremental, the SVD (and average structure) is instead updated as each\n"
+  "block is read, requiring one pass for U and s and a second for V.  This is\n"
+  "slightly less accurate for the last few modes requested.  --source is not\n"
+  "available with --modes.\n"
+  "\n"
+  "Writing (and reading) large ASCII matrices can take longer than the\n"
+  "SVD itself.  With --binary=1, all matrices are written in the LOOS\n"
+  "binary matrix format instead, with a .lmat suffix rather than .asc.\n"
+  "Tools that read matrices will recognize either format.\n"
+  "\n"
   //
   "EXAMPLES\n"
   "\n"
@@ -200,6 +249,10 @@ string s =
   "\twe are not aligning the trajectory.  Finally, we are now computing the \n"
   "\tPCs of all heavy atoms in the protein (segid PROT).\n"
   "\t\n"
+  "svd --modes 20 -S '!hydrogen' model.pdb long_traj.dcd\n"
+  "\tComputes only the first 20 PCs of the heavy atoms, without storing\n"
+  "\tthe trajectory in memory.\n"
+  "\t\n"
   "\t\n"
   //
   "SEE ALSO\n"
@@ -312,26 +365,114 @@ void write_map(const string& fname, const AtomicGroup& grp) {
 }
 
 
-void writeMatrixChunk(opts::OutputPrefix* popts, opts::MultiTrajOptions* tropts, ToolOptions* topts, const Matrix& Vt, const Math::Range& start, const Math::Range& end, const string& header, const uint index) {
+void writeMatrixChunk(opts::OutputPrefix* popts, opts::MultiTrajOptions* tropts, ToolOptions* topts, opts::MatrixOutputOptions* mopts, const Matrix& Vt, const Math::Range& start, const Math::Range& end, const string& header, const uint index) {
   string filename;
 
   if (topts->autoname) {
     boost::filesystem::path p(tropts->mtraj[index]->filename());
 #if BOOST_FILESYSTEM_VERSION >= 3
-    filename = p.stem().string() + "_V.asc";
+    filename = p.stem().string() + "_V" + mopts->suffix();
 #else
-    filename = p.stem() + "_V.asc";
+    filename = p.stem() + "_V" + mopts->suffix();
 #endif
   } else {
     ostringstream oss;
-    oss << boost::format("%s_V_%04d.asc") % popts->prefix % index;
+    oss << boost::format("%s_V_%04d%s") % popts->prefix % index % mopts->suffix();
     filename = oss.str();
   }
 
-  writeAsciiMatrix(filename, Vt, header, start, end, true);
+  writeMatrix(filename, Vt, header, start, end, mopts->binary, true);
+}
+
+
+
+
+// Writes U, S, and V (split by trajectory if requested), honoring
+// the number of terms requested
+void writeResults(opts::OutputPrefix* popts, opts::MultiTrajOptions* tropts, ToolOptions* topts, opts::MatrixOutputOptions* mopts, const Matrix& U, const Matrix& S, const Matrix& Vt) {
+  int m = U.rows();
+  int n = Vt.cols();
+  int sn = S.rows();
+
+  Math::Range orig(0,0);
+  Math::Range Usize(m,m);
+  Math::Range Ssize(sn,1);
+  Math::Range Vsize(sn,n);
+
+  if (topts->terms) {
+    int terms = static_cast<int>(topts->terms);
+    if (terms > m || terms > sn || terms > n) {
+      cerr << "ERROR- The number of terms requested exceeds matrix dimensions.\n";
+      exit(-1);
+    }
+    Usize = Math::Range(m, terms);
+    Ssize = Math::Range(terms, 1);
+    Vsize = Math::Range(terms, n);
+  }
+
+  writeMatrix(prefix + "_U" + mopts->suffix(), U, header, orig, Usize, mopts->binary);
+  writeMatrix(prefix + "_s" + mopts->suffix(), S, header, orig, Ssize, mopts->binary);
+
+  if (topts->splitv && tropts->mtraj.size() > 1) {
+    // Need to reconstruct what row-ranges correspond to the input trajectories...
+    uint a = 0;
+    uint curtraj = 0;
+    int terms = topts->terms ? static_cast<int>(topts->terms) : sn;
+
+    for (uint i=0; i<n; ++i) {
+      MultiTrajectory::Location loc = tropts->mtraj.frameIndexToLocation(i);
+      if (loc.first != curtraj) {
+        writeMatrixChunk(popts, tropts, topts, mopts, Vt, Math::Range(0, a), Math::Range(terms, i), header, curtraj);
+        a = i;
+        curtraj = loc.first;
+      }
+    }
+
+    writeMatrixChunk(popts, tropts, topts, mopts, Vt, Math::Range(0, a), Math::Range(terms, n), header, curtraj);
+    
+  } else
+    writeMatrix(prefix + "_V" + mopts->suffix(), Vt, header, orig, Vsize, mopts->binary, true);
 }
 
 
+// PCA of the first few modes only.  The coordinates are streamed from
+// the trajectory a block at a time rather than held in memory.
+boost::tuple<Matrix, Matrix, Matrix> truncatedSVD(const AtomicGroup& subset, const vector<XForm>& xforms, pTraj traj, const vector<uint>& indices, ToolOptions* topts) {
+  TrajectoryMatrix A(subset, traj, indices, xforms);
+  Matrix U, S, Vt;
+
+  if (topts->incremental) {
+    // One pass for U and S (and the average), another for V.  Tracking
+    // extra terms keeps the last few modes requested accurate.
+    Math::IncrementalSVD isvd(topts->modes, true, max(10u, 2 * topts->modes));
+    for (uint i=0; i<A.cols(); i += topts->blocksize)
+      isvd.update(A.columns(i, min(i + topts->blocksize, A.cols())));
+    U = isvd.U();
+    S = isvd.S();
+
+    Matrix mean = isvd.mean();
+    AtomicGroup avg = subset.copy();
+    for (uint i=0; i<avg.size(); ++i)
+      avg[i]->coords(GCoord(mean[3*i], mean[3*i+1], mean[3*i+2]));
+    writeAverage(avg);
+
+    A.average(avg);
+    Vt = Math::rightSingularVectors(A, U, S, topts->blocksize);
+
+  } else {
+    AtomicGroup avg = averageStructure(subset, xforms, traj, indices);
+    writeAverage(avg);
+
+    A.average(avg);
+    boost::tuple<Matrix, Matrix, Matrix> res = Math::svd(A, topts->modes, 10, topts->power_iterations, topts->blocksize);
+    U = boost::get<0>(res);
+    S = boost::get<1>(res);
+    Vt = boost::get<2>(res);
+  }
+
+  return(boost::tuple<Matrix, Matrix, Matrix>(U, S, Vt));
+}
+
 
 
 int main(int argc, char *argv[]) {
@@ -340,9 +481,10 @@ int main(int argc, char *argv[]) {
   opts::OutputPrefix* popts = new opts::OutputPrefix;
   opts::MultiTrajOptions* tropts = new opts::MultiTrajOptions;
   ToolOptions* topts = new ToolOptions;
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
 
   opts::AggregateOptions options;
-  options.add(bhopts).add(popts).add(tropts).add(topts);
+  options.add(bhopts).add(popts).add(tropts).add(topts).add(mopts);
   if (!options.parse(argc, argv))
     exit(-1);
 
@@ -362,14 +504,33 @@ int main(int argc, char *argv[]) {
   if (topts->noalign) {
     // Make noop xforms to prevent doing any alignment...
     cerr << argv[0] << ": SKIPPING ALIGNMENT\n";
+    ptraj->setAtomSubset(svdsub);    // Only read the atoms that are used
     for (uint i=0; i<indices.size(); ++i)
       xforms.push_back(XForm());
   } else {
     AtomicGroup alignsub = selectAtoms(model, topts->alignment_string);
+    ptraj->setAtomSubset(svdsub + alignsub);
     cerr << argv[0] << ": Aligning...\n";
     xforms = doAlign(alignsub, ptraj, indices, topts->alignment_tol);   // Honors indices
   }
 
+  if (topts->modes) {
+    cerr << boost::format("%s: Calculating %s SVD of the first %d modes...\n")
+      % argv[0]
+      % (topts->incremental ? "incremental" : "randomized")
+      % topts->modes;
+    Timer<WallTimer> timer;
+    timer.start();
+    boost::tuple<Matrix, Matrix, Matrix> res = truncatedSVD(svdsub, xforms, ptraj, indices, topts);
+    timer.stop();
+    cerr << argv[0] << ": Done!  Calculation took " << timeAsString(timer.elapsed()) << endl;
+
+    cerr << argv[0] << ": Writing results...\n";
+    writeResults(popts, tropts, topts, mopts, boost::get<0>(res), boost::get<1>(res), boost::get<2>(res));
+    cerr << argv[0] << ": done!\n";
+    exit(0);
+  }
+
   cerr << argv[0] << ": Extracting coordinates...\n";
   Matrix A = extractCoords(svdsub, xforms, ptraj, indices);   // Honors indices
   f77int m = A.rows();
@@ -378,7 +539,7 @@ int main(int argc, char *argv[]) {
 
 
   if (topts->include_source)
-    writeAsciiMatrix(prefix + "_A.asc", A, header);
+    writeMatrix(prefix + "_A" + mopts->suffix(), A, header, mopts->binary);
 
   double estimate = static_cast<double>(m)*m*sizeof(svdreal) + static_cast<double>(n)*n*sizeof(svdreal) + static_cast<double>(m)*n*sizeof(svdreal) + sn*sizeof(svdreal);
   cerr << boost::format("%s: Allocating estimated %.3f GB for %d x %d SVD\n")
@@ -423,46 +584,9 @@ int main(int argc, char *argv[]) {
   }
 
 
-  Math::Range orig(0,0);
-  Math::Range Usize(m,m);
-  Math::Range Ssize(sn,1);
-  Math::Range Vsize(sn,n);
-
-  if (topts->terms) {
-    int terms = static_cast<int>(topts->terms);
-    if (terms > m || terms > sn || terms > n) {
-      cerr << "ERROR- The number of terms requested exceeds matrix dimensions.\n";
-      exit(-1);
-    }
-    Usize = Math::Range(m, terms);
-    Ssize = Math::Range(terms, 1);
-    Vsize = Math::Range(terms, n);
-  }
-
   cerr << argv[0] << ": Writing results...\n";
-  writeAsciiMatrix(prefix + "_U.asc", U, header, orig, Usize);
-  writeAsciiMatrix(prefix + "_s.asc", S, header, orig, Ssize);
-
-  if (topts->splitv && tropts->mtraj.size() > 1) {
-    // Need to reconstruct what row-ranges correspond to the input trajectories...
-    uint a = 0;
-    uint curtraj = 0;
-    int terms = topts->terms ? static_cast<int>(topts->terms) : sn;
+  writeResults(popts, tropts, topts, mopts, U, S, Vt);
 
-    for (uint i=0; i<n; ++i) {
-      MultiTrajectory::Location loc = tropts->mtraj.frameIndexToLocation(i);
-      if (loc.first != curtraj) {
-        writeMatrixChunk(popts, tropts, topts, Vt, Math::Range(0, a), Math::Range(terms, i), header, curtraj);
-        a = i;
-        curtraj = loc.first;
-      }
-    }
-
-    writeMatrixChunk(popts, tropts, topts, Vt, Math::Range(0, a), Math::Range(terms, n), header, curtraj);
-    
-  } else
-    writeAsciiMatrix(prefix + "_V.asc", Vt, header, orig, Vsize, true);
-  
   cerr << argv[0] << ": done!\n";
 
   delete[] work;
@@ -148,11 +148,12 @@ int main(int argc, char *argv[]) {
   }
 
   Matrix U;
-  readAsciiMatrix(ropts->value("svd_prefix") + "_U.asc", U);
+  string lsv_name = findMatrixFile(ropts->value("svd_prefix") + "_U");
+  readMatrix(lsv_name, U);
   uint m = U.rows();
   uint n = U.cols();
 
-  cerr << "Read in " << m << " x " << n << " matrix from " << ropts->value("svd_prefix") + "_U.asc" << endl;
+  cerr << "Read in " << m << " x " << n << " matrix from " << lsv_name << endl;
 
   if (m % 3 != 0) {
     cerr << "Error- dimensions of LSVs are bad.\n";
@@ -167,8 +168,9 @@ int main(int argc, char *argv[]) {
   }
 
   Matrix S;
-  readAsciiMatrix(ropts->value("svd_prefix") + "_s.asc", S);
-  cerr << "Read in " << S.rows() << " singular values from " << ropts->value("svd_prefix") + "_s.asc" << endl;
+  string sval_name = findMatrixFile(ropts->value("svd_prefix") + "_s");
+  readMatrix(sval_name, S);
+  cerr << "Read in " << S.rows() << " singular values from " << sval_name << endl;
 
   pAtom pa;
   AtomicGroup::Iterator iter(model);
@@ -183,9 +183,10 @@ int main(int argc, char *argv[]) {
   opts::BasicSelection* sopts = new opts::BasicSelection("backbone");
   opts::TrajectoryWithFrameIndices* tropts = new opts::TrajectoryWithFrameIndices;
   ToolOptions* topts = new ToolOptions;
+  opts::MatrixOutputOptions* mopts = new opts::MatrixOutputOptions;
   
   opts::AggregateOptions options;
-  options.add(bopts).add(sopts).add(tropts).add(topts);
+  options.add(bopts).add(sopts).add(tropts).add(topts).add(mopts);
   if (!options.parse(argc, argv))
     exit(-1);
 
@@ -240,7 +241,7 @@ int main(int argc, char *argv[]) {
     devs[j] = sqrt(devs[j]/(n-1));
 
   if (! topts->timeseries_filename.empty())
-    writeAsciiMatrix(topts->timeseries_filename, M, hdr);
+    writeMatrix(topts->timeseries_filename, M, hdr, mopts->binary);
 
   cout << "# " << hdr << endl;
   cout << "# out of bounds = " << out_of_bounds << endl;
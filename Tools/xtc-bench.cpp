@@ -0,0 +1,508 @@
+/*
+  xtc-bench.cpp
+
+  Micro-benchmark for the XTC decoder
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017 Tod D. Romo
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <loos.hpp>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <unistd.h>
+
+#include <boost/random.hpp>
+
+
+using namespace std;
+using namespace loos;
+
+
+string fullHelpMessage(void) {
+  string msg =
+    "\n"
+    "SYNOPSIS\n"
+    "\tBenchmark the XTC decoder\n"
+    "\n"
+    "DESCRIPTION\n"
+    "\n"
+    "\tWrites a synthetic water box to an XTC (or uses an existing XTC), loads\n"
+    "it into memory, and times decoding every frame with both the original\n"
+    "byte-at-a-time xdrfile decoder and the LOOS XTC class.  Frames/s and\n"
+    "atoms/s are reported for each, and the decoded coordinates are checked\n"
+    "to make sure they are bit-for-bit identical.\n"
+    "\n"
+    "\tThe default is a 1,000,002 atom system with 10 frames.\n"
+    "\n"
+    "EXAMPLES\n"
+    "\n"
+    "\txtc-bench\n"
+    "\tBenchmark the default 1M atom synthetic system\n"
+    "\n"
+    "\txtc-bench 30000 100\n"
+    "\tBenchmark a 30,000 atom system with 100 frames\n"
+    "\n"
+    "\txtc-bench -f sim.xtc\n"
+    "\tBenchmark using an existing trajectory\n"
+    "\n"
+    "SEE ALSO\n"
+    "\txtcinfo, trajinfo\n";
+
+  return(msg);
+}
+
+
+// ----------------------------------------------------------------------
+// The original decoder (from the xdrfile library), kept here as the
+// reference implementation...
+
+namespace legacy {
+
+  const int magicints[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 10, 12, 16, 20, 25, 32, 40, 50, 64,
+    80, 101, 128, 161, 203, 256, 322, 406, 512, 645, 812, 1024, 1290,
+    1625, 2048, 2580, 3250, 4096, 5060, 6501, 8192, 10321, 13003,
+    16384, 20642, 26007, 32768, 41285, 52015, 65536,82570, 104031,
+    131072, 165140, 208063, 262144, 330280, 416127, 524287, 660561,
+    832255, 1048576, 1321122, 1664510, 2097152, 2642245, 3329021,
+    4194304, 5284491, 6658042, 8388607, 10568983, 13316085, 16777216
+  };
+
+  const int firstidx = 9;
+
+
+  int sizeofint(int size) {
+    int n = 0;
+    while ( size > 0 ) {
+      size >>= 1;
+      ++n;
+    }
+    return(n);
+  }
+
+
+  int sizeofints(uint* data, const uint n) {
+    uint nbytes = 1;
+    uint bytes[32];
+    uint nbits = 0;
+
+    bytes[0] = 1;
+    for (uint i = 0; i < n; ++i) {
+      uint tmp = 0;
+      uint bytecnt;
+      for (bytecnt = 0; bytecnt < nbytes; ++bytecnt) {
+        tmp += bytes[bytecnt] * data[i];
+        bytes[bytecnt] = tmp & 0xff;
+        tmp >>= 8;
+      }
+      while (tmp != 0) {
+        bytes[bytecnt++] = tmp & 0xff;
+        tmp >>= 8;
+      }
+      nbytes = bytecnt;
+    }
+
+    uint num = 1;
+    --nbytes;
+    while (bytes[nbytes] >= num) {
+      ++nbits;
+      num *= 2;
+    }
+
+    return(nbits + nbytes*8);
+  }
+
+
+  int decodebits(int* buf, uint nbits) {
+    int mask = (1 << nbits) -1;
+
+    unsigned char *cbuf = reinterpret_cast<unsigned char*>(buf) + 3*sizeof(*buf);
+    int cnt = buf[0];
+    uint lastbits = static_cast<uint>(buf[1]);
+    uint lastbyte = static_cast<uint>(buf[2]);
+
+    int num = 0;
+    while (nbits >= 8) {
+      lastbyte = ( lastbyte << 8 ) | cbuf[cnt++];
+      num |=  (lastbyte >> lastbits) << (nbits - 8);
+      nbits -=8;
+    }
+    if (nbits > 0) {
+      if (lastbits < nbits) {
+        lastbits += 8;
+        lastbyte = (lastbyte << 8) | cbuf[cnt++];
+      }
+      lastbits -= nbits;
+      num |= (lastbyte >> lastbits) & ((1 << nbits) -1);
+    }
+    num &= mask;
+    buf[0] = cnt;
+    buf[1] = static_cast<int>(lastbits);
+    buf[2] = static_cast<int>(lastbyte);
+
+    return(num);
+  }
+
+
+  void decodeints(int* buf, const int nints, int nbits, uint* sizes, int* nums) {
+    int bytes[32];
+    int i, j, num_of_bytes, p, num;
+
+    bytes[1] = bytes[2] = bytes[3] = 0;
+    num_of_bytes = 0;
+    while (nbits > 8) {
+      bytes[num_of_bytes++] = decodebits(buf, 8);
+      nbits -= 8;
+    }
+    if (nbits > 0) {
+      bytes[num_of_bytes++] = decodebits(buf, nbits);
+    }
+    for (i = nints-1; i > 0; i--) {
+      num = 0;
+      for (j = num_of_bytes-1; j >=0; j--) {
+        num = (num << 8) | bytes[j];
+        p = num / sizes[i];
+        bytes[j] = p;
+        num = num - p * sizes[i];
+      }
+      nums[i] = num;
+    }
+    nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
+  }
+
+
+  // Reads one frame (header and coordinates), returning false at EOF
+  bool readFrame(internal::XDRReader& xdr, vector<GCoord>& coords) {
+    int magic;
+    if (!xdr.read(magic))
+      return(false);
+    if (magic != 1995)
+      throw(LOOSError("Invalid XTC magic number"));
+
+    uint natoms, step;
+    float time, box[9];
+    xdr.read(natoms);
+    xdr.read(step);
+    xdr.read(time);
+    xdr.read(box, 9);
+
+    coords.clear();
+
+    int lsize;
+    xdr.read(lsize);
+    uint size3 = lsize * 3;
+    if (lsize <= 9) {
+      vector<float> tmp(size3);
+      xdr.read(&tmp[0], size3);
+      for (uint i=0; i<size3; i += 3)
+        coords.push_back(GCoord(tmp[i], tmp[i+1], tmp[i+2]) * 10.0);
+      return(true);
+    }
+
+    float precision;
+    xdr.read(precision);
+
+    static vector<int> intbuf1, intbuf2;
+    uint size3padded = static_cast<uint>(size3 * 1.2);
+    if (intbuf1.size() < size3padded) {
+      intbuf1.resize(size3padded);
+      intbuf2.resize(size3padded);
+    }
+    int* buf1 = &intbuf1[0];
+    int* buf2 = &intbuf2[0];
+    buf2[0] = buf2[1] = buf2[2] = 0;
+
+    int minint[3], maxint[3];
+    uint sizeint[3], sizesmall[3], bitsizeint[3] = {0, 0, 0};
+    uint bitsize;
+    xdr.read(minint, 3);
+    xdr.read(maxint, 3);
+    for (int k=0; k<3; ++k)
+      sizeint[k] = maxint[k] - minint[k] + 1;
+
+    if ((sizeint[0] | sizeint[1] | sizeint[2] ) > 0xffffff) {
+      for (int k=0; k<3; ++k)
+        bitsizeint[k] = sizeofint(sizeint[k]);
+      bitsize = 0;
+    } else
+      bitsize = sizeofints(sizeint, 3);
+
+    int smallidx;
+    xdr.read(smallidx);
+    int smaller = magicints[max(firstidx, smallidx-1)] / 2;
+    int smallnum = magicints[smallidx] / 2;
+    sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
+
+    xdr.read(buf2, 1);
+    uint nbytes = static_cast<uint>(buf2[0]);
+    if (intbuf2.size() < 3 + nbytes / sizeof(int) + 1) {
+      intbuf2.resize(3 + nbytes / sizeof(int) + 1);
+      buf2 = &intbuf2[0];
+    }
+    xdr.read(reinterpret_cast<char*>(&(buf2[3])), nbytes);
+    buf2[0] = buf2[1] = buf2[2] = 0;
+
+    float inv_precision = 1.0 / precision;
+    int run = 0;
+    int i = 0;
+    int prevcoord[3];
+    while (i < lsize) {
+      int* thiscoord = buf1 + i * 3;
+      if (bitsize == 0) {
+        thiscoord[0] = decodebits(buf2, bitsizeint[0]);
+        thiscoord[1] = decodebits(buf2, bitsizeint[1]);
+        thiscoord[2] = decodebits(buf2, bitsizeint[2]);
+      } else
+        decodeints(buf2, 3, bitsize, sizeint, thiscoord);
+
+      i++;
+      for (int k=0; k<3; ++k) {
+        thiscoord[k] += minint[k];
+        prevcoord[k] = thiscoord[k];
+      }
+
+      int flag = decodebits(buf2, 1);
+      int is_smaller = 0;
+      if (flag == 1) {
+        run = decodebits(buf2, 5);
+        is_smaller = run % 3;
+        run -= is_smaller;
+        is_smaller--;
+      }
+      if (run > 0) {
+        thiscoord += 3;
+        for (int k = 0; k < run; k+=3) {
+          decodeints(buf2, 3, smallidx, sizesmall, thiscoord);
+          i++;
+          for (int m=0; m<3; ++m)
+            thiscoord[m] += prevcoord[m] - smallnum;
+          if (k == 0) {
+            for (int m=0; m<3; ++m)
+              swap(thiscoord[m], prevcoord[m]);
+            coords.push_back(GCoord(prevcoord[0] * inv_precision,
+                                    prevcoord[1] * inv_precision,
+                                    prevcoord[2] * inv_precision) * 10.0);
+          } else
+            for (int m=0; m<3; ++m)
+              prevcoord[m] = thiscoord[m];
+          coords.push_back(GCoord(thiscoord[0] * inv_precision,
+                                  thiscoord[1] * inv_precision,
+                                  thiscoord[2] * inv_precision) * 10.0);
+        }
+      } else
+        coords.push_back(GCoord(thiscoord[0] * inv_precision,
+                                thiscoord[1] * inv_precision,
+                                thiscoord[2] * inv_precision) * 10.0);
+
+      smallidx += is_smaller;
+      if (is_smaller < 0) {
+        smallnum = smaller;
+        smaller = (smallidx > firstidx) ? magicints[smallidx - 1] / 2 : 0;
+      } else if (is_smaller > 0) {
+        smaller = smallnum;
+        smallnum = magicints[smallidx] / 2;
+      }
+      sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
+    }
+
+    return(true);
+  }
+
+}
+
+
+// ----------------------------------------------------------------------
+
+
+// Builds a water box on a (jittered) lattice, in the order a
+// simulation package would typically write it
+AtomicGroup makeWaterBox(const uint nmols, boost::mt19937& rng) {
+  boost::uniform_real<> unit(-1.0, 1.0);
+  boost::variate_generator<boost::mt19937&, boost::uniform_real<> > jitter(rng, unit);
+
+  uint side = static_cast<uint>(ceil(pow(static_cast<double>(nmols), 1.0/3.0)));
+  double spacing = 3.1;
+
+  AtomicGroup model;
+  uint id = 1;
+  for (uint n = 0; n < nmols; ++n) {
+    GCoord o(spacing * (n % side), spacing * ((n / side) % side), spacing * (n / (side * side)));
+    o += GCoord(jitter(), jitter(), jitter()) * 0.3;
+    GCoord h1 = o + GCoord(0.96, 0.0, 0.0) + GCoord(jitter(), jitter(), jitter()) * 0.1;
+    GCoord h2 = o + GCoord(-0.24, 0.93, 0.0) + GCoord(jitter(), jitter(), jitter()) * 0.1;
+
+    const char* names[3] = { "OW", "HW1", "HW2" };
+    GCoord c[3] = { o, h1, h2 };
+    for (uint k=0; k<3; ++k) {
+      pAtom atom(new Atom(id, names[k], c[k]));
+      atom->index(id - 1);
+      atom->resid(n + 1);
+      atom->resname("SOL");
+      model.append(atom);
+      ++id;
+    }
+  }
+
+  model.periodicBox(GCoord(side, side, side) * spacing);
+  return(model);
+}
+
+
+void writeSynthetic(const string& fname, AtomicGroup& model, const uint nframes, boost::mt19937& rng) {
+  boost::uniform_real<> unit(-1.0, 1.0);
+  boost::variate_generator<boost::mt19937&, boost::uniform_real<> > jitter(rng, unit);
+
+  XTCWriter xtc(fname);
+  for (uint i=0; i<nframes; ++i) {
+    for (AtomicGroup::iterator j = model.begin(); j != model.end(); ++j)
+      (*j)->coords() += GCoord(jitter(), jitter(), jitter()) * 0.05;
+    xtc.writeFrame(model);
+  }
+}
+
+
+// FNV-1a over the raw bytes of the coordinates...
+unsigned long hashCoords(const vector<GCoord>& crds, unsigned long h) {
+  for (vector<GCoord>::const_iterator i = crds.begin(); i != crds.end(); ++i)
+    for (uint k=0; k<3; ++k) {
+      double d = (*i)[k];
+      const unsigned char* p = reinterpret_cast<const unsigned char*>(&d);
+      for (uint b=0; b<sizeof(d); ++b) {
+        h ^= p[b];
+        h *= 1099511628211ul;
+      }
+    }
+  return(h);
+}
+
+
+void report(const string& label, const uint nframes, const uint natoms, const double t) {
+  cout << boost::format("%-10s %8.3f s %10.2f frames/s %14.4g atoms/s\n")
+    % label % t % (nframes / t) % (static_cast<double>(nframes) * natoms / t);
+}
+
+
+
+int main(int argc, char *argv[]) {
+
+  string fname;
+  bool synthetic = true;
+  uint natoms = 1000002;
+  uint nframes = 10;
+
+  if (argc == 3 && string(argv[1]) == "-f") {
+    fname = argv[2];
+    synthetic = false;
+  } else if (argc <= 3) {
+    if (argc > 1)
+      natoms = strtoul(argv[1], 0, 10);
+    if (argc > 2)
+      nframes = strtoul(argv[2], 0, 10);
+    if (natoms < 30 || nframes == 0) {
+      cerr << "Error- must have at least 30 atoms and 1 frame\n";
+      exit(-1);
+    }
+  } else {
+    cerr << "Usage- " << argv[0] << " [natoms [nframes]] | [-f trajectory.xtc]\n";
+    cerr << fullHelpMessage();
+    exit(-1);
+  }
+
+  if (synthetic) {
+    ostringstream oss;
+    oss << "xtc-bench-" << getpid() << ".xtc";
+    fname = oss.str();
+
+    boost::mt19937 rng(1234);
+    AtomicGroup model = makeWaterBox(natoms / 3, rng);
+    natoms = model.size();
+    cerr << "Writing " << nframes << " frames of a " << natoms << " atom water box to " << fname << endl;
+    writeSynthetic(fname, model, nframes, rng);
+  }
+
+  // Decode from memory so the benchmark isn't just measuring disk speed
+  ifstream ifs(fname.c_str(), ios_base::in | ios_base::binary);
+  if (!ifs) {
+    cerr << "Error- cannot open " << fname << endl;
+    exit(-1);
+  }
+  ostringstream contents;
+  contents << ifs.rdbuf();
+  ifs.close();
+  if (synthetic)
+    remove(fname.c_str());
+  string data = contents.str();
+
+
+  vector<GCoord> crds;
+  Timer<WallTimer> timer;
+  double t_legacy = 0.0, t_loos = 0.0;
+  unsigned long h_legacy = 14695981039346656037ul, h_loos = 14695981039346656037ul;
+  uint frames_legacy = 0, frames_loos = 0;
+
+  {
+    istringstream iss(data);
+    internal::XDRReader xdr(&iss);
+    while (true) {
+      timer.start();
+      bool ok = legacy::readFrame(xdr, crds);
+      t_legacy += timer.stop();
+      if (!ok)
+        break;
+      h_legacy = hashCoords(crds, h_legacy);
+      ++frames_legacy;
+      natoms = crds.size();
+    }
+  }
+
+  {
+    istringstream iss(data);
+    XTC xtc(iss);
+    xtc.rewind();
+    while (true) {
+      timer.start();
+      bool ok = xtc.readFrame();
+      t_loos += timer.stop();
+      if (!ok)
+        break;
+      crds = xtc.coords();
+      h_loos = hashCoords(crds, h_loos);
+      ++frames_loos;
+    }
+  }
+
+  cout << "# " << frames_loos << " frames, " << natoms << " atoms\n";
+  report("xdrfile", frames_legacy, natoms, t_legacy);
+  report("loos", frames_loos, natoms, t_loos);
+  cout << boost::format("Speedup: %.2fx\n") % (t_legacy / t_loos);
+
+  if (h_legacy != h_loos || frames_legacy != frames_loos) {
+    cout << "ERROR- decoded coordinates differ between decoders\n";
+    exit(-2);
+  }
+  cout << "Decoded coordinates are identical\n";
+}
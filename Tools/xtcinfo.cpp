@@ -68,17 +68,37 @@ int main(int argc, char* argv[]) {
     exit(-1);
   }
 
-  ifstream ifs(argv[1]);
-  internal::XDRReader xdr(&ifs);
-  uint frameno = 0;
-  Header hdr;
-
   cout << boost::format("#%8s %10s %10s %10s\n")
     % "Frame"
     % "NAtoms"
     % "Step"
     % "Time";
 
+  // Use the XTC frame index (and its sidecar file) when possible.  If
+  // the trajectory is malformed (e.g. the number of atoms changes),
+  // fall back to walking the raw frame headers...
+  bool indexed = false;
+  try {
+    XTC xtc(argv[1]);
+    for (uint i=0; i<xtc.nframes(); ++i)
+      cout << boost::format(" %8d %10d %10d %10.1f\n")
+        % i
+        % xtc.natoms()
+        % xtc.frameStep(i)
+        % xtc.frameTime(i);
+    indexed = true;
+  }
+  catch (LOOSError& e) {
+    cerr << "Warning- " << e.what() << "\nWarning- scanning raw frame headers instead\n";
+  }
+
+  if (indexed)
+    exit(0);
+
+  ifstream ifs(argv[1]);
+  internal::XDRReader xdr(&ifs);
+  uint frameno = 0;
+  Header hdr;
 
   while (readFrameHeader(xdr, hdr)) {
     cout << boost::format(" %8d %10d %10d %10.1f\n")
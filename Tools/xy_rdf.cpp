@@ -43,6 +43,8 @@ int timeseries_interval;
 string output_directory;
 bool sel1_spans, sel2_spans;
 bool reselect_leaflet = false;
+uint nthreads;
+string partition_by;
 
 
 // @cond TOOLS_INTERNAL
@@ -59,6 +61,8 @@ public:
       ("sel1-spans", "Selection 1 appears in both leaflets")
       ("sel2-spans", "Selection 2 appears in both leaflets")
       ("reselect", "Recompute leaflet location for each frame")
+      ("threads", po::value<uint>(&nthreads)->default_value(1), "Number of threads to use (0=all available)")
+      ("partition", po::value<string>(&partition_by)->default_value("frames"), "How to divide the work between threads (frames, pairs)")
        ;
 
   }
@@ -119,7 +123,7 @@ public:
   string print() const
   {
     ostringstream oss;
-    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, timeseries=%d, timeseries-directory='%s', sel1-spans=%d, sel2-spans=%d reselect=%d")
+    oss << boost::format("split-mode='%s', sel1='%s', sel2='%s', hist-min=%f, hist-max=%f, num-bins=%f, timeseries=%d, timeseries-directory='%s', sel1-spans=%d, sel2-spans=%d reselect=%d, threads=%d, partition='%s'")
       % split_by
       % selection1
       % selection2
@@ -130,7 +134,9 @@ public:
       % output_directory
       % sel1_spans
       % sel2_spans
-      % reselect_leaflet;
+      % reselect_leaflet
+      % nthreads
+      % partition_by;
     return(oss.str());
   }
 
@@ -247,6 +253,11 @@ string s =
     "Note: the 5th column (\"Cum\") is not a density like the other values, \n"
     "but rather the absolute number of molecules of the second selection \n"
     "found around the first selection.\n"
+    "\n"
+    "The histograms can be computed using several threads with --threads.\n"
+    "By default, each thread handles a share of the frames (--partition=frames).\n"
+    "With --partition=pairs, each frame is divided among the threads instead,\n"
+    "which is better for very large systems with few frames.\n"
     ;
 
     return (s);
@@ -281,6 +292,25 @@ void assign_leaflet(vector<AtomicGroup> &molecules,
         }
     }
 
+// Histograms the xy-distances from each g1 group to the g2 groups in
+// one leaflet, returning the number of (non-self) pairs.  The engine
+// flattens the centers of mass onto the xy-plane.
+unsigned long leaflet_rdf(const vector<AtomicGroup>& g1, const vector<AtomicGroup>& g2,
+                          const vector< vector<uint> >& overlap, const GCoord& box,
+                          RDFEngine& engine)
+    {
+    vector<GCoord> centers1(g1.size());
+    for (uint j = 0; j < g1.size(); j++)
+        centers1[j] = g1[j].centerOfMass();
+
+    vector<GCoord> centers2(g2.size());
+    for (uint k = 0; k < g2.size(); k++)
+        centers2[k] = g2[k].centerOfMass();
+
+    return(engine.addFrame(centers1, centers2, box, overlap));
+    }
+
+
 int main (int argc, char *argv[])
 {
 
@@ -299,6 +329,17 @@ if (!options.parse(argc, argv))
 // parse the split mode, barf if you can't do it
 split_mode split=parseSplit(split_by);
 
+RDFEngine::Partition parallel_by;
+try
+    {
+    parallel_by = parseRDFPartition(partition_by);
+    }
+catch (LOOSError& e)
+    {
+    cerr << "Error- " << e.what() << endl;
+    exit(-1);
+    }
+
 cout << "# " << invocationHeader(argc, argv) << endl;
 
 // copy the command line variables to real variable names
@@ -359,31 +400,35 @@ vector<AtomicGroup> g2_upper, g2_lower;
 assign_leaflet(g1_mols, g1_upper, g1_lower, sel1_spans);
 assign_leaflet(g2_mols, g2_upper, g2_lower, sel2_spans);
 
+// Pairs of groups that are the same, so they can be skipped
+vector< vector<uint> > lower_overlap = findIdenticalGroups(g1_lower, g2_lower);
+vector< vector<uint> > upper_overlap = findIdenticalGroups(g1_upper, g2_upper);
+
+
+// Create 2 engines -- one for top, one for bottom -- which hold the
+// histograms for the current interval.  Also create 2 histograms to
+// store the total
+RDFEngine upper_engine(hist_min, hist_max, num_bins);
+RDFEngine lower_engine(hist_min, hist_max, num_bins);
+upper_engine.planar(true);
+lower_engine.planar(true);
+upper_engine.threads(nthreads, parallel_by);
+lower_engine.threads(nthreads, parallel_by);
 
-// Create 2 histograms -- one for top, one for bottom
-// Also create 2 histograms to store the total
 vector<double> hist_lower, hist_upper;
 vector<double> hist_lower_total, hist_upper_total;
-hist_lower.reserve(num_bins);
-hist_upper.reserve(num_bins);
 hist_lower_total.reserve(num_bins);
 hist_upper_total.reserve(num_bins);
-hist_lower.insert(hist_lower.begin(), num_bins, 0.0);
-hist_upper.insert(hist_upper.begin(), num_bins, 0.0);
 hist_lower_total.insert(hist_lower_total.begin(), num_bins, 0.0);
 hist_upper_total.insert(hist_upper_total.begin(), num_bins, 0.0);
 
-
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
-
 // loop over the frames of the traj file
 double area = 0.0;
 double interval_area = 0.0;
-uint cum_upper_pairs = 0;
-uint cum_lower_pairs = 0;
-uint interval_upper_pairs = 0;
-uint interval_lower_pairs = 0;
+unsigned long cum_upper_pairs = 0;
+unsigned long cum_lower_pairs = 0;
+unsigned long interval_upper_pairs = 0;
+unsigned long interval_lower_pairs = 0;
 
 vector<uint> framelist = tropts->frameList();
 uint framecnt = framelist.size();
@@ -402,63 +447,21 @@ for (uint index = 0; index<framecnt; ++index)
         {
         assign_leaflet(g1_mols, g1_upper, g1_lower, sel1_spans);
         assign_leaflet(g2_mols, g2_upper, g2_lower, sel2_spans);
+        lower_overlap = findIdenticalGroups(g1_lower, g2_lower);
+        upper_overlap = findIdenticalGroups(g1_upper, g2_upper);
         }
 
     // compute the distribution of g2 around g1 for the lower leaflet
-    for (unsigned int j = 0; j < g1_lower.size(); j++)
-        {
-        GCoord p1 = g1_lower[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_lower.size(); k++)
-            {
-            // skip "self" pairs
-            if (g1_lower[j] == g2_lower[k])
-                {
-                continue;
-                }
-
-            cum_lower_pairs++;
-            interval_lower_pairs++;
-
-            GCoord p2 = g2_lower[k].centerOfMass();
-            GCoord displ = (p2 - p1);
-            displ.reimage(box);
-            double d2 = (displ.x() * displ.x()) + (displ.y() * displ.y());
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist_lower[bin]++;
-                }
-            }
-        }
+    unsigned long lower_pairs = leaflet_rdf(g1_lower, g2_lower, lower_overlap, box,
+                                            lower_engine);
+    cum_lower_pairs += lower_pairs;
+    interval_lower_pairs += lower_pairs;
 
     // compute the distribution of g2 around g1 for the upper leaflet
-    for (unsigned int j = 0; j < g1_upper.size(); j++)
-        {
-        GCoord p1 = g1_upper[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_upper.size(); k++)
-            {
-            // skip "self" pairs
-            if (g1_upper[j] == g2_upper[k])
-                {
-                continue;
-                }
-
-            cum_upper_pairs++;
-            interval_lower_pairs++;
-
-            GCoord p2 = g2_upper[k].centerOfMass();
-            GCoord displ = (p2 - p1);
-            displ.reimage(box);
-            double d2 = (displ.x() * displ.x()) + (displ.y() * displ.y());
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist_upper[bin]++;
-                }
-            }
-        }
+    unsigned long upper_pairs = leaflet_rdf(g1_upper, g2_upper, upper_overlap, box,
+                                            upper_engine);
+    cum_upper_pairs += upper_pairs;
+    interval_upper_pairs += upper_pairs;
 
 
     // if requested, write out timeseries as well
@@ -467,6 +470,8 @@ for (uint index = 0; index<framecnt; ++index)
         interval_area /= timeseries_interval;
         double upper_expected = interval_upper_pairs / interval_area;
         double lower_expected = interval_lower_pairs / interval_area;
+        hist_upper = upper_engine.histogram();
+        hist_lower = lower_engine.histogram();
 
 
         // create the output file
@@ -523,8 +528,8 @@ for (uint index = 0; index<framecnt; ++index)
             }
 
         // rezero the histograms
-        hist_upper.assign(num_bins, 0.0);
-        hist_lower.assign(num_bins, 0.0);
+        upper_engine.clear();
+        lower_engine.clear();
 
         // zero out the area
         interval_area = 0.0;
@@ -537,6 +542,9 @@ for (uint index = 0; index<framecnt; ++index)
 // normalize the area
 area /= framecnt;
 
+hist_upper = upper_engine.histogram();
+hist_lower = lower_engine.histogram();
+
 // If we didn't write timeseries, then we need to copy the interval histograms
 // to the total ones.  If we did, we need to add in the additional data points
 // since the last time we wrote out a times series file
@@ -128,13 +128,16 @@ for (unsigned int i = 0; i < g2_mols.size(); i++)
 
 // Create 2 histograms -- one for top, one for bottom
 vector<double> hist_lower, hist_upper;
-hist_lower.reserve(num_bins);
-hist_upper.reserve(num_bins);
-hist_lower.insert(hist_lower.begin(), num_bins, 0.0);
-hist_upper.insert(hist_upper.begin(), num_bins, 0.0);
+RDFEngine upper_engine(hist_min, hist_max, num_bins);
+RDFEngine lower_engine(hist_min, hist_max, num_bins);
+upper_engine.planar(true);
+lower_engine.planar(true);
 
-double min2 = hist_min*hist_min;
-double max2 = hist_max*hist_max;
+// "self" pairs are skipped
+vector< vector<uint> > lower_overlap = findIdenticalGroups(g1_lower, g2_lower);
+vector< vector<uint> > upper_overlap = findIdenticalGroups(g1_upper, g2_upper);
+vector<GCoord> p1_lower(g1_lower.size()), p2_lower(g2_lower.size());
+vector<GCoord> p1_upper(g1_upper.size()), p2_upper(g2_upper.size());
 
 // Set up the normalization
 uint num_upper, num_lower;
@@ -168,51 +171,17 @@ while (traj->readFrame())
 
     // compute the distribution of g2 around g1 for the lower leaflet
     for (unsigned int j = 0; j < g1_lower.size(); j++)
-        {
-        GCoord p1 = g1_lower[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_lower.size(); k++)
-            {
-            // skip "self" pairs
-            if (g1_lower[j] == g2_lower[k])
-                {
-                continue;
-                }
-            GCoord p2 = g2_lower[k].centerOfMass();
-            GCoord displ = (p2 - p1);
-            displ.reimage(box);
-            double d2 = (displ.x() * displ.x()) + (displ.y() * displ.y());
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist_lower[bin]++;
-                }
-            }
-        }
+        p1_lower[j] = g1_lower[j].centerOfMass();
+    for (unsigned int k = 0; k < g2_lower.size(); k++)
+        p2_lower[k] = g2_lower[k].centerOfMass();
+    lower_engine.addFrame(p1_lower, p2_lower, box, lower_overlap);
 
     // compute the distribution of g2 around g1 for the upper leaflet
     for (unsigned int j = 0; j < g1_upper.size(); j++)
-        {
-        GCoord p1 = g1_upper[j].centerOfMass();
-        for (unsigned int k = 0; k < g2_upper.size(); k++)
-            {
-            // skip "self" pairs
-            if (g1_upper[j] == g2_upper[k])
-                {
-                continue;
-                }
-            GCoord p2 = g2_upper[k].centerOfMass();
-            GCoord displ = (p2 - p1);
-            displ.reimage(box);
-            double d2 = (displ.x() * displ.x()) + (displ.y() * displ.y());
-            if ( (d2 < max2) && (d2 > min2) )
-                {
-                double d = sqrt(d2);
-                int bin = int((d-hist_min)/bin_width);
-                hist_upper[bin]++;
-                }
-            }
-        }
+        p1_upper[j] = g1_upper[j].centerOfMass();
+    for (unsigned int k = 0; k < g2_upper.size(); k++)
+        p2_upper[k] = g2_upper[k].centerOfMass();
+    upper_engine.addFrame(p1_upper, p2_upper, box, upper_overlap);
 
     frame++;
 
@@ -220,6 +189,8 @@ while (traj->readFrame())
     if (frame %interval == 0)
         {
         area /= interval;
+        hist_upper = upper_engine.histogram();
+        hist_lower = lower_engine.histogram();
 
         // create the output file
         ostringstream outfilename;
@@ -257,8 +228,8 @@ while (traj->readFrame())
         out << endl; // blank line for gnuplot
         out.close();
         // rezero the histograms
-        hist_upper.assign(num_bins, 0.0);
-        hist_lower.assign(num_bins, 0.0);
+        upper_engine.clear();
+        lower_engine.clear();
 
         // zero out the area
         area = 0;
@@ -50,26 +50,26 @@ namespace loos {
     setPropertyBit(anumbit);
   }
 
-  std::string Atom::name(void) const { return(_name); }
-  void Atom::name(const std::string s) { _name = s; }
+  const std::string& Atom::name(void) const { return(_name.str()); }
+  void Atom::name(const std::string s) { _name = InternedString(s); }
 
-  std::string Atom::altLoc(void) const { return(_altloc); }
-  void Atom::altLoc(const std::string s) { _altloc = s; }
+  const std::string& Atom::altLoc(void) const { return(_altloc.str()); }
+  void Atom::altLoc(const std::string s) { _altloc = InternedString(s); }
 
-  std::string Atom::chainId(void) const { return(_chainid); }
-  void Atom::chainId(const std::string s) { _chainid = s; }
+  const std::string& Atom::chainId(void) const { return(_chainid.str()); }
+  void Atom::chainId(const std::string s) { _chainid = InternedString(s); }
 
-  std::string Atom::resname(void) const { return(_resname); }
-  void Atom::resname(const std::string s) { _resname = s; }
+  const std::string& Atom::resname(void) const { return(_resname.str()); }
+  void Atom::resname(const std::string s) { _resname = InternedString(s); }
 
-  std::string Atom::segid(void) const { return(_segid); }
-  void Atom::segid(const std::string s) { _segid = s; }
+  const std::string& Atom::segid(void) const { return(_segid.str()); }
+  void Atom::segid(const std::string s) { _segid = InternedString(s); }
 
-  std::string Atom::iCode(void) const { return(_icode); }
-  void Atom::iCode(const std::string s) { _icode = s; }
+  const std::string& Atom::iCode(void) const { return(_icode.str()); }
+  void Atom::iCode(const std::string s) { _icode = InternedString(s); }
 
-  std::string Atom::PDBelement(void) const { return(_pdbelement); }
-  void Atom::PDBelement(const std::string s) { _pdbelement = s; }
+  const std::string& Atom::PDBelement(void) const { return(_pdbelement.str()); }
+  void Atom::PDBelement(const std::string s) { _pdbelement = InternedString(s); }
 
   const GCoord& Atom::coords(void) const { return(_coords); }
   GCoord& Atom::coords(void) { setPropertyBit(coordsbit); return(_coords); }
@@ -102,8 +102,8 @@ namespace loos {
     //! Recordname imported from the PDB for this Atom
     //! This is mainly for atoms that come from a PDB, i.e. whether or
     //! not they were an ATOM or a HETATM
-  std::string Atom::recordName(void) const { return(_record); }
-  void Atom::recordName(const std::string s) { _record = s; }
+  const std::string& Atom::recordName(void) const { return(_record.str()); }
+  void Atom::recordName(const std::string s) { _record = InternedString(s); }
 
     //! Clear all stored bonds
   void Atom::clearBonds(void) { bonds.clear(); clearPropertyBit(bondsbit); }
@@ -195,13 +195,20 @@ namespace loos {
     _q = 1.0;
     _charge = 0.0;
     _mass = 1.0;
-    _name = "    ";
-    _altloc = " ";
-    _resname = "   ";
-    _chainid = " ";
-    _segid = "    ";
-    _pdbelement = "";
-    _record = "ATOM";
+
+    // Interned once, rather than for every new Atom
+    static const InternedString four_blanks("    ");
+    static const InternedString three_blanks("   ");
+    static const InternedString one_blank(" ");
+    static const InternedString atom_record("ATOM");
+
+    _name = four_blanks;
+    _altloc = one_blank;
+    _resname = three_blanks;
+    _chainid = one_blank;
+    _segid = four_blanks;
+    _pdbelement = InternedString();
+    _record = atom_record;
     _atom_type = -1;
     mask = nullbit;   // Nullbit means nothing was set...
   }
@@ -233,19 +240,19 @@ namespace loos {
 
 
   bool AtomEquals::operator()(const pAtom& a, const pAtom& b) const {
-    return(a->name() == b->name()
+    return(a->nameHandle() == b->nameHandle()
            && a->id() == b->id()
-           && a->resname() == b->resname()
+           && a->resnameHandle() == b->resnameHandle()
            && a->resid() == b->resid()
-           && a->segid() == b->segid());
+           && a->segidHandle() == b->segidHandle());
   }
 
   bool AtomCoordsEquals::operator()(const pAtom& a, const pAtom& b) const {
-    bool bb = (a->name() == b->name()
+    bool bb = (a->nameHandle() == b->nameHandle()
                && a->id() == b->id()
-               && a->resname() == b->resname()
+               && a->resnameHandle() == b->resnameHandle()
                && a->resid() == b->resid()
-               && a->segid() == b->segid());
+               && a->segidHandle() == b->segidHandle());
     if (!bb)
       return(false);
 
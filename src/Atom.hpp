@@ -32,6 +32,7 @@
 #include <loos_defs.hpp>
 #include <exceptions.hpp>
 #include <Coord.hpp>
+#include <InternedString.hpp>
 
 namespace loos {
 
@@ -44,6 +45,11 @@ namespace loos {
    * Most properties are derived from the PDB file specification.
    * Exceptions are noted below.  Accessors for each property are
    * provided and should be self-explanatory...
+   *
+   * The string properties (name, resname, segid, etc) are stored as
+   * InternedStrings, so atoms with the same name share one copy of
+   * it.  The string accessors return references into the string
+   * pool, which remain valid even if the property is later changed.
    */
 
   
@@ -91,7 +97,7 @@ namespace loos {
       init();
       _index = 0;
       _id = i;
-      _name = s;
+      _name = InternedString(s);
       _coords = c;
     }
 
@@ -111,27 +117,39 @@ namespace loos {
     int atomic_number(void) const;
     void atomic_number(const int);
 
-    std::string name(void) const;
+    const std::string& name(void) const;
     void name(const std::string);
 
-    std::string altLoc(void) const;
+    const std::string& altLoc(void) const;
     void altLoc(const std::string);
 
-    std::string chainId(void) const;
+    const std::string& chainId(void) const;
     void chainId(const std::string);
 
-    std::string resname(void) const;
+    const std::string& resname(void) const;
     void resname(const std::string);
 
-    std::string segid(void) const;
+    const std::string& segid(void) const;
     void segid(const std::string);
 
-    std::string iCode(void) const;
+    const std::string& iCode(void) const;
     void iCode(const std::string);
 
-    std::string PDBelement(void) const;
+    const std::string& PDBelement(void) const;
     void PDBelement(const std::string);
 
+#if !defined(SWIG)
+    //! Interned handles for the string properties most often compared
+    /**
+     * Two atoms have the same name exactly when their name handles
+     * are equal, which is much cheaper than comparing strings.
+     */
+    InternedString nameHandle(void) const { return(_name); }
+    InternedString resnameHandle(void) const { return(_resname); }
+    InternedString segidHandle(void) const { return(_segid); }
+    InternedString chainIdHandle(void) const { return(_chainid); }
+#endif
+
 
 #if !defined(SWIG)
     //! Returns a const ref to internally stored coordinates.
@@ -188,7 +206,7 @@ namespace loos {
     //! Recordname imported from the PDB for this Atom
     //! This is mainly for atoms that come from a PDB, i.e. whether or
     //! not they were an ATOM or a HETATM
-    std::string recordName(void) const;
+    const std::string& recordName(void) const;
     void recordName(const std::string);
 
     //! Clear all stored bonds
@@ -265,12 +283,12 @@ namespace loos {
   private:
     int _id;
     uint _index;
-    std::string _record, _name, _altloc, _resname, _chainid;
+    InternedString _record, _name, _altloc, _resname, _chainid;
     int _resid;
     int _atomic_number;
-    std::string _icode;
+    InternedString _icode;
     double _b, _q, _charge, _mass;
-    std::string _segid, _pdbelement;
+    InternedString _segid, _pdbelement;
     int _atom_type;
     GCoord _coords;
     GCoord _velocities;
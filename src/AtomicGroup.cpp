@@ -314,6 +314,20 @@ namespace loos {
   }
 
 
+  AtomicGroup AtomicGroup::select(const std::vector<bool>& mask) const {
+    if (mask.size() != atoms.size())
+      throw(LOOSError("Selection mask does not match the size of the AtomicGroup"));
+
+    AtomicGroup res;
+    for (uint i=0; i<atoms.size(); ++i)
+      if (mask[i])
+        res.addAtom(atoms[i]);
+
+    res.box = box;
+    return(res);
+  }
+
+
   // Split up a group into a vector of groups based on unique segids...
   std::vector<AtomicGroup> AtomicGroup::splitByUniqueSegid(void) const {
     const_iterator i;
@@ -310,6 +310,9 @@ namespace loos {
     //! Return a group consisting of atoms for which sel predicate returns true...
     AtomicGroup select(const AtomSelector& sel) const;
 
+    //! Return a group consisting of atoms whose entry in mask is true (one entry per atom)
+    AtomicGroup select(const std::vector<bool>& mask) const;
+
     //! Returns a vector of AtomicGroups split from the current group based on segid
     /**
      * The groups that are returned will be in the same order that the segids appear
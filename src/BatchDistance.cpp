@@ -0,0 +1,424 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cmath>
+
+#include <BatchDistance.hpp>
+#include <AtomicGroup.hpp>
+#include <exceptions.hpp>
+
+
+// The AVX2 and AVX-512 kernels are compiled for their instruction
+// sets using function attributes (so the rest of LOOS does not need
+// them) and are only called if the processor supports them
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define LOOS_BATCH_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+
+namespace loos {
+
+
+  void PackedCoords::pack(const GCoord* coords, const uint n) {
+    _n = n;
+    _x.resize(n);
+    _y.resize(n);
+    _z.resize(n);
+    for (uint i=0; i<n; ++i) {
+      _x[i] = coords[i].x();
+      _y[i] = coords[i].y();
+      _z[i] = coords[i].z();
+    }
+  }
+
+
+  void PackedCoords::pack(const std::vector<GCoord>& coords) {
+    pack(coords.empty() ? 0 : &coords[0], coords.size());
+  }
+
+
+  void PackedCoords::pack(const AtomicGroup& group) {
+    _n = group.size();
+    _x.resize(_n);
+    _y.resize(_n);
+    _z.resize(_n);
+    for (uint i=0; i<_n; ++i) {
+      const GCoord& c = group[i]->coords();
+      _x[i] = c.x();
+      _y[i] = c.y();
+      _z[i] = c.z();
+    }
+  }
+
+
+
+  namespace batch {
+
+    namespace {
+
+      // All kernels take the point as p[3] and the box as box[3] (or
+      // null, for no periodicity)
+      typedef void (*Kernel)(const double* p, const double* x, const double* y, const double* z,
+                             const uint n, const double* box, double* d2);
+
+
+      // Coord::reimage() without a branch, so the compiler can still
+      // vectorize the portable kernel
+      inline double reimage(const double d, const double box, const double inv) {
+        double n = static_cast<int>(fabs(d) * inv + 0.5);
+        return(d - copysign(n * box, d));
+      }
+
+
+      void scalarKernel(const double* p, const double* x, const double* y, const double* z,
+                        const uint n, const double* box, double* d2) {
+        const double px = p[0], py = p[1], pz = p[2];
+
+        if (box == 0) {
+          for (uint k=0; k<n; ++k) {
+            double dx = x[k] - px;
+            double dy = y[k] - py;
+            double dz = z[k] - pz;
+            d2[k] = dx*dx + dy*dy + dz*dz;
+          }
+          return;
+        }
+
+        const double bx = box[0], by = box[1], bz = box[2];
+        const double ix = 1.0 / bx, iy = 1.0 / by, iz = 1.0 / bz;
+        for (uint k=0; k<n; ++k) {
+          double dx = reimage(x[k] - px, bx, ix);
+          double dy = reimage(y[k] - py, by, iy);
+          double dz = reimage(z[k] - pz, bz, iz);
+          d2[k] = dx*dx + dy*dy + dz*dz;
+        }
+      }
+
+
+#if defined(LOOS_BATCH_X86_DISPATCH)
+
+      // Four distances at a time.  The leftovers go through the scalar
+      // kernel.  FMA is deliberately not used, so every kernel rounds
+      // the same way.
+      __attribute__((target("avx2")))
+      void avx2Kernel(const double* p, const double* x, const double* y, const double* z,
+                      const uint n, const double* box, double* d2) {
+        const __m256d px = _mm256_set1_pd(p[0]);
+        const __m256d py = _mm256_set1_pd(p[1]);
+        const __m256d pz = _mm256_set1_pd(p[2]);
+        uint m = n & ~3u;
+
+        if (box == 0) {
+          for (uint k=0; k<m; k += 4) {
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + k), px);
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + k), py);
+            __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + k), pz);
+            __m256d s = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+            _mm256_storeu_pd(d2 + k, s);
+          }
+        } else {
+          const __m256d bx = _mm256_set1_pd(box[0]);
+          const __m256d by = _mm256_set1_pd(box[1]);
+          const __m256d bz = _mm256_set1_pd(box[2]);
+          const __m256d ix = _mm256_set1_pd(1.0 / box[0]);
+          const __m256d iy = _mm256_set1_pd(1.0 / box[1]);
+          const __m256d iz = _mm256_set1_pd(1.0 / box[2]);
+          const int nearest = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+
+          for (uint k=0; k<m; k += 4) {
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + k), px);
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + k), py);
+            __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + k), pz);
+            dx = _mm256_sub_pd(dx, _mm256_mul_pd(_mm256_round_pd(_mm256_mul_pd(dx, ix), nearest), bx));
+            dy = _mm256_sub_pd(dy, _mm256_mul_pd(_mm256_round_pd(_mm256_mul_pd(dy, iy), nearest), by));
+            dz = _mm256_sub_pd(dz, _mm256_mul_pd(_mm256_round_pd(_mm256_mul_pd(dz, iz), nearest), bz));
+            __m256d s = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+            _mm256_storeu_pd(d2 + k, s);
+          }
+        }
+
+        if (m < n)
+          scalarKernel(p, x + m, y + m, z + m, n - m, box, d2 + m);
+      }
+
+
+      // Eight distances at a time, with the leftovers handled by a
+      // masked load and store
+      __attribute__((target("avx512f")))
+      void avx512Kernel(const double* p, const double* x, const double* y, const double* z,
+                        const uint n, const double* box, double* d2) {
+        const __m512d px = _mm512_set1_pd(p[0]);
+        const __m512d py = _mm512_set1_pd(p[1]);
+        const __m512d pz = _mm512_set1_pd(p[2]);
+        const bool periodic = (box != 0);
+        const __m512d bx = _mm512_set1_pd(periodic ? box[0] : 1.0);
+        const __m512d by = _mm512_set1_pd(periodic ? box[1] : 1.0);
+        const __m512d bz = _mm512_set1_pd(periodic ? box[2] : 1.0);
+        const __m512d ix = _mm512_set1_pd(periodic ? 1.0 / box[0] : 1.0);
+        const __m512d iy = _mm512_set1_pd(periodic ? 1.0 / box[1] : 1.0);
+        const __m512d iz = _mm512_set1_pd(periodic ? 1.0 / box[2] : 1.0);
+
+        for (uint k=0; k<n; k += 8) {
+          __mmask8 mask = (n - k >= 8) ? 0xff : static_cast<__mmask8>((1u << (n - k)) - 1);
+          __m512d dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, x + k), px);
+          __m512d dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, y + k), py);
+          __m512d dz = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, z + k), pz);
+          if (periodic) {
+            dx = _mm512_sub_pd(dx, _mm512_mul_pd(_mm512_maskz_roundscale_pd(mask, _mm512_mul_pd(dx, ix), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC), bx));
+            dy = _mm512_sub_pd(dy, _mm512_mul_pd(_mm512_maskz_roundscale_pd(mask, _mm512_mul_pd(dy, iy), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC), by));
+            dz = _mm512_sub_pd(dz, _mm512_mul_pd(_mm512_maskz_roundscale_pd(mask, _mm512_mul_pd(dz, iz), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC), bz));
+          }
+          __m512d s = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy)), _mm512_mul_pd(dz, dz));
+          _mm512_mask_storeu_pd(d2 + k, mask, s);
+        }
+      }
+
+#endif
+
+
+      bool supported(const InstructionSet isa) {
+        switch(isa) {
+        case Scalar:
+          return(true);
+#if defined(LOOS_BATCH_X86_DISPATCH)
+        case AVX2:
+          __builtin_cpu_init();
+          return(__builtin_cpu_supports("avx2"));
+        case AVX512:
+          __builtin_cpu_init();
+          return(__builtin_cpu_supports("avx512f"));
+#endif
+        default:
+          return(false);
+        }
+      }
+
+
+      Kernel kernelFor(const InstructionSet isa) {
+        switch(isa) {
+#if defined(LOOS_BATCH_X86_DISPATCH)
+        case AVX2:
+          return(&avx2Kernel);
+        case AVX512:
+          return(&avx512Kernel);
+#endif
+        default:
+          return(&scalarKernel);
+        }
+      }
+
+
+      // The selection is made once, the first time it's needed
+      struct Dispatch {
+        Dispatch() : isa(bestInstructionSet()), kernel(kernelFor(isa)) { }
+        InstructionSet isa;
+        Kernel kernel;
+      };
+
+      Dispatch& dispatch() {
+        static Dispatch d;
+        return(d);
+      }
+
+
+      void boxArray(const GCoord& box, double* b) {
+        for (uint i=0; i<3; ++i) {
+          if (!(box[i] > 0.0))
+            throw(LOOSError("Batch distances require a periodic box with positive dimensions"));
+          b[i] = box[i];
+        }
+      }
+
+
+      // Points are checked in blocks of this many, so the search can
+      // stop early
+      const uint block_size = 256;
+
+      uint anyWithin(const double* p, const PackedCoords& b, const double cutoff2, const double* box) {
+        double d2[block_size];
+        Kernel kernel = dispatch().kernel;
+
+        for (uint k=0; k<b.size(); k += block_size) {
+          uint n = std::min(block_size, b.size() - k);
+          (*kernel)(p, b.x() + k, b.y() + k, b.z() + k, n, box, d2);
+          uint hits = 0;
+          for (uint i=0; i<n; ++i)
+            hits += (d2[i] <= cutoff2);
+          if (hits)
+            return(1);
+        }
+        return(0);
+      }
+
+
+      std::vector<int> anyWithinCutoffImpl(const PackedCoords& a, const PackedCoords& b, const double cutoff,
+                                           const double* box) {
+        std::vector<int> mask(a.size(), 0);
+        double c2 = cutoff * cutoff;
+        for (uint i=0; i<a.size(); ++i) {
+          double p[3] = { a.x()[i], a.y()[i], a.z()[i] };
+          mask[i] = anyWithin(p, b, c2, box);
+        }
+        return(mask);
+      }
+
+
+      uint withinCutoffImpl(const GCoord& p, const PackedCoords& q, const double cutoff, const double* box,
+                            std::vector<int>& mask) {
+        std::vector<double> d2(q.size());
+        double pp[3] = { p.x(), p.y(), p.z() };
+        if (!q.empty())
+          (*dispatch().kernel)(pp, q.x(), q.y(), q.z(), q.size(), box, &d2[0]);
+
+        mask.resize(q.size());
+        double c2 = cutoff * cutoff;
+        uint count = 0;
+        for (uint k=0; k<q.size(); ++k) {
+          mask[k] = (d2[k] <= c2);
+          count += mask[k];
+        }
+        return(count);
+      }
+
+
+      DoubleMatrix distance2Impl(const PackedCoords& a, const PackedCoords& b, const double* box) {
+        DoubleMatrix M(a.size(), b.size());
+        if (a.empty())
+          return(M);
+
+        // Column j holds the distances from b[j], so it is one call
+        Kernel kernel = dispatch().kernel;
+        for (uint j=0; j<b.size(); ++j) {
+          double p[3] = { b.x()[j], b.y()[j], b.z()[j] };
+          (*kernel)(p, a.x(), a.y(), a.z(), a.size(), box, M.get() + static_cast<ulong>(j) * a.size());
+        }
+        return(M);
+      }
+
+    }
+
+
+
+    InstructionSet bestInstructionSet() {
+      if (supported(AVX512))
+        return(AVX512);
+      if (supported(AVX2))
+        return(AVX2);
+      return(Scalar);
+    }
+
+
+    InstructionSet instructionSet() {
+      return(dispatch().isa);
+    }
+
+
+    void instructionSet(const InstructionSet isa) {
+      if (!supported(isa))
+        throw(LOOSError("The " + instructionSetName(isa) + " instruction set is not supported here"));
+      Dispatch& d = dispatch();
+      d.isa = isa;
+      d.kernel = kernelFor(isa);
+    }
+
+
+    std::string instructionSetName(const InstructionSet isa) {
+      switch(isa) {
+      case Scalar: return("scalar");
+      case AVX2: return("AVX2");
+      case AVX512: return("AVX-512");
+      default: return("unknown");
+      }
+    }
+
+
+
+    void distance2(const GCoord& p, const double* x, const double* y, const double* z, const uint n,
+                   double* d2) {
+      double pp[3] = { p.x(), p.y(), p.z() };
+      if (n)
+        (*dispatch().kernel)(pp, x, y, z, n, 0, d2);
+    }
+
+
+    void distance2(const GCoord& p, const double* x, const double* y, const double* z, const uint n,
+                   const GCoord& box, double* d2) {
+      double pp[3] = { p.x(), p.y(), p.z() };
+      double b[3];
+      boxArray(box, b);
+      if (n)
+        (*dispatch().kernel)(pp, x, y, z, n, b, d2);
+    }
+
+
+    void distance2(const GCoord& p, const PackedCoords& q, double* d2) {
+      distance2(p, q.x(), q.y(), q.z(), q.size(), d2);
+    }
+
+
+    void distance2(const GCoord& p, const PackedCoords& q, const GCoord& box, double* d2) {
+      distance2(p, q.x(), q.y(), q.z(), q.size(), box, d2);
+    }
+
+
+    DoubleMatrix distance2(const PackedCoords& a, const PackedCoords& b) {
+      return(distance2Impl(a, b, 0));
+    }
+
+
+    DoubleMatrix distance2(const PackedCoords& a, const PackedCoords& b, const GCoord& box) {
+      double bb[3];
+      boxArray(box, bb);
+      return(distance2Impl(a, b, bb));
+    }
+
+
+    uint withinCutoff(const GCoord& p, const PackedCoords& q, const double cutoff, std::vector<int>& mask) {
+      return(withinCutoffImpl(p, q, cutoff, 0, mask));
+    }
+
+
+    uint withinCutoff(const GCoord& p, const PackedCoords& q, const double cutoff, const GCoord& box,
+                      std::vector<int>& mask) {
+      double b[3];
+      boxArray(box, b);
+      return(withinCutoffImpl(p, q, cutoff, b, mask));
+    }
+
+
+    std::vector<int> anyWithinCutoff(const PackedCoords& a, const PackedCoords& b, const double cutoff) {
+      return(anyWithinCutoffImpl(a, b, cutoff, 0));
+    }
+
+
+    std::vector<int> anyWithinCutoff(const PackedCoords& a, const PackedCoords& b, const double cutoff,
+                                     const GCoord& box) {
+      double bb[3];
+      boxArray(box, bb);
+      return(anyWithinCutoffImpl(a, b, cutoff, bb));
+    }
+
+  }
+
+}
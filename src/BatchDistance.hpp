@@ -0,0 +1,156 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_BATCH_DISTANCE_HPP)
+#define LOOS_BATCH_DISTANCE_HPP
+
+#include <string>
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <MatrixOps.hpp>
+
+
+namespace loos {
+
+
+  //! Coordinates stored as separate x, y, and z arrays
+  /**
+   * This is the layout the batch distance kernels (see loos::batch)
+   * work on.  Like a CellList, it is a snapshot of the coordinates,
+   * so pack() must be called again when they change.  Storage is
+   * reused between calls.
+   */
+  class PackedCoords {
+  public:
+    PackedCoords() : _n(0) { }
+    explicit PackedCoords(const std::vector<GCoord>& coords) : _n(0) { pack(coords); }
+    explicit PackedCoords(const AtomicGroup& group) : _n(0) { pack(group); }
+
+    void pack(const std::vector<GCoord>& coords);
+    void pack(const AtomicGroup& group);
+    void pack(const GCoord* coords, const uint n);
+
+    uint size() const { return(_n); }
+    bool empty() const { return(_n == 0); }
+
+    const double* x() const { return(_x.empty() ? 0 : &_x[0]); }
+    const double* y() const { return(_y.empty() ? 0 : &_y[0]); }
+    const double* z() const { return(_z.empty() ? 0 : &_z[0]); }
+
+    GCoord operator[](const uint i) const { return(GCoord(_x[i], _y[i], _z[i])); }
+
+  private:
+    uint _n;
+    std::vector<double> _x, _y, _z;
+  };
+
+
+
+  //! Distances between many points at once
+  /**
+   * These kernels compute squared distances from one point to many
+   * (stored as separate x, y, and z arrays), optionally using the
+   * minimum image convention for an orthorhombic periodic box.  The
+   * minimum image is found by rounding, d - box * round(d / box), with
+   * no branches, so several distances are computed at once with SIMD
+   * instructions.
+   *
+   * On x86 processors, the widest instruction set the processor
+   * supports (AVX-512, then AVX2) is chosen the first time a kernel is
+   * called, falling back to portable C++ (which the compiler may
+   * still vectorize).  All of them compute the same distances, except
+   * that a point exactly half a box away may be imaged either way.
+   *
+   * Example:
+   * \code
+   *   PackedCoords solvent(waters);
+   *   std::vector<double> d2(solvent.size());
+   *   batch::distance2(ion->coords(), solvent, box, &d2[0]);
+   *
+   *   std::vector<int> near = batch::anyWithinCutoff(PackedCoords(waters), PackedCoords(protein), 3.5);
+   * \endcode
+   */
+  namespace batch {
+
+    enum InstructionSet { Scalar = 0, AVX2, AVX512 };
+
+    //! The instruction set the kernels are using
+    InstructionSet instructionSet();
+
+    //! The widest instruction set this processor (and this build) supports
+    InstructionSet bestInstructionSet();
+
+    //! Use a specific instruction set (e.g. for benchmarking)
+    /**
+     * Throws a LOOSError if the processor does not support it.  This
+     * should not be changed while other threads are using the kernels.
+     */
+    void instructionSet(const InstructionSet isa);
+
+    std::string instructionSetName(const InstructionSet isa);
+
+
+    //! d2[k] is the squared distance from \a p to point k
+    void distance2(const GCoord& p, const double* x, const double* y, const double* z, const uint n,
+                   double* d2);
+
+    //! d2[k] is the squared minimum-image distance from \a p to point k in the periodic \a box
+    void distance2(const GCoord& p, const double* x, const double* y, const double* z, const uint n,
+                   const GCoord& box, double* d2);
+
+    void distance2(const GCoord& p, const PackedCoords& q, double* d2);
+    void distance2(const GCoord& p, const PackedCoords& q, const GCoord& box, double* d2);
+
+
+    //! Matrix of squared distances, where M(i, j) is between a[i] and b[j]
+    DoubleMatrix distance2(const PackedCoords& a, const PackedCoords& b);
+    DoubleMatrix distance2(const PackedCoords& a, const PackedCoords& b, const GCoord& box);
+
+
+    //! mask[k] is 1 if point k of \a q is within \a cutoff of \a p, or 0 otherwise
+    /**
+     * Returns the number of points within the cutoff
+     */
+    uint withinCutoff(const GCoord& p, const PackedCoords& q, const double cutoff, std::vector<int>& mask);
+    uint withinCutoff(const GCoord& p, const PackedCoords& q, const double cutoff, const GCoord& box,
+                      std::vector<int>& mask);
+
+
+    //! mask[i] is 1 if any point of \a b is within \a cutoff of a[i], or 0 otherwise
+    /**
+     * This is the usual test for contacts (or for waters near a
+     * protein).  The search for each point of \a a stops at the first
+     * point of \a b found within the cutoff.
+     */
+    std::vector<int> anyWithinCutoff(const PackedCoords& a, const PackedCoords& b, const double cutoff);
+    std::vector<int> anyWithinCutoff(const PackedCoords& a, const PackedCoords& b, const double cutoff,
+                                     const GCoord& box);
+
+  }
+
+}
+
+
+#endif
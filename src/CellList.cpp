@@ -0,0 +1,239 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cmath>
+
+#include <CellList.hpp>
+#include <AtomicGroup.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // Collects indices for CellList::neighbors()
+    struct Collector {
+      Collector(std::vector<uint>& v, const double r2) : _v(v), _r2(r2) { }
+      void operator()(const uint i, const double d2) { if (d2 <= _r2) _v.push_back(i); }
+      std::vector<uint>& _v;
+      double _r2;
+    };
+
+  }
+
+
+  CellList::CellList(const double cutoff)
+    : _cutoff(cutoff), _cutoff2(cutoff * cutoff), _periodic(false)
+  {
+    if (cutoff <= 0.0)
+      throw(LOOSError("CellList cutoff must be greater than zero"));
+
+    for (uint i=0; i<3; ++i) {
+      _scale[i] = 0.0;
+      _ncells[i] = 1;
+    }
+    _cell_start.assign(2, 0);
+  }
+
+
+  void CellList::build(const std::vector<GCoord>& coords) {
+    _periodic = false;
+    _box = GCoord(0,0,0);
+    setupGrid(coords);
+    sortPoints(coords);
+  }
+
+
+  void CellList::build(const std::vector<GCoord>& coords, const GCoord& box) {
+    for (uint i=0; i<3; ++i)
+      if (!(box[i] > 0.0))
+        throw(LOOSError("CellList requires a periodic box with positive dimensions"));
+
+    _periodic = true;
+    _box = box;
+    setupGrid(coords);
+    sortPoints(coords);
+  }
+
+
+  void CellList::build(const AtomicGroup& group) {
+    std::vector<GCoord> coords(group.size());
+    for (uint i=0; i<coords.size(); ++i)
+      coords[i] = group[i]->coords();
+
+    if (group.isPeriodic())
+      build(coords, group.periodicBox());
+    else
+      build(coords);
+  }
+
+
+
+  // Cells are at least as wide as the cutoff.  Without a box, the
+  // grid covers the bounding box of the points.  Either way, the grid
+  // is kept from having many more cells than points (for very sparse
+  // sets or very short cutoffs).
+  void CellList::setupGrid(const std::vector<GCoord>& coords) {
+    GCoord extent;
+
+    if (_periodic) {
+      _origin = GCoord(0,0,0);
+      extent = _box;
+    } else if (coords.empty()) {
+      _origin = extent = GCoord(0,0,0);
+    } else {
+      GCoord lo = coords[0], hi = coords[0];
+      for (uint j=1; j<coords.size(); ++j)
+        for (uint i=0; i<3; ++i) {
+          if (coords[j][i] < lo[i])
+            lo[i] = coords[j][i];
+          if (coords[j][i] > hi[i])
+            hi[i] = coords[j][i];
+        }
+      _origin = lo;
+      extent = hi - lo;
+    }
+
+    double total = 1.0;
+    for (uint i=0; i<3; ++i) {
+      double n = floor(extent[i] / _cutoff);
+      _ncells[i] = (n < 1.0) ? 1 : static_cast<uint>(std::min(n, 4096.0));
+      total *= _ncells[i];
+    }
+
+    double limit = 8.0 * coords.size() + 27.0;
+    if (total > limit) {
+      double shrink = pow(total / limit, 1.0/3.0);
+      for (uint i=0; i<3; ++i) {
+        uint n = static_cast<uint>(_ncells[i] / shrink);
+        _ncells[i] = (n < 1) ? 1 : n;
+      }
+    }
+
+    for (uint i=0; i<3; ++i)
+      _scale[i] = (extent[i] > 0.0) ? _ncells[i] / extent[i] : 0.0;
+  }
+
+
+  int CellList::cellCoord(const double x, const uint axis) const {
+    int n = _ncells[axis];
+    if (_periodic) {
+      double f = x / _box[axis];
+      f -= floor(f);
+      int c = static_cast<int>(f * n);
+      return(c >= n ? n - 1 : c);
+    }
+
+    double f = (x - _origin[axis]) * _scale[axis];
+    if (!(f > 0.0))        // Also catches NaN
+      return(0);
+    if (f >= n)
+      return(n - 1);
+    return(static_cast<int>(f));
+  }
+
+
+  // Counting sort of the points by cell
+  void CellList::sortPoints(const std::vector<GCoord>& coords) {
+    uint ncells = _ncells[0] * _ncells[1] * _ncells[2];
+    uint n = coords.size();
+
+    _cell_start.assign(ncells + 1, 0);
+    _point_cell.resize(n);
+    for (uint j=0; j<n; ++j) {
+      uint c = (cellCoord(coords[j][2], 2) * _ncells[1] + cellCoord(coords[j][1], 1)) * _ncells[0] + cellCoord(coords[j][0], 0);
+      _point_cell[j] = c;
+      ++_cell_start[c + 1];
+    }
+
+    for (uint c=0; c<ncells; ++c)
+      _cell_start[c + 1] += _cell_start[c];
+
+    _coords.resize(n);
+    _index.resize(n);
+    std::vector<uint> fill(_cell_start.begin(), _cell_start.end() - 1);
+    for (uint j=0; j<n; ++j) {
+      uint k = fill[_point_cell[j]]++;
+      _coords[k] = coords[j];
+      _index[k] = j;
+    }
+  }
+
+
+  // With fewer than 3 cells along a periodic axis, the neighbors on
+  // either side may be the same cell, so only distinct cells are kept
+  void CellList::stencil(const GCoord& p, Stencil& st) const {
+    int cells[3][3];
+    uint ncells[3];
+
+    for (uint i=0; i<3; ++i) {
+      int n = _ncells[i];
+      int c = cellCoord(p[i], i);
+
+      if (_periodic) {
+        if (n < 3) {
+          for (int k=0; k<n; ++k)
+            cells[i][k] = k;
+          ncells[i] = n;
+        } else {
+          cells[i][0] = (c + n - 1) % n;
+          cells[i][1] = c;
+          cells[i][2] = (c + 1) % n;
+          ncells[i] = 3;
+        }
+      } else {
+        uint m = 0;
+        for (int k = std::max(0, c-1); k <= std::min(n-1, c+1); ++k)
+          cells[i][m++] = k;
+        ncells[i] = m;
+      }
+    }
+
+    st.n = 0;
+    for (uint k=0; k<ncells[2]; ++k)
+      for (uint j=0; j<ncells[1]; ++j)
+        for (uint i=0; i<ncells[0]; ++i)
+          st.cells[st.n++] = (cells[2][k] * _ncells[1] + cells[1][j]) * _ncells[0] + cells[0][i];
+  }
+
+
+
+  std::vector<uint> CellList::neighbors(const GCoord& p) const {
+    return(neighbors(p, _cutoff));
+  }
+
+
+  std::vector<uint> CellList::neighbors(const GCoord& p, const double radius) const {
+    if (radius > _cutoff)
+      throw(LOOSError("CellList search radius cannot be larger than its cutoff"));
+
+    std::vector<uint> result;
+    Collector collect(result, radius * radius);
+    forEachNeighbor(p, collect);
+    std::sort(result.begin(), result.end());
+    return(result);
+  }
+
+
+}
@@ -0,0 +1,215 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_CELL_LIST_HPP)
+#define LOOS_CELL_LIST_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+
+
+namespace loos {
+
+
+  //! Spatial index for finding points within a cutoff distance
+  /**
+   * Space is divided into cells that are at least as wide as the
+   * cutoff, and the points are sorted by the cell they fall in.  All
+   * points within the cutoff of a given location are then in the
+   * location's cell or one of its 26 neighbors, so finding them
+   * takes time proportional to the number of nearby points rather
+   * than the total number of points.
+   *
+   * With a periodic box, the cells tile the box and distances use
+   * the minimum image convention (exactly as Coord::distance2(o, box)
+   * does).  Only orthorhombic boxes are supported.  Without a box,
+   * the cells cover the bounding box of the points.
+   *
+   * The list is a snapshot of the coordinates given to build().  When
+   * the coordinates change (e.g. for every trajectory frame), call
+   * build() again.  Storage is reused, so rebuilding is a single
+   * linear pass over the points.
+   *
+   * Example:
+   * \code
+   *   CellList cells(cutoff);
+   *   while (traj->readFrame()) {
+   *     traj->updateGroupCoords(model);
+   *     cells.build(waters);     // Periodic if waters has a box
+   *     for (uint i=0; i<ions.size(); ++i) {
+   *       std::vector<uint> near = cells.neighbors(ions[i]->coords());
+   *       ...
+   *     }
+   *   }
+   * \endcode
+   */
+  class CellList {
+  public:
+    //! Create an empty cell list for finding points within \a cutoff
+    explicit CellList(const double cutoff);
+
+    //! Index \a coords without periodicity
+    void build(const std::vector<GCoord>& coords);
+
+    //! Index \a coords in the periodic box \a box
+    void build(const std::vector<GCoord>& coords, const GCoord& box);
+
+    //! Index the atoms of \a group (using its periodic box, if it has one)
+    /**
+     * Indices returned by queries are indices into \a group
+     */
+    void build(const AtomicGroup& group);
+
+    double cutoff() const { return(_cutoff); }
+
+    //! Number of points indexed
+    uint size() const { return(_index.size()); }
+
+    bool isPeriodic() const { return(_periodic); }
+    GCoord periodicBox() const { return(_box); }
+
+    //! Number of cells along each axis
+    uint cells(const uint axis) const { return(_ncells[axis]); }
+
+
+    //! Returns the indices of all points within the cutoff of \a p (in ascending order)
+    std::vector<uint> neighbors(const GCoord& p) const;
+
+    //! Returns the indices of all points within \a radius (no larger than the cutoff) of \a p
+    std::vector<uint> neighbors(const GCoord& p, const double radius) const;
+
+
+    //! Calls f(i) for every point that might be within the cutoff of \a p
+    /**
+     * This visits every point in the cells neighboring \a p without
+     * checking their distance, for when the caller needs its own
+     * test.  No point within the cutoff is skipped.
+     */
+    template<class Functor>
+    void forEachCandidate(const GCoord& p, Functor& f) const {
+      Stencil st;
+      stencil(p, st);
+      for (uint c = 0; c < st.n; ++c)
+        for (uint k = _cell_start[st.cells[c]]; k < _cell_start[st.cells[c] + 1]; ++k)
+          f(_index[k]);
+    }
+
+
+    //! Calls f(coords, indices, n) for each cell neighboring \a p
+    /**
+     * This is forEachCandidate() a cell at a time, for callers that
+     * process the candidates in batches.  The \a n points in a cell are
+     * stored contiguously, with coords[k] being the point with the
+     * caller's index indices[k].  Empty cells are not visited.
+     */
+    template<class Functor>
+    void forEachCandidateBlock(const GCoord& p, Functor& f) const {
+      Stencil st;
+      stencil(p, st);
+      for (uint c = 0; c < st.n; ++c) {
+        uint begin = _cell_start[st.cells[c]];
+        uint end = _cell_start[st.cells[c] + 1];
+        if (end > begin)
+          f(&_coords[begin], &_index[begin], end - begin);
+      }
+    }
+
+
+    //! Calls f(i, d2) for every point i whose distance squared from \a p is within the cutoff
+    template<class Functor>
+    void forEachNeighbor(const GCoord& p, Functor& f) const {
+      Stencil st;
+      stencil(p, st);
+      for (uint c = 0; c < st.n; ++c)
+        for (uint k = _cell_start[st.cells[c]]; k < _cell_start[st.cells[c] + 1]; ++k) {
+          double d2 = distance2(p, _coords[k]);
+          if (d2 <= _cutoff2)
+            f(_index[k], d2);
+        }
+    }
+
+
+    //! Calls f(i, j, d2) once for every pair of indexed points within the cutoff
+    /**
+     * The order of i and j within a pair is unspecified.
+     */
+    template<class Functor>
+    void forEachPair(Functor& f) const {
+      Stencil st;
+      for (uint a = 0; a < _coords.size(); ++a) {
+        stencil(_coords[a], st);
+        for (uint c = 0; c < st.n; ++c) {
+          uint end = _cell_start[st.cells[c] + 1];
+          for (uint b = _cell_start[st.cells[c]]; b < end; ++b) {
+            if (b <= a)
+              continue;
+            double d2 = distance2(_coords[a], _coords[b]);
+            if (d2 <= _cutoff2)
+              f(_index[a], _index[b], d2);
+          }
+        }
+      }
+    }
+
+
+  private:
+
+    // The (distinct) cells neighboring a location
+    struct Stencil {
+      uint cells[27];
+      uint n;
+    };
+
+    void setupGrid(const std::vector<GCoord>& coords);
+    void sortPoints(const std::vector<GCoord>& coords);
+    int cellCoord(const double x, const uint axis) const;
+    void stencil(const GCoord& p, Stencil& st) const;
+
+    double distance2(const GCoord& p, const GCoord& q) const {
+      return(_periodic ? p.distance2(q, _box) : p.distance2(q));
+    }
+
+
+    double _cutoff, _cutoff2;
+    bool _periodic;
+    GCoord _box;
+    GCoord _origin;
+    double _scale[3];      // Cells per Angstrom along each axis
+    uint _ncells[3];
+
+    // Points sorted by cell.  Cell c holds _coords[_cell_start[c]]
+    // through _coords[_cell_start[c+1]-1], and _index maps these
+    // back to the caller's indices.
+    std::vector<uint> _cell_start;
+    std::vector<GCoord> _coords;
+    std::vector<uint> _index;
+    std::vector<uint> _point_cell;
+  };
+
+
+}
+
+
+#endif
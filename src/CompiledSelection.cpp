@@ -0,0 +1,715 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <sstream>
+
+#include <stdint.h>
+
+#include <boost/regex.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <CompiledSelection.hpp>
+#include <AtomicGroup.hpp>
+#include <Parser.hpp>
+#include <Selectors.hpp>
+
+
+namespace loos {
+
+  namespace internal {
+
+    typedef std::vector<uint64_t>    Bits;
+
+
+    // The atom properties used by a selection, pulled out of the group
+    // the first time they are needed.  All string properties share one
+    // table of unique strings, so they are stored as ids into it.
+    // Since Atom strings are interned, the address of a string
+    // identifies it, so the table is keyed by address.
+    class SelectionColumns {
+    public:
+      enum StringField { NAME=0, RESNAME, SEGID, CHAINID };
+      enum IntField { ID=0, RESID, INDEX };
+
+      explicit SelectionColumns(const AtomicGroup& g) : group(g), size(g.size()),
+                                                        _strings(4), _have_strings(4, false),
+                                                        _ints(3), _have_ints(3, false)
+      { }
+
+      const std::vector<uint>& strings(const StringField f) {
+        if (!_have_strings[f]) {
+          std::vector<uint>& col = _strings[f];
+          col.resize(size);
+
+          // Atoms in the same residue or segment tend to share strings,
+          // so check the last one seen before going to the hash table
+          const std::string* last = 0;
+          uint last_id = 0;
+          for (uint i=0; i<size; ++i) {
+            const std::string* s = &(property(group[i], f));
+            if (s != last) {
+              last_id = intern(s);
+              last = s;
+            }
+            col[i] = last_id;
+          }
+          _have_strings[f] = true;
+        }
+        return(_strings[f]);
+      }
+
+      const std::vector<long>& ints(const IntField f) {
+        if (!_have_ints[f]) {
+          std::vector<long>& col = _ints[f];
+          col.resize(size);
+          for (uint i=0; i<size; ++i) {
+            const pAtom& pa = group[i];
+            switch(f) {
+            case ID: col[i] = pa->id(); break;
+            case RESID: col[i] = pa->resid(); break;
+            case INDEX: col[i] = static_cast<long>(pa->index()); break;
+            }
+          }
+          _have_ints[f] = true;
+        }
+        return(_ints[f]);
+      }
+
+      uint nstrings() const { return(_table.size()); }
+      const std::string& string(const uint id) const { return(*(_table[id])); }
+
+      const AtomicGroup& group;
+      const uint size;
+
+    private:
+      static const std::string& property(const pAtom& pa, const StringField f) {
+        switch(f) {
+        case RESNAME: return(pa->resname());
+        case SEGID: return(pa->segid());
+        case CHAINID: return(pa->chainId());
+        case NAME:
+        default: return(pa->name());
+        }
+      }
+
+      uint intern(const std::string* s) {
+        boost::unordered_map<const std::string*, uint>::iterator i = _ids.find(s);
+        if (i != _ids.end())
+          return(i->second);
+        uint id = _table.size();
+        _table.push_back(s);
+        _ids[s] = id;
+        return(id);
+      }
+
+      std::vector<const std::string*> _table;
+      boost::unordered_map<const std::string*, uint> _ids;
+
+      std::vector< std::vector<uint> > _strings;
+      std::vector<bool> _have_strings;
+      std::vector< std::vector<long> > _ints;
+      std::vector<bool> _have_ints;
+    };
+
+
+    // --------------------------------------------------------------
+    // Bitmask helpers
+
+
+    inline bool testBit(const Bits& b, const uint i) {
+      return((b[i >> 6] >> (i & 63)) & 1u);
+    }
+
+    // Builds a mask of n bits from pred(i)
+    template<class Predicate>
+    void fillBits(Bits& b, const uint n, const Predicate& pred) {
+      b.assign((n + 63) / 64, 0);
+      for (uint i=0; i<n; ++i)
+        if (pred(i))
+          b[i >> 6] |= static_cast<uint64_t>(1) << (i & 63);
+    }
+
+    // Clears the bits past the end of the group
+    inline void clearTail(Bits& b, const uint n) {
+      if (n & 63)
+        b.back() &= (static_cast<uint64_t>(1) << (n & 63)) - 1;
+    }
+
+
+    // Predicates for fillBits()...
+
+    struct NonZero {
+      explicit NonZero(const std::vector<long>& v) : _v(v) { }
+      bool operator()(const uint i) const { return(_v[i] != 0); }
+      const std::vector<long>& _v;
+    };
+
+    struct LookupTable {
+      LookupTable(const std::vector<bool>& t, const std::vector<uint>& ids) : _t(t), _ids(ids) { }
+      bool operator()(const uint i) const { return(_t[_ids[i]]); }
+      const std::vector<bool>& _t;
+      const std::vector<uint>& _ids;
+    };
+
+    struct LookupTables {
+      LookupTables(const std::vector<bool>& t1, const std::vector<uint>& ids1,
+                   const std::vector<bool>& t2, const std::vector<uint>& ids2)
+        : _t1(t1), _ids1(ids1), _t2(t2), _ids2(ids2) { }
+      bool operator()(const uint i) const { return(_t1[_ids1[i]] && _t2[_ids2[i]]); }
+      const std::vector<bool>& _t1;
+      const std::vector<uint>& _ids1;
+      const std::vector<bool>& _t2;
+      const std::vector<uint>& _ids2;
+    };
+
+
+
+    // --------------------------------------------------------------
+    // The expression tree
+
+
+    class SelectionNode {
+    public:
+      // INT includes the results of comparisons and logical operations,
+      // since the Kernel treats these as integers
+      enum Type { BOOL, INT, STRING };
+
+      explicit SelectionNode(const Type t) : type(t) { }
+      virtual ~SelectionNode() { }
+
+      // Boolean nodes override this.  Integer nodes are true when non-zero.
+      virtual void evalBits(SelectionColumns& cols, Bits& result) const {
+        std::vector<long> v;
+        evalInts(cols, v);
+        fillBits(result, cols.size, NonZero(v));
+      }
+
+      // Integer nodes override this.  Boolean nodes are 0 or 1.
+      virtual void evalInts(SelectionColumns& cols, std::vector<long>& result) const {
+        Bits b;
+        evalBits(cols, b);
+        result.resize(cols.size);
+        for (uint i=0; i<cols.size; ++i)
+          result[i] = testBit(b, i);
+      }
+
+      virtual bool isConstant() const { return(false); }
+      virtual long constant() const { return(0); }
+
+      const Type type;
+    };
+
+    typedef boost::shared_ptr<SelectionNode>    pNode;
+
+
+    class StringNode : public SelectionNode {
+    public:
+      explicit StringNode(const std::string& s) : SelectionNode(STRING), is_constant(true), value(s), field(SelectionColumns::NAME) { }
+      explicit StringNode(const SelectionColumns::StringField f) : SelectionNode(STRING), is_constant(false), field(f) { }
+
+      void evalBits(SelectionColumns&, Bits&) const { throw(LOOSError("String used as a logical value in selection")); }
+      void evalInts(SelectionColumns&, std::vector<long>&) const { throw(LOOSError("String used as a number in selection")); }
+
+      const bool is_constant;
+      const std::string value;
+      const SelectionColumns::StringField field;
+    };
+
+
+    class IntConstant : public SelectionNode {
+    public:
+      explicit IntConstant(const long i) : SelectionNode(INT), _value(i) { }
+      void evalInts(SelectionColumns& cols, std::vector<long>& result) const { result.assign(cols.size, _value); }
+      bool isConstant() const { return(true); }
+      long constant() const { return(_value); }
+    private:
+      long _value;
+    };
+
+
+    class IntField : public SelectionNode {
+    public:
+      explicit IntField(const SelectionColumns::IntField f) : SelectionNode(INT), _field(f) { }
+      void evalInts(SelectionColumns& cols, std::vector<long>& result) const { result = cols.ints(_field); }
+    private:
+      SelectionColumns::IntField _field;
+    };
+
+
+    // Same as internal::extractNumber, but only run once per unique string
+    class ExtractNumber : public SelectionNode {
+    public:
+      ExtractNumber(const SelectionColumns::StringField f, const boost::regex& re) : SelectionNode(INT), _field(f), _regexp(re) { }
+
+      void evalInts(SelectionColumns& cols, std::vector<long>& result) const {
+        const std::vector<uint>& ids = cols.strings(_field);
+        std::vector<long> table(cols.nstrings());
+        for (uint k=0; k<table.size(); ++k)
+          table[k] = extract(cols.string(k));
+
+        result.resize(cols.size);
+        for (uint i=0; i<cols.size; ++i)
+          result[i] = table[ids[i]];
+      }
+
+    private:
+      long extract(const std::string& s) const {
+        boost::smatch what;
+        if (boost::regex_search(s, what, _regexp))
+          for (uint i=0; i<what.size(); ++i) {
+            std::stringstream ss(what[i].str());
+            int val;
+            if (ss >> val)
+              return(val);
+          }
+        return(-1);
+      }
+
+      SelectionColumns::StringField _field;
+      boost::regex _regexp;
+    };
+
+
+    class Compare : public SelectionNode {
+    public:
+      enum Op { EQ, LT, LTE, GT, GTE };
+
+      Compare(const Op op, const pNode& lhs, const pNode& rhs) : SelectionNode(BOOL), _op(op), _lhs(lhs), _rhs(rhs) { }
+
+      void evalBits(SelectionColumns& cols, Bits& result) const {
+        if (_lhs->type == STRING)
+          compareStrings(cols, result);
+        else
+          compareInts(cols, result);
+      }
+
+    private:
+      // e is the result of internal::compare()
+      bool test(const int e) const {
+        switch(_op) {
+        case EQ: return(e == 0);
+        case LT: return(e < 0);
+        case LTE: return(e <= 0);
+        case GT: return(e > 0);
+        case GTE: return(e >= 0);
+        }
+        return(false);
+      }
+
+      static int compareStrings(const std::string& a, const std::string& b) {
+        if (a == b)
+          return(0);
+        return(a < b ? -1 : 1);
+      }
+
+      // As in the Kernel, < and <= are always false when either
+      // operand is negative
+      bool testInts(const long x, const long y) const {
+        if ((_op == LT || _op == LTE) && (x < 0 || y < 0))
+          return(false);
+        int e = x - y;
+        return(test(e));
+      }
+
+
+      struct IntPredicate {
+        IntPredicate(const Compare& c, const std::vector<long>& x, const std::vector<long>& y) : _c(c), _x(x), _y(y) { }
+        bool operator()(const uint i) const { return(_c.testInts(_x[i], _y[i])); }
+        const Compare& _c;
+        const std::vector<long>& _x;
+        const std::vector<long>& _y;
+      };
+
+      struct IntConstantPredicate {
+        IntConstantPredicate(const Compare& c, const std::vector<long>& x, const long y, const bool swapped)
+          : _c(c), _x(x), _y(y), _swapped(swapped) { }
+        bool operator()(const uint i) const { return(_swapped ? _c.testInts(_y, _x[i]) : _c.testInts(_x[i], _y)); }
+        const Compare& _c;
+        const std::vector<long>& _x;
+        const long _y;
+        const bool _swapped;
+      };
+
+      struct StringPredicate {
+        StringPredicate(const Compare& c, const SelectionColumns& cols, const std::vector<uint>& x, const std::vector<uint>& y)
+          : _c(c), _cols(cols), _x(x), _y(y) { }
+        bool operator()(const uint i) const {
+          if (_c._op == EQ)
+            return(_x[i] == _y[i]);
+          return(_c.test(compareStrings(_cols.string(_x[i]), _cols.string(_y[i]))));
+        }
+        const Compare& _c;
+        const SelectionColumns& _cols;
+        const std::vector<uint>& _x;
+        const std::vector<uint>& _y;
+      };
+
+
+      void compareInts(SelectionColumns& cols, Bits& result) const {
+        std::vector<long> x, y;
+
+        if (_lhs->isConstant() && _rhs->isConstant()) {
+          result.assign((cols.size + 63) / 64, testInts(_lhs->constant(), _rhs->constant()) ? ~static_cast<uint64_t>(0) : 0);
+          if (!result.empty())
+            clearTail(result, cols.size);
+        } else if (_rhs->isConstant()) {
+          _lhs->evalInts(cols, x);
+          fillBits(result, cols.size, IntConstantPredicate(*this, x, _rhs->constant(), false));
+        } else if (_lhs->isConstant()) {
+          _rhs->evalInts(cols, y);
+          fillBits(result, cols.size, IntConstantPredicate(*this, y, _lhs->constant(), true));
+        } else {
+          _lhs->evalInts(cols, x);
+          _rhs->evalInts(cols, y);
+          fillBits(result, cols.size, IntPredicate(*this, x, y));
+        }
+      }
+
+
+      void compareStrings(SelectionColumns& cols, Bits& result) const {
+        const StringNode& a = dynamic_cast<const StringNode&>(*_lhs);
+        const StringNode& b = dynamic_cast<const StringNode&>(*_rhs);
+
+        if (a.is_constant && b.is_constant) {
+          result.assign((cols.size + 63) / 64, test(compareStrings(a.value, b.value)) ? ~static_cast<uint64_t>(0) : 0);
+          if (!result.empty())
+            clearTail(result, cols.size);
+
+        } else if (a.is_constant || b.is_constant) {
+          // Compare each unique string once, then look up each atom's result
+          const StringNode& field = a.is_constant ? b : a;
+          const std::string& value = a.is_constant ? a.value : b.value;
+          const std::vector<uint>& ids = cols.strings(field.field);
+
+          std::vector<bool> table(cols.nstrings());
+          for (uint k=0; k<table.size(); ++k)
+            table[k] = a.is_constant ? test(compareStrings(value, cols.string(k))) : test(compareStrings(cols.string(k), value));
+          fillBits(result, cols.size, LookupTable(table, ids));
+
+        } else {
+          const std::vector<uint>& x = cols.strings(a.field);
+          const std::vector<uint>& y = cols.strings(b.field);
+          fillBits(result, cols.size, StringPredicate(*this, cols, x, y));
+        }
+      }
+
+
+      Op _op;
+      pNode _lhs, _rhs;
+    };
+
+
+    class RegexMatch : public SelectionNode {
+    public:
+      RegexMatch(const SelectionColumns::StringField f, const boost::regex& re) : SelectionNode(BOOL), _field(f), _regexp(re) { }
+
+      void evalBits(SelectionColumns& cols, Bits& result) const {
+        const std::vector<uint>& ids = cols.strings(_field);
+        std::vector<bool> table(cols.nstrings());
+        for (uint k=0; k<table.size(); ++k)
+          table[k] = boost::regex_search(cols.string(k), _regexp);
+        fillBits(result, cols.size, LookupTable(table, ids));
+      }
+
+    private:
+      SelectionColumns::StringField _field;
+      boost::regex _regexp;
+    };
+
+
+    class LogicalAnd : public SelectionNode {
+    public:
+      LogicalAnd(const pNode& lhs, const pNode& rhs) : SelectionNode(BOOL), _lhs(lhs), _rhs(rhs) { }
+      void evalBits(SelectionColumns& cols, Bits& result) const {
+        Bits b;
+        _lhs->evalBits(cols, result);
+        _rhs->evalBits(cols, b);
+        for (uint i=0; i<result.size(); ++i)
+          result[i] &= b[i];
+      }
+    private:
+      pNode _lhs, _rhs;
+    };
+
+
+    class LogicalOr : public SelectionNode {
+    public:
+      LogicalOr(const pNode& lhs, const pNode& rhs) : SelectionNode(BOOL), _lhs(lhs), _rhs(rhs) { }
+      void evalBits(SelectionColumns& cols, Bits& result) const {
+        Bits b;
+        _lhs->evalBits(cols, result);
+        _rhs->evalBits(cols, b);
+        for (uint i=0; i<result.size(); ++i)
+          result[i] |= b[i];
+      }
+    private:
+      pNode _lhs, _rhs;
+    };
+
+
+    class LogicalNot : public SelectionNode {
+    public:
+      explicit LogicalNot(const pNode& arg) : SelectionNode(BOOL), _arg(arg) { }
+      void evalBits(SelectionColumns& cols, Bits& result) const {
+        _arg->evalBits(cols, result);
+        for (uint i=0; i<result.size(); ++i)
+          result[i] = ~result[i];
+        if (!result.empty())
+          clearTail(result, cols.size);
+      }
+    private:
+      pNode _arg;
+    };
+
+
+    class LogicalTrue : public SelectionNode {
+    public:
+      LogicalTrue() : SelectionNode(BOOL) { }
+      void evalBits(SelectionColumns& cols, Bits& result) const {
+        result.assign((cols.size + 63) / 64, ~static_cast<uint64_t>(0));
+        if (!result.empty())
+          clearTail(result, cols.size);
+      }
+    };
+
+
+    // Same test as internal::Hydrogen
+    class IsHydrogen : public SelectionNode {
+    public:
+      IsHydrogen() : SelectionNode(BOOL) { }
+
+      struct Predicate {
+        Predicate(const AtomicGroup& g, const std::vector<bool>& t, const std::vector<uint>& ids) : _g(g), _t(t), _ids(ids) { }
+        bool operator()(const uint i) const {
+          if (!_t[_ids[i]])
+            return(false);
+          const pAtom& pa = _g[i];
+          if (pa->checkProperty(Atom::massbit))
+            return(pa->mass() < 1.1);
+          return(true);
+        }
+        const AtomicGroup& _g;
+        const std::vector<bool>& _t;
+        const std::vector<uint>& _ids;
+      };
+
+      void evalBits(SelectionColumns& cols, Bits& result) const {
+        const std::vector<uint>& ids = cols.strings(SelectionColumns::NAME);
+        std::vector<bool> table(cols.nstrings());
+        for (uint k=0; k<table.size(); ++k)
+          table[k] = (!cols.string(k).empty() && cols.string(k)[0] == 'H');
+        fillBits(result, cols.size, Predicate(cols.group, table, ids));
+      }
+    };
+
+
+    // Same test as internal::Backbone
+    class IsBackbone : public SelectionNode {
+    public:
+      IsBackbone() : SelectionNode(BOOL) { }
+
+      void evalBits(SelectionColumns& cols, Bits& result) const {
+        const std::vector<uint>& names = cols.strings(SelectionColumns::NAME);
+        const std::vector<uint>& resnames = cols.strings(SelectionColumns::RESNAME);
+
+        std::vector<bool> name_table(cols.nstrings()), resname_table(cols.nstrings());
+        for (uint k=0; k<cols.nstrings(); ++k) {
+          name_table[k] = BackboneSelector::isBackboneName(cols.string(k));
+          resname_table[k] = BackboneSelector::isBackboneResidue(cols.string(k));
+        }
+        fillBits(result, cols.size, LookupTables(resname_table, resnames, name_table, names));
+      }
+    };
+
+  }
+
+
+
+  // ------------------------------------------------------------------
+
+
+  namespace {
+
+    // Thrown when the Kernel contains something that cannot be compiled
+    struct Unsupported { };
+
+    typedef internal::pNode    pNode;
+
+    pNode popNode(std::vector<pNode>& stack) {
+      if (stack.empty())
+        throw(Unsupported());
+      pNode n = stack.back();
+      stack.pop_back();
+      return(n);
+    }
+
+    bool isNumeric(const pNode& n) { return(n->type != internal::SelectionNode::STRING); }
+
+    const internal::StringNode& stringField(const pNode& n) {
+      if (n->type != internal::SelectionNode::STRING)
+        throw(Unsupported());
+      const internal::StringNode& s = dynamic_cast<const internal::StringNode&>(*n);
+      if (s.is_constant)
+        throw(Unsupported());
+      return(s);
+    }
+
+    // Comparing a string with a number is an error in the Kernel, so
+    // leave it to the Kernel to report
+    void pushCompare(std::vector<pNode>& stack, const internal::Compare::Op op) {
+      pNode rhs = popNode(stack);
+      pNode lhs = popNode(stack);
+      if (isNumeric(lhs) != isNumeric(rhs))
+        throw(Unsupported());
+      stack.push_back(pNode(new internal::Compare(op, lhs, rhs)));
+    }
+
+    template<class T>
+    bool is(const internal::Action* a) { return(dynamic_cast<const T*>(a) != 0); }
+  }
+
+
+
+  CompiledSelection::CompiledSelection(const std::string& selection)
+    : _parser(new Parser(selection)), _kernel(&(_parser->kernel()))
+  {
+    compile();
+  }
+
+
+  CompiledSelection::CompiledSelection(Kernel& kernel) : _kernel(&kernel) {
+    compile();
+  }
+
+
+  // The Kernel's commands are postfix, so running them with a stack
+  // of nodes (rather than values) rebuilds the expression tree
+  void CompiledSelection::compile() {
+    using namespace internal;
+
+    const std::vector<Action*>& cmds = _kernel->commands();
+    std::vector<pNode> stack;
+
+    try {
+      for (std::vector<Action*>::const_iterator i = cmds.begin(); i != cmds.end(); ++i) {
+        const Action* a = *i;
+
+        if (const pushString* p = dynamic_cast<const pushString*>(a)) {
+          stack.push_back(pNode(new StringNode(p->value().getString())));
+        } else if (const pushInt* p = dynamic_cast<const pushInt*>(a)) {
+          stack.push_back(pNode(new IntConstant(p->value().getInt())));
+
+        } else if (is<pushAtomName>(a)) {
+          stack.push_back(pNode(new StringNode(SelectionColumns::NAME)));
+        } else if (is<pushAtomResname>(a)) {
+          stack.push_back(pNode(new StringNode(SelectionColumns::RESNAME)));
+        } else if (is<pushAtomSegid>(a)) {
+          stack.push_back(pNode(new StringNode(SelectionColumns::SEGID)));
+        } else if (is<pushAtomChainId>(a)) {
+          stack.push_back(pNode(new StringNode(SelectionColumns::CHAINID)));
+        } else if (is<pushAtomId>(a)) {
+          stack.push_back(pNode(new IntField(SelectionColumns::ID)));
+        } else if (is<pushAtomResid>(a)) {
+          stack.push_back(pNode(new IntField(SelectionColumns::RESID)));
+        } else if (is<pushAtomIndex>(a)) {
+          stack.push_back(pNode(new IntField(SelectionColumns::INDEX)));
+
+        } else if (is<equals>(a)) {
+          pushCompare(stack, Compare::EQ);
+        } else if (is<lessThan>(a)) {
+          pushCompare(stack, Compare::LT);
+        } else if (is<lessThanEquals>(a)) {
+          pushCompare(stack, Compare::LTE);
+        } else if (is<greaterThan>(a)) {
+          pushCompare(stack, Compare::GT);
+        } else if (is<greaterThanEquals>(a)) {
+          pushCompare(stack, Compare::GTE);
+
+        } else if (const matchRegex* p = dynamic_cast<const matchRegex*>(a)) {
+          const StringNode& s = stringField(popNode(stack));
+          stack.push_back(pNode(new RegexMatch(s.field, p->regex())));
+        } else if (const extractNumber* p = dynamic_cast<const extractNumber*>(a)) {
+          const StringNode& s = stringField(popNode(stack));
+          stack.push_back(pNode(new ExtractNumber(s.field, p->regex())));
+
+        } else if (is<logicalAnd>(a) || is<logicalOr>(a)) {
+          pNode rhs = popNode(stack);
+          pNode lhs = popNode(stack);
+          if (!(isNumeric(lhs) && isNumeric(rhs)))
+            throw(Unsupported());
+          if (is<logicalAnd>(a))
+            stack.push_back(pNode(new LogicalAnd(lhs, rhs)));
+          else
+            stack.push_back(pNode(new LogicalOr(lhs, rhs)));
+        } else if (is<logicalNot>(a)) {
+          pNode arg = popNode(stack);
+          if (!isNumeric(arg))
+            throw(Unsupported());
+          stack.push_back(pNode(new LogicalNot(arg)));
+
+        } else if (is<logicalTrue>(a)) {
+          stack.push_back(pNode(new LogicalTrue));
+        } else if (is<Hydrogen>(a)) {
+          stack.push_back(pNode(new IsHydrogen));
+        } else if (is<Backbone>(a)) {
+          stack.push_back(pNode(new IsBackbone));
+
+        } else
+          throw(Unsupported());
+      }
+
+      if (stack.size() != 1 || !isNumeric(stack.back()))
+        throw(Unsupported());
+      _root = stack.back();
+    }
+    catch (Unsupported&) {
+      _root.reset();
+    }
+  }
+
+
+  std::vector<bool> CompiledSelection::evaluate(const AtomicGroup& source) const {
+    uint n = source.size();
+    std::vector<bool> mask(n);
+
+    if (_root) {
+      internal::SelectionColumns cols(source);
+      internal::Bits bits;
+      _root->evalBits(cols, bits);
+      for (uint i=0; i<n; ++i)
+        mask[i] = internal::testBit(bits, i);
+    } else {
+      KernelSelector sel(*_kernel);
+      for (uint i=0; i<n; ++i)
+        mask[i] = sel(source[i]);
+    }
+
+    return(mask);
+  }
+
+
+  AtomicGroup CompiledSelection::select(const AtomicGroup& source) const {
+    return(source.select(evaluate(source)));
+  }
+
+
+}
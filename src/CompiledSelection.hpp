@@ -0,0 +1,107 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_COMPILED_SELECTION_HPP)
+#define LOOS_COMPILED_SELECTION_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <loos_defs.hpp>
+
+
+namespace loos {
+
+  class Kernel;
+  class Parser;
+
+  namespace internal {
+    class SelectionNode;
+  }
+
+
+  //! Evaluates an atom selection over an entire group at once
+  /**
+   * The Kernel built by the Parser is a stack machine that is run
+   * once for every atom, pushing and popping Values (and copying
+   * strings) as it goes.  CompiledSelection instead converts the
+   * Kernel's commands back into an expression tree and evaluates
+   * each node over the whole group:  the atom properties used by the
+   * selection are pulled into columns once (with names, resnames,
+   * segids, and chain ids turned into integer ids from a table of the
+   * unique strings), string comparisons and regular expressions are
+   * only evaluated once per unique string, and logical operations
+   * are done on bitmasks.
+   *
+   * The selected atoms are exactly those that KernelSelector would
+   * choose.  If the Kernel contains something that cannot be
+   * converted (isCompiled() will be false), then the Kernel is
+   * simply run for each atom as before.
+   *
+   * A CompiledSelection can be reused, so when a selection is
+   * applied to many groups (e.g. each molecule from
+   * AtomicGroup::splitByMolecule()), parse it once:
+   * \code
+   *   CompiledSelection sel("name == 'CA'");
+   *   for (uint i=0; i<molecules.size(); ++i) {
+   *     AtomicGroup ca = sel.select(molecules[i]);
+   *     ...
+   *   }
+   * \endcode
+   */
+  class CompiledSelection {
+  public:
+    //! Parse and compile a selection string (throws a ParseError if invalid)
+    explicit CompiledSelection(const std::string& selection);
+
+    //! Compile an already parsed Kernel
+    /**
+     * If the Kernel cannot be compiled, it will be used directly, so
+     * it must outlive the CompiledSelection.
+     */
+    explicit CompiledSelection(Kernel& kernel);
+
+    //! Returns the atoms in \a source that match the selection
+    AtomicGroup select(const AtomicGroup& source) const;
+
+    //! Returns a vector with one entry per atom in \a source that is true for matching atoms
+    std::vector<bool> evaluate(const AtomicGroup& source) const;
+
+    //! True if the selection was compiled (rather than falling back to the Kernel)
+    bool isCompiled() const { return(_root != 0); }
+
+  private:
+    void compile();
+
+    boost::shared_ptr<Parser> _parser;
+    Kernel* _kernel;
+    boost::shared_ptr<internal::SelectionNode> _root;
+  };
+
+
+}
+
+
+#endif
@@ -0,0 +1,582 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <fstream>
+#include <streambuf>
+#include <vector>
+
+#include <boost/crc.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/version.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+
+// Boost only added zstd support in 1.67
+#if BOOST_VERSION >= 106700
+#define LOOS_HAS_ZSTD
+#include <boost/iostreams/filter/zstd.hpp>
+#endif
+
+#include <CompressedStream.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    namespace bio = boost::iostreams;
+
+
+    // Amount decompressed at a time for files that are not seekable
+    const std::streamsize sequential_buffer_size = 256 * 1024;
+
+    // Largest amount of data in one BGZF block (as used by bgzip)
+    const uint bgzf_block_size = 0xff00;
+
+    // Default size of each frame in a seekable zstd file
+    const uint zstd_chunk_size = 1024 * 1024;
+
+    const uint zstd_skippable_magic = 0x184D2A5E;
+    const uint zstd_seekable_magic = 0x8F92EAB1;
+
+
+    // Both formats are little-endian throughout
+    uint getLE16(const unsigned char* p) {
+      return(p[0] | (p[1] << 8));
+    }
+
+    uint getLE32(const unsigned char* p) {
+      return(p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint>(p[3]) << 24));
+    }
+
+    void putLE16(std::ostream& os, const uint x) {
+      char b[2] = { static_cast<char>(x & 0xff), static_cast<char>((x >> 8) & 0xff) };
+      os.write(b, 2);
+    }
+
+    void putLE32(std::ostream& os, const uint x) {
+      putLE16(os, x & 0xffff);
+      putLE16(os, x >> 16);
+    }
+
+
+    bool readBytes(std::istream& is, const std::streamoff pos, unsigned char* buf, const std::streamsize n) {
+      is.clear();
+      is.seekg(pos);
+      is.read(reinterpret_cast<char*>(buf), n);
+      return(is.gcount() == n);
+    }
+
+
+#if !defined(LOOS_HAS_ZSTD)
+    const char* no_zstd_message = "Zstd compressed files require LOOS to be built with Boost 1.67 or newer";
+
+    void noZstd() {
+      throw(LOOSError(no_zstd_message));
+    }
+#endif
+
+
+    // Zstd files are turned away by newInputStream() when they can't be
+    // read, so this is only a safeguard
+    void pushDecompressor(bio::filtering_istream& in, const Compression c) {
+      if (c == Gzip)
+        in.push(bio::gzip_decompressor());
+      else
+#if defined(LOOS_HAS_ZSTD)
+        in.push(bio::zstd_decompressor());
+#else
+        noZstd();
+#endif
+    }
+
+
+
+    // A chunk of a seekable file, i.e. one BGZF block or one zstd frame
+    struct Chunk {
+      Chunk(const std::streamoff co, const uint cs, const std::streamoff uo, const uint us)
+        : coffset(co), csize(cs), uoffset(uo), usize(us) { }
+
+      std::streamoff coffset;
+      uint csize;
+      std::streamoff uoffset;
+      uint usize;
+    };
+
+    bool operator<(const std::streamoff pos, const Chunk& c) { return(pos < c.uoffset); }
+
+
+    // Each BGZF block is a gzip member with an extra field giving the
+    // size of the block, and the uncompressed size is at the end of
+    // the member, so the blocks can be indexed without decompressing
+    // them.  Returns false if this is not a BGZF file.
+    bool indexBGZF(std::istream& is, std::vector<Chunk>& chunks) {
+      is.seekg(0, std::ios_base::end);
+      std::streamoff file_size = is.tellg();
+      std::streamoff coffset = 0, uoffset = 0;
+      unsigned char header[12], extra[256], footer[4];
+
+      while (coffset < file_size) {
+        if (!readBytes(is, coffset, header, 12))
+          return(false);
+        if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 || !(header[3] & 4))
+          return(false);
+        uint xlen = getLE16(header + 10);
+        if (xlen > sizeof(extra) || !readBytes(is, coffset + 12, extra, xlen))
+          return(false);
+
+        uint block_size = 0;
+        for (uint i=0; i+4 <= xlen; ) {
+          uint slen = getLE16(extra + i + 2);
+          if (extra[i] == 'B' && extra[i+1] == 'C' && slen == 2 && i + 6 <= xlen)
+            block_size = getLE16(extra + i + 4) + 1;
+          i += 4 + slen;
+        }
+        if (block_size == 0 || coffset + block_size > file_size)
+          return(false);
+
+        if (!readBytes(is, coffset + block_size - 4, footer, 4))
+          return(false);
+        uint usize = getLE32(footer);
+        if (usize > 0)
+          chunks.push_back(Chunk(coffset, block_size, uoffset, usize));
+        coffset += block_size;
+        uoffset += usize;
+      }
+
+      return(true);
+    }
+
+
+    // The zstd seekable format ends with a skippable frame holding the
+    // compressed and uncompressed size of every frame.  Returns false
+    // if this is not a seekable zstd file.
+    bool indexZstdSeekable(std::istream& is, std::vector<Chunk>& chunks) {
+      is.seekg(0, std::ios_base::end);
+      std::streamoff file_size = is.tellg();
+      unsigned char footer[9];
+
+      if (file_size < 17 || !readBytes(is, file_size - 9, footer, 9))
+        return(false);
+      if (getLE32(footer + 5) != zstd_seekable_magic)
+        return(false);
+
+      uint nframes = getLE32(footer);
+      uint entry_size = (footer[4] & 0x80) ? 12 : 8;
+      std::streamoff table_size = static_cast<std::streamoff>(nframes) * entry_size;
+      std::streamoff table_start = file_size - 9 - table_size;
+      if (table_start < 8)
+        return(false);
+
+      unsigned char frame_header[8];
+      if (!readBytes(is, table_start - 8, frame_header, 8))
+        return(false);
+      if (getLE32(frame_header) != zstd_skippable_magic || getLE32(frame_header + 4) != table_size + 9)
+        return(false);
+
+      std::vector<unsigned char> table(table_size + 1);
+      if (!readBytes(is, table_start, &table[0], table_size))
+        return(false);
+
+      std::streamoff coffset = 0, uoffset = 0;
+      for (uint i=0; i<nframes; ++i) {
+        uint csize = getLE32(&table[i * entry_size]);
+        uint usize = getLE32(&table[i * entry_size + 4]);
+        if (usize > 0)
+          chunks.push_back(Chunk(coffset, csize, uoffset, usize));
+        coffset += csize;
+        uoffset += usize;
+      }
+
+      return(coffset == table_start - 8);
+    }
+
+
+
+    // Decompresses chunks as they are needed, so seeking only has to
+    // decompress the chunk containing the new position
+    class ChunkedBuf : public std::streambuf {
+    public:
+      ChunkedBuf(const std::string& fname, const Compression c, const std::vector<Chunk>& chunks)
+        : _fname(fname), _compression(c),
+          _file(fname.c_str(), std::ios_base::in | std::ios_base::binary),
+          _chunks(chunks), _total(0), _current(chunks.size())
+      {
+        if (!_file)
+          throw(FileOpenError(fname));
+        if (!_chunks.empty())
+          _total = _chunks.back().uoffset + _chunks.back().usize;
+        _buf.resize(1);
+        setg(&_buf[0], &_buf[0], &_buf[0]);
+      }
+
+    protected:
+
+      int_type underflow() {
+        if (gptr() < egptr())
+          return(traits_type::to_int_type(*gptr()));
+
+        uint next = (_current == _chunks.size()) ? 0 : _current + 1;
+        if (next >= _chunks.size())
+          return(traits_type::eof());
+        load(next);
+        return(traits_type::to_int_type(*gptr()));
+      }
+
+
+      pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+        if (dir == std::ios_base::cur)
+          off += position();
+        else if (dir == std::ios_base::end)
+          off += _total;
+        return(seekpos(off, which));
+      }
+
+
+      pos_type seekpos(pos_type pos, std::ios_base::openmode which) {
+        std::streamoff target = pos;
+        if (!(which & std::ios_base::in) || target < 0 || target > _total)
+          return(pos_type(off_type(-1)));
+        if (_chunks.empty())
+          return(pos);
+
+        uint i = std::upper_bound(_chunks.begin(), _chunks.end(), target) - _chunks.begin() - 1;
+        if (i != _current)
+          load(i);
+        setg(eback(), eback() + (target - _chunks[i].uoffset), egptr());
+        return(pos);
+      }
+
+
+    private:
+
+      std::streamoff position() const {
+        if (_current == _chunks.size())
+          return(0);
+        return(_chunks[_current].uoffset + (gptr() - eback()));
+      }
+
+
+      void load(const uint i) {
+        const Chunk& c = _chunks[i];
+        _cbuf.resize(c.csize);
+        _file.clear();
+        _file.seekg(c.coffset);
+        _file.read(&_cbuf[0], c.csize);
+        if (_file.gcount() != static_cast<std::streamsize>(c.csize))
+          throw(FileReadError(_fname, "Compressed file is truncated"));
+
+        bio::filtering_istream in;
+        pushDecompressor(in, _compression);
+        in.push(bio::array_source(&_cbuf[0], _cbuf.size()));
+        _buf.resize(c.usize);
+        in.read(&_buf[0], c.usize);
+        if (in.gcount() != static_cast<std::streamsize>(c.usize))
+          throw(FileReadError(_fname, "Compressed file is corrupted"));
+
+        _current = i;
+        setg(&_buf[0], &_buf[0], &_buf[0] + c.usize);
+      }
+
+
+      std::string _fname;
+      Compression _compression;
+      std::ifstream _file;
+      std::vector<Chunk> _chunks;
+      std::streamoff _total;
+      uint _current;              // == _chunks.size() if nothing loaded yet
+      std::vector<char> _buf, _cbuf;
+    };
+
+
+
+
+    // Decompresses the whole file in order.  Seeking forward
+    // decompresses and discards, and seeking backwards starts over.
+    class SequentialBuf : public std::streambuf {
+    public:
+      SequentialBuf(const std::string& fname, const Compression c)
+        : _fname(fname), _compression(c), _buf(sequential_buffer_size), _start(0), _size(-1)
+      {
+        restart();
+      }
+
+    protected:
+
+      int_type underflow() {
+        if (gptr() < egptr())
+          return(traits_type::to_int_type(*gptr()));
+
+        _start += egptr() - eback();
+        _in->read(&_buf[0], _buf.size());
+        std::streamsize n = _in->gcount();
+        setg(&_buf[0], &_buf[0], &_buf[0] + n);
+        if (n <= 0) {
+          _size = _start;
+          return(traits_type::eof());
+        }
+        return(traits_type::to_int_type(*gptr()));
+      }
+
+
+      pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+        std::streamoff here = _start + (gptr() - eback());
+        if (dir == std::ios_base::cur) {
+          if (off == 0)                   // i.e. tellg()
+            return(pos_type(here));
+          off += here;
+        } else if (dir == std::ios_base::end) {
+          if (_size < 0) {
+            setg(eback(), egptr(), egptr());
+            while (underflow() != traits_type::eof())
+              setg(eback(), egptr(), egptr());
+          }
+          off += _size;
+        }
+        return(seekpos(off, which));
+      }
+
+
+      pos_type seekpos(pos_type pos, std::ios_base::openmode which) {
+        std::streamoff target = pos;
+        if (!(which & std::ios_base::in) || target < 0)
+          return(pos_type(off_type(-1)));
+
+        if (target < _start)
+          restart();
+        while (target > _start + (egptr() - eback())) {
+          setg(eback(), egptr(), egptr());
+          if (underflow() == traits_type::eof())
+            return(pos_type(off_type(-1)));
+        }
+        setg(eback(), eback() + (target - _start), egptr());
+        return(pos);
+      }
+
+
+    private:
+
+      void restart() {
+        bio::file_source source(_fname, std::ios_base::in | std::ios_base::binary);
+        if (!source.is_open())
+          throw(FileOpenError(_fname));
+        _in.reset(new bio::filtering_istream);
+        pushDecompressor(*_in, _compression);
+        _in->push(source);
+        _start = 0;
+        setg(&_buf[0], &_buf[0], &_buf[0]);
+      }
+
+
+      std::string _fname;
+      Compression _compression;
+      boost::scoped_ptr<bio::filtering_istream> _in;
+      std::vector<char> _buf;
+      std::streamoff _start;      // Position of the start of _buf in the file
+      std::streamoff _size;       // Uncompressed size, once known
+    };
+
+
+
+    // An istream that owns its streambuf
+    class DecompressingStream : public std::istream {
+    public:
+      explicit DecompressingStream(std::streambuf* buf) : std::istream(buf), _buf(buf) { }
+    private:
+      boost::scoped_ptr<std::streambuf> _buf;
+    };
+
+
+
+    template<class Filter>
+    void compressChunk(const Filter& filter, const std::vector<char>& src, const std::streamsize n,
+                       std::vector<char>& dst) {
+      dst.clear();
+      bio::filtering_ostream out;
+      out.push(filter);
+      out.push(bio::back_inserter(dst));
+      out.write(&src[0], n);
+      out.reset();
+    }
+
+
+    void writeBGZF(std::istream& is, std::ostream& os) {
+      std::vector<char> buf(bgzf_block_size), cbuf;
+      bio::zlib_params params(bio::zlib::default_compression);
+      params.noheader = true;     // Raw deflate, since the gzip header is written here
+
+      for (;;) {
+        is.read(&buf[0], buf.size());
+        std::streamsize n = is.gcount();
+        if (n <= 0)
+          break;
+
+        compressChunk(bio::zlib_compressor(params), buf, n, cbuf);
+        boost::crc_32_type crc;
+        crc.process_bytes(&buf[0], n);
+
+        const char header[] = { 0x1f, static_cast<char>(0x8b), 8, 4, 0, 0, 0, 0, 0, static_cast<char>(0xff), 6, 0, 'B', 'C', 2, 0 };
+        os.write(header, sizeof(header));
+        putLE16(os, sizeof(header) + 2 + cbuf.size() + 8 - 1);
+        os.write(&cbuf[0], cbuf.size());
+        putLE32(os, crc.checksum());
+        putLE32(os, n);
+      }
+
+      // Empty block that marks the end of the file
+      const char eof_block[] = { 0x1f, static_cast<char>(0x8b), 8, 4, 0, 0, 0, 0, 0, static_cast<char>(0xff),
+                                 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+      os.write(eof_block, sizeof(eof_block));
+    }
+
+
+    void writeZstdSeekable(std::istream& is, std::ostream& os, const uint chunk_size) {
+      std::vector<char> buf(chunk_size), cbuf;
+      std::vector<uint> csizes, usizes;
+
+      for (;;) {
+        is.read(&buf[0], buf.size());
+        std::streamsize n = is.gcount();
+        if (n <= 0)
+          break;
+
+#if defined(LOOS_HAS_ZSTD)
+        compressChunk(bio::zstd_compressor(), buf, n, cbuf);
+#else
+        noZstd();
+#endif
+        os.write(&cbuf[0], cbuf.size());
+        csizes.push_back(cbuf.size());
+        usizes.push_back(n);
+      }
+
+      putLE32(os, zstd_skippable_magic);
+      putLE32(os, csizes.size() * 8 + 9);
+      for (uint i=0; i<csizes.size(); ++i) {
+        putLE32(os, csizes[i]);
+        putLE32(os, usizes[i]);
+      }
+      putLE32(os, csizes.size());
+      os.put(0);                  // No checksums
+      putLE32(os, zstd_seekable_magic);
+    }
+
+  }
+
+
+
+  Compression detectCompression(const std::string& fname) {
+    std::ifstream ifs(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!ifs)
+      throw(FileOpenError(fname));
+
+    unsigned char magic[4];
+    ifs.read(reinterpret_cast<char*>(magic), 4);
+    std::streamsize n = ifs.gcount();
+
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+      return(Gzip);
+    if (n == 4 && getLE32(magic) == 0xFD2FB528)
+      return(Zstd);
+    return(Uncompressed);
+  }
+
+
+  std::string compressionName(const Compression c) {
+    switch(c) {
+    case Gzip: return("gzip");
+    case Zstd: return("zstd");
+    default: return("none");
+    }
+  }
+
+
+  bool isCompressedSuffix(const std::string& suffix) {
+    return(suffix == "gz" || suffix == "bgz" || suffix == "zst" || suffix == "zstd");
+  }
+
+
+  bool isSeekableCompressed(const std::string& fname) {
+    Compression c = detectCompression(fname);
+    if (c == Uncompressed)
+      return(false);
+
+    std::ifstream ifs(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+    std::vector<Chunk> chunks;
+    return(c == Gzip ? indexBGZF(ifs, chunks) : indexZstdSeekable(ifs, chunks));
+  }
+
+
+  std::istream* newInputStream(const std::string& fname) {
+    Compression c = detectCompression(fname);
+    if (c == Uncompressed) {
+      std::istream* is = new std::fstream(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+      if (!is->good()) {
+        delete is;
+        throw(FileOpenError(fname));
+      }
+      return(is);
+    }
+
+#if !defined(LOOS_HAS_ZSTD)
+    // Caught here rather than when decompressing, since this is called
+    // from functions that only allow a FileOpenError (such as
+    // Trajectory::setInputStream()), and a seekable file isn't
+    // decompressed until it is read
+    if (c == Zstd)
+      throw(FileOpenError(fname, no_zstd_message));
+#endif
+
+    std::vector<Chunk> chunks;
+    bool seekable;
+    {
+      std::ifstream ifs(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+      seekable = (c == Gzip) ? indexBGZF(ifs, chunks) : indexZstdSeekable(ifs, chunks);
+    }
+
+    if (seekable)
+      return(new DecompressingStream(new ChunkedBuf(fname, c, chunks)));
+    return(new DecompressingStream(new SequentialBuf(fname, c)));
+  }
+
+
+  boost::shared_ptr<std::istream> openInputStream(const std::string& fname) {
+    return(boost::shared_ptr<std::istream>(newInputStream(fname)));
+  }
+
+
+  void writeSeekableCompressed(std::istream& is, std::ostream& os, const Compression c, const uint chunk_size) {
+    if (c == Gzip)
+      writeBGZF(is, os);
+    else if (c == Zstd)
+      writeZstdSeekable(is, os, chunk_size == 0 ? zstd_chunk_size : chunk_size);
+    else
+      throw(LOOSError("Seekable files must be compressed"));
+  }
+
+
+}
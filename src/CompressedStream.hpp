@@ -0,0 +1,101 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_COMPRESSED_STREAM_HPP)
+#define LOOS_COMPRESSED_STREAM_HPP
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+#include <loos_defs.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  //! Compression formats that can be read transparently
+  enum Compression { Uncompressed, Gzip, Zstd };
+
+
+  //! Determines how a file is compressed from its first few bytes
+  /**
+   * Throws a FileOpenError if the file cannot be opened
+   */
+  Compression detectCompression(const std::string& fname);
+
+  std::string compressionName(const Compression c);
+
+  //! True if \a suffix (without the dot) is one used for compressed files (gz, bgz, zst)
+  bool isCompressedSuffix(const std::string& suffix);
+
+  //! True if \a fname is compressed in one of the seekable formats (see writeSeekableCompressed())
+  bool isSeekableCompressed(const std::string& fname);
+
+
+  //! Opens a file for reading, transparently decompressing it if necessary
+  /**
+   * Gzip and zstd compressed files are recognized by their contents
+   * (not their names) and decompressed as they are read, so there is
+   * no need to decompress them to disk first.  Uncompressed files are
+   * opened as a regular std::fstream.
+   *
+   * The returned stream is seekable in all cases.  Files in one of the
+   * seekable formats (blocked gzip, as written by bgzip, or the zstd
+   * seekable format) are compressed in independent chunks, and a seek
+   * only decompresses the chunk containing the new position.  For
+   * other compressed files, seeking forward decompresses (and
+   * discards) everything in between, and seeking backwards starts over
+   * from the beginning of the file.  These are fine for reading a
+   * trajectory straight through, but random access (e.g. readFrame(i))
+   * should use a seekable file.
+   *
+   * Throws a FileOpenError if the file cannot be opened.
+   */
+  boost::shared_ptr<std::istream> openInputStream(const std::string& fname);
+
+  //! As openInputStream(), but the caller owns (and must delete) the stream
+  std::istream* newInputStream(const std::string& fname);
+
+
+  //! Compresses \a is into \a os in a seekable format
+  /**
+   * Gzip files are written in blocked gzip (BGZF) format, a series of
+   * gzip members of up to 64k each, each recording its own compressed
+   * size.  These can still be read by gunzip or zcat.  Zstd files are
+   * written in the zstd seekable format, a series of independent
+   * frames of \a chunk_size bytes (default is 1MB) followed by a table
+   * of their sizes.  These can still be read by zstd.
+   */
+  void writeSeekableCompressed(std::istream& is, std::ostream& os, const Compression c,
+                               const uint chunk_size = 0);
+
+
+}
+
+
+
+#endif
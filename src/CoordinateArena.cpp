@@ -0,0 +1,413 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <new>
+
+#include <CoordinateArena.hpp>
+
+
+namespace loos {
+
+  // 64-bytes covers a cache line as well as the widest SIMD registers
+  const uint CoordinateArena::alignment = 64;
+
+
+  CoordinateArena::CoordinateArena(const uint n) : _n(0), _stride(0), _data(0), _periodic(false) {
+    allocate(n);
+  }
+
+
+  CoordinateArena::CoordinateArena(const AtomicGroup& model) : _n(0), _stride(0), _data(0), _periodic(false) {
+    uint n = 0;
+    for (AtomicGroup::const_iterator i = model.begin(); i != model.end(); ++i) {
+      if (!(*i)->checkProperty(Atom::indexbit))
+        throw(LOOSError(**i, "Atom has no index and cannot be placed into a CoordinateArena"));
+      if ((*i)->index() >= n)
+        n = (*i)->index() + 1;
+    }
+
+    allocate(n);
+    copyCoordinatesFrom(model);
+  }
+
+
+  CoordinateArena::CoordinateArena(const CoordinateArena& a) : _n(0), _stride(0), _data(0),
+                                                               _box(a._box), _periodic(a._periodic)
+  {
+    allocate(a._n);
+    if (_n)
+      memcpy(_data, a._data, 3 * _stride * sizeof(greal));
+  }
+
+
+  CoordinateArena& CoordinateArena::operator=(const CoordinateArena& a) {
+    if (this != &a) {
+      allocate(a._n);
+      if (_n)
+        memcpy(_data, a._data, 3 * _stride * sizeof(greal));
+      _box = a._box;
+      _periodic = a._periodic;
+    }
+    return(*this);
+  }
+
+
+  CoordinateArena::~CoordinateArena() {
+    release();
+  }
+
+
+  void CoordinateArena::release() {
+    free(_data);
+    _data = 0;
+    _n = _stride = 0;
+  }
+
+
+  // Allocates (and zeros) space for n atoms.  Each array is padded out
+  // so the y and z arrays also start on an aligned boundary.
+  void CoordinateArena::allocate(const uint n) {
+    release();
+    if (n == 0)
+      return;
+
+    uint per_line = alignment / sizeof(greal);
+    uint stride = ((n + per_line - 1) / per_line) * per_line;
+
+    void* p;
+    if (posix_memalign(&p, alignment, 3 * stride * sizeof(greal)) != 0)
+      throw(std::bad_alloc());
+
+    _data = static_cast<greal*>(p);
+    memset(_data, 0, 3 * stride * sizeof(greal));
+    _n = n;
+    _stride = stride;
+  }
+
+
+  void CoordinateArena::resize(const uint n) {
+    if (n == _n)
+      return;
+
+    CoordinateArena old(*this);
+    allocate(n);
+    uint m = (n < old._n) ? n : old._n;
+    for (uint k=0; k<3; ++k)
+      if (m)
+        memcpy(_data + k*_stride, old._data + k*old._stride, m * sizeof(greal));
+  }
+
+
+  void CoordinateArena::copyCoordinatesFrom(const AtomicGroup& g) {
+    for (AtomicGroup::const_iterator i = g.begin(); i != g.end(); ++i) {
+      if (!(*i)->checkProperty(Atom::indexbit))
+        throw(LOOSError(**i, "Atom has no index and cannot be placed into a CoordinateArena"));
+      uint idx = (*i)->index();
+      if (idx >= _n)
+        throw(LOOSError(**i, "Atom index is out of range for the CoordinateArena"));
+      coords(idx, (*i)->coords());
+    }
+
+    if (g.isPeriodic())
+      periodicBox(g.periodicBox());
+  }
+
+
+  void CoordinateArena::copyCoordinatesFrom(const std::vector<GCoord>& crds) {
+    if (crds.size() != _n)
+      throw(LOOSError("Coordinate vector does not match the size of the CoordinateArena"));
+
+    greal* xp = x();
+    greal* yp = y();
+    greal* zp = z();
+    for (uint i=0; i<_n; ++i) {
+      xp[i] = crds[i].x();
+      yp[i] = crds[i].y();
+      zp[i] = crds[i].z();
+    }
+  }
+
+
+  void CoordinateArena::copyCoordinatesTo(AtomicGroup& g) const {
+    for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
+      uint idx = (*i)->index();
+      if (idx >= _n)
+        throw(LOOSError(**i, "Atom index is out of range for the CoordinateArena"));
+      (*i)->coords(coords(idx));
+    }
+
+    if (_periodic)
+      g.periodicBox(_box);
+  }
+
+
+  std::vector<GCoord> CoordinateArena::coords() const {
+    std::vector<GCoord> crds(_n);
+    for (uint i=0; i<_n; ++i)
+      crds[i] = coords(i);
+    return(crds);
+  }
+
+
+
+  // ----------------------------------------------------------------------
+
+
+
+  CoordinateView::CoordinateView(const pCoordinateArena& arena) : _arena(arena), _contiguous(true), _first(0) {
+    _indices.resize(arena->size());
+    for (uint i=0; i<_indices.size(); ++i)
+      _indices[i] = i;
+  }
+
+
+  CoordinateView::CoordinateView(const pCoordinateArena& arena, const AtomicGroup& g) : _arena(arena), _contiguous(false), _first(0) {
+    _indices.reserve(g.size());
+    for (AtomicGroup::const_iterator i = g.begin(); i != g.end(); ++i) {
+      if (!(*i)->checkProperty(Atom::indexbit))
+        throw(LOOSError(**i, "Atom has no index and cannot be used in a CoordinateView"));
+      _indices.push_back((*i)->index());
+    }
+    checkIndices();
+    detectContiguous();
+  }
+
+
+  CoordinateView::CoordinateView(const pCoordinateArena& arena, const std::vector<uint>& indices)
+    : _arena(arena), _indices(indices), _contiguous(false), _first(0)
+  {
+    checkIndices();
+    detectContiguous();
+  }
+
+
+  void CoordinateView::checkIndices() const {
+    for (std::vector<uint>::const_iterator i = _indices.begin(); i != _indices.end(); ++i)
+      if (*i >= _arena->size())
+        throw(LOOSError("Index is out of range for the CoordinateArena in CoordinateView"));
+  }
+
+
+  void CoordinateView::detectContiguous() {
+    _contiguous = true;
+    _first = _indices.empty() ? 0 : _indices[0];
+    for (uint i=1; i<_indices.size(); ++i)
+      if (_indices[i] != _first + i) {
+        _contiguous = false;
+        break;
+      }
+  }
+
+
+  std::vector<GCoord> CoordinateView::boundingBox() const {
+    std::vector<GCoord> res(2);
+    uint n = size();
+    if (n == 0)
+      return(res);
+
+    const greal* arrays[3] = { _arena->x(), _arena->y(), _arena->z() };
+    for (uint k=0; k<3; ++k) {
+      const greal* p = arrays[k];
+      greal lo = p[_indices[0]];
+      greal hi = lo;
+      if (_contiguous) {
+        p += _first;
+        for (uint i=1; i<n; ++i) {
+          lo = (p[i] < lo) ? p[i] : lo;
+          hi = (p[i] > hi) ? p[i] : hi;
+        }
+      } else
+        for (uint i=1; i<n; ++i) {
+          greal v = p[_indices[i]];
+          lo = (v < lo) ? v : lo;
+          hi = (v > hi) ? v : hi;
+        }
+      res[0][k] = lo;
+      res[1][k] = hi;
+    }
+
+    return(res);
+  }
+
+
+  GCoord CoordinateView::centroid() const {
+    uint n = size();
+    if (n == 0)
+      return(GCoord(0,0,0));
+
+    const greal* xp = _arena->x();
+    const greal* yp = _arena->y();
+    const greal* zp = _arena->z();
+    greal cx = 0.0, cy = 0.0, cz = 0.0;
+
+    if (_contiguous) {
+      xp += _first;
+      yp += _first;
+      zp += _first;
+      for (uint i=0; i<n; ++i) {
+        cx += xp[i];
+        cy += yp[i];
+        cz += zp[i];
+      }
+    } else
+      for (uint i=0; i<n; ++i) {
+        uint j = _indices[i];
+        cx += xp[j];
+        cy += yp[j];
+        cz += zp[j];
+      }
+
+    return(GCoord(cx/n, cy/n, cz/n));
+  }
+
+
+  GCoord CoordinateView::centerAtOrigin() {
+    GCoord c = centroid();
+    translate(-c);
+    return(c);
+  }
+
+
+  greal CoordinateView::rmsd(const CoordinateView& v) const {
+    if (size() != v.size())
+      throw(LOOSError("Cannot compute RMSD between views with different sizes"));
+
+    uint n = size();
+    if (n == 0)
+      return(0.0);
+
+    const greal* ax = _arena->x();
+    const greal* ay = _arena->y();
+    const greal* az = _arena->z();
+    const greal* bx = v._arena->x();
+    const greal* by = v._arena->y();
+    const greal* bz = v._arena->z();
+    double d = 0.0;
+
+    if (_contiguous && v._contiguous) {
+      ax += _first; ay += _first; az += _first;
+      bx += v._first; by += v._first; bz += v._first;
+      for (uint i=0; i<n; ++i) {
+        double dx = ax[i] - bx[i];
+        double dy = ay[i] - by[i];
+        double dz = az[i] - bz[i];
+        d += dx*dx + dy*dy + dz*dz;
+      }
+    } else
+      for (uint i=0; i<n; ++i) {
+        uint j = _indices[i];
+        uint k = v._indices[i];
+        double dx = ax[j] - bx[k];
+        double dy = ay[j] - by[k];
+        double dz = az[j] - bz[k];
+        d += dx*dx + dy*dy + dz*dz;
+      }
+
+    return(sqrt(d / n));
+  }
+
+
+  std::vector<GCoord> CoordinateView::getTransformedCoords(const XForm& M) const {
+    GMatrix W = M.current();
+    uint n = size();
+    std::vector<GCoord> crds(n);
+
+    const greal* xp = _arena->x();
+    const greal* yp = _arena->y();
+    const greal* zp = _arena->z();
+    for (uint i=0; i<n; ++i) {
+      uint j = _indices[i];
+      crds[i] = GCoord(W[0]*xp[j] + W[1]*yp[j] + W[2]*zp[j] + W[3],
+                       W[4]*xp[j] + W[5]*yp[j] + W[6]*zp[j] + W[7],
+                       W[8]*xp[j] + W[9]*yp[j] + W[10]*zp[j] + W[11]);
+    }
+
+    return(crds);
+  }
+
+
+  void CoordinateView::translate(const GCoord& v) {
+    uint n = size();
+    greal* xp = _arena->x();
+    greal* yp = _arena->y();
+    greal* zp = _arena->z();
+    greal tx = v.x(), ty = v.y(), tz = v.z();
+
+    if (_contiguous) {
+      xp += _first;
+      yp += _first;
+      zp += _first;
+      for (uint i=0; i<n; ++i) {
+        xp[i] += tx;
+        yp[i] += ty;
+        zp[i] += tz;
+      }
+    } else
+      for (uint i=0; i<n; ++i) {
+        uint j = _indices[i];
+        xp[j] += tx;
+        yp[j] += ty;
+        zp[j] += tz;
+      }
+  }
+
+
+  // Note: assumes an affine transform (i.e. the last row of the
+  // matrix is [0 0 0 1]), which is all that XForm generates
+  void CoordinateView::applyTransform(const XForm& M) {
+    GMatrix W = M.current();
+    uint n = size();
+    greal* xp = _arena->x();
+    greal* yp = _arena->y();
+    greal* zp = _arena->z();
+
+    for (uint i=0; i<n; ++i) {
+      uint j = _contiguous ? _first + i : _indices[i];
+      greal a = xp[j], b = yp[j], c = zp[j];
+      xp[j] = W[0]*a + W[1]*b + W[2]*c + W[3];
+      yp[j] = W[4]*a + W[5]*b + W[6]*c + W[7];
+      zp[j] = W[8]*a + W[9]*b + W[10]*c + W[11];
+    }
+  }
+
+
+  std::vector<double> CoordinateView::coordsAsVector() const {
+    uint n = size();
+    std::vector<double> v(3*n);
+    const greal* xp = _arena->x();
+    const greal* yp = _arena->y();
+    const greal* zp = _arena->z();
+
+    for (uint i=0, k=0; i<n; ++i) {
+      uint j = _indices[i];
+      v[k++] = xp[j];
+      v[k++] = yp[j];
+      v[k++] = zp[j];
+    }
+
+    return(v);
+  }
+
+}
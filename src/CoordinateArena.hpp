@@ -0,0 +1,244 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_COORDINATE_ARENA_HPP)
+#define LOOS_COORDINATE_ARENA_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <XForm.hpp>
+#include <AtomicGroup.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  //! Contiguous structure-of-arrays storage for the coordinates of a system
+  /**
+   * Atoms store their own coordinates, so any loop over an AtomicGroup
+   * has to chase a shared pointer (and touch an entire Atom) for every
+   * coordinate.  A CoordinateArena instead keeps all of the x, y, and z
+   * coordinates for a system in three separate, aligned arrays that are
+   * indexed by the Atom::index() property, i.e. the same index used to
+   * pull coordinates out of a trajectory frame.  Subsets of the system
+   * are represented by a CoordinateView, which holds the indices of its
+   * atoms into the arena.
+   *
+   * The arena does not replace the coordinates stored in the Atoms.  Use
+   * copyCoordinatesFrom() and copyCoordinatesTo() to move coordinates
+   * between the arena and an AtomicGroup when needed.
+   *
+   * Copying a CoordinateArena makes a deep copy.  Use a pCoordinateArena
+   * to share one arena between several views.
+   */
+  class CoordinateArena {
+  public:
+
+    //! Each coordinate array begins on a boundary of this many bytes
+    static const uint alignment;
+
+    CoordinateArena() : _n(0), _stride(0), _data(0), _periodic(false) { }
+
+    //! Creates an arena for \a n atoms with all coordinates set to zero
+    explicit CoordinateArena(const uint n);
+
+    //! Creates an arena large enough to hold every atom in \a model and copies its coordinates in
+    /**
+     * Atoms are placed using their Atom::index() property, so the
+     * arena will have (largest index + 1) slots.
+     */
+    explicit CoordinateArena(const AtomicGroup& model);
+
+    CoordinateArena(const CoordinateArena& a);
+    CoordinateArena& operator=(const CoordinateArena& a);
+
+    ~CoordinateArena();
+
+    uint size() const { return(_n); }
+    bool empty() const { return(_n == 0); }
+
+    //! Resize the arena, preserving existing coordinates (new ones are zero)
+    /**
+     * Views onto the arena are only checked when they are created, so
+     * any view with indices past the new size is no longer valid.
+     */
+    void resize(const uint n);
+
+    //! Distance (in elements) between the start of the x, y, and z arrays
+    uint stride() const { return(_stride); }
+
+    greal* x() { return(_data); }
+    greal* y() { return(_data + _stride); }
+    greal* z() { return(_data + 2*_stride); }
+
+    const greal* x() const { return(_data); }
+    const greal* y() const { return(_data + _stride); }
+    const greal* z() const { return(_data + 2*_stride); }
+
+    //! Return the coordinates for the ith slot as a GCoord
+    GCoord coords(const uint i) const {
+      return(GCoord(_data[i], _data[i + _stride], _data[i + 2*_stride]));
+    }
+
+    //! Set the coordinates for the ith slot
+    void coords(const uint i, const GCoord& c) {
+      _data[i] = c.x();
+      _data[i + _stride] = c.y();
+      _data[i + 2*_stride] = c.z();
+    }
+
+    bool isPeriodic() const { return(_periodic); }
+    GCoord periodicBox() const { return(_box); }
+    void periodicBox(const GCoord& c) { _box = c; _periodic = true; }
+    void removePeriodicBox() { _periodic = false; }
+
+
+    //! Copy the coordinates of atoms in \a g into their slots in the arena
+    /**
+     * Throws a LOOSError if an atom has no index or if the index lies
+     * outside the arena.  If \a g is periodic, the box is copied too.
+     */
+    void copyCoordinatesFrom(const AtomicGroup& g);
+
+    //! Copy a vector of coordinates (e.g. from Trajectory::coords()) into the arena
+    /**
+     * The vector must have exactly size() elements, otherwise a
+     * LOOSError is thrown.  The arena is never reallocated here, so
+     * existing CoordinateViews remain valid.
+     */
+    void copyCoordinatesFrom(const std::vector<GCoord>& crds);
+
+    //! Copy coordinates from the arena back into the atoms of \a g (by Atom::index())
+    /**
+     * If the arena has a periodic box, it is set in \a g as well.
+     */
+    void copyCoordinatesTo(AtomicGroup& g) const;
+
+    //! Return the arena's coordinates as a vector of GCoords
+    std::vector<GCoord> coords() const;
+
+  private:
+    void allocate(const uint n);
+    void release();
+
+    uint _n, _stride;
+    greal* _data;       // One block holding x, y, then z
+
+    GCoord _box;
+    bool _periodic;
+  };
+
+
+
+  //! A set of atoms whose coordinates live in a CoordinateArena
+  /**
+   * This is the arena analog of an AtomicGroup.  It only holds indices
+   * into a shared arena, so copying a view is cheap and changes made
+   * through one view are visible through any other view onto the same
+   * arena.  When the indices form a single contiguous range (as is the
+   * case for a view of an entire system, or of a selection that was
+   * read in order), the numerical routines run directly over the arena
+   * arrays without any gather step.
+   *
+   * Example:
+   * \code
+   *   pCoordinateArena arena(new CoordinateArena(model));
+   *   CoordinateView ca(arena, selectAtoms(model, "name == 'CA'"));
+   *   while (traj->readFrame()) {
+   *     traj->updateGroupCoords(model);
+   *     arena->copyCoordinatesFrom(model);
+   *     GCoord c = ca.centroid();
+   *   }
+   * \endcode
+   */
+  class CoordinateView {
+  public:
+    CoordinateView() : _contiguous(true), _first(0) { }
+
+    //! A view of every slot in the arena
+    explicit CoordinateView(const pCoordinateArena& arena);
+
+    //! A view of the atoms in \a g (using their Atom::index() property)
+    CoordinateView(const pCoordinateArena& arena, const AtomicGroup& g);
+
+    //! A view of the given slots
+    CoordinateView(const pCoordinateArena& arena, const std::vector<uint>& indices);
+
+    uint size() const { return(_indices.size()); }
+    bool empty() const { return(_indices.empty()); }
+
+    //! Indices into the arena of the atoms in this view
+    const std::vector<uint>& indices() const { return(_indices); }
+
+    //! The arena this view refers to
+    pCoordinateArena arena() const { return(_arena); }
+
+    //! True if the indices form a single, ascending run
+    bool isContiguous() const { return(_contiguous); }
+
+    //! Coordinates of the ith atom in the view
+    GCoord coords(const uint i) const { return(_arena->coords(_indices[i])); }
+
+    //! Set coordinates of the ith atom in the view
+    void coords(const uint i, const GCoord& c) { _arena->coords(_indices[i], c); }
+
+
+    //! Bounding box (as in AtomicGroup::boundingBox())
+    std::vector<GCoord> boundingBox() const;
+
+    //! Centroid of the atoms in the view
+    GCoord centroid() const;
+
+    //! Translates the view's atoms so the centroid is at the origin, returning the old centroid
+    GCoord centerAtOrigin();
+
+    //! RMSD between two views, assuming a 1:1 correspondence between atoms
+    greal rmsd(const CoordinateView& v) const;
+
+    //! Returns the coordinates transformed by \a M (coordinates are not altered)
+    std::vector<GCoord> getTransformedCoords(const XForm& M) const;
+
+    void translate(const GCoord& v);
+    void applyTransform(const XForm& M);
+
+    //! Coordinates packed as (x0, y0, z0, x1, y1, z1, ...)
+    std::vector<double> coordsAsVector() const;
+
+  private:
+    void checkIndices() const;
+    void detectContiguous();
+
+    pCoordinateArena _arena;
+    std::vector<uint> _indices;
+    bool _contiguous;
+    uint _first;
+  };
+
+
+}
+
+
+#endif
@@ -0,0 +1,211 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <CoordinateEnsemble.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+  namespace internal {
+
+    EnsembleStorage::EnsembleStorage(const AtomicGroup& g, const uint n, const std::string& dir)
+      : model(g.copy()), natoms(g.size()), nframes(n), scratch_dir(dir), data(0), _fd(-1),
+        _bytes(static_cast<ulong>(n) * 3 * g.size() * sizeof(float))
+    {
+      if (scratch_dir.empty()) {
+        data = new float[static_cast<ulong>(nframes) * 3 * natoms]();
+        return;
+      }
+
+      std::string name = scratch_dir + "/loos-ensemble-XXXXXX";
+      std::vector<char> tmpl(name.begin(), name.end());
+      tmpl.push_back('\0');
+
+      _fd = mkstemp(&(tmpl[0]));
+      if (_fd < 0)
+        throw(FileOpenError(name, strerror(errno), errno));
+
+      // The file only needs to exist for as long as it is mapped
+      unlink(&(tmpl[0]));
+
+      if (_bytes == 0)
+        return;
+
+      if (ftruncate(_fd, _bytes) != 0) {
+        int err = errno;
+        close(_fd);
+        throw(FileOpenError(name, std::string("Unable to size scratch file: ") + strerror(err), err));
+      }
+
+      void* p = mmap(0, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+      if (p == MAP_FAILED) {
+        int err = errno;
+        close(_fd);
+        throw(FileOpenError(name, std::string("Unable to map scratch file: ") + strerror(err), err));
+      }
+
+      data = static_cast<float*>(p);
+    }
+
+
+    EnsembleStorage::~EnsembleStorage() {
+      if (_fd < 0) {
+        delete[] data;
+        return;
+      }
+
+      if (data)
+        munmap(data, _bytes);
+      close(_fd);
+    }
+
+  }
+
+
+
+  CoordinateEnsemble::CoordinateEnsemble(const AtomicGroup& model, const uint nframes, const std::string& scratch_dir)
+    : _store(new internal::EnsembleStorage(model, nframes, scratch_dir)),
+      _scratch_dir(scratch_dir), _offset(0), _nframes(nframes)
+  { }
+
+
+  void CoordinateEnsemble::checkFrame(const uint i) const {
+    if (i >= _nframes)
+      throw(LOOSError("Frame index out of range for CoordinateEnsemble"));
+  }
+
+
+  const AtomicGroup& CoordinateEnsemble::model() const {
+    if (!_store)
+      throw(LOOSError("CoordinateEnsemble has no model"));
+    return(_store->model);
+  }
+
+
+  alignment::vecDouble CoordinateEnsemble::coordsAsVector(const uint i) const {
+    checkFrame(i);
+    const float* p = frame(i);
+    return(alignment::vecDouble(p, p + 3 * _store->natoms));
+  }
+
+
+  void CoordinateEnsemble::coords(const uint i, const alignment::vecDouble& v) {
+    checkFrame(i);
+    if (v.size() != 3 * _store->natoms)
+      throw(LOOSError("Coordinates do not match the size of the CoordinateEnsemble"));
+
+    float* p = frame(i);
+    for (uint k=0; k<v.size(); ++k)
+      p[k] = v[k];
+  }
+
+
+  void CoordinateEnsemble::coords(const uint i, const AtomicGroup& g) {
+    checkFrame(i);
+    if (g.size() != _store->natoms)
+      throw(LOOSError("AtomicGroup does not match the size of the CoordinateEnsemble"));
+
+    float* p = frame(i);
+    for (uint k=0; k<g.size(); ++k) {
+      const GCoord& c = g[k]->coords();
+      *p++ = c.x();
+      *p++ = c.y();
+      *p++ = c.z();
+    }
+  }
+
+
+  void CoordinateEnsemble::copyCoordinatesTo(const uint i, AtomicGroup& g) const {
+    checkFrame(i);
+    if (g.size() != _store->natoms)
+      throw(LOOSError("AtomicGroup does not match the size of the CoordinateEnsemble"));
+
+    const float* p = frame(i);
+    for (uint k=0; k<g.size(); ++k, p += 3)
+      g[k]->coords(GCoord(p[0], p[1], p[2]));
+  }
+
+
+  AtomicGroup CoordinateEnsemble::frameAsGroup(const uint i) const {
+    AtomicGroup g = model().copy();
+    copyCoordinatesTo(i, g);
+    return(g);
+  }
+
+
+  void CoordinateEnsemble::applyTransform(const uint i, const XForm& W) {
+    checkFrame(i);
+    GMatrix M = W.current();
+
+    float* p = frame(i);
+    for (uint k=0; k<_store->natoms; ++k, p += 3) {
+      GCoord c = M * GCoord(p[0], p[1], p[2]);
+      p[0] = c.x();
+      p[1] = c.y();
+      p[2] = c.z();
+    }
+  }
+
+
+  CoordinateEnsemble CoordinateEnsemble::frames(const uint begin, const uint end) const {
+    if (begin > end || end > _nframes)
+      throw(LOOSError("Invalid range of frames for CoordinateEnsemble view"));
+
+    CoordinateEnsemble view(*this);
+    view._offset = _offset + begin;
+    view._nframes = end - begin;
+    return(view);
+  }
+
+
+  CoordinateEnsemble CoordinateEnsemble::copy() const {
+    if (!_store)
+      return(CoordinateEnsemble(_scratch_dir));
+
+    CoordinateEnsemble E(_store->model, _nframes, _scratch_dir);
+    if (_nframes)
+      memcpy(E.frame(0), frame(0), static_cast<ulong>(_nframes) * 3 * _store->natoms * sizeof(float));
+    return(E);
+  }
+
+
+  CoordinateEnsemble CoordinateEnsemble::select(const std::vector<uint>& indices) const {
+    CoordinateEnsemble E(model(), indices.size());
+
+    for (uint i=0; i<indices.size(); ++i) {
+      checkFrame(indices[i]);
+      memcpy(E.frame(i), frame(indices[i]), 3 * _store->natoms * sizeof(float));
+    }
+    return(E);
+  }
+
+
+}
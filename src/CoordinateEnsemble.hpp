@@ -0,0 +1,169 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_COORDINATE_ENSEMBLE_HPP)
+#define LOOS_COORDINATE_ENSEMBLE_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <XForm.hpp>
+#include <alignment.hpp>
+
+
+namespace loos {
+
+
+  namespace internal {
+
+    // The frames for a CoordinateEnsemble (and all views onto it),
+    // either on the heap or mapped from an unlinked scratch file
+    class EnsembleStorage {
+    public:
+      EnsembleStorage(const AtomicGroup& model, const uint nframes, const std::string& scratch_dir);
+      ~EnsembleStorage();
+
+      AtomicGroup model;
+      uint natoms, nframes;
+      std::string scratch_dir;
+      float* data;
+
+    private:
+      EnsembleStorage(const EnsembleStorage&);
+      EnsembleStorage& operator=(const EnsembleStorage&);
+
+      int _fd;
+      ulong _bytes;
+    };
+
+  }
+
+
+  //! A compact, optionally out-of-core, set of structures from a trajectory
+  /**
+   * A std::vector<AtomicGroup> ensemble stores a deep copy of every
+   * atom for every frame.  A CoordinateEnsemble stores only the
+   * coordinates, packed as a single frames x 3N matrix of floats (the
+   * x, y, and z coordinates of each atom for a frame are contiguous,
+   * in the same order as AtomicGroup::coordsAsVector()), along with a
+   * single copy of the atoms to use as a template.
+   *
+   * If a scratch directory is given, the matrix is memory-mapped from
+   * a temporary file created there (and removed as soon as it is
+   * opened) instead of being allocated on the heap, so the operating
+   * system can page frames in and out as needed.  This allows working
+   * with ensembles larger than physical memory.
+   *
+   * As with Math::Matrix, copying a CoordinateEnsemble shares the
+   * underlying data.  frames() returns a view of a contiguous range of
+   * frames, also sharing the data.  Use copy() or select() for a deep
+   * copy.
+   *
+   * Example:
+   * \code
+   *   CoordinateEnsemble ensemble("/scratch");
+   *   readTrajectory(ensemble, subset, traj);
+   *   iterativeAlignment(ensemble);
+   *   AtomicGroup avg = averageStructure(ensemble.frames(0, 1000));
+   * \endcode
+   */
+  class CoordinateEnsemble {
+  public:
+    //! An empty, in-memory ensemble
+    CoordinateEnsemble() : _offset(0), _nframes(0) { }
+
+    //! An empty ensemble that will be stored in \a scratch_dir when filled (e.g. by readTrajectory())
+    explicit CoordinateEnsemble(const std::string& scratch_dir) : _scratch_dir(scratch_dir), _offset(0), _nframes(0) { }
+
+    //! Allocates space for \a nframes structures with the atoms in \a model
+    /**
+     * The coordinates are all initially zero.  If \a scratch_dir is
+     * not empty, the frames are stored in a file there.
+     */
+    CoordinateEnsemble(const AtomicGroup& model, const uint nframes, const std::string& scratch_dir = "");
+
+    //! Number of structures
+    uint size() const { return(_nframes); }
+    bool empty() const { return(_nframes == 0); }
+
+    //! Number of atoms in each structure
+    uint atoms() const { return(_store ? _store->natoms : 0); }
+
+    //! Where the frames are (or will be) kept (empty for memory)
+    std::string scratchDirectory() const { return(_scratch_dir); }
+
+    //! True if the frames are memory-mapped from a scratch file
+    bool isMapped() const { return(_store && !_store->scratch_dir.empty()); }
+
+    //! The atoms each frame refers to (with undefined coordinates)
+    const AtomicGroup& model() const;
+
+    //! Pointer to the 3N packed coordinates for the ith frame
+    float* frame(const uint i) { return(_store->data + (static_cast<ulong>(_offset) + i) * 3 * _store->natoms); }
+    const float* frame(const uint i) const { return(_store->data + (static_cast<ulong>(_offset) + i) * 3 * _store->natoms); }
+
+    //! Coordinates of the ith frame (for use with the alignment functions)
+    alignment::vecDouble coordsAsVector(const uint i) const;
+
+    //! Set the coordinates of the ith frame
+    void coords(const uint i, const alignment::vecDouble& v);
+
+    //! Set the coordinates of the ith frame from the atoms in \a g
+    void coords(const uint i, const AtomicGroup& g);
+
+    //! Copy the coordinates of the ith frame into the atoms of \a g
+    void copyCoordinatesTo(const uint i, AtomicGroup& g) const;
+
+    //! Returns a copy of the model with the coordinates of the ith frame
+    AtomicGroup frameAsGroup(const uint i) const;
+
+    //! Transform the coordinates of the ith frame
+    void applyTransform(const uint i, const XForm& W);
+
+    //! A view of frames [begin, end) that shares data with this ensemble
+    CoordinateEnsemble frames(const uint begin, const uint end) const;
+
+    //! Deep copy, kept in the same scratch directory (or memory) as this ensemble
+    CoordinateEnsemble copy() const;
+
+    //! Deep copy (in memory) of the frames listed in \a indices
+    CoordinateEnsemble select(const std::vector<uint>& indices) const;
+
+  private:
+    void checkFrame(const uint i) const;
+
+  private:
+    boost::shared_ptr<internal::EnsembleStorage> _store;
+    std::string _scratch_dir;
+    uint _offset, _nframes;
+  };
+
+
+}
+
+
+#endif
@@ -0,0 +1,403 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/thread/thread.hpp>
+
+#include <Correlation.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  namespace correlation {
+
+    namespace {
+
+      typedef std::complex<double>    Complex;
+
+
+      uint threadCount(const uint n) {
+        return(n == 0 ? std::max(1u, boost::thread::hardware_concurrency()) : n);
+      }
+
+
+      // Smallest power of 2 that is at least n
+      ulong fftSize(const ulong n) {
+        ulong m = 1;
+        while (m < n)
+          m <<= 1;
+        return(m);
+      }
+
+
+      // Autocorrelations of x (real part) and y (imaginary part) in a
+      // single transform.  The spectrum of each is recovered from the
+      // symmetry of the transform of a real series, and the two power
+      // spectra are inverted together as real and imaginary parts.
+      void autocorrelatePair(const std::vector<double>* x, const std::vector<double>* y, const uint maxlag,
+                             std::vector<Complex>& a, std::vector<double>* cx, std::vector<double>* cy) {
+        ulong n = std::max(x->size(), y ? y->size() : 0);
+        ulong m = fftSize(n + maxlag);
+
+        a.assign(m, Complex(0.0, 0.0));
+        for (ulong i=0; i<x->size(); ++i)
+          a[i] = Complex((*x)[i], 0.0);
+        if (y)
+          for (ulong i=0; i<y->size(); ++i)
+            a[i] = Complex(a[i].real(), (*y)[i]);
+
+        fft(a);
+
+        // Pairs k and m-k are updated together, since each needs the other
+        for (ulong k=0; k<=m/2; ++k) {
+          ulong j = (m - k) & (m - 1);
+          Complex zk = a[k];
+          Complex zj = std::conj(a[j]);
+          double px = std::norm(zk + zj) / 4.0;
+          double py = std::norm(zk - zj) / 4.0;
+          a[k] = Complex(px, py);
+          a[j] = a[k];
+        }
+
+        fft(a, true);
+
+        cx->resize(maxlag);
+        for (uint k=0; k<maxlag; ++k)
+          (*cx)[k] = a[k].real() / m;
+        if (cy) {
+          cy->resize(maxlag);
+          for (uint k=0; k<maxlag; ++k)
+            (*cy)[k] = a[k].imag() / m;
+        }
+      }
+
+
+      // Each thread handles a block of pairs of series
+      struct AutocorrelationJob {
+        AutocorrelationJob(const std::vector< std::vector<double> >* s, std::vector< std::vector<double> >* r,
+                           const uint l, const uint b, const uint e)
+          : series(s), results(r), maxlag(l), begin(b), end(e)
+        { }
+
+        void operator()() {
+          std::vector<Complex> a;
+          for (uint i=begin; i<end; i += 2) {
+            if (i+1 < end)
+              autocorrelatePair(&(*series)[i], &(*series)[i+1], maxlag, a, &(*results)[i], &(*results)[i+1]);
+            else
+              autocorrelatePair(&(*series)[i], 0, maxlag, a, &(*results)[i], 0);
+          }
+        }
+
+        const std::vector< std::vector<double> >* series;
+        std::vector< std::vector<double> >* results;
+        uint maxlag, begin, end;
+      };
+
+
+
+      // Occupied pairs by walking over every pair of occupied frames
+      // less than maxlag apart
+      void sparseCounts(const OccupancyMatrix& M, const uint row, const uint maxlag, std::vector<ulong>& inside) {
+        const OccupancyMatrix::word_type* bits = M.row(row);
+        std::vector<uint> frames;
+        for (uint w=0; w<M.wordsPerRow(); ++w)
+          for (OccupancyMatrix::word_type b = bits[w]; b; b &= b - 1)
+            frames.push_back(w * OccupancyMatrix::word_bits + __builtin_ctzll(b));
+
+        for (uint i=0; i<frames.size(); ++i)
+          for (uint j=i; j<frames.size() && frames[j] - frames[i] < maxlag; ++j)
+            ++inside[frames[j] - frames[i]];
+      }
+
+
+      // Occupied pairs by ANDing the row with itself shifted by each lag
+      void shiftCounts(const OccupancyMatrix& M, const uint row, const uint maxlag, std::vector<ulong>& inside) {
+        const OccupancyMatrix::word_type* bits = M.row(row);
+        uint nw = M.wordsPerRow();
+
+        for (uint k=0; k<maxlag; ++k) {
+          uint q = k / OccupancyMatrix::word_bits;
+          uint r = k % OccupancyMatrix::word_bits;
+          ulong n = 0;
+
+          for (uint w=0; w+q < nw; ++w) {
+            OccupancyMatrix::word_type s = bits[w+q] >> r;
+            if (r && w+q+1 < nw)
+              s |= bits[w+q+1] << (OccupancyMatrix::word_bits - r);
+            n += __builtin_popcountll(bits[w] & s);
+          }
+          inside[k] = n;
+        }
+      }
+
+
+      // Occupied pairs from the FFT autocorrelation, which is exact
+      // once rounded since the sums are integers
+      void fftCounts(const OccupancyMatrix& M, const uint row, const uint maxlag, std::vector<ulong>& inside,
+                     std::vector<double>& x, std::vector<Complex>& a) {
+        x.assign(M.cols(), 0.0);
+        for (uint t=0; t<M.cols(); ++t)
+          if (M(row, t))
+            x[t] = 1.0;
+
+        std::vector<double> c;
+        autocorrelatePair(&x, 0, maxlag, a, &c, 0);
+        for (uint k=0; k<maxlag; ++k)
+          inside[k] = static_cast<ulong>(floor(c[k] + 0.5));
+      }
+
+
+      void rowCounts(const OccupancyMatrix& M, const uint row, const uint maxlag,
+                     std::vector<ulong>& inside, std::vector<ulong>& pairs,
+                     std::vector<double>& x, std::vector<Complex>& a) {
+        uint n = M.cols();
+        uint p = M.count(row);
+
+        inside.assign(maxlag, 0);
+        pairs.assign(maxlag, 0);
+        if (p == 0)
+          return;
+
+        // pairs[k] counts the occupied frames t with t+k < n
+        pairs[0] = p;
+        for (uint k=1; k<maxlag && k<n; ++k)
+          pairs[k] = pairs[k-1] - M(row, n-k);
+
+        // Rough operation counts for each method
+        double sparse_cost = static_cast<double>(p) * (static_cast<double>(p) * maxlag / n + 1.0);
+        double shift_cost = static_cast<double>(maxlag) * M.wordsPerRow();
+        double m = fftSize(n + maxlag);
+        double fft_cost = 10.0 * m * log(m) / log(2.0);
+
+        if (sparse_cost <= shift_cost && sparse_cost <= fft_cost)
+          sparseCounts(M, row, maxlag, inside);
+        else if (shift_cost <= fft_cost)
+          shiftCounts(M, row, maxlag, inside);
+        else
+          fftCounts(M, row, maxlag, inside, x, a);
+      }
+
+
+      // Each thread accumulates the survival probabilities for every
+      // nthreads'th row
+      struct SurvivalJob {
+        SurvivalJob(const OccupancyMatrix* m, const uint l, const uint b, const uint s)
+          : M(m), maxlag(l), begin(b), stride(s),
+            sum(l, 0.0), sumsq(l, 0.0), nrows(l, 0), inside_total(l, 0), pairs_total(l, 0)
+        { }
+
+        void operator()() {
+          std::vector<ulong> inside, pairs;
+          std::vector<double> x;
+          std::vector<Complex> a;
+
+          for (uint i=begin; i<M->rows(); i += stride) {
+            rowCounts(*M, i, maxlag, inside, pairs, x, a);
+            for (uint k=0; k<maxlag; ++k)
+              if (pairs[k]) {
+                double s = static_cast<double>(inside[k]) / pairs[k];
+                sum[k] += s;
+                sumsq[k] += s*s;
+                ++nrows[k];
+                inside_total[k] += inside[k];
+                pairs_total[k] += pairs[k];
+              }
+          }
+        }
+
+        const OccupancyMatrix* M;
+        uint maxlag, begin, stride;
+        std::vector<double> sum, sumsq;
+        std::vector<uint> nrows;
+        std::vector<ulong> inside_total, pairs_total;
+      };
+
+    }
+
+
+
+    void fft(std::vector<Complex>& a, const bool inverse) {
+      ulong n = a.size();
+      if (n & (n - 1))
+        throw(LOOSError("FFT size must be a power of 2"));
+      if (n <= 1)
+        return;
+
+      // Bit-reversal permutation
+      for (ulong i=1, j=0; i<n; ++i) {
+        ulong bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+          j ^= bit;
+        j ^= bit;
+        if (i < j)
+          std::swap(a[i], a[j]);
+      }
+
+      // Twiddle factors are computed directly rather than by
+      // recurrence, to keep the error from growing with n
+      double sign = inverse ? 1.0 : -1.0;
+      std::vector<Complex> w(n/2);
+      for (ulong k=0; k<n/2; ++k) {
+        double theta = sign * 2.0 * M_PI * k / n;
+        w[k] = Complex(cos(theta), sin(theta));
+      }
+
+      for (ulong len = 2; len <= n; len <<= 1) {
+        ulong half = len >> 1;
+        ulong step = n / len;
+        for (ulong i=0; i<n; i += len)
+          for (ulong j=0; j<half; ++j) {
+            Complex u = a[i+j];
+            Complex v = a[i+j+half] * w[j * step];
+            a[i+j] = u + v;
+            a[i+j+half] = u - v;
+          }
+      }
+    }
+
+
+
+    std::vector<double> autocorrelation(const std::vector<double>& x, const uint maxlag) {
+      std::vector<Complex> a;
+      std::vector<double> c;
+      autocorrelatePair(&x, 0, maxlag, a, &c, 0);
+      return(c);
+    }
+
+
+
+    std::vector<double> crossCorrelation(const std::vector<double>& x, const std::vector<double>& y,
+                                         const uint maxlag) {
+      ulong m = fftSize(std::max(x.size() + maxlag, y.size()));
+      std::vector<Complex> a(m, Complex(0.0, 0.0));
+      std::vector<Complex> b(m, Complex(0.0, 0.0));
+      std::copy(x.begin(), x.end(), a.begin());
+      std::copy(y.begin(), y.end(), b.begin());
+
+      fft(a);
+      fft(b);
+      for (ulong k=0; k<m; ++k)
+        a[k] = std::conj(a[k]) * b[k];
+      fft(a, true);
+
+      std::vector<double> c(maxlag);
+      for (uint k=0; k<maxlag; ++k)
+        c[k] = a[k].real() / m;
+      return(c);
+    }
+
+
+
+    std::vector< std::vector<double> > autocorrelations(const std::vector< std::vector<double> >& series,
+                                                        const uint maxlag, const uint nthreads) {
+      std::vector< std::vector<double> > results(series.size());
+
+      // Blocks are kept to an even size so the pairs of series stay together
+      uint npairs = (series.size() + 1) / 2;
+      uint n = std::min(threadCount(nthreads), npairs);
+      if (n <= 1) {
+        AutocorrelationJob(&series, &results, maxlag, 0, series.size())();
+        return(results);
+      }
+
+      boost::thread_group threads;
+      uint block = npairs / n;
+      uint extra = npairs % n;
+      uint begin = 0;
+      for (uint i=0; i<n; ++i) {
+        uint end = std::min(static_cast<uint>(series.size()), begin + 2 * (block + (i < extra ? 1 : 0)));
+        threads.create_thread(AutocorrelationJob(&series, &results, maxlag, begin, end));
+        begin = end;
+      }
+      threads.join_all();
+
+      return(results);
+    }
+
+
+
+    void survivalCounts(const OccupancyMatrix& M, const uint row, const uint maxlag,
+                        std::vector<ulong>& inside, std::vector<ulong>& pairs) {
+      std::vector<double> x;
+      std::vector<Complex> a;
+      rowCounts(M, row, maxlag, inside, pairs, x, a);
+    }
+
+
+
+    SurvivalFunction survival(const OccupancyMatrix& M, const uint maxlag, const uint nthreads) {
+      uint n = std::max(1u, std::min(threadCount(nthreads), M.rows()));
+
+      // Jobs are copied into the threads, so they're kept here and
+      // passed by reference to get at the results
+      std::vector<SurvivalJob> jobs;
+      for (uint i=0; i<n; ++i)
+        jobs.push_back(SurvivalJob(&M, maxlag, i, n));
+
+      if (n == 1)
+        jobs[0]();
+      else {
+        boost::thread_group threads;
+        for (uint i=0; i<n; ++i)
+          threads.create_thread(boost::ref(jobs[i]));
+        threads.join_all();
+      }
+
+      SurvivalFunction sf;
+      sf.avg.assign(maxlag, 0.0);
+      sf.stdev.assign(maxlag, 0.0);
+      sf.sterr.assign(maxlag, 0.0);
+      sf.pooled.assign(maxlag, 0.0);
+      sf.nrows.assign(maxlag, 0);
+
+      for (uint k=0; k<maxlag; ++k) {
+        double sum = 0.0, sumsq = 0.0;
+        ulong inside = 0, pairs = 0;
+        for (uint i=0; i<n; ++i) {
+          sum += jobs[i].sum[k];
+          sumsq += jobs[i].sumsq[k];
+          sf.nrows[k] += jobs[i].nrows[k];
+          inside += jobs[i].inside_total[k];
+          pairs += jobs[i].pairs_total[k];
+        }
+
+        if (sf.nrows[k]) {
+          sf.avg[k] = sum / sf.nrows[k];
+          double var = sumsq / sf.nrows[k] - sf.avg[k] * sf.avg[k];
+          sf.stdev[k] = var > 0.0 ? sqrt(var) : 0.0;
+          sf.sterr[k] = sf.stdev[k] / sqrt(static_cast<double>(sf.nrows[k]));
+          sf.pooled[k] = static_cast<double>(inside) / pairs;
+        }
+      }
+
+      return(sf);
+    }
+
+
+  }
+
+}
@@ -0,0 +1,105 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_CORRELATION_HPP)
+#define LOOS_CORRELATION_HPP
+
+#include <complex>
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <OccupancyMatrix.hpp>
+
+
+namespace loos {
+
+
+  //! FFT-based time correlations
+  /**
+   * These compute all the lags of a correlation at once, in O(T log T)
+   * time rather than the O(T^2) of summing each lag directly.  The
+   * results are the raw sums over pairs of points (i.e. they are not
+   * divided by the number of pairs, nor normalized).  The
+   * TimeSeries::correl() family of methods are built on these.
+   */
+  namespace correlation {
+
+    //! In-place complex FFT (the inverse is not scaled).  The size must be a power of 2
+    void fft(std::vector< std::complex<double> >& a, const bool inverse = false);
+
+    //! c[k] = sum_t x[t] * x[t+k], for k < \a maxlag
+    std::vector<double> autocorrelation(const std::vector<double>& x, const uint maxlag);
+
+    //! c[k] = sum_t x[t] * y[t+k], for k < \a maxlag
+    /**
+     * The series may be of different lengths, with the sum taken over
+     * the pairs that exist in both
+     */
+    std::vector<double> crossCorrelation(const std::vector<double>& x, const std::vector<double>& y,
+                                         const uint maxlag);
+
+    //! The autocorrelation of each series, divided among \a nthreads threads (0 = one per core)
+    /**
+     * Series are transformed two at a time, one as the real and one as
+     * the imaginary part of a single complex FFT.
+     */
+    std::vector< std::vector<double> > autocorrelations(const std::vector< std::vector<double> >& series,
+                                                        const uint maxlag, const uint nthreads = 0);
+
+
+    //! Survival function of the rows of an OccupancyMatrix
+    /**
+     * For row i, the survival probability at lag tau is
+     * P(occupied at t+tau | occupied at t), taken over all t where both
+     * frames exist.  avg, stdev, and sterr are over the rows with at
+     * least one such pair (stdev is the population standard deviation,
+     * as in TimeSeries::stdev()), and nrows is the number of these rows.
+     * pooled is the probability taken over all rows together (the total
+     * number of pairs where both frames are occupied divided by the
+     * total number where the first one is).
+     */
+    struct SurvivalFunction {
+      std::vector<double> avg, stdev, sterr, pooled;
+      std::vector<uint> nrows;
+    };
+
+    //! Survival function for lags less than \a maxlag, with the rows divided among threads
+    /**
+     * Each row is handled whichever way is fastest for it: sparse rows
+     * by pairing up the occupied frames directly, short lags by ANDing
+     * and counting shifted copies of the packed bits, and everything
+     * else by FFT.  The counts are exact in all cases.
+     */
+    SurvivalFunction survival(const OccupancyMatrix& M, const uint maxlag, const uint nthreads = 0);
+
+    //! Counts for a single row, where inside[k] is the number of pairs occupied at both t and t+k
+    //! and pairs[k] is the number occupied at t (for t+k < cols)
+    void survivalCounts(const OccupancyMatrix& M, const uint row, const uint maxlag,
+                        std::vector<ulong>& inside, std::vector<ulong>& pairs);
+
+  }
+
+}
+
+
+#endif
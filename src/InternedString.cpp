@@ -0,0 +1,72 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <boost/unordered_set.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <InternedString.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // Elements of an unordered_set are never moved once inserted, so
+    // pointers to them can be handed out.  The pool is created on
+    // first use and deliberately never destroyed, so that Atoms in
+    // static objects can still use it during program exit.
+    struct StringPool {
+      boost::unordered_set<std::string> strings;
+      boost::mutex mutex;
+      const std::string* empty;
+
+      StringPool() : empty(&(*strings.insert(std::string()).first)) { }
+
+      const std::string* intern(const std::string& s) {
+        if (s.empty())
+          return(empty);
+        boost::mutex::scoped_lock lock(mutex);
+        return(&(*strings.insert(s).first));
+      }
+    };
+
+
+    StringPool& pool() {
+      static StringPool* the_pool = new StringPool;
+      return(*the_pool);
+    }
+
+  }
+
+
+  InternedString::InternedString() : _ptr(pool().empty) { }
+
+  InternedString::InternedString(const std::string& s) : _ptr(pool().intern(s)) { }
+
+
+  unsigned long InternedString::poolSize() {
+    StringPool& p = pool();
+    boost::mutex::scoped_lock lock(p.mutex);
+    return(p.strings.size());
+  }
+
+}
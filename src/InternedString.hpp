@@ -0,0 +1,79 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_INTERNED_STRING_HPP)
+#define LOOS_INTERNED_STRING_HPP
+
+#include <iostream>
+#include <string>
+
+
+namespace loos {
+
+
+  //! Handle to a string stored once in a global pool
+  /**
+   * Atoms in a system share a small number of distinct names,
+   * residue names, segids, etc.  Rather than each Atom holding its
+   * own copies, an InternedString points to the single copy of that
+   * string in a process-wide pool.  Handles are the size of a
+   * pointer, and two handles are equal exactly when their strings
+   * are equal, so comparing them is just a pointer comparison.
+   *
+   * Strings are never removed from the pool, so a reference returned
+   * by str() remains valid for the life of the program.  Interning
+   * is thread-safe.
+   */
+  class InternedString {
+  public:
+    //! The empty string
+    InternedString();
+
+    //! Interns \a s
+    explicit InternedString(const std::string& s);
+
+    //! The string this handle refers to
+    const std::string& str() const { return(*_ptr); }
+
+    bool operator==(const InternedString& s) const { return(_ptr == s._ptr); }
+    bool operator!=(const InternedString& s) const { return(_ptr != s._ptr); }
+
+    //! Orders handles by address (not lexically), for use as keys
+    bool operator<(const InternedString& s) const { return(_ptr < s._ptr); }
+
+    //! Number of distinct strings in the pool
+    static unsigned long poolSize();
+
+  private:
+    const std::string* _ptr;
+  };
+
+
+  inline std::ostream& operator<<(std::ostream& os, const InternedString& s) {
+    return(os << s.str());
+  }
+
+}
+
+
+#endif
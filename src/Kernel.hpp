@@ -67,6 +67,9 @@ namespace loos {
     
     void clearActions(void);
 
+    //! The compiled commands, in execution order
+    const std::vector<internal::Action*>& commands(void) const { return(actions); }
+
     internal::ValueStack& stack(void);
 
     friend std::ostream& operator<<(std::ostream&, const Kernel&);
@@ -274,7 +274,7 @@ namespace loos {
       if (atom->checkProperty(Atom::massbit))
         masscheck = (atom->mass() < 1.1);
       
-      std::string n = atom->name();
+      const std::string& n = atom->name();
       Value v;
       v.setInt( (n[0] == 'H' && masscheck) );
       stack->push(v);
@@ -107,6 +107,7 @@ namespace loos {
       explicit pushString(const std::string str) : Action("pushString"), val(str) { }
       void execute(void);
       std::string name(void) const;
+      const Value& value(void) const { return(val); }
     };
 
     //! Push an integer onto the data stack
@@ -116,6 +117,7 @@ namespace loos {
       explicit pushInt(const long i) : Action("pushInt"), val(i) { }
       void execute(void);
       std::string name(void) const;
+      const Value& value(void) const { return(val); }
     };
 
     //! Push a float onto the data stack
@@ -125,6 +127,7 @@ namespace loos {
       explicit pushFloat(const float f) : Action("pushFloat"), val(f) { }
       void execute(void);
       std::string name(void) const;
+      const Value& value(void) const { return(val); }
     };
 
 
@@ -190,6 +193,7 @@ namespace loos {
       explicit matchRegex(const std::string s) : Action("matchRegex"), regexp(s, boost::regex::perl|boost::regex::icase), pattern(s) { }
       void execute(void);
       std::string name(void) const;
+      const boost::regex& regex(void) const { return(regexp); }
     
     private:
       std::string pattern;
@@ -224,6 +228,7 @@ namespace loos {
 
       void execute(void);
       std::string name(void) const;
+      const boost::regex& regex(void) const { return(regexp); }
 
     private:
       boost::regex regexp;
@@ -0,0 +1,248 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <MatrixBinary.hpp>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <limits>
+
+
+namespace loos {
+
+  namespace {
+
+    const char binary_matrix_magic[8] = { 'L', 'O', 'O', 'S', 'M', 'A', 'T', '\0' };
+    const boost::uint32_t binary_matrix_version = 1;
+    const boost::uint32_t binary_matrix_byte_order = 0x01020304;
+    const ulong binary_matrix_header_size = 64;
+    const ulong binary_matrix_alignment = 64;
+
+
+    template<typename T>
+    void putField(unsigned char* buf, const ulong offset, const T datum) {
+      memcpy(buf + offset, &datum, sizeof(T));
+    }
+
+    template<typename T>
+    T getField(const unsigned char* buf, const ulong offset, const bool swapped) {
+      unsigned char tmp[sizeof(T)];
+      if (swapped)
+        std::reverse_copy(buf + offset, buf + offset + sizeof(T), tmp);
+      else
+        std::copy(buf + offset, buf + offset + sizeof(T), tmp);
+
+      T datum;
+      memcpy(&datum, tmp, sizeof(T));
+      return(datum);
+    }
+
+  }
+
+
+  namespace internal {
+
+    uint binaryElementSize(const uint type) {
+      switch(type) {
+      case BinaryInt32:
+      case BinaryUInt32:
+      case BinaryFloat32:
+        return(4);
+      case BinaryInt64:
+      case BinaryUInt64:
+      case BinaryFloat64:
+        return(8);
+      // Bit-packed elements have no size of their own (see binaryBitWords())
+      default:
+        return(0);
+      }
+    }
+
+
+    void writeBinaryMatrixHeader(std::ostream& os, const uint type, const uint order,
+                                 const ulong rows, const ulong cols, const ulong elements,
+                                 const std::string& meta) {
+      ulong offset = binary_matrix_header_size + meta.size();
+      offset = ((offset + binary_matrix_alignment - 1) / binary_matrix_alignment) * binary_matrix_alignment;
+
+      unsigned char buf[binary_matrix_header_size];
+      memcpy(buf, binary_matrix_magic, sizeof(binary_matrix_magic));
+      putField<boost::uint32_t>(buf, 8, binary_matrix_version);
+      putField<boost::uint32_t>(buf, 12, binary_matrix_byte_order);
+      putField<boost::uint32_t>(buf, 16, type);
+      putField<boost::uint32_t>(buf, 20, order);
+      putField<boost::uint64_t>(buf, 24, rows);
+      putField<boost::uint64_t>(buf, 32, cols);
+      putField<boost::uint64_t>(buf, 40, elements);
+      putField<boost::uint64_t>(buf, 48, meta.size());
+      putField<boost::uint64_t>(buf, 56, offset);
+
+      os.write(reinterpret_cast<const char*>(buf), binary_matrix_header_size);
+      os.write(meta.data(), meta.size());
+      std::vector<char> padding(offset - binary_matrix_header_size - meta.size(), '\0');
+      if (!padding.empty())
+        os.write(&padding[0], padding.size());
+    }
+
+
+    BinaryMatrixInfo parseBinaryMatrixHeader(const unsigned char* p, const ulong size, const std::string& fname) {
+      if (size < binary_matrix_header_size || memcmp(p, binary_matrix_magic, sizeof(binary_matrix_magic)) != 0)
+        throw(MatrixReadError(fname + " is not a binary matrix"));
+
+      BinaryMatrixInfo info;
+      boost::uint32_t marker = getField<boost::uint32_t>(p, 12, false);
+      if (marker == binary_matrix_byte_order)
+        info.swapped = false;
+      else if (getField<boost::uint32_t>(p, 12, true) == binary_matrix_byte_order)
+        info.swapped = true;
+      else
+        throw(MatrixReadError("Unable to determine the byte-order of binary matrix " + fname));
+
+      info.version = getField<boost::uint32_t>(p, 8, info.swapped);
+      if (info.version > binary_matrix_version)
+        throw(MatrixReadError(fname + " was written by a newer version of LOOS"));
+
+      info.type = getField<boost::uint32_t>(p, 16, info.swapped);
+      uint elsize = binaryElementSize(info.type);
+      if (elsize == 0 && info.type != BinaryBit)
+        throw(MatrixReadError("Unknown element type in binary matrix " + fname));
+
+      info.order = getField<boost::uint32_t>(p, 20, info.swapped);
+      if (info.order > BinaryTriangular)
+        throw(MatrixReadError("Unknown matrix order in binary matrix " + fname));
+      if (info.type == BinaryBit && info.order != BinaryRowMajor)
+        throw(MatrixReadError("Bit-packed binary matrix " + fname + " must be row-major"));
+
+      boost::uint64_t rows = getField<boost::uint64_t>(p, 24, info.swapped);
+      boost::uint64_t cols = getField<boost::uint64_t>(p, 32, info.swapped);
+      if (rows > std::numeric_limits<uint>::max() || cols > std::numeric_limits<uint>::max())
+        throw(MatrixReadError("Binary matrix " + fname + " is too large"));
+      info.rows = rows;
+      info.cols = cols;
+
+      info.elements = getField<boost::uint64_t>(p, 40, info.swapped);
+      ulong expected = (info.order == BinaryTriangular) ? (static_cast<ulong>(info.rows) * (info.rows + 1)) / 2
+        : static_cast<ulong>(info.rows) * info.cols;
+      if (info.elements != expected || (info.order == BinaryTriangular && info.rows != info.cols))
+        throw(MatrixReadError("Size mismatch in binary matrix " + fname));
+
+      ulong metasize = getField<boost::uint64_t>(p, 48, info.swapped);
+      info.data_offset = getField<boost::uint64_t>(p, 56, info.swapped);
+      if (info.data_offset < binary_matrix_header_size + metasize || info.data_offset > size)
+        throw(MatrixReadError("Binary matrix " + fname + " is truncated"));
+      ulong available = size - info.data_offset;
+      if (info.type == BinaryBit ? available / 8 < static_cast<ulong>(info.rows) * binaryBitWords(info.cols)
+          : available / elsize < info.elements)
+        throw(MatrixReadError("Binary matrix " + fname + " is truncated"));
+
+      info.meta = std::string(reinterpret_cast<const char*>(p) + binary_matrix_header_size, metasize);
+
+      return(info);
+    }
+
+
+    ulong binaryMatrixIndex(const uint order, const uint rows, const uint cols, const uint y, const uint x) {
+      switch(order) {
+      case BinaryColMajor:
+        return(static_cast<ulong>(x) * rows + y);
+      case BinaryRowMajor:
+        return(static_cast<ulong>(y) * cols + x);
+      default:
+        {
+          ulong b = std::max(y, x);
+          ulong a = std::min(y, x);
+          return( (b * (b + 1)) / 2 + a );
+        }
+      }
+    }
+
+
+
+    MappedMatrixFile::MappedMatrixFile(const std::string& fname) : _map(0), _size(0) {
+      int fd = open(fname.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw(MatrixReadError("Cannot open " + fname + " for reading."));
+
+      struct stat st;
+      if (fstat(fd, &st) < 0) {
+        close(fd);
+        throw(MatrixReadError("Cannot stat " + fname));
+      }
+      _size = st.st_size;
+      if (_size == 0) {
+        close(fd);
+        throw(MatrixReadError(fname + " is empty"));
+      }
+
+      // Private and writable, so the Matrix can be modified without
+      // touching the file (pages are only copied when written to)
+      void* p = mmap(0, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (p == MAP_FAILED)
+        throw(MatrixReadError("Unable to map " + fname + ": " + strerror(errno)));
+      _map = static_cast<unsigned char*>(p);
+    }
+
+
+    MappedMatrixFile::~MappedMatrixFile() {
+      if (_map)
+        munmap(_map, _size);
+    }
+
+  }
+
+
+
+  bool isBinaryMatrix(const std::string& fname) {
+    std::ifstream ifs(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!ifs)
+      throw(MatrixReadError("Cannot open " + fname + " for reading."));
+
+    char buf[sizeof(binary_matrix_magic)];
+    if (!ifs.read(buf, sizeof(buf)))
+      return(false);
+    return(memcmp(buf, binary_matrix_magic, sizeof(buf)) == 0);
+  }
+
+
+  // Mapping the file only reads the pages with the header
+  BinaryMatrixInfo readBinaryMatrixInfo(const std::string& fname) {
+    internal::MappedMatrixFile file(fname);
+    return(internal::parseBinaryMatrixHeader(file.data(), file.size(), fname));
+  }
+
+
+
+  std::string findMatrixFile(const std::string& base) {
+    std::string fname = base + matrixSuffix(true);
+    std::ifstream ifs(fname.c_str());
+    if (ifs)
+      return(fname);
+    return(base + matrixSuffix(false));
+  }
+
+}
@@ -0,0 +1,457 @@
+/*
+  MatrixBinary.hpp
+
+  Binary (memory-mapped) reading and writing of Matrix objects...
+*/
+
+
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_MATRIXBINARY_HPP)
+#define LOOS_MATRIXBINARY_HPP
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <loos_defs.hpp>
+#include <Matrix.hpp>
+#include <MatrixRead.hpp>
+#include <MatrixWrite.hpp>
+
+
+namespace loos {
+
+
+  //! Contents of the header of a binary matrix file
+  /**
+   * The file starts with a fixed 64-byte header:
+   *
+   *   - magic "LOOSMAT" (8 bytes, NUL terminated)
+   *   - version (uint32)
+   *   - byte-order marker 0x01020304 (uint32), as written
+   *   - element type (uint32, see internal::BinaryMatrixElement)
+   *   - order policy (uint32, see internal::BinaryMatrixOrder)
+   *   - rows, columns, number of elements stored (uint64 each)
+   *   - size of the metadata (uint64)
+   *   - offset to the data (uint64)
+   *
+   * followed by the metadata (the same text that would be in the
+   * header of an ASCII matrix) and then, starting on a 64-byte
+   * boundary, the raw elements exactly as the Matrix stores them.
+   * Files are written in native byte-order.  Occupancy matrices
+   * (see OccupancyMatrix) are instead stored with one bit per element,
+   * packed into 64-bit words (see internal::binaryBitWords()).  These
+   * can be read into a Matrix of any type as 0's and 1's.
+   */
+  struct BinaryMatrixInfo {
+    BinaryMatrixInfo() : version(0), type(0), order(0), rows(0), cols(0),
+                         elements(0), data_offset(0), swapped(false) { }
+
+    uint version;
+    uint type;
+    uint order;
+    uint rows, cols;
+    ulong elements;
+    ulong data_offset;
+    bool swapped;        // File is not in native byte-order
+    std::string meta;
+  };
+
+
+  namespace internal {
+
+    enum BinaryMatrixElement { BinaryInt32 = 1, BinaryUInt32, BinaryInt64, BinaryUInt64, BinaryFloat32, BinaryFloat64,
+                               BinaryBit };
+    enum BinaryMatrixOrder { BinaryColMajor = 0, BinaryRowMajor, BinaryTriangular };
+
+
+    // Maps C++ types to the element types in the file.  Matrices of
+    // other types cannot be written in binary...
+    template<typename T> struct BinaryElementType;
+
+    template<> struct BinaryElementType<float> { static const uint code = BinaryFloat32; };
+    template<> struct BinaryElementType<double> { static const uint code = BinaryFloat64; };
+    template<> struct BinaryElementType<int> { static const uint code = BinaryInt32; };
+    template<> struct BinaryElementType<uint> { static const uint code = BinaryUInt32; };
+    template<> struct BinaryElementType<long> { static const uint code = (sizeof(long) == 8 ? BinaryInt64 : BinaryInt32); };
+    template<> struct BinaryElementType<ulong> { static const uint code = (sizeof(ulong) == 8 ? BinaryUInt64 : BinaryUInt32); };
+
+
+    template<class P> struct BinaryOrderType;
+
+    template<> struct BinaryOrderType<Math::ColMajor> { static const uint code = BinaryColMajor; };
+    template<> struct BinaryOrderType<Math::RowMajor> { static const uint code = BinaryRowMajor; };
+    template<> struct BinaryOrderType<Math::Triangular> { static const uint code = BinaryTriangular; };
+
+
+    //! Size (in bytes) of an element type, or 0 if unknown
+    uint binaryElementSize(const uint type);
+
+    //! Number of 64-bit words in each row of a bit-packed (BinaryBit) matrix
+    /**
+     * Bit-packed matrices are always row-major.  Each row starts on a
+     * new word, with column i in bit i%64 of word i/64.  These are
+     * written by OccupancyMatrix.
+     */
+    inline ulong binaryBitWords(const uint cols) { return((static_cast<ulong>(cols) + 63) / 64); }
+
+    //! Writes the header and metadata (including padding up to the data)
+    void writeBinaryMatrixHeader(std::ostream& os, const uint type, const uint order,
+                                 const ulong rows, const ulong cols, const ulong elements,
+                                 const std::string& meta);
+
+    //! Parses and validates the header of a mapped file
+    BinaryMatrixInfo parseBinaryMatrixHeader(const unsigned char* p, const ulong size, const std::string& fname);
+
+    //! Index of (y,x) into the elements stored with the given order policy
+    ulong binaryMatrixIndex(const uint order, const uint rows, const uint cols, const uint y, const uint x);
+
+
+    //! Private, copy-on-write mapping of an entire matrix file
+    /**
+     * Pages are only read from disk as they are touched.  Writes to
+     * the mapping are never written back to the file.
+     */
+    class MappedMatrixFile {
+    public:
+      explicit MappedMatrixFile(const std::string& fname);
+      ~MappedMatrixFile();
+
+      unsigned char* data() const { return(_map); }
+      ulong size() const { return(_size); }
+
+    private:
+      MappedMatrixFile(const MappedMatrixFile&);
+      MappedMatrixFile& operator=(const MappedMatrixFile&);
+
+      unsigned char* _map;
+      ulong _size;
+    };
+
+
+    // Deleter for a shared_array that points into a mapped file.  The
+    // mapping goes away when the last copy of the deleter does.
+    struct MappedMatrixReleaser {
+      explicit MappedMatrixReleaser(const boost::shared_ptr<MappedMatrixFile>& f) : file(f) { }
+
+      template<typename T> void operator()(T*) const { }
+
+      boost::shared_ptr<MappedMatrixFile> file;
+    };
+
+
+    template<typename S, typename T>
+    void convertBinaryElements(const unsigned char* src, const ulong n, const bool swapped, T* dst) {
+      unsigned char buf[sizeof(S)];
+      S datum;
+
+      for (ulong k=0; k<n; ++k, src += sizeof(S)) {
+        if (swapped)
+          std::reverse_copy(src, src + sizeof(S), buf);
+        else
+          std::copy(src, src + sizeof(S), buf);
+        memcpy(&datum, buf, sizeof(S));
+        dst[k] = static_cast<T>(datum);
+      }
+    }
+
+    //! Unpacks a bit-packed matrix, where each element becomes 0 or 1
+    template<typename T, class P>
+    void unpackBinaryBits(const unsigned char* src, const BinaryMatrixInfo& info,
+                          Math::Matrix<T,P,Math::SharedArray>& M) {
+      ulong words = binaryBitWords(info.cols);
+      unsigned char buf[8];
+
+      for (uint j=0; j<info.rows; ++j) {
+        uint n = (BinaryOrderType<P>::code == BinaryTriangular) ? j+1 : info.cols;
+        for (uint i=0; i<n; i += 64, src += 8) {
+          if (info.swapped)
+            std::reverse_copy(src, src + 8, buf);
+          else
+            std::copy(src, src + 8, buf);
+          boost::uint64_t w;
+          memcpy(&w, buf, 8);
+          for (uint k=0; k<64 && i+k<n; ++k)
+            M(j, i+k) = static_cast<T>((w >> k) & 1u);
+        }
+        src += (words - (n + 63) / 64) * 8;
+      }
+    }
+
+    //! Converts \a n elements of type \a type in the file to T
+    template<typename T>
+    void convertBinaryElements(const unsigned char* src, const uint type, const ulong n, const bool swapped, T* dst) {
+      switch(type) {
+      case BinaryInt32: convertBinaryElements<boost::int32_t>(src, n, swapped, dst); break;
+      case BinaryUInt32: convertBinaryElements<boost::uint32_t>(src, n, swapped, dst); break;
+      case BinaryInt64: convertBinaryElements<boost::int64_t>(src, n, swapped, dst); break;
+      case BinaryUInt64: convertBinaryElements<boost::uint64_t>(src, n, swapped, dst); break;
+      case BinaryFloat32: convertBinaryElements<float>(src, n, swapped, dst); break;
+      case BinaryFloat64: convertBinaryElements<double>(src, n, swapped, dst); break;
+      default:
+        throw(MatrixReadError("Unknown element type in binary matrix"));
+      }
+    }
+
+  }
+
+
+  // Forward declaration for binary writing implementation
+  template<class T, class P>
+  struct MatrixWriteBinaryImpl;
+
+
+  //! Write a submatrix in binary format to a stream
+  /**
+   * \a start and \a end are used exactly as in writeAsciiMatrix().  If
+   * \a trans is true, the transpose is written, which only changes the
+   * order policy recorded in the header (e.g. a column-major matrix is
+   * written as its row-major transpose), so no copying is involved.
+   */
+  template<class T, class P>
+  void writeBinaryMatrix(std::ostream& os, const Math::Matrix<T,P,Math::SharedArray>& M,
+                         const std::string& meta, const Math::Range& start,
+                         const Math::Range& end, const bool trans = false) {
+    MatrixWriteBinaryImpl<T,P>::write(os, M, meta, start, end, trans);
+  }
+
+  //! Write an entire matrix in binary format to a stream
+  template<class T, class P>
+  void writeBinaryMatrix(std::ostream& os, const Math::Matrix<T,P,Math::SharedArray>& M,
+                         const std::string& meta, const bool trans = false) {
+    MatrixWriteBinaryImpl<T,P>::write(os, M, meta, Math::Range(0,0), Math::Range(M.rows(), M.cols()), trans);
+  }
+
+  //! Write a submatrix in binary format to a file
+  template<class T, class P>
+  void writeBinaryMatrix(const std::string& fname, const Math::Matrix<T,P,Math::SharedArray>& M,
+                         const std::string& meta, const Math::Range& start,
+                         const Math::Range& end, const bool trans = false) {
+    std::ofstream ofs(fname.c_str(), std::ios_base::out | std::ios_base::binary);
+    if (!ofs.is_open())
+      throw(std::runtime_error("Cannot open " + fname + " for writing."));
+    MatrixWriteBinaryImpl<T,P>::write(ofs, M, meta, start, end, trans);
+  }
+
+  //! Write an entire matrix in binary format to a file
+  /**
+   * This is the binary counterpart to writeAsciiMatrix().  The file
+   * is much smaller, is written with a single pass over memory, and
+   * can be read back with readBinaryMatrix() without parsing.
+   */
+  template<class T, class P>
+  void writeBinaryMatrix(const std::string& fname, const Math::Matrix<T,P,Math::SharedArray>& M,
+                         const std::string& meta, const bool trans = false) {
+    writeBinaryMatrix(fname, M, meta, Math::Range(0,0), Math::Range(M.rows(), M.cols()), trans);
+  }
+
+
+  template<class T, class P>
+  struct MatrixWriteBinaryImpl {
+    static void write(std::ostream& os, const Math::Matrix<T,P,Math::SharedArray>& M,
+                      const std::string& meta, const Math::Range& start,
+                      const Math::Range& end, const bool trans) {
+      uint ja = start.first;
+      uint jb = end.first;
+      uint ia = start.second;
+      uint ib = end.second;
+      ulong m = jb - ja;
+      ulong n = ib - ia;
+
+      uint order = internal::BinaryOrderType<P>::code;
+      if (trans) {
+        std::swap(m, n);
+        order = (order == internal::BinaryColMajor) ? internal::BinaryRowMajor : internal::BinaryColMajor;
+      }
+      internal::writeBinaryMatrixHeader(os, internal::BinaryElementType<T>::code, order, m, n, m*n, meta);
+      if (m * n == 0)
+        return;
+
+      // Write out contiguous runs (whole columns or rows of the
+      // submatrix, depending on the order)
+      if (internal::BinaryOrderType<P>::code == internal::BinaryColMajor) {
+        for (uint i=ia; i<ib; ++i)
+          os.write(reinterpret_cast<const char*>(&M(ja, i)), (jb - ja) * sizeof(T));
+      } else {
+        for (uint j=ja; j<jb; ++j)
+          os.write(reinterpret_cast<const char*>(&M(j, ia)), (ib - ia) * sizeof(T));
+      }
+
+      if (os.fail())
+        throw(std::runtime_error("Error while writing binary matrix"));
+    }
+  };
+
+
+  //! Write out a triangular matrix
+  /** Ignores \a start, \a end, and \a trans */
+  template<class T>
+  struct MatrixWriteBinaryImpl<T, Math::Triangular> {
+    static void write(std::ostream& os, const Math::Matrix<T,Math::Triangular,Math::SharedArray>& M,
+                      const std::string& meta, const Math::Range&,
+                      const Math::Range&, const bool) {
+      internal::writeBinaryMatrixHeader(os, internal::BinaryElementType<T>::code, internal::BinaryTriangular,
+                                        M.rows(), M.cols(), M.size(), meta);
+      if (M.size() != 0)
+        os.write(reinterpret_cast<const char*>(M.get()), M.size() * sizeof(T));
+
+      if (os.fail())
+        throw(std::runtime_error("Error while writing binary matrix"));
+    }
+  };
+
+
+
+  //! Returns true if \a fname is a binary matrix
+  bool isBinaryMatrix(const std::string& fname);
+
+  //! Reads the header of a binary matrix without reading the data
+  BinaryMatrixInfo readBinaryMatrixInfo(const std::string& fname);
+
+
+  //! Read a binary matrix from a file
+  /**
+   * The file is memory-mapped.  If the matrix in the file has the
+   * same element type, order policy, and byte-order as the requested
+   * Matrix, then the returned Matrix is backed directly by the mapping
+   * (nothing is read until it is used, and only the pages touched are
+   * read).  The mapping is private, so changes to the Matrix are not
+   * written back to the file, and it is released when the last copy of
+   * the Matrix goes away.
+   *
+   * Otherwise, the elements are converted into a newly allocated
+   * Matrix.  A triangular matrix can be read into a dense one (both
+   * halves are filled in) and vice versa (only the lower triangle is
+   * used).
+   */
+  template<class T, class P>
+  Math::Matrix<T,P,Math::SharedArray> readBinaryMatrix(const std::string& fname) {
+    boost::shared_ptr<internal::MappedMatrixFile> file(new internal::MappedMatrixFile(fname));
+    BinaryMatrixInfo info = internal::parseBinaryMatrixHeader(file->data(), file->size(), fname);
+    unsigned char* data = file->data() + info.data_offset;
+    uint order = internal::BinaryOrderType<P>::code;
+
+    if (info.type == internal::BinaryElementType<T>::code && info.order == order && !info.swapped) {
+      boost::shared_array<T> p(reinterpret_cast<T*>(data), internal::MappedMatrixReleaser(file));
+      Math::Matrix<T,P,Math::SharedArray> M(p, info.rows, info.cols);
+      M.metaData(info.meta);
+      return(M);
+    }
+
+    if ((order == internal::BinaryTriangular || info.order == internal::BinaryTriangular) && info.rows != info.cols)
+      throw(MatrixReadError("Cannot read a non-square matrix from " + fname + " as a triangular matrix"));
+
+    if (info.type == internal::BinaryBit) {
+      Math::Matrix<T,P,Math::SharedArray> M(info.rows, info.cols);
+      internal::unpackBinaryBits(data, info, M);
+      M.metaData(info.meta);
+      return(M);
+    }
+
+    std::vector<T> elements(info.elements);
+    if (info.elements != 0)
+      internal::convertBinaryElements(data, info.type, info.elements, info.swapped, &elements[0]);
+
+    Math::Matrix<T,P,Math::SharedArray> M(info.rows, info.cols);
+    for (uint j=0; j<info.rows; ++j) {
+      uint n = (order == internal::BinaryTriangular) ? j+1 : info.cols;
+      for (uint i=0; i<n; ++i)
+        M(j, i) = elements[internal::binaryMatrixIndex(info.order, info.rows, info.cols, j, i)];
+    }
+    M.metaData(info.meta);
+
+    return(M);
+  }
+
+
+  //! Read a binary matrix from a file storing it in the specified matrix
+  template<class T, class P>
+  void readBinaryMatrix(const std::string& fname, Math::Matrix<T,P,Math::SharedArray>& M) {
+    M = readBinaryMatrix<T,P>(fname);
+  }
+
+
+  //! Read a matrix in either binary or ASCII format
+  template<class T, class P>
+  void readMatrix(const std::string& fname, Math::Matrix<T,P,Math::SharedArray>& M) {
+    if (isBinaryMatrix(fname))
+      M = readBinaryMatrix<T,P>(fname);
+    else
+      readAsciiMatrix(fname, M);
+  }
+
+
+  //! Write a matrix in either binary or ASCII format to a stream
+  template<class T, class P>
+  void writeMatrix(std::ostream& os, const Math::Matrix<T,P,Math::SharedArray>& M,
+                   const std::string& meta, const bool binary, const bool trans = false) {
+    if (binary)
+      writeBinaryMatrix(os, M, meta, trans);
+    else
+      writeAsciiMatrix(os, M, meta, trans);
+  }
+
+  //! Write a submatrix in either binary or ASCII format to a file
+  template<class T, class P>
+  void writeMatrix(const std::string& fname, const Math::Matrix<T,P,Math::SharedArray>& M,
+                   const std::string& meta, const Math::Range& start,
+                   const Math::Range& end, const bool binary, const bool trans = false) {
+    if (binary)
+      writeBinaryMatrix(fname, M, meta, start, end, trans);
+    else
+      writeAsciiMatrix(fname, M, meta, start, end, trans);
+  }
+
+  //! Write a matrix in either binary or ASCII format to a file
+  template<class T, class P>
+  void writeMatrix(const std::string& fname, const Math::Matrix<T,P,Math::SharedArray>& M,
+                   const std::string& meta, const bool binary, const bool trans = false) {
+    if (binary)
+      writeBinaryMatrix(fname, M, meta, trans);
+    else
+      writeAsciiMatrix(fname, M, meta, trans);
+  }
+
+
+  //! Suffix for matrix files in the given format (".lmat" for binary, ".asc" for ASCII)
+  inline std::string matrixSuffix(const bool binary) {
+    return(binary ? ".lmat" : ".asc");
+  }
+
+  //! Given a filename without its suffix, returns the binary matrix if it exists or the ASCII one otherwise
+  std::string findMatrixFile(const std::string& base);
+
+}
+
+
+#endif
@@ -35,5 +35,6 @@
 #include <Matrix.hpp>
 #include <MatrixWrite.hpp>
 #include <MatrixRead.hpp>
+#include <MatrixBinary.hpp>
 
 #endif
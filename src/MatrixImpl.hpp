@@ -161,6 +161,16 @@ writeAsciiMatrix(filename, M, "My matrix");
                                                  StoragePolicy<T>(p, OrderPolicy::size()),
                                                  meta("") { }
 
+      //! Share an existing block of data (with its own deleter)
+      /**
+       * This is how a Matrix can be backed by something other than
+       * a plain new[] allocation, such as a memory-mapped file (see
+       * loos::readBinaryMatrix()).  Only valid for dense storage.
+       */
+      Matrix(const boost::shared_array<T>& p, const uint b, const uint a) : OrderPolicy(b, a),
+                                                                          StoragePolicy<T>(p, OrderPolicy::size()),
+                                                                          meta("") { }
+
       //! Create a new block of data for the requested Matrix
       Matrix(const uint b, const uint a) : OrderPolicy(b, a),
                                            StoragePolicy<T>(OrderPolicy::size()),
@@ -27,6 +27,9 @@
 
 
 
+#include <vector>
+#include <algorithm>
+
 #include <MatrixOps.hpp>
 
 
@@ -225,6 +228,380 @@ namespace loos {
     }
 
 
+    // ----------------------------------------------------------
+    // Truncated SVDs
+
+
+    namespace {
+
+      // C = alpha * op(A) * op(B) + beta * C, with C already sized
+      void accumulateProduct(const DoubleMatrix& A, const DoubleMatrix& B, DoubleMatrix& C, const bool transa, const bool transb, double alpha, double beta) {
+        f77int m = transa ? A.cols() : A.rows();
+        f77int n = transb ? B.rows() : B.cols();
+        f77int k = transa ? A.rows() : A.cols();
+
+        f77int lda = A.rows();
+        f77int ldb = B.rows();
+        f77int ldc = C.rows();
+
+#if defined(__linux__) || defined(__CYGWIN__) || defined(__FreeBSD__)
+        char ta = (transa ? 'T' : 'N');
+        char tb = (transb ? 'T' : 'N');
+
+        dgemm_(&ta, &tb, &m, &n, &k, &alpha, A.get(), &lda, B.get(), &ldb, &beta, C.get(), &ldc);
+#else
+        cblas_dgemm(CblasColMajor, transa ? CblasTrans : CblasNoTrans, transb ? CblasTrans : CblasNoTrans,
+                    m, n, k, alpha, A.get(), lda, B.get(), ldb, beta, C.get(), ldc);
+#endif
+      }
+
+
+      // Overwrites Y (m x n, m >= n) with Q from its QR decomposition and returns R
+      DoubleMatrix qr(DoubleMatrix& Y) {
+        f77int m = Y.rows();
+        f77int n = Y.cols();
+        f77int lda = m, lwork = -1, info;
+        double prework;
+
+        DoubleMatrix tau(n, 1);
+        dgeqrf_(&m, &n, Y.get(), &lda, tau.get(), &prework, &lwork, &info);
+        if (info != 0)
+          throw(NumericalError("DGEQRF estimate reported an error", info));
+
+        lwork = static_cast<f77int>(prework);
+        std::vector<double> work(lwork);
+        dgeqrf_(&m, &n, Y.get(), &lda, tau.get(), &work[0], &lwork, &info);
+        if (info != 0)
+          throw(NumericalError("DGEQRF reported an error", info));
+
+        DoubleMatrix R(n, n);
+        for (uint i=0; i<Y.cols(); ++i)
+          for (uint j=0; j<=i; ++j)
+            R(j, i) = Y(j, i);
+
+        lwork = -1;
+        dorgqr_(&m, &n, &n, Y.get(), &lda, tau.get(), &prework, &lwork, &info);
+        if (info != 0)
+          throw(NumericalError("DORGQR estimate reported an error", info));
+
+        lwork = static_cast<f77int>(prework);
+        work.resize(lwork);
+        dorgqr_(&m, &n, &n, Y.get(), &lda, tau.get(), &work[0], &lwork, &info);
+        if (info != 0)
+          throw(NumericalError("DORGQR reported an error", info));
+
+        return(R);
+      }
+
+
+      // Thin SVD of an m x n matrix (overwritten): U is m x r, S is r x 1,
+      // and Vt is r x n, where r = min(m, n)
+      boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> thinSVD(DoubleMatrix& M) {
+        f77int m = M.rows();
+        f77int n = M.cols();
+        f77int sn = m<n ? m : n;
+
+        char jobu = 'S', jobvt = 'S';
+        f77int lda = m, ldu = m, ldvt = sn, lwork = -1, info;
+        double prework;
+
+        DoubleMatrix U(m, sn);
+        DoubleMatrix S(sn, 1);
+        DoubleMatrix Vt(sn, n);
+
+        dgesvd_(&jobu, &jobvt, &m, &n, M.get(), &lda, S.get(), U.get(), &ldu, Vt.get(), &ldvt, &prework, &lwork, &info);
+        if (info != 0)
+          throw(NumericalError("DGESVD estimate reported an error", info));
+
+        lwork = static_cast<f77int>(prework);
+        std::vector<double> work(lwork);
+        dgesvd_(&jobu, &jobvt, &m, &n, M.get(), &lda, S.get(), U.get(), &ldu, Vt.get(), &ldvt, &work[0], &lwork, &info);
+        if (info != 0)
+          throw(NumericalError("DGESVD reported an error", info));
+
+        return(boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix>(U, S, Vt));
+      }
+
+
+      // Number of singular values (up to n) that are not zero to working
+      // precision.  If the residual of a block is rank deficient, QR
+      // fills out the basis with arbitrary vectors that are not
+      // orthogonal to U.  These only ever pair with (numerically) zero
+      // singular values, so they are dropped here.
+      uint numericalRank(const DoubleMatrix& S, const uint n) {
+        uint r = std::min(n, S.rows());
+        while (r > 1 && S[r-1] <= S[0] * 1e-10)
+          --r;
+        return(r);
+      }
+
+
+      DoubleMatrix gaussianMatrix(const uint m, const uint n) {
+        base_generator_type& rng = rng_singleton();
+        boost::normal_distribution<> rngmap(0.0, 1.0);
+        boost::variate_generator<base_generator_type&, boost::normal_distribution<> > rnd(rng, rngmap);
+
+        DoubleMatrix G(m, n);
+        for (ulong i=0; i<G.size(); ++i)
+          G[i] = rnd();
+
+        return(G);
+      }
+
+
+      // Exposes an in-memory matrix as a ColumnSource
+      template<typename T>
+      class MatrixColumns : public ColumnSource {
+      public:
+        explicit MatrixColumns(const T& M) : _M(M) { }
+
+        uint rows() const { return(_M.rows()); }
+        uint cols() const { return(_M.cols()); }
+
+        DoubleMatrix columns(const uint begin, const uint end) {
+          DoubleMatrix C(_M.rows(), end - begin);
+          for (uint i=begin; i<end; ++i)
+            for (uint j=0; j<_M.rows(); ++j)
+              C(j, i-begin) = _M(j, i);
+          return(C);
+        }
+
+      private:
+        const T& _M;
+      };
+
+    }
+
+
+
+    boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> svd(ColumnSource& A, const uint k, const uint oversample, const uint power_iterations, const uint blocksize) {
+      uint m = A.rows();
+      uint n = A.cols();
+      uint b = blocksize ? blocksize : n;
+
+      if (k == 0 || k > std::min(m, n))
+        throw(NumericalError("The number of terms requested for a truncated SVD exceeds the matrix dimensions"));
+      uint l = std::min(k + oversample, std::min(m, n));
+
+      // Sample the range of A, Y = A * Omega.  The rows of Omega are
+      // drawn as the matching columns of A are read, so it is never
+      // stored.
+      DoubleMatrix Y(m, l);
+      for (uint i=0; i<n; i += b) {
+        uint e = std::min(i + b, n);
+        DoubleMatrix C = A.columns(i, e);
+        DoubleMatrix Omega = gaussianMatrix(e - i, l);
+        accumulateProduct(C, Omega, Y, false, false, 1.0, 1.0);
+      }
+      qr(Y);
+
+      // Power iterations, Y = (AA')Y, sharpen the separation between
+      // the leading singular values and the rest...
+      for (uint q=0; q<power_iterations; ++q) {
+        DoubleMatrix Z(m, l);
+        for (uint i=0; i<n; i += b) {
+          DoubleMatrix C = A.columns(i, std::min(i + b, n));
+          DoubleMatrix W = MMMultiply(C, Y, true, false);
+          accumulateProduct(C, W, Z, false, false, 1.0, 1.0);
+        }
+        Y = Z;
+        qr(Y);
+      }
+
+      // Project A onto the basis and take the SVD of the (small) result
+      DoubleMatrix B(l, n);
+      for (uint i=0; i<n; i += b) {
+        uint e = std::min(i + b, n);
+        DoubleMatrix C = A.columns(i, e);
+        DoubleMatrix P = MMMultiply(Y, C, true, false);
+        for (uint c=0; c<P.cols(); ++c)
+          for (uint j=0; j<l; ++j)
+            B(j, i+c) = P(j, c);
+      }
+
+      boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> res = thinSVD(B);
+      DoubleMatrix U = MMMultiply(Y, boost::get<0>(res));
+      DoubleMatrix S = boost::get<1>(res);
+      DoubleMatrix Vt = boost::get<2>(res);
+
+      return(boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix>(submatrix(U, Range(0, m), Range(0, k)),
+                                                                    submatrix(S, Range(0, k), Range(0, 1)),
+                                                                    submatrix(Vt, Range(0, k), Range(0, n))));
+    }
+
+
+    boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> svd(const DoubleMatrix& M, const uint k, const uint oversample, const uint power_iterations) {
+      MatrixColumns<DoubleMatrix> A(M);
+      return(svd(A, k, oversample, power_iterations, 0));
+    }
+
+
+    boost::tuple<RealMatrix, RealMatrix, RealMatrix> svd(const RealMatrix& M, const uint k, const uint oversample, const uint power_iterations) {
+      MatrixColumns<RealMatrix> A(M);
+      boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> res = svd(A, k, oversample, power_iterations, 0);
+
+      RealMatrix U(M.rows(), k);
+      RealMatrix S(k, 1);
+      RealMatrix Vt(k, M.cols());
+      std::copy(boost::get<0>(res).get(), boost::get<0>(res).get() + U.size(), U.get());
+      std::copy(boost::get<1>(res).get(), boost::get<1>(res).get() + S.size(), S.get());
+      std::copy(boost::get<2>(res).get(), boost::get<2>(res).get() + Vt.size(), Vt.get());
+
+      return(boost::tuple<RealMatrix, RealMatrix, RealMatrix>(U, S, Vt));
+    }
+
+
+    DoubleMatrix rightSingularVectors(ColumnSource& A, const DoubleMatrix& U, const DoubleMatrix& S, const uint blocksize) {
+      uint n = A.cols();
+      uint k = U.cols();
+      uint b = blocksize ? blocksize : n;
+
+      if (U.rows() != A.rows() || S.rows() < k)
+        throw(NumericalError("rightSingularVectors: Matrices have incorrect dimensions"));
+
+      DoubleMatrix Vt(k, n);
+      for (uint i=0; i<n; i += b) {
+        DoubleMatrix P = MMMultiply(U, A.columns(i, std::min(i + b, n)), true, false);
+        for (uint c=0; c<P.cols(); ++c)
+          for (uint j=0; j<k; ++j)
+            Vt(j, i+c) = S[j] > 0.0 ? P(j, c) / S[j] : 0.0;
+      }
+
+      return(Vt);
+    }
+
+
+
+    IncrementalSVD::IncrementalSVD(const uint k, const bool centered, const uint oversample)
+      : _k(k), _kept(k + oversample), _n(0), _centered(centered)
+    {
+      if (k == 0)
+        throw(NumericalError("IncrementalSVD requires at least one term"));
+    }
+
+
+    uint IncrementalSVD::terms() const {
+      if (_n == 0)
+        throw(NumericalError("IncrementalSVD has not been given any columns"));
+      return(std::min(_k, _S.rows()));
+    }
+
+
+    DoubleMatrix IncrementalSVD::U() const {
+      return(submatrix(_U, Range(0, _U.rows()), Range(0, terms())));
+    }
+
+
+    DoubleMatrix IncrementalSVD::S() const {
+      return(submatrix(_S, Range(0, terms()), Range(0, 1)));
+    }
+
+
+    void IncrementalSVD::update(const DoubleMatrix& block) {
+      uint m = block.rows();
+      uint b = block.cols();
+      if (b == 0)
+        return;
+      if (_n != 0 && m != _U.rows())
+        throw(NumericalError("IncrementalSVD: block does not have the same number of rows as the decomposition"));
+
+      DoubleMatrix C(m, _centered ? b + 1 : b);
+      for (uint i=0; i<b; ++i)
+        for (uint j=0; j<m; ++j)
+          C(j, i) = block(j, i);
+
+      if (_centered) {
+        // Center the block on its own mean.  The shift from the old
+        // mean to the new one adds one more (scaled) column.
+        DoubleMatrix mu(m, 1);
+        for (uint i=0; i<b; ++i)
+          for (uint j=0; j<m; ++j)
+            mu[j] += block(j, i);
+        for (uint j=0; j<m; ++j)
+          mu[j] /= b;
+
+        for (uint i=0; i<b; ++i)
+          for (uint j=0; j<m; ++j)
+            C(j, i) -= mu[j];
+
+        if (_n == 0) {
+          _mean = mu;
+          C = submatrix(C, Range(0, m), Range(0, b));
+        } else {
+          double na = _n;
+          double scale = sqrt(na * b / (na + b));
+          for (uint j=0; j<m; ++j) {
+            C(j, b) = scale * (mu[j] - _mean[j]);
+            _mean[j] = (na * _mean[j] + b * mu[j]) / (na + b);
+          }
+        }
+      }
+
+      _n += b;
+
+      // The cost of each update grows with the cube of the number of
+      // terms plus columns, so large blocks are added a few columns at
+      // a time.  This also keeps the pieces narrower than they are tall,
+      // so the residual always has a QR decomposition.
+      uint w = std::min(m, 2 * _kept);
+      for (uint i=0; i<C.cols(); i += w) {
+        DoubleMatrix D = (C.cols() <= w) ? C : submatrix(C, Range(0, m), Range(i, std::min(i + w, C.cols())));
+        addColumns(D);
+      }
+    }
+
+
+    void IncrementalSVD::addColumns(DoubleMatrix& C) {
+      uint m = C.rows();
+      uint b = C.cols();
+
+      if (_U.rows() == 0) {
+        boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> res = thinSVD(C);
+        uint r = numericalRank(boost::get<1>(res), _kept);
+        _U = submatrix(boost::get<0>(res), Range(0, m), Range(0, r));
+        _S = submatrix(boost::get<1>(res), Range(0, r), Range(0, 1));
+        return;
+      }
+
+      uint k = _U.cols();
+
+      // Split C into the part in span(U) and the residual, orthogonalizing
+      // twice to keep U orthonormal over many updates
+      DoubleMatrix P = MMMultiply(_U, C, true, false);
+      DoubleMatrix R = C.copy();
+      accumulateProduct(_U, P, R, false, false, -1.0, 1.0);
+      DoubleMatrix P2 = MMMultiply(_U, R, true, false);
+      accumulateProduct(_U, P2, R, false, false, -1.0, 1.0);
+      P += P2;
+
+      DoubleMatrix Rr = qr(R);
+
+      //      [ S  P  ]
+      // K =  [ 0  Rr ]
+      DoubleMatrix K(k + b, k + b);
+      for (uint i=0; i<k; ++i)
+        K(i, i) = _S[i];
+      for (uint i=0; i<b; ++i) {
+        for (uint j=0; j<k; ++j)
+          K(j, k+i) = P(j, i);
+        for (uint j=0; j<b; ++j)
+          K(k+j, k+i) = Rr(j, i);
+      }
+
+      boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> res = thinSVD(K);
+      uint r = numericalRank(boost::get<1>(res), _kept);
+      DoubleMatrix Uk = submatrix(boost::get<0>(res), Range(0, k + b), Range(0, r));
+
+      // U = [U R] * Uk
+      DoubleMatrix Ua = MMMultiply(_U, submatrix(Uk, Range(0, k), Range(0, r)));
+      accumulateProduct(R, submatrix(Uk, Range(k, k + b), Range(0, r)), Ua, false, false, 1.0, 1.0);
+
+      _U = Ua;
+      _S = submatrix(boost::get<1>(res), Range(0, r), Range(0, 1));
+    }
+
+
+
     // Pseudo-inverse of a matrix using the SVD
 
     RealMatrix invert(RealMatrix& A, const float eps) {
@@ -64,6 +64,104 @@ namespace loos {
      */
     boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> svd(DoubleMatrix& M);
 
+
+    //! A matrix that is read a block of columns at a time
+    /**
+     * The truncated SVD functions only ever need to see a few columns
+     * of the matrix at once, so the matrix does not have to be held in
+     * memory (see TrajectoryMatrix for a trajectory-backed source).
+     */
+    class ColumnSource {
+    public:
+      virtual ~ColumnSource() { }
+
+      virtual uint rows() const =0;
+      virtual uint cols() const =0;
+
+      //! Returns columns [begin, end) as a rows() x (end-begin) matrix
+      virtual DoubleMatrix columns(const uint begin, const uint end) =0;
+    };
+
+
+    //! Truncated SVD (first \a k terms) using a randomized range finder
+    /**
+     * The range of \a M is sampled by multiplying it with a random
+     * Gaussian matrix of \a k + \a oversample columns, then refined with
+     * \a power_iterations passes of (MM')Q.  The SVD is only computed for
+     * the projection of \a M onto this basis.  Returns U (m x k), S (k x 1),
+     * and Vt (k x n).  Unlike the full SVD, \a M is not overwritten.
+     *
+     * The random matrix is drawn from rng_singleton().
+     */
+    boost::tuple<RealMatrix, RealMatrix, RealMatrix> svd(const RealMatrix& M, const uint k, const uint oversample = 10, const uint power_iterations = 2);
+
+    boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> svd(const DoubleMatrix& M, const uint k, const uint oversample = 10, const uint power_iterations = 2);
+
+    //! Truncated randomized SVD of a matrix read \a blocksize columns at a time
+    /**
+     * Makes 2 + \a power_iterations passes over the columns of \a A.
+     * Only the m x (k + oversample) basis and the (k + oversample) x n
+     * projection are kept in memory.
+     */
+    boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> svd(ColumnSource& A, const uint k, const uint oversample = 10, const uint power_iterations = 2, const uint blocksize = 1024);
+
+    //! Right singular vectors (Vt = inv(S) U' A) for the left singular vectors \a U of \a A
+    DoubleMatrix rightSingularVectors(ColumnSource& A, const DoubleMatrix& U, const DoubleMatrix& S, const uint blocksize = 1024);
+
+
+    //! Single-pass, truncated SVD that is updated a block of columns at a time
+    /**
+     * Each block of columns is projected onto the current left singular
+     * vectors, and the part of the block outside of that subspace is
+     * orthonormalized.  Only the SVD of the small (k + b) x (k + b)
+     * matrix these form is needed to update the decomposition (Brand,
+     * Linear Algebra Appl 415:20-30, 2006).  The first \a k + \a
+     * oversample terms are tracked, but only the first \a k are
+     * returned.
+     *
+     * If \a centered is true, the mean of the columns is also tracked
+     * and the SVD is of the mean-subtracted columns (Ross et al., Int J
+     * Comput Vision 77:125-141, 2008), i.e. a PCA in one pass.
+     *
+     * Example:
+     * \code
+     *   IncrementalSVD isvd(20, true);
+     *   for (uint i=0; i<A.cols(); i += 1024)
+     *     isvd.update(A.columns(i, std::min(i+1024, A.cols())));
+     *   DoubleMatrix U = isvd.U();
+     *   DoubleMatrix S = isvd.S();
+     *   DoubleMatrix avg = isvd.mean();
+     * \endcode
+     */
+    class IncrementalSVD {
+    public:
+      explicit IncrementalSVD(const uint k, const bool centered = false, const uint oversample = 10);
+
+      //! Adds the columns of \a block to the decomposition
+      void update(const DoubleMatrix& block);
+
+      //! Number of columns added so far
+      uint size() const { return(_n); }
+
+      //! Left singular vectors (m x k)
+      DoubleMatrix U() const;
+
+      //! Singular values (k x 1)
+      DoubleMatrix S() const;
+
+      //! Mean of the columns (m x 1), if centered
+      DoubleMatrix mean() const { return(_mean.copy()); }
+
+    private:
+      void addColumns(DoubleMatrix& C);
+      uint terms() const;
+
+    private:
+      uint _k, _kept, _n;
+      bool _centered;
+      DoubleMatrix _U, _S, _mean;
+    };
+
     //! Compute eigendecomposition of M
     /**
      * Internally, this function uses dsyev from ATLAS/LAPACK.  The passed matrix, M,
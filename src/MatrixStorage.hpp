@@ -64,6 +64,9 @@ namespace loos {
       SharedArray(const ulong n) : dim_(n) { allocate(n); }
       SharedArray(T* p, const ulong n) : dim_(n), dptr(p) { }
 
+      //! Share a block whose lifetime is managed elsewhere (e.g. a memory-mapped file)
+      SharedArray(const boost::shared_array<T>& p, const ulong n) : dim_(n), dptr(p) { }
+
       // In some cases, BOOST makes dptr(0) a shared_array<int> which
       // will cause subsequent type problems.  So, we force it to be a NULL
       // pointer but with type T and wrap that...
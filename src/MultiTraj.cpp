@@ -62,6 +62,12 @@ namespace loos {
 		throw(LOOSError("Error- MultiTrajectory::seekNextFrameImpl() is deprecated.\n"));
 	}
 
+	// The subset is passed on to each trajectory, which reads only those atoms if it can
+	void MultiTrajectory::atomSubsetImpl() {
+		for (std::vector<pTraj>::iterator i = _trajectories.begin(); i != _trajectories.end(); ++i)
+			(*i)->setAtomSubset(_atom_subset);
+	}
+
 	void MultiTrajectory::seekFrameImpl(const uint i) {
 		if (i >= _nframes)
 			throw(FileReadError("Cannot seek past end of MultiTraj"));
@@ -86,6 +92,16 @@ namespace loos {
 			_trajectories[_curtraj]->updateGroupVelocities(g);
 	}
 
+	void MultiTrajectory::copyCoordsImpl(greal* x, greal* y, greal* z) const {
+		uint i = eof() ? _trajectories.size()-1 : _curtraj;
+		_trajectories[i]->copyCoords(x, y, z);
+	}
+
+	void MultiTrajectory::updateArenaCoordsImpl(CoordinateArena& arena) {
+		if (!eof())
+			_trajectories[_curtraj]->updateArenaCoords(arena);
+	}
+
 
 	void MultiTrajectory::initWithList(const std::vector<std::string>& filenames, const AtomicGroup& model) {
 		for (uint i=0; i<filenames.size(); ++i) {
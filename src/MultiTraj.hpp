@@ -79,6 +79,8 @@ namespace loos {
 		//! Add a trajectory (by filename)
 		void addTrajectory(const std::string& filename) {
 			pTraj traj = createTrajectory(filename, _model);
+			if (!_atom_subset.empty())
+				traj->setAtomSubset(_atom_subset);
 			_trajectories.push_back(traj);
 			if (traj->nframes() > _skip)
 				_nframes += (traj->nframes() - _skip) / _stride;
@@ -162,6 +164,9 @@ namespace loos {
 		virtual bool parseFrame();
 		virtual void updateGroupCoordsImpl(AtomicGroup& g);
 		virtual void updateGroupVelocitiesImpl(AtomicGroup& g);
+		virtual void copyCoordsImpl(greal* x, greal* y, greal* z) const;
+		virtual void updateArenaCoordsImpl(CoordinateArena& arena);
+		virtual void atomSubsetImpl();
 
 		void findNextUsableTraj();
 
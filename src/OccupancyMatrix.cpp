@@ -0,0 +1,327 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include <boost/format.hpp>
+
+#include <OccupancyMatrix.hpp>
+#include <MatrixBinary.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  OccupancyMatrix::word_type OccupancyMatrix::lastWordMask() const {
+    uint r = _cols % word_bits;
+    return(r ? (static_cast<word_type>(1) << r) - 1 : ~static_cast<word_type>(0));
+  }
+
+
+  void OccupancyMatrix::checkSize(const OccupancyMatrix& rhs) const {
+    if (_rows != rhs._rows || _cols != rhs._cols)
+      throw(LOOSError("Occupancy matrices must be the same size"));
+  }
+
+
+  uint OccupancyMatrix::count(const uint i) const {
+    const word_type* p = row(i);
+    uint n = 0;
+    for (uint k=0; k<_words; ++k)
+      n += __builtin_popcountll(p[k]);
+    return(n);
+  }
+
+
+  ulong OccupancyMatrix::count() const {
+    ulong n = 0;
+    for (ulong k=0; k<_bits.size(); ++k)
+      n += __builtin_popcountll(_bits[k]);
+    return(n);
+  }
+
+
+  std::vector<uint> OccupancyMatrix::rowCounts() const {
+    std::vector<uint> counts(_rows);
+    for (uint i=0; i<_rows; ++i)
+      counts[i] = count(i);
+    return(counts);
+  }
+
+
+  // Only the occupied bits are visited, so sparse matrices are cheap
+  std::vector<uint> OccupancyMatrix::columnCounts() const {
+    std::vector<uint> counts(_cols, 0);
+    for (uint i=0; i<_rows; ++i) {
+      const word_type* p = row(i);
+      for (uint k=0; k<_words; ++k)
+        for (word_type w = p[k]; w; w &= w - 1)
+          ++counts[k * word_bits + __builtin_ctzll(w)];
+    }
+    return(counts);
+  }
+
+
+
+  OccupancyMatrix OccupancyMatrix::orRows() const {
+    OccupancyMatrix R(1, _cols);
+    word_type* r = R.row(0);
+    for (uint i=0; i<_rows; ++i) {
+      const word_type* p = row(i);
+      for (uint k=0; k<_words; ++k)
+        r[k] |= p[k];
+    }
+    return(R);
+  }
+
+
+  OccupancyMatrix OccupancyMatrix::andRows() const {
+    OccupancyMatrix R(1, _cols);
+    if (_rows == 0 || _words == 0)
+      return(R);
+
+    word_type* r = R.row(0);
+    std::copy(row(0), row(0) + _words, r);
+    for (uint i=1; i<_rows; ++i) {
+      const word_type* p = row(i);
+      for (uint k=0; k<_words; ++k)
+        r[k] &= p[k];
+    }
+    return(R);
+  }
+
+
+  OccupancyMatrix OccupancyMatrix::orColumns() const {
+    OccupancyMatrix R(_rows, 1);
+    for (uint i=0; i<_rows; ++i) {
+      const word_type* p = row(i);
+      for (uint k=0; k<_words; ++k)
+        if (p[k]) {
+          R.set(i, 0);
+          break;
+        }
+    }
+    return(R);
+  }
+
+
+  OccupancyMatrix OccupancyMatrix::andColumns() const {
+    OccupancyMatrix R(_rows, 1);
+    if (_cols == 0)
+      return(R);
+
+    for (uint i=0; i<_rows; ++i) {
+      const word_type* p = row(i);
+      bool all = ((p[_words-1] & lastWordMask()) == lastWordMask());
+      for (uint k=0; all && k+1<_words; ++k)
+        all = (p[k] == ~static_cast<word_type>(0));
+      R.set(i, 0, all);
+    }
+    return(R);
+  }
+
+
+  OccupancyMatrix& OccupancyMatrix::operator|=(const OccupancyMatrix& rhs) {
+    checkSize(rhs);
+    for (ulong k=0; k<_bits.size(); ++k)
+      _bits[k] |= rhs._bits[k];
+    return(*this);
+  }
+
+
+  OccupancyMatrix& OccupancyMatrix::operator&=(const OccupancyMatrix& rhs) {
+    checkSize(rhs);
+    for (ulong k=0; k<_bits.size(); ++k)
+      _bits[k] &= rhs._bits[k];
+    return(*this);
+  }
+
+
+  OccupancyMatrix OccupancyMatrix::transpose() const {
+    OccupancyMatrix T(_cols, _rows);
+    for (uint i=0; i<_rows; ++i) {
+      const word_type* p = row(i);
+      for (uint k=0; k<_words; ++k)
+        for (word_type w = p[k]; w; w &= w - 1)
+          T.set(k * word_bits + __builtin_ctzll(w), i);
+    }
+    return(T);
+  }
+
+
+
+  // Runs are found a word at a time by skipping over whole stretches
+  // of 0's or 1's
+  std::vector<OccupancyMatrix::Run> OccupancyMatrix::runs(const uint i) const {
+    std::vector<Run> result;
+    const word_type* p = row(i);
+    uint t = 0;
+
+    while (t < _cols) {
+      // Find the next occupied frame...
+      uint k = t / word_bits;
+      word_type w = p[k] & (~static_cast<word_type>(0) << (t % word_bits));
+      while (!w && ++k < _words)
+        w = p[k];
+      if (!w)
+        break;
+      uint start = k * word_bits + __builtin_ctzll(w);
+
+      // ...and the next unoccupied one after it
+      k = start / word_bits;
+      w = ~p[k] & (~static_cast<word_type>(0) << (start % word_bits));
+      while (!w && ++k < _words)
+        w = ~p[k];
+      uint end = w ? std::min(_cols, static_cast<uint>(k * word_bits + __builtin_ctzll(w))) : _cols;
+
+      result.push_back(Run(start, end - start));
+      t = end;
+    }
+
+    return(result);
+  }
+
+
+  std::vector<ulong> OccupancyMatrix::lifetimeHistogram() const {
+    std::vector<ulong> hist(_cols + 1, 0);
+    uint longest = 0;
+    for (uint i=0; i<_rows; ++i) {
+      std::vector<Run> r = runs(i);
+      for (std::vector<Run>::const_iterator j = r.begin(); j != r.end(); ++j) {
+        ++hist[j->length];
+        longest = std::max(longest, j->length);
+      }
+    }
+    hist.resize(longest + 1);
+    return(hist);
+  }
+
+
+
+  void writeOccupancyMatrix(std::ostream& os, const OccupancyMatrix& M, const std::string& meta,
+                            const bool binary) {
+    if (binary) {
+      internal::writeBinaryMatrixHeader(os, internal::BinaryBit, internal::BinaryRowMajor,
+                                        M.rows(), M.cols(), static_cast<ulong>(M.rows()) * M.cols(), meta);
+      for (uint j=0; j<M.rows(); ++j)
+        os.write(reinterpret_cast<const char*>(M.row(j)), M.wordsPerRow() * sizeof(OccupancyMatrix::word_type));
+      return;
+    }
+
+    // Same layout as writeAsciiMatrix() for a Matrix<int>
+    os << "# " << meta << std::endl;
+    os << boost::format("# %d %d (%d)\n") % M.rows() % M.cols() % 0;
+    for (uint j=0; j<M.rows(); ++j) {
+      for (uint i=0; i<M.cols(); ++i)
+        os << (M(j, i) ? "1 " : "0 ");
+      os << std::endl;
+    }
+  }
+
+
+  void writeOccupancyMatrix(const std::string& fname, const OccupancyMatrix& M, const std::string& meta,
+                            const bool binary) {
+    std::ofstream ofs(fname.c_str(), std::ios_base::out | std::ios_base::binary);
+    if (!ofs.is_open())
+      throw(std::runtime_error("Cannot open " + fname + " for writing."));
+    writeOccupancyMatrix(ofs, M, meta, binary);
+  }
+
+
+
+  namespace {
+
+    OccupancyMatrix readBitMatrix(const std::string& fname, const BinaryMatrixInfo& info) {
+      std::ifstream ifs(fname.c_str(), std::ios_base::in | std::ios_base::binary);
+      if (!ifs)
+        throw(MatrixReadError("Cannot open " + fname + " for reading."));
+      ifs.seekg(info.data_offset);
+
+      OccupancyMatrix M(info.rows, info.cols);
+      ulong nbytes = M.wordsPerRow() * sizeof(OccupancyMatrix::word_type);
+      for (uint j=0; j<M.rows(); ++j) {
+        OccupancyMatrix::word_type* p = M.row(j);
+        if (!ifs.read(reinterpret_cast<char*>(p), nbytes))
+          throw(MatrixReadError("Error reading occupancy matrix from " + fname));
+        if (info.swapped)
+          for (uint k=0; k<M.wordsPerRow(); ++k) {
+            unsigned char* b = reinterpret_cast<unsigned char*>(p + k);
+            std::reverse(b, b + sizeof(OccupancyMatrix::word_type));
+          }
+      }
+
+      return(M);
+    }
+
+
+    // Parsed in the same way as MatrixReadImpl, but without ever
+    // holding the full matrix of integers
+    OccupancyMatrix readAsciiOccupancy(const std::string& fname) {
+      std::ifstream ifs(fname.c_str());
+      if (!ifs)
+        throw(MatrixReadError("Cannot open " + fname + " for reading."));
+
+      std::string inbuf;
+      int m = 0, n = 0;
+      while (getline(ifs, inbuf).good())
+        if (sscanf(inbuf.c_str(), "# %d %d", &m, &n) == 2)
+          break;
+      if (m <= 0 || n <= 0)
+        throw(MatrixReadError("Could not find magic marker in matrix file " + fname));
+
+      OccupancyMatrix M(m, n);
+      double datum;
+      for (int j=0; j<m; ++j)
+        for (int i=0; i<n; ++i) {
+          if (!(ifs >> datum))
+            throw(MatrixReadError(str(boost::format("Read error at (%d,%d) in %s") % j % i % fname)));
+          if (datum != 0.0)
+            M.set(j, i);
+        }
+
+      return(M);
+    }
+
+  }
+
+
+  OccupancyMatrix readOccupancyMatrix(const std::string& fname) {
+    if (!isBinaryMatrix(fname))
+      return(readAsciiOccupancy(fname));
+
+    BinaryMatrixInfo info = readBinaryMatrixInfo(fname);
+    if (info.type == internal::BinaryBit)
+      return(readBitMatrix(fname, info));
+
+    // Integer matrices written by water-inside are column-major, so
+    // these are used directly from the mapped file.  Anything else is
+    // read as doubles, so no non-zero element (such as 0.5, or a large
+    // 64-bit integer) is truncated to zero.
+    if (info.type == internal::BinaryInt32)
+      return(OccupancyMatrix(readBinaryMatrix<int, Math::ColMajor>(fname)));
+    return(OccupancyMatrix(readBinaryMatrix<double, Math::ColMajor>(fname)));
+  }
+
+}
@@ -0,0 +1,184 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_OCCUPANCY_MATRIX_HPP)
+#define LOOS_OCCUPANCY_MATRIX_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <MatrixImpl.hpp>
+
+
+namespace loos {
+
+
+  //! A bit-packed matrix of occupancies (e.g. water i is inside at frame t)
+  /**
+   * Each row is a time series of true/false values, stored as one bit
+   * per frame, so a 10,000 water by 500,000 frame matrix takes about
+   * 600MB rather than the 20GB of a Math::Matrix<int>.  Counts and
+   * reductions work on whole 64-bit words at a time.
+   *
+   * Occupancy matrices can be written either as ASCII (the same as a
+   * Math::Matrix<int> of 0's and 1's) or in the LOOS binary matrix
+   * format, where they are stored with one bit per element.  Either
+   * can be read back with readOccupancyMatrix() or with readMatrix()
+   * into a regular Matrix.
+   */
+  class OccupancyMatrix {
+  public:
+    typedef unsigned long long    word_type;
+    static const uint word_bits = 64;
+
+    //! A run of consecutive occupied frames
+    struct Run {
+      Run(const uint s, const uint n) : start(s), length(n) { }
+      uint start, length;
+    };
+
+
+    OccupancyMatrix() : _rows(0), _cols(0), _words(0) { }
+    OccupancyMatrix(const uint rows, const uint cols)
+      : _rows(rows), _cols(cols), _words((cols + word_bits - 1) / word_bits),
+        _bits(static_cast<ulong>(rows) * _words, 0)
+    { }
+
+    //! Converts a Matrix, where any non-zero element is occupied
+    template<typename T, class P, template<typename> class S>
+    explicit OccupancyMatrix(const Math::Matrix<T,P,S>& M)
+      : _rows(M.rows()), _cols(M.cols()), _words((M.cols() + word_bits - 1) / word_bits),
+        _bits(static_cast<ulong>(M.rows()) * _words, 0)
+    {
+      for (uint j=0; j<_rows; ++j)
+        for (uint i=0; i<_cols; ++i)
+          if (M(j, i) != 0)
+            set(j, i);
+    }
+
+    uint rows() const { return(_rows); }
+    uint cols() const { return(_cols); }
+
+    bool operator()(const uint i, const uint t) const {
+      return((_bits[index(i, t)] >> (t % word_bits)) & 1u);
+    }
+
+    void set(const uint i, const uint t, const bool b = true) {
+      word_type mask = static_cast<word_type>(1) << (t % word_bits);
+      if (b)
+        _bits[index(i, t)] |= mask;
+      else
+        _bits[index(i, t)] &= ~mask;
+    }
+
+    //! Marks everything as unoccupied
+    void clear() { _bits.assign(_bits.size(), 0); }
+
+
+    //! Number of frames in which row \a i is occupied
+    uint count(const uint i) const;
+
+    //! Total number of occupied elements
+    ulong count() const;
+
+    //! Number of occupied frames for each row
+    std::vector<uint> rowCounts() const;
+
+    //! Number of occupied rows in each frame (column)
+    std::vector<uint> columnCounts() const;
+
+
+    //! A single row that is occupied in the frames where any row is
+    OccupancyMatrix orRows() const;
+
+    //! A single row that is occupied in the frames where every row is
+    OccupancyMatrix andRows() const;
+
+    //! A single column that is set for the rows that are ever occupied
+    OccupancyMatrix orColumns() const;
+
+    //! A single column that is set for the rows that are always occupied
+    OccupancyMatrix andColumns() const;
+
+    //! Element-wise OR with another matrix of the same size
+    OccupancyMatrix& operator|=(const OccupancyMatrix& rhs);
+
+    //! Element-wise AND with another matrix of the same size
+    OccupancyMatrix& operator&=(const OccupancyMatrix& rhs);
+
+    OccupancyMatrix transpose() const;
+
+
+    //! The runs of consecutive occupied frames in row \a i
+    std::vector<Run> runs(const uint i) const;
+
+    //! Histogram of how long rows stay occupied, over all runs in all rows
+    /**
+     * Element k is the number of runs that last exactly k frames.  Runs
+     * that reach the first or last frame are included, even though
+     * their true length is unknown.
+     */
+    std::vector<ulong> lifetimeHistogram() const;
+
+
+    //! The packed bits of row \a i (frame t is bit t%64 of word t/64)
+    const word_type* row(const uint i) const { return(&_bits[static_cast<ulong>(i) * _words]); }
+    word_type* row(const uint i) { return(&_bits[static_cast<ulong>(i) * _words]); }
+    uint wordsPerRow() const { return(_words); }
+
+  private:
+    ulong index(const uint i, const uint t) const { return(static_cast<ulong>(i) * _words + t / word_bits); }
+
+    // Mask for the frames actually used in the last word of each row
+    word_type lastWordMask() const;
+
+    void checkSize(const OccupancyMatrix& rhs) const;
+
+    uint _rows, _cols, _words;
+    std::vector<word_type> _bits;
+  };
+
+
+
+  //! Writes an occupancy matrix in either binary (bit-packed) or ASCII format
+  void writeOccupancyMatrix(std::ostream& os, const OccupancyMatrix& M, const std::string& meta,
+                            const bool binary);
+
+  void writeOccupancyMatrix(const std::string& fname, const OccupancyMatrix& M, const std::string& meta,
+                            const bool binary);
+
+  //! Reads an occupancy matrix from any matrix file
+  /**
+   * Bit-packed binary matrices are read directly.  ASCII and other
+   * binary matrices are converted, with any non-zero element taken as
+   * occupied.  ASCII matrices are converted as they are read, so a
+   * full integer matrix is never held in memory.
+   */
+  OccupancyMatrix readOccupancyMatrix(const std::string& fname);
+
+}
+
+
+#endif
@@ -22,6 +22,7 @@
 
 #include <utils_structural.hpp>
 #include <OptionsFramework.hpp>
+#include <PrefetchingTrajectory.hpp>
 
 #include <boost/lambda/lambda.hpp>
 
@@ -301,7 +302,8 @@ namespace loos {
       opts.add_options()
         ("skip,k", po::value<unsigned int>(&skip)->default_value(skip), "Number of frames to skip")
         ("modeltype", po::value<std::string>(), modeltypes.c_str())
-        ("trajtype", po::value<std::string>(), trajtypes.c_str());
+        ("trajtype", po::value<std::string>(), trajtypes.c_str())
+        ("prefetch", po::value<unsigned int>(&prefetch)->default_value(prefetch), "Read this many frames ahead in a background thread (0 = off)");
     };
 
     void BasicTrajectory::addHidden(po::options_description& opts) {
@@ -332,6 +334,9 @@ namespace loos {
       } else
         trajectory = createTrajectory(traj_name, model);
 
+      if (prefetch > 0)
+        trajectory = pTraj(new PrefetchingTrajectory(trajectory, prefetch));
+
       if (skip > 0)
         trajectory->readFrame(skip-1);
 
@@ -358,7 +363,8 @@ namespace loos {
         ("modeltype", po::value<std::string>(&model_type)->default_value(model_type), modeltypes.c_str())
         ("trajtype", po::value<std::string>(&traj_type)->default_value(traj_type), trajtypes.c_str())
         ("stride,i", po::value<unsigned int>(&stride)->default_value(stride), "Take every ith frame")
-        ("range,r", po::value<std::string>(&frame_index_spec), "Which frames to use (matlab style range, overrides stride and skip)");
+        ("range,r", po::value<std::string>(&frame_index_spec), "Which frames to use (matlab style range, overrides stride and skip)")
+        ("prefetch", po::value<unsigned int>(&prefetch)->default_value(prefetch), "Read this many frames ahead in a background thread (0 = off)");
     };
 
     void TrajectoryWithFrameIndices::addHidden(po::options_description& opts) {
@@ -391,6 +397,9 @@ namespace loos {
         trajectory = createTrajectory(traj_name, model);
       else
         trajectory = createTrajectory(traj_name, traj_type, model);
+
+      if (prefetch > 0)
+        trajectory = pTraj(new PrefetchingTrajectory(trajectory, prefetch));
       
       return(true);
     }
@@ -423,7 +432,8 @@ namespace loos {
         ("modeltype", po::value<std::string>(), modeltypes.c_str())
         ("skip,k", po::value<uint>(&skip)->default_value(skip), "Number of frames to skip in sub-trajectories")
         ("stride,i", po::value<uint>(&stride)->default_value(stride), "Step through sub-trajectories by this amount")
-        ("range,r", po::value<std::string>(&frame_index_spec), "Which frames to use in composite trajectory");
+        ("range,r", po::value<std::string>(&frame_index_spec), "Which frames to use in composite trajectory")
+        ("prefetch", po::value<uint>(&prefetch)->default_value(prefetch), "Read this many frames ahead in a background thread (0 = off)");
     }
 
     void MultiTrajOptions::addHidden(po::options_description& opts) {
@@ -450,6 +460,8 @@ namespace loos {
 
       mtraj = MultiTrajectory(traj_names, model, skip, stride);
       trajectory = pTraj(&mtraj, boost::lambda::_1);
+      if (prefetch > 0)
+        trajectory = pTraj(new PrefetchingTrajectory(trajectory, prefetch));
 
       return true;
     }
@@ -573,6 +585,19 @@ namespace loos {
     
     // -------------------------------------------------------
 
+    void MatrixOutputOptions::addGeneric(po::options_description& opts) {
+      opts.add_options()
+        ("binary", po::value<bool>(&binary)->default_value(binary), "Write matrices in binary (.lmat) format");
+    }
+
+    std::string MatrixOutputOptions::print() const {
+      std::ostringstream oss;
+      oss << "binary=" << binary;
+      return(oss.str());
+    }
+
+    // -------------------------------------------------------
+
     void RequiredArguments::addArgument(const std::string& name, const std::string& description) {
       StringPair arg(name, description);
       if (find(arguments.begin(), arguments.end(), arg) != arguments.end()) {
@@ -493,10 +493,11 @@ namespace loos {
      **/
     class BasicTrajectory : public OptionsPackage {
     public:
-      BasicTrajectory() : skip(0) { }
+      BasicTrajectory() : skip(0), prefetch(0) { }
 
 
       unsigned int skip;
+      unsigned int prefetch;
       std::string model_name, model_type, traj_name, traj_type;
 
       //! Model that describes the trajectory
@@ -534,12 +535,12 @@ namespace loos {
      **/
     class TrajectoryWithFrameIndices : public OptionsPackage {
     public:
-      TrajectoryWithFrameIndices() : skip(0), stride(1), frame_index_spec("") { }
+      TrajectoryWithFrameIndices() : skip(0), stride(1), prefetch(0), frame_index_spec("") { }
 
       //! Returns the list of frames the user requested
       std::vector<uint> frameList() const;
 
-      unsigned int skip, stride;
+      unsigned int skip, stride, prefetch;
       std::string frame_index_spec;
       std::string model_name, model_type, traj_name, traj_type;
 
@@ -584,11 +585,12 @@ namespace loos {
      **/
     class MultiTrajOptions : public OptionsPackage {
     public:
-      MultiTrajOptions() : skip(0), stride(1) { }
+      MultiTrajOptions() : skip(0), stride(1), prefetch(0) { }
 
 
       uint skip;
       uint stride;
+      uint prefetch;
       std::vector< std::string > traj_names;
       std::string model_name, model_type, frame_index_spec;
 
@@ -773,6 +775,30 @@ namespace loos {
 
 
 
+    // ----------------------------------------------------------------------
+
+    //! Selects the format for matrices written by a tool (--binary)
+    /**
+     * Tools should write matrices with loos::writeMatrix(), passing
+     * \a binary, and name files using suffix() so that binary
+     * matrices get a .lmat suffix rather than .asc
+     */
+    class MatrixOutputOptions : public OptionsPackage {
+    public:
+      MatrixOutputOptions() : binary(false) { }
+
+      //! Suffix for matrix files in the selected format
+      std::string suffix() const { return(matrixSuffix(binary)); }
+
+      bool binary;
+
+    private:
+      void addGeneric(po::options_description& opts);
+      std::string print() const;
+    };
+
+
+
     // ----------------------------------------------------------------------
 
     typedef std::vector<OptionsPackage *> vOpts;
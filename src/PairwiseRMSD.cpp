@@ -0,0 +1,262 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/ref.hpp>
+
+#include <PairwiseRMSD.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+  // Conservative, so the tiles also fit on machines with a small L2
+  const uint PairwiseRMSD::l2_cache_size = 256 * 1024;
+
+
+  namespace {
+
+    // Number of atoms handled together by the inner-product loop.  The
+    // coordinate arrays are padded (with zeros) to a multiple of this.
+    const uint lanes = 4;
+
+
+    // Inner products between two packed, centered frames.  Each lane
+    // keeps its own partial sums so the compiler can vectorize the
+    // loop without reassociating the floating-point additions.
+    void innerProducts(const double* u, const double* v, const uint n, double* A) {
+      const double* ux = u;
+      const double* uy = u + n;
+      const double* uz = u + 2*n;
+      const double* vx = v;
+      const double* vy = v + n;
+      const double* vz = v + 2*n;
+
+      double a[9][lanes];
+      for (uint i=0; i<9; ++i)
+        for (uint l=0; l<lanes; ++l)
+          a[i][l] = 0.0;
+
+      for (uint k=0; k<n; k += lanes)
+        for (uint l=0; l<lanes; ++l) {
+          double x = ux[k+l], y = uy[k+l], z = uz[k+l];
+          a[0][l] += vx[k+l] * x;  a[1][l] += vx[k+l] * y;  a[2][l] += vx[k+l] * z;
+          a[3][l] += vy[k+l] * x;  a[4][l] += vy[k+l] * y;  a[5][l] += vy[k+l] * z;
+          a[6][l] += vz[k+l] * x;  a[7][l] += vz[k+l] * y;  a[8][l] += vz[k+l] * z;
+        }
+
+      for (uint i=0; i<9; ++i)
+        A[i] = (a[i][0] + a[i][1]) + (a[i][2] + a[i][3]);
+    }
+
+  }
+
+
+
+  // Hands out tiles to the threads, in the order they were listed
+  template<class M>
+  struct PairwiseRMSD::Worker {
+    Worker(const PairwiseRMSD* self, const PairwiseRMSD* other, const bool half,
+           const std::vector< std::pair<uint,uint> >* tiles, uint* next,
+           boost::mutex* mtx, M* R)
+      : _self(self), _other(other), _half(half), _tiles(tiles), _next(next), _mtx(mtx), _R(R)
+    { }
+
+    bool nextTile(uint* t) {
+      boost::mutex::scoped_lock lock(*_mtx);
+      if (*_next >= _tiles->size())
+        return(false);
+      *t = (*_next)++;
+      return(true);
+    }
+
+    void operator()() {
+      uint t;
+      while (nextTile(&t))
+        _self->tile(*_other, (*_tiles)[t].first, (*_tiles)[t].second, _half, *_R);
+    }
+
+    const PairwiseRMSD* _self;
+    const PairwiseRMSD* _other;
+    bool _half;
+    const std::vector< std::pair<uint,uint> >* _tiles;
+    uint* _next;
+    boost::mutex* _mtx;
+    M* _R;
+  };
+
+
+
+  PairwiseRMSD::PairwiseRMSD(const alignment::vecMatrix& frames)
+    : _nframes(frames.size()), _natoms(0), _padded(0), _tile(1)
+  {
+    if (_nframes == 0)
+      throw(LOOSError("Cannot compute pairwise RMSDs for an empty ensemble"));
+
+    _natoms = frames[0].size() / 3;
+    if (_natoms == 0)
+      throw(LOOSError("Cannot compute pairwise RMSDs for structures with no atoms"));
+    _padded = ((_natoms + lanes - 1) / lanes) * lanes;
+    _coords.assign(static_cast<ulong>(_nframes) * 3 * _padded, 0.0);
+    _sumsq.resize(_nframes);
+
+    for (uint i=0; i<_nframes; ++i) {
+      if (frames[i].size() != 3 * _natoms)
+        throw(LOOSError("All structures in a pairwise RMSD must have the same number of atoms"));
+      pack(i, frames[i]);
+    }
+
+    defaultTileSize();
+  }
+
+
+  PairwiseRMSD::PairwiseRMSD(const std::vector<AtomicGroup>& ensemble)
+    : _nframes(ensemble.size()), _natoms(0), _padded(0), _tile(1)
+  {
+    if (_nframes == 0)
+      throw(LOOSError("Cannot compute pairwise RMSDs for an empty ensemble"));
+
+    _natoms = ensemble[0].size();
+    if (_natoms == 0)
+      throw(LOOSError("Cannot compute pairwise RMSDs for structures with no atoms"));
+    _padded = ((_natoms + lanes - 1) / lanes) * lanes;
+    _coords.assign(static_cast<ulong>(_nframes) * 3 * _padded, 0.0);
+    _sumsq.resize(_nframes);
+
+    for (uint i=0; i<_nframes; ++i) {
+      if (ensemble[i].size() != _natoms)
+        throw(LOOSError("All structures in a pairwise RMSD must have the same number of atoms"));
+      pack(i, ensemble[i].coordsAsVector());
+    }
+
+    defaultTileSize();
+  }
+
+
+  // Centers the coords and scatters them into the x, y, and z arrays for the frame
+  void PairwiseRMSD::pack(const uint i, const alignment::vecDouble& crds) {
+    alignment::vecDouble c(crds);
+    alignment::centerAtOrigin(c);
+
+    double* p = &(_coords[static_cast<ulong>(i) * 3 * _padded]);
+    double ss = 0.0;
+    for (uint k=0; k<_natoms; ++k)
+      for (uint d=0; d<3; ++d) {
+        double x = c[k*3 + d];
+        p[d * _padded + k] = x;
+        ss += x * x;
+      }
+
+    _sumsq[i] = ss;
+  }
+
+
+  void PairwiseRMSD::defaultTileSize() {
+    ulong frame_bytes = 3 * _padded * sizeof(double);
+    _tile = std::max(1ul, l2_cache_size / (2 * frame_bytes));
+  }
+
+
+  double PairwiseRMSD::rmsd(const uint i, const uint j) const {
+    double A[9];
+
+    innerProducts(frame(i), frame(j), _padded, A);
+    return(alignment::qcpRMSD(A, 0.5 * (_sumsq[i] + _sumsq[j]), _natoms));
+  }
+
+
+  template<class M>
+  void PairwiseRMSD::tile(const PairwiseRMSD& other, const uint ti, const uint tj, const bool half, M& R) const {
+    uint ibegin = ti * _tile;
+    uint iend = std::min(ibegin + _tile, _nframes);
+    uint jbegin = tj * other._tile;
+    uint jend = std::min(jbegin + other._tile, other._nframes);
+
+    double A[9];
+    for (uint i=ibegin; i<iend; ++i) {
+      const double* u = frame(i);
+      uint jlast = (half && ti == tj) ? i : jend;
+      for (uint j=jbegin; j<jlast; ++j) {
+        innerProducts(u, other.frame(j), _padded, A);
+        R(i, j) = alignment::qcpRMSD(A, 0.5 * (_sumsq[i] + other._sumsq[j]), _natoms);
+      }
+    }
+  }
+
+
+  template<class M>
+  void PairwiseRMSD::compute(const PairwiseRMSD& other, const bool half, uint nthreads, M& R) const {
+    uint ni = (_nframes + _tile - 1) / _tile;
+    uint nj = (other._nframes + other._tile - 1) / other._tile;
+
+    std::vector< std::pair<uint,uint> > tiles;
+    for (uint i=0; i<ni; ++i)
+      for (uint j=0; j < (half ? i+1 : nj); ++j)
+        tiles.push_back(std::pair<uint,uint>(i, j));
+
+    if (nthreads == 0)
+      nthreads = boost::thread::hardware_concurrency();
+    if (nthreads == 0)
+      nthreads = 1;
+    if (nthreads > tiles.size())
+      nthreads = tiles.size();
+
+    uint next = 0;
+    boost::mutex mtx;
+    Worker<M> worker(this, &other, half, &tiles, &next, &mtx, &R);
+
+    if (nthreads == 1) {
+      worker();
+      return;
+    }
+
+    boost::thread_group threads;
+    for (uint i=0; i<nthreads; ++i)
+      threads.create_thread(worker);
+    threads.join_all();
+  }
+
+
+  PairwiseRMSD::TriangularMatrix PairwiseRMSD::allToAll(uint nthreads) const {
+    TriangularMatrix R(_nframes, _nframes);
+    for (uint i=0; i<_nframes; ++i)
+      R(i, i) = 0.0;
+
+    compute(*this, true, nthreads, R);
+    return(R);
+  }
+
+
+  RealMatrix PairwiseRMSD::allToAll(const PairwiseRMSD& other, uint nthreads) const {
+    if (other._natoms != _natoms)
+      throw(LOOSError("Both ensembles in a pairwise RMSD must have the same number of atoms"));
+
+    RealMatrix R(_nframes, other._nframes);
+    compute(other, false, nthreads, R);
+    return(R);
+  }
+
+
+}
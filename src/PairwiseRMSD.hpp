@@ -0,0 +1,124 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_PAIRWISE_RMSD_HPP)
+#define LOOS_PAIRWISE_RMSD_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <alignment.hpp>
+#include <MatrixImpl.hpp>
+#include <MatrixOps.hpp>
+
+
+namespace loos {
+
+
+  //! All-to-all RMSD between the structures of an ensemble
+  /**
+   * Every structure is centered once, when the engine is built, and
+   * its coordinates packed into a single block as separate x, y, and z
+   * arrays (each padded to a multiple of four atoms).  The sum of the
+   * squared coordinates of each structure is cached too, so each pair
+   * only needs the nine inner products of the QCP correlation matrix
+   * (see alignment::qcpRMSD()), accumulated in one vectorizable pass.
+   *
+   * The RMSD matrix is computed in square tiles of tileSize() frames
+   * on a side, chosen so that the two blocks of frames for a tile fit
+   * in the L2 cache.  Only the lower half of the matrix is computed for
+   * an ensemble against itself.  Tiles are handed out to the worker
+   * threads as they finish their previous tile.
+   *
+   * Example:
+   * \code
+   *   std::vector<AtomicGroup> ensemble;
+   *   readTrajectory(ensemble, subset, traj);
+   *   PairwiseRMSD engine(ensemble);
+   *   PairwiseRMSD::TriangularMatrix M = engine.allToAll(8);
+   * \endcode
+   */
+  class PairwiseRMSD {
+  public:
+    typedef Math::Matrix<float, Math::Triangular>    TriangularMatrix;
+
+    //! Size of the cache the tiles are sized for (in bytes)
+    static const uint l2_cache_size;
+
+    //! Each element of \a frames holds the (x,y,z) coords of one structure
+    explicit PairwiseRMSD(const alignment::vecMatrix& frames);
+
+    explicit PairwiseRMSD(const std::vector<AtomicGroup>& ensemble);
+
+    //! Number of structures
+    uint size() const { return(_nframes); }
+
+    //! Number of atoms in each structure
+    uint atoms() const { return(_natoms); }
+
+    //! Frames along each side of a tile
+    uint tileSize() const { return(_tile); }
+    void tileSize(const uint n) { _tile = (n == 0) ? 1 : n; }
+
+    //! RMSD between structures \a i and \a j after optimal superposition
+    double rmsd(const uint i, const uint j) const;
+
+    //! Symmetric matrix of the RMSD between every pair of structures
+    /**
+     * If \a nthreads is zero, one thread per core is used.
+     */
+    TriangularMatrix allToAll(uint nthreads = 1) const;
+
+    //! RMSD between every structure in this ensemble (rows) and in \a other (cols)
+    /**
+     * Throws a LOOSError if the ensembles do not have the same number of atoms.
+     */
+    RealMatrix allToAll(const PairwiseRMSD& other, uint nthreads = 1) const;
+
+  private:
+    void pack(const uint frame, const alignment::vecDouble& crds);
+    void defaultTileSize();
+
+    const double* frame(const uint i) const { return(&(_coords[static_cast<ulong>(i) * 3 * _padded])); }
+
+    // Worker for one tile of the matrix
+    template<class M>
+    void tile(const PairwiseRMSD& other, const uint ti, const uint tj, const bool half, M& R) const;
+
+    template<class M>
+    void compute(const PairwiseRMSD& other, const bool half, uint nthreads, M& R) const;
+
+    template<class M> struct Worker;
+
+  private:
+    uint _nframes, _natoms, _padded, _tile;
+    std::vector<double> _coords;
+    std::vector<double> _sumsq;
+  };
+
+
+}
+
+
+#endif
@@ -0,0 +1,61 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <ParallelFrameDriver.hpp>
+#include <sfactories.hpp>
+#include <MultiTraj.hpp>
+#include <PrefetchingTrajectory.hpp>
+
+
+namespace loos {
+
+  TrajectoryOpener::TrajectoryOpener(const std::string& fname, const AtomicGroup& model)
+    : _filenames(1, fname), _model(model), _skip(0), _stride(1), _prefetch(0), _multi(false)
+  { }
+
+
+  TrajectoryOpener::TrajectoryOpener(const std::string& fname, const std::string& type, const AtomicGroup& model)
+    : _filenames(1, fname), _type(type), _model(model), _skip(0), _stride(1), _prefetch(0), _multi(false)
+  { }
+
+
+  TrajectoryOpener::TrajectoryOpener(const std::vector<std::string>& fnames, const AtomicGroup& model,
+                                     const uint skip, const uint stride)
+    : _filenames(fnames), _model(model), _skip(skip), _stride(stride), _prefetch(0), _multi(true)
+  { }
+
+
+  pTraj TrajectoryOpener::operator()() const {
+    pTraj traj;
+    if (_multi)
+      traj = pTraj(new MultiTrajectory(_filenames, _model, _skip, _stride));
+    else if (_type.empty())
+      traj = createTrajectory(_filenames[0], _model);
+    else
+      traj = createTrajectory(_filenames[0], _type, _model);
+
+    if (_prefetch > 0)
+      traj = pTraj(new PrefetchingTrajectory(traj, _prefetch));
+    return(traj);
+  }
+
+}
@@ -0,0 +1,207 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_PARALLEL_FRAME_DRIVER_HPP)
+#define LOOS_PARALLEL_FRAME_DRIVER_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/ref.hpp>
+
+#include <loos_defs.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  //! Opens a new, independent handle onto a trajectory
+  /**
+   * Threads cannot share a Trajectory object, since reading a frame
+   * changes its state.  A TrajectoryOpener remembers how a trajectory
+   * was opened so each thread can open its own copy.  Multiple
+   * filenames are combined into a MultiTrajectory.  If prefetch() is
+   * set, each copy is wrapped in a PrefetchingTrajectory that reads
+   * that many frames ahead.
+   */
+  class TrajectoryOpener {
+  public:
+    //! Open \a fname, determining the type from its extension
+    TrajectoryOpener(const std::string& fname, const AtomicGroup& model);
+
+    //! Open \a fname as trajectory type \a type (if empty, use the extension)
+    TrajectoryOpener(const std::string& fname, const std::string& type, const AtomicGroup& model);
+
+    //! Open \a fnames as a MultiTrajectory with the given skip and stride
+    TrajectoryOpener(const std::vector<std::string>& fnames, const AtomicGroup& model,
+                     const uint skip = 0, const uint stride = 1);
+
+    //! Number of frames each opened trajectory reads ahead (0 = none)
+    uint prefetch() const { return(_prefetch); }
+    void prefetch(const uint n) { _prefetch = n; }
+
+    //! Returns a newly opened trajectory
+    pTraj operator()() const;
+
+  private:
+    std::vector<std::string> _filenames;
+    std::string _type;
+    AtomicGroup _model;
+    uint _skip, _stride, _prefetch;
+    bool _multi;
+  };
+
+
+
+  namespace internal {
+
+    // Each worker reads a contiguous block of the requested frames
+    // from its own trajectory into its own copy of the group
+    template<class Calculator>
+    struct FrameWorker {
+      typedef typename Calculator::result_type    result_type;
+
+      FrameWorker(const pTraj& traj, const AtomicGroup& group, const Calculator& calc,
+                  const std::vector<uint>& frames, const uint begin, const uint end,
+                  std::vector<result_type>& results)
+        : _traj(traj), _group(group.copy()), _calc(calc), _frames(&frames),
+          _begin(begin), _end(end), _results(&results)
+      { }
+
+      void operator()() {
+        try {
+          for (uint k = _begin; k < _end; ++k) {
+            uint frame = (*_frames)[k];
+
+            // Consecutive frames are read without seeking
+            bool ok = (k > _begin && frame == (*_frames)[k-1] + 1) ? _traj->readFrame() : _traj->readFrame(frame);
+            if (!ok)
+              throw(LOOSError("Unable to read trajectory frame"));
+            _traj->updateGroupCoords(_group);
+            (*_results)[k] = _calc(_group, frame);
+          }
+        }
+        catch (std::exception& e) {
+          _error = e.what();
+        }
+      }
+
+      pTraj _traj;
+      AtomicGroup _group;
+      Calculator _calc;
+      const std::vector<uint>* _frames;
+      uint _begin, _end;
+      std::vector<result_type>* _results;
+      std::string _error;
+    };
+
+  }
+
+
+
+  //! Apply a calculation to frames of a trajectory using multiple threads
+  /**
+   * The requested frames are split into contiguous blocks, one per
+   * thread.  Each thread opens its own copy of the trajectory (via
+   * \a opener), makes its own deep copy of \a group and of \a calc,
+   * then for each of its frames updates the group's coordinates and
+   * calls the calculator.  The results are returned in the same order
+   * as \a frames, regardless of which thread computed them.
+   *
+   * The Calculator is a functor that defines its return type as
+   * result_type (which should not be bool, as std::vector<bool>
+   * cannot be safely written to by multiple threads) and provides
+   * \code
+   *   result_type operator()(AtomicGroup& group, const uint frame);
+   * \endcode
+   * Since each thread has its own copy of the calculator, it may
+   * keep scratch space in member variables, but must not modify
+   * anything shared between threads.
+   *
+   * If \a nthreads is zero, one thread per core is used.  If any
+   * thread encounters an error, a LOOSError is thrown after all
+   * threads have finished.
+   *
+   * Example:
+   * \code
+   *   struct Rgyr {
+   *     typedef double result_type;
+   *     double operator()(AtomicGroup& g, const uint frame) { return(g.radiusOfGyration()); }
+   *   };
+   *
+   *   TrajectoryOpener opener(traj_name, model);
+   *   std::vector<double> rgyr = parallelFrameMap(opener, subset, frames, Rgyr());
+   * \endcode
+   */
+  template<class Calculator>
+  std::vector<typename Calculator::result_type>
+  parallelFrameMap(const TrajectoryOpener& opener, const AtomicGroup& group,
+                   const std::vector<uint>& frames, const Calculator& calc,
+                   uint nthreads = 0) {
+    typedef internal::FrameWorker<Calculator>    Worker;
+
+    std::vector<typename Calculator::result_type> results(frames.size());
+    if (frames.empty())
+      return(results);
+
+    if (nthreads == 0)
+      nthreads = boost::thread::hardware_concurrency();
+    if (nthreads == 0)
+      nthreads = 1;
+    if (nthreads > frames.size())
+      nthreads = frames.size();
+
+    // Trajectories are opened here (rather than in the threads) so
+    // that any problems opening them are reported up front
+    std::vector<Worker> workers;
+    workers.reserve(nthreads);
+    uint block = frames.size() / nthreads;
+    uint extra = frames.size() % nthreads;
+    uint begin = 0;
+    for (uint i=0; i<nthreads; ++i) {
+      uint end = begin + block + (i < extra ? 1 : 0);
+      workers.push_back(Worker(opener(), group, calc, frames, begin, end, results));
+      begin = end;
+    }
+
+    boost::thread_group threads;
+    for (uint i=0; i<nthreads; ++i)
+      threads.create_thread(boost::ref(workers[i]));
+    threads.join_all();
+
+    for (uint i=0; i<nthreads; ++i)
+      if (!workers[i]._error.empty())
+        throw(LOOSError("Error while processing trajectory in parallel: " + workers[i]._error));
+
+    return(results);
+  }
+
+
+}
+
+
+#endif
@@ -0,0 +1,289 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstring>
+
+#include <PrefetchingTrajectory.hpp>
+#include <AtomicGroup.hpp>
+
+
+namespace loos {
+
+
+  PrefetchingTrajectory::PrefetchingTrajectory(const pTraj& traj, const uint lookahead)
+    : Trajectory(), _traj(traj), _description(traj->description()), _traj_filename(traj->filename()),
+      _natoms(traj->natoms()), _nframes(traj->nframes()), _timestep(traj->timestep()),
+      _velocity_factor(traj->velocityConversionFactor()),
+      _traj_periodic(traj->hasPeriodicBox()), _traj_velocities(traj->hasVelocities()),
+      _slots(lookahead + 1), _head(0), _count(0), _have_current(false), _head_frame(0),
+      _reader_done(true), _stop(false)
+  {
+    if (lookahead == 0)
+      throw(LOOSError("PrefetchingTrajectory must read ahead at least one frame"));
+
+    _filename = _traj_filename;
+    startReader(0);
+
+    // The destructor won't run if this throws, so the reader must be
+    // stopped here before it is left running on a dead object
+    try {
+      if (_nframes > 0 && !parseFrame())
+        throw(LOOSError("Cannot read first frame of trajectory during initialization"));
+    }
+    catch (...) {
+      boost::unique_lock<boost::mutex> lock(_mutex);
+      stopReader(lock);
+      throw;
+    }
+    cached_first = true;
+  }
+
+
+  PrefetchingTrajectory::~PrefetchingTrajectory() {
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    stopReader(lock);
+  }
+
+
+  // Must be called with the lock held.  The lock is released while
+  // waiting for the thread to finish.
+  void PrefetchingTrajectory::stopReader(boost::unique_lock<boost::mutex>& lock) {
+    _stop = true;
+    _cond.notify_all();
+    lock.unlock();
+    if (_thread.joinable())
+      _thread.join();
+    lock.lock();
+
+    _stop = false;
+    _head = _count = 0;
+    _have_current = false;
+  }
+
+
+  // Must be called with the reader stopped
+  void PrefetchingTrajectory::startReader(const uint frame) {
+    _head_frame = frame;
+    _reader_done = false;
+    _thread = boost::thread(&PrefetchingTrajectory::reader, this, frame);
+  }
+
+
+  // Background thread:  reads frames in order into free slots until
+  // told to stop, the end of the trajectory is reached, or there is
+  // an error (which is handed back to the caller via the slot)
+  void PrefetchingTrajectory::reader(const uint start) {
+    bool first = true;
+
+    for (uint frame = start; ; ++frame) {
+      uint k;
+      {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        while (!_stop && _count == _slots.size())
+          _cond.wait(lock);
+        if (_stop || frame >= _nframes) {
+          _reader_done = true;
+          return;
+        }
+        k = (_head + _count) % _slots.size();
+      }
+
+      // The slot is not visible to the caller until _count is bumped,
+      // so it can be filled without holding the lock
+      Slot& slot = _slots[k];
+      slot.error.clear();
+      try {
+        slot.ok = first ? _traj->readFrame(frame) : _traj->readFrame();
+        first = false;
+        if (slot.ok) {
+          slot.coords.removePeriodicBox();
+          _traj->updateArenaCoords(slot.coords);
+          slot.has_velocities = _traj->hasVelocities();
+          if (slot.has_velocities)
+            slot.velocities = _traj->velocities();
+        }
+      }
+      catch (std::exception& e) {
+        slot.ok = false;
+        slot.error = e.what();
+      }
+
+      boost::unique_lock<boost::mutex> lock(_mutex);
+      ++_count;
+      _cond.notify_all();
+      if (!slot.ok) {
+        _reader_done = true;
+        return;
+      }
+    }
+  }
+
+
+  // Must be called with the lock held
+  void PrefetchingTrajectory::releaseHead() {
+    _head = (_head + 1) % _slots.size();
+    --_count;
+    ++_head_frame;
+    _cond.notify_all();
+  }
+
+
+  bool PrefetchingTrajectory::parseFrame(void) {
+    if (_current_frame >= _nframes)
+      return(false);
+
+    boost::unique_lock<boost::mutex> lock(_mutex);
+
+    if (_have_current) {
+      if (_head_frame == _current_frame && _slots[_head].ok)
+        return(true);
+
+      // Done with the current frame, so hand its slot back to the reader
+      releaseHead();
+      _have_current = false;
+    }
+
+    // Frames a short distance ahead (e.g. when using a stride) are
+    // reached by discarding the intervening frames.  Anything else
+    // restarts the reader at the requested frame.
+    while (true) {
+      bool stalled = (_count == 0 && _reader_done);
+
+      if (_head_frame == _current_frame && !stalled) {
+        if (_count > 0)
+          break;
+        _cond.wait(lock);
+      } else if (_head_frame < _current_frame && _current_frame - _head_frame <= lookahead() && !stalled) {
+        if (_count > 0)
+          releaseHead();
+        else
+          _cond.wait(lock);
+      } else {
+        stopReader(lock);
+        startReader(_current_frame);
+      }
+    }
+    _have_current = true;
+
+    const Slot& slot = _slots[_head];
+    if (!slot.error.empty())
+      throw(LOOSError(slot.error));
+    return(slot.ok);
+  }
+
+
+
+  const PrefetchingTrajectory::Slot& PrefetchingTrajectory::current() const {
+    if (!_have_current)
+      throw(LOOSError("No frame has been read from the PrefetchingTrajectory"));
+    return(_slots[_head]);
+  }
+
+
+  // The read-ahead frames were read with the old subset, so they are
+  // discarded (keeping the current frame) and the reader is restarted
+  // by the next parseFrame()
+  void PrefetchingTrajectory::atomSubsetImpl() {
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    bool had_current = _have_current;
+    uint head = _head;
+    stopReader(lock);
+    if (had_current) {
+      _head = head;
+      _count = 1;
+      _have_current = true;
+    }
+
+    _traj->setAtomSubset(_atom_subset);
+  }
+
+
+  void PrefetchingTrajectory::seekFrameImpl(const uint i) {
+    if (i >= _nframes)
+      throw(LOOSError("Requested frame is out of range in PrefetchingTrajectory"));
+  }
+
+
+  bool PrefetchingTrajectory::hasPeriodicBox(void) const {
+    return(_have_current ? current().coords.isPeriodic() : _traj_periodic);
+  }
+
+
+  GCoord PrefetchingTrajectory::periodicBox(void) const {
+    return(current().coords.periodicBox());
+  }
+
+
+  bool PrefetchingTrajectory::hasVelocities() const {
+    return(_have_current ? current().has_velocities : _traj_velocities);
+  }
+
+
+  std::vector<GCoord> PrefetchingTrajectory::coords(void) const {
+    return(current().coords.coords());
+  }
+
+
+  std::vector<GCoord> PrefetchingTrajectory::velocitiesImpl() const {
+    return(current().velocities);
+  }
+
+
+  void PrefetchingTrajectory::updateGroupCoordsImpl(AtomicGroup& g) {
+    const CoordinateArena& crds = current().coords;
+
+    for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
+      uint idx = (*i)->index();
+      if (idx >= crds.size())
+        throw(LOOSError(**i, "Atom index into trajectory frame is out of bounds"));
+      (*i)->coords(crds.coords(idx));
+    }
+
+    if (crds.isPeriodic())
+      g.periodicBox(crds.periodicBox());
+  }
+
+
+  void PrefetchingTrajectory::updateGroupVelocitiesImpl(AtomicGroup& g) {
+    g.copyVelocitiesWithIndex(current().velocities);
+  }
+
+
+  void PrefetchingTrajectory::copyCoordsImpl(greal* x, greal* y, greal* z) const {
+    const CoordinateArena& crds = current().coords;
+    uint n = crds.size();
+    memcpy(x, crds.x(), n * sizeof(greal));
+    memcpy(y, crds.y(), n * sizeof(greal));
+    memcpy(z, crds.z(), n * sizeof(greal));
+  }
+
+
+  void PrefetchingTrajectory::updateArenaCoordsImpl(CoordinateArena& arena) {
+    const CoordinateArena& crds = current().coords;
+    if (arena.size() != crds.size())
+      arena.resize(crds.size());
+    copyCoordsImpl(arena.x(), arena.y(), arena.z());
+    if (crds.isPeriodic())
+      arena.periodicBox(crds.periodicBox());
+  }
+
+}
@@ -0,0 +1,162 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_PREFETCHING_TRAJECTORY_HPP)
+#define LOOS_PREFETCHING_TRAJECTORY_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <loos_defs.hpp>
+#include <Trajectory.hpp>
+#include <CoordinateArena.hpp>
+
+
+namespace loos {
+
+
+  //! Reads frames from another trajectory ahead of time in a background thread
+  /**
+   * A typical tool reads a frame, then computes something with it, so
+   * the time spent reading and decoding the trajectory is never
+   * overlapped with the analysis.  PrefetchingTrajectory wraps any
+   * pTraj (including a MultiTrajectory) and uses a background thread
+   * to read the next few frames into a ring of coordinate buffers
+   * while the caller works on the current frame.
+   *
+   * Reading frames in order (readFrame()) is served from the ring, as
+   * is reading frames a short distance ahead (such as when stepping
+   * through a trajectory with a stride).  Seeking anywhere else (via
+   * readFrame(i), seekFrame(), or rewind()) discards the buffered
+   * frames and restarts the read-ahead from the new position.
+   *
+   * The wrapped trajectory belongs to the background thread while
+   * the PrefetchingTrajectory exists, so it should not be used
+   * directly in the meantime.  An atom subset (see
+   * Trajectory::setAtomSubset()) is passed on to it, discarding any
+   * frames already read ahead.
+   *
+   * Example:
+   * \code
+   *   pTraj traj(new PrefetchingTrajectory(createTrajectory(fname, model), 4));
+   *   while (traj->readFrame()) {
+   *     traj->updateGroupCoords(model);
+   *     ...
+   *   }
+   * \endcode
+   */
+  class PrefetchingTrajectory : public Trajectory {
+
+    // A single buffered frame
+    struct Slot {
+      Slot() : ok(false), has_velocities(false) { }
+
+      bool ok;
+      std::string error;
+      CoordinateArena coords;
+      bool has_velocities;
+      std::vector<GCoord> velocities;
+    };
+
+  public:
+    //! Wrap \a traj, reading up to \a lookahead frames ahead of the current one
+    PrefetchingTrajectory(const pTraj& traj, const uint lookahead = 4);
+
+    virtual ~PrefetchingTrajectory();
+
+    virtual std::string description() const { return(_description + " (prefetched)"); }
+    virtual std::string filename() const { return(_traj_filename); }
+
+    virtual uint natoms(void) const { return(_natoms); }
+    virtual float timestep(void) const { return(_timestep); }
+    virtual uint nframes(void) const { return(_nframes); }
+
+    //! Whether the current frame has a periodic box
+    virtual bool hasPeriodicBox(void) const;
+    virtual GCoord periodicBox(void) const;
+
+    virtual bool hasVelocities() const;
+    virtual double velocityConversionFactor() const { return(_velocity_factor); }
+
+    virtual std::vector<GCoord> coords(void) const;
+
+    virtual bool parseFrame(void);
+
+    //! The trajectory being read from
+    pTraj wrappedTrajectory() const { return(_traj); }
+
+    //! Maximum number of frames read ahead of the current one
+    uint lookahead() const { return(_slots.size() - 1); }
+
+  private:
+    // Not copyable (owns a thread)
+    PrefetchingTrajectory(const PrefetchingTrajectory&);
+    PrefetchingTrajectory& operator=(const PrefetchingTrajectory&);
+
+    const Slot& current() const;
+
+    void releaseHead();
+    void startReader(const uint frame);
+    void stopReader(boost::unique_lock<boost::mutex>& lock);
+    void reader(const uint frame);
+
+    virtual void seekNextFrameImpl(void) { }
+    virtual void seekFrameImpl(const uint i);
+    virtual void rewindImpl(void) { }
+    virtual void updateGroupCoordsImpl(AtomicGroup& g);
+    virtual void updateGroupVelocitiesImpl(AtomicGroup& g);
+    virtual std::vector<GCoord> velocitiesImpl() const;
+    virtual void copyCoordsImpl(greal* x, greal* y, greal* z) const;
+    virtual void updateArenaCoordsImpl(CoordinateArena& arena);
+    virtual void atomSubsetImpl();
+
+
+    pTraj _traj;
+    std::string _description, _traj_filename;
+    uint _natoms, _nframes;
+    float _timestep;
+    double _velocity_factor;
+    bool _traj_periodic, _traj_velocities;
+
+    // The ring holds the current frame at _head, followed by up to
+    // (size-1) frames read ahead.  Only _count slots are valid.
+    std::vector<Slot> _slots;
+    uint _head, _count;
+    bool _have_current;
+    uint _head_frame;       // Frame that is (or will be) in the head slot
+    bool _reader_done;      // Reader thread has exited
+
+    boost::thread _thread;
+    mutable boost::mutex _mutex;
+    boost::condition_variable _cond;
+    bool _stop;
+  };
+
+}
+
+
+#endif
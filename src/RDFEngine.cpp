@@ -0,0 +1,392 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/thread/thread.hpp>
+
+#include <RDFEngine.hpp>
+#include <BatchDistance.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // Number of frames buffered per thread with FrameParallel
+    const uint frames_per_thread = 4;
+
+  }
+
+
+
+  // Each worker has its own histogram, along with its own cell list
+  // and scratch space for binning
+  class RDFEngine::Worker {
+  public:
+    Worker(const double hist_min, const double hist_max, const double width, const uint nbins)
+      : _min(hist_min), _min2(hist_min * hist_min), _max2(hist_max * hist_max),
+        _width(width), _nbins(nbins), _cells(hist_max),
+        _counts(nbins, 0)
+    { }
+
+
+    void frame(const Frame& f) {
+      _cells.build(f.b, f.box);
+      scan(_cells, f, 0, f.a.size());
+    }
+
+
+    // Histograms points begin through end-1 of f.a against the
+    // points in cells
+    void scan(const CellList& cells, const Frame& f, const uint begin, const uint end) {
+      for (uint j=begin; j<end; ++j) {
+        Block blk(this, f.a[j], f.box);
+        if (!f.skip_start.empty()) {
+          blk.skip_begin = &f.skip[0] + f.skip_start[j];
+          blk.skip_end = &f.skip[0] + f.skip_start[j+1];
+        }
+        cells.forEachCandidateBlock(f.a[j], blk);
+      }
+    }
+
+
+    void bin(const GCoord& p, const GCoord* q, const uint* index, const uint n, const GCoord& box,
+             const uint* skip_begin, const uint* skip_end) {
+      if (_d2.size() < n) {
+        _x.resize(n);
+        _y.resize(n);
+        _z.resize(n);
+        _d2.resize(n);
+        _bins.resize(n);
+      }
+      double* x = &_x[0];
+      double* y = &_y[0];
+      double* z = &_z[0];
+      double* d2 = &_d2[0];
+      int* bins = &_bins[0];
+
+      // Separate x, y, and z arrays vectorize far better than the
+      // interleaved coords
+      for (uint k=0; k<n; ++k) {
+        x[k] = q[k].x();
+        y[k] = q[k].y();
+        z[k] = q[k].z();
+      }
+
+      batch::distance2(p, x, y, z, n, box, d2);
+      if (skip_begin != skip_end)
+        for (uint k=0; k<n; ++k)
+          if (std::binary_search(skip_begin, skip_end, index[k]))
+            d2[k] = -1.0;
+
+      // Most of the candidates are out of range (the neighboring cells
+      // are much larger than the sphere within the cutoff), so the
+      // distances in range are packed together (without branching)
+      // before taking the square root
+      uint m = 0;
+      for (uint k=0; k<n; ++k) {
+        d2[m] = d2[k];
+        m += (d2[k] > _min2) & (d2[k] < _max2);
+      }
+
+      const int last = _nbins - 1;
+      for (uint k=0; k<m; ++k) {
+        int b = static_cast<int>((sqrt(d2[k]) - _min) / _width);
+        bins[k] = (b > last) ? last : b;
+      }
+
+      for (uint k=0; k<m; ++k)
+        ++_counts[bins[k]];
+    }
+
+
+    std::vector<ulong>& counts() { return(_counts); }
+
+    void clear() { std::fill(_counts.begin(), _counts.end(), 0); }
+
+
+  private:
+    // Passed to CellList::forEachCandidateBlock()
+    struct Block {
+      Block(Worker* w, const GCoord& p, const GCoord& box) : worker(w), p(p), box(box), skip_begin(0), skip_end(0) { }
+      void operator()(const GCoord* q, const uint* index, const uint n) {
+        worker->bin(p, q, index, n, box, skip_begin, skip_end);
+      }
+
+      Worker* worker;
+      const GCoord& p;
+      const GCoord& box;
+      const uint* skip_begin;
+      const uint* skip_end;
+    };
+
+
+    double _min, _min2, _max2, _width;
+    int _nbins;
+    CellList _cells;
+    std::vector<ulong> _counts;
+    std::vector<double> _x, _y, _z, _d2;
+    std::vector<int> _bins;
+  };
+
+
+
+  namespace {
+
+    template<class W, class F>
+    struct FrameJob {
+      FrameJob(W* w, const std::vector<F>* frames, const uint begin, const uint end)
+        : worker(w), frames(frames), begin(begin), end(end) { }
+
+      void operator()() {
+        for (uint k=begin; k<end; ++k)
+          worker->frame((*frames)[k]);
+      }
+
+      W* worker;
+      const std::vector<F>* frames;
+      uint begin, end;
+    };
+
+
+    template<class W, class F>
+    struct PairJob {
+      PairJob(W* w, const CellList* cells, const F* frame, const uint begin, const uint end)
+        : worker(w), cells(cells), frame(frame), begin(begin), end(end) { }
+
+      void operator()() {
+        worker->scan(*cells, *frame, begin, end);
+      }
+
+      W* worker;
+      const CellList* cells;
+      const F* frame;
+      uint begin, end;
+    };
+
+  }
+
+
+
+  RDFEngine::RDFEngine(const double hist_min, const double hist_max, const uint nbins)
+    : _min(hist_min), _max(hist_max), _width(0.0), _nbins(nbins), _nthreads(0),
+      _partition(FrameParallel), _planar(false), _npending(0), _cells(hist_max)
+  {
+    if (nbins == 0)
+      throw(LOOSError("An RDF must have at least one bin"));
+    if (!(hist_max > hist_min) || hist_min < 0.0)
+      throw(LOOSError("Invalid range for an RDF histogram"));
+
+    _width = (hist_max - hist_min) / nbins;
+    threads(1);
+  }
+
+
+  RDFEngine::~RDFEngine() {
+    for (uint i=0; i<_workers.size(); ++i)
+      delete _workers[i];
+  }
+
+
+  // Workers that are removed have their counts folded into the first
+  // one, so changing the number of threads doesn't lose anything
+  void RDFEngine::makeWorkers(const uint n) {
+    while (_workers.size() < n)
+      _workers.push_back(new Worker(_min, _max, _width, _nbins));
+
+    while (_workers.size() > n) {
+      Worker* w = _workers.back();
+      _workers.pop_back();
+      std::vector<ulong>& src = w->counts();
+      std::vector<ulong>& dst = _workers[0]->counts();
+      for (uint i=0; i<_nbins; ++i)
+        dst[i] += src[i];
+      delete w;
+    }
+  }
+
+
+  void RDFEngine::threads(const uint n, const Partition p) {
+    flush();
+
+    uint m = (n == 0) ? boost::thread::hardware_concurrency() : n;
+    if (m == 0)
+      m = 1;
+
+    makeWorkers(m);
+    _nthreads = m;
+    _partition = p;
+    _pending.resize(m > 1 && p == FrameParallel ? m * frames_per_thread : 0);
+  }
+
+
+  void RDFEngine::store(Frame& f, const std::vector<GCoord>& a, const std::vector<GCoord>& b, const GCoord& box,
+                        const std::vector< std::vector<uint> >& skip) const {
+    f.a = a;
+    f.b = b;
+    f.box = box;
+    if (_planar) {
+      for (uint i=0; i<f.a.size(); ++i)
+        f.a[i].z() = 0.0;
+      for (uint i=0; i<f.b.size(); ++i)
+        f.b[i].z() = 0.0;
+    }
+
+    f.skip_start.clear();
+    f.skip.clear();
+    if (!skip.empty()) {
+      f.skip_start.push_back(0);
+      for (uint j=0; j<skip.size(); ++j) {
+        f.skip.insert(f.skip.end(), skip[j].begin(), skip[j].end());
+        f.skip_start.push_back(f.skip.size());
+      }
+    }
+  }
+
+
+  ulong RDFEngine::addFrame(const std::vector<GCoord>& a, const std::vector<GCoord>& b, const GCoord& box,
+                            const std::vector< std::vector<uint> >& skip) {
+    if (!skip.empty() && skip.size() != a.size())
+      throw(LOOSError("The skip list for an RDF must have one entry for each point"));
+    for (uint i=0; i<3; ++i)
+      if (!(box[i] > 0.0))
+        throw(LOOSError("An RDF requires a periodic box with positive dimensions"));
+
+    ulong pairs = static_cast<ulong>(a.size()) * b.size();
+    for (uint j=0; j<skip.size(); ++j)
+      pairs -= skip[j].size();
+
+    if (a.empty() || b.empty())
+      return(pairs);
+
+    if (_nthreads == 1) {
+      store(_current, a, b, box, skip);
+      _workers[0]->frame(_current);
+    } else if (_partition == PairParallel) {
+      store(_current, a, b, box, skip);
+      processPairs(_current);
+    } else {
+      store(_pending[_npending++], a, b, box, skip);
+      if (_npending == _pending.size())
+        processPending();
+    }
+
+    return(pairs);
+  }
+
+
+  // Each thread gets a contiguous block of the buffered frames
+  void RDFEngine::processPending() {
+    typedef FrameJob<Worker, Frame>    Job;
+
+    uint n = std::min(_nthreads, _npending);
+    if (n <= 1) {
+      for (uint k=0; k<_npending; ++k)
+        _workers[0]->frame(_pending[k]);
+      _npending = 0;
+      return;
+    }
+
+    boost::thread_group threads;
+    uint block = _npending / n;
+    uint extra = _npending % n;
+    uint begin = 0;
+    for (uint i=0; i<n; ++i) {
+      uint end = begin + block + (i < extra ? 1 : 0);
+      threads.create_thread(Job(_workers[i], &_pending, begin, end));
+      begin = end;
+    }
+    threads.join_all();
+
+    _npending = 0;
+  }
+
+
+  // The cell list is shared and each thread gets a contiguous block
+  // of the points in f.a
+  void RDFEngine::processPairs(const Frame& f) {
+    typedef PairJob<Worker, Frame>    Job;
+
+    _cells.build(f.b, f.box);
+
+    uint m = f.a.size();
+    uint n = std::min(_nthreads, m);
+    if (n <= 1) {
+      _workers[0]->scan(_cells, f, 0, m);
+      return;
+    }
+
+    boost::thread_group threads;
+    uint block = m / n;
+    uint extra = m % n;
+    uint begin = 0;
+    for (uint i=0; i<n; ++i) {
+      uint end = begin + block + (i < extra ? 1 : 0);
+      threads.create_thread(Job(_workers[i], &_cells, &f, begin, end));
+      begin = end;
+    }
+    threads.join_all();
+  }
+
+
+  void RDFEngine::flush() {
+    if (_npending)
+      processPending();
+  }
+
+
+  std::vector<double> RDFEngine::histogram() {
+    flush();
+
+    std::vector<double> hist(_nbins, 0.0);
+    for (uint i=0; i<_workers.size(); ++i) {
+      const std::vector<ulong>& counts = _workers[i]->counts();
+      for (uint j=0; j<_nbins; ++j)
+        hist[j] += counts[j];
+    }
+
+    return(hist);
+  }
+
+
+  // Frames that have not been histogrammed yet are discarded too
+  void RDFEngine::clear() {
+    _npending = 0;
+    for (uint i=0; i<_workers.size(); ++i)
+      _workers[i]->clear();
+  }
+
+
+
+  RDFEngine::Partition parseRDFPartition(const std::string& s) {
+    if (s == "frames")
+      return(RDFEngine::FrameParallel);
+    else if (s == "pairs")
+      return(RDFEngine::PairParallel);
+
+    throw(LOOSError("Unknown RDF partition '" + s + "' (must be frames or pairs)"));
+  }
+
+}
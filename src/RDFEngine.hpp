@@ -0,0 +1,160 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_RDF_ENGINE_HPP)
+#define LOOS_RDF_ENGINE_HPP
+
+#include <string>
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Coord.hpp>
+#include <CellList.hpp>
+
+
+namespace loos {
+
+
+  //! Histograms the distances between two sets of points for radial distribution functions
+  /**
+   * Each frame consists of two sets of points (e.g. the centers of
+   * mass of the groups in each selection) and a periodic box.  The
+   * second set is placed in a CellList, and the distances from each
+   * point in the first set to the points in the neighboring cells are
+   * computed a cell at a time (see batch::distance2()), then binned.
+   * Distances use the minimum image convention (as with
+   * Coord::distance2(o, box)), and a distance d is counted in bin
+   * int((d - min) / width) if min^2 < d^2 < max^2.
+   *
+   * Pairs that should not be counted (e.g. a group against itself when
+   * the two selections overlap) are given as a list, for each point in
+   * the first set, of the indices into the second set to skip (see
+   * findIdenticalGroups()).
+   *
+   * With more than one thread, the work is divided either by frame or
+   * by pair.  With FrameParallel, frames are buffered as they are added
+   * and each thread histograms a share of the buffered frames.  This
+   * is best for long trajectories.  With PairParallel, each frame is
+   * histogrammed as it is added, with each thread taking a share of
+   * the points in the first set.  This is best for very large systems
+   * with few frames.  Either way, every thread has its own private
+   * histogram, so there is no contention, and the histograms are only
+   * merged when the result is requested.
+   *
+   * Example:
+   * \code
+   *   RDFEngine engine(0.0, 20.0, 40);
+   *   engine.threads(8);
+   *   while (traj->readFrame()) {
+   *     traj->updateGroupCoords(model);
+   *     for (uint i=0; i<n1; ++i) a[i] = g1[i].centerOfMass();
+   *     for (uint i=0; i<n2; ++i) b[i] = g2[i].centerOfMass();
+   *     pairs += engine.addFrame(a, b, model.periodicBox(), overlap);
+   *   }
+   *   std::vector<double> hist = engine.histogram();
+   * \endcode
+   */
+  class RDFEngine {
+  public:
+    enum Partition { FrameParallel, PairParallel };
+
+    //! Histogram from \a hist_min to \a hist_max with \a nbins bins
+    RDFEngine(const double hist_min, const double hist_max, const uint nbins);
+
+    ~RDFEngine();
+
+    //! Use \a n threads (0 = one per core), dividing the work as given by \a p
+    void threads(const uint n, const Partition p = FrameParallel);
+    uint threads() const { return(_nthreads); }
+    Partition partition() const { return(_partition); }
+
+    //! Only use the x and y coordinates (i.e. a 2D RDF)
+    void planar(const bool b) { _planar = b; }
+    bool planar() const { return(_planar); }
+
+    uint bins() const { return(_nbins); }
+    double binWidth() const { return(_width); }
+
+    //! Adds the distances from each of \a a to each of \a b
+    /**
+     * \a skip, if not empty, lists the (sorted) indices into \a b to
+     * skip for each point of \a a.  Returns the number of pairs that
+     * were considered (i.e. excluding the skipped ones), for
+     * normalizing the RDF.
+     */
+    ulong addFrame(const std::vector<GCoord>& a, const std::vector<GCoord>& b, const GCoord& box,
+                   const std::vector< std::vector<uint> >& skip = std::vector< std::vector<uint> >());
+
+    //! Finishes any frames that are waiting to be histogrammed
+    void flush();
+
+    //! Counts for each bin (for all frames added since the last clear())
+    std::vector<double> histogram();
+
+    //! Zeroes the histogram (discarding any frames not yet histogrammed)
+    void clear();
+
+
+  private:
+    struct Frame {
+      std::vector<GCoord> a, b;
+      GCoord box;
+      std::vector<uint> skip_start, skip;
+    };
+
+    class Worker;
+
+    void store(Frame& f, const std::vector<GCoord>& a, const std::vector<GCoord>& b, const GCoord& box,
+               const std::vector< std::vector<uint> >& skip) const;
+    void processPending();
+    void processPairs(const Frame& f);
+    void makeWorkers(const uint n);
+
+    RDFEngine(const RDFEngine&);
+    RDFEngine& operator=(const RDFEngine&);
+
+  private:
+    double _min, _max, _width;
+    uint _nbins;
+    uint _nthreads;
+    Partition _partition;
+    bool _planar;
+
+    std::vector<Worker*> _workers;
+    std::vector<Frame> _pending;
+    uint _npending;
+    Frame _current;
+    CellList _cells;
+  };
+
+
+  //! Converts the name of a partition ("frames" or "pairs") into a RDFEngine::Partition
+  /**
+   * Throws a LOOSError if the name is not recognized
+   */
+  RDFEngine::Partition parseRDFPartition(const std::string& s);
+
+}
+
+
+#endif
@@ -124,19 +124,27 @@ namespace loos {
 
 
   bool BackboneSelector::operator()(const pAtom& pa) const {
-    if (std::binary_search(residue_names, residue_names + nresnames, pa->resname()))
-      if (std::binary_search(atom_names, atom_names + natomnames, pa->name()))
+    if (isBackboneResidue(pa->resname()))
+      if (isBackboneName(pa->name()))
         return(true);
 
     return(false);
   }
 
+  bool BackboneSelector::isBackboneResidue(const std::string& resname) {
+    return(std::binary_search(residue_names, residue_names + nresnames, resname));
+  }
+
+  bool BackboneSelector::isBackboneName(const std::string& name) {
+    return(std::binary_search(atom_names, atom_names + natomnames, name));
+  }
+
   bool SegidSelector::operator()(const pAtom& pa) const {
-    return(pa->segid() == str);
+    return(pa->segidHandle() == handle);
   }
 
   bool AtomNameSelector::operator()(const pAtom& pa) const {
-    return(pa->name() == str);
+    return(pa->nameHandle() == handle);
   }
 
   bool ResidRangeSelector::operator()(const pAtom& pa) const {
@@ -159,7 +167,7 @@ namespace loos {
     if (pa->checkProperty(Atom::massbit))
       masscheck = (pa->mass() < 1.1);
     
-    std::string n = pa->name();
+    const std::string& n = pa->name();
     return( (n[0] == 'H') && masscheck );
   }
 
@@ -59,24 +59,32 @@ namespace loos {
 
   public:
     bool operator()(const pAtom&) const;
+
+    //! True if \a resname is one of the residues that have a backbone
+    static bool isBackboneResidue(const std::string& resname);
+
+    //! True if \a name is one of the backbone atom names
+    static bool isBackboneName(const std::string& name);
   };
 
 
   //! Predicate for selecting atoms based on the passed segid string
   struct SegidSelector : public AtomSelector {
-    explicit SegidSelector(const std::string s) : str(s) { }
+    explicit SegidSelector(const std::string s) : str(s), handle(s) { }
     bool operator()(const pAtom&) const;
 
     std::string str;
+    InternedString handle;
   };
 
 
   //! Predicate for selecting atoms based on explicit name matching
   struct AtomNameSelector : public AtomSelector {
-    explicit AtomNameSelector(const std::string& s) : str(s) { }
+    explicit AtomNameSelector(const std::string& s) : str(s), handle(s) { }
     bool operator()(const pAtom&) const;
 
     std::string str;
+    InternedString handle;
   };
 
 
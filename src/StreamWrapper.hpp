@@ -32,6 +32,7 @@
 
 #include <boost/utility.hpp>
 #include <exceptions.hpp>
+#include <CompressedStream.hpp>
 
 
 namespace loos {
@@ -49,6 +50,9 @@ namespace loos {
    *  pass the wrapper an fstream, however, the internal pointer is
    *  initialized to point to that stream and when the wrapper object is
    *  destroyed, the stream is left alone.
+   *
+   *  Files opened only for reading may be compressed (see
+   *  openInputStream()).
    */
   class StreamWrapper : public boost::noncopyable {
   public:
@@ -63,9 +67,7 @@ namespace loos {
       throw(FileOpenError)
       : new_stream(true)
     {
-      stream = new std::fstream(s.c_str(), mode);
-      if (!stream->good())
-        throw(FileOpenError(s));
+      stream = open(s, mode);
     }
 
     //! Sets the internal stream to point to a newly opened filed...
@@ -77,9 +79,7 @@ namespace loos {
         delete stream;
 
       new_stream = true;
-      stream = new std::fstream(s.c_str(), mode);
-      if (!stream->good())
-        throw(FileOpenError(s));
+      stream = open(s, mode);
     }
 
     //! Sets the internal stream to the passed fstream.
@@ -104,6 +104,19 @@ namespace loos {
 
 
   private:
+    // Files opened only for reading are decompressed if necessary
+    static std::istream* open(const std::string& s, const std::ios_base::openmode mode) {
+      if (!(mode & std::ios_base::out))
+        return(newInputStream(s));
+
+      std::istream* fs = new std::fstream(s.c_str(), mode);
+      if (!fs->good()) {
+        delete fs;
+        throw(FileOpenError(s));
+      }
+      return(fs);
+    }
+
     bool new_stream;
     std::istream* stream;
   };
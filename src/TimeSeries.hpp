@@ -33,6 +33,7 @@
 #include <sstream>
 
 #include <loos_defs.hpp>
+#include <Correlation.hpp>
 
 namespace loos {
 
@@ -465,54 +466,101 @@ public:
       return (block_ave2 - block_ave*block_ave)*ratio;
     }
 
+    //! Return the autocorrelation of the time series
+    /** The correlation is computed for every \a interval'th lag less
+     * than \a max_time, with each lag averaged over all of the pairs
+     * of points that far apart.  With \a normalize, the mean is
+     * removed and the series scaled to unit variance first (so the
+     * correlation starts at 1), and a constant series (standard
+     * deviation less than \a tol) is taken to be perfectly correlated.
+     *
+     * All of the lags are computed at once by FFT, so this takes
+     * O(N log N) time rather than O(N*max_time).
+     */
     TimeSeries<T> correl(const int max_time, 
                          const int interval=1, 
                          const bool normalize=true,
                          T tol=1.0e-8) const {
 
-      TimeSeries<T> data = copy();
       uint n = abs(max_time);
-      if (n > data.size()) {
+      if (n > _data.size()) {
         throw(std::runtime_error("Can't take correlation time longer than time series"));
       }
 
-      n /= interval;
-      TimeSeries<T> c(n, 0.0);
-
-      // normalize the data
-      if (normalize) {
-          data -= data.average();
-          T dev = data.stdev();
-            
-          // drop through if this is a constant array
-          if (dev < tol) {
-            c._data.assign(n, 1.0);
-            return(c);
-          }
-            
-          data /= dev;
-      }
-
-      std::vector<int> num_pairs(n);
-      num_pairs.assign(n, 0);
-      // TODO: This is the O(N^2) way -- there are much faster
-      // algorithms for long time series
-      for (int i = 0; i < max_time; i+=interval) {
-        int index = i / interval;
-        for (unsigned int j = 0; j < data.size() - i; j++) {
-          c[index] += data[j] * data[j+i];
-          num_pairs[index]++;
-        }
+      std::vector<double> data;
+      if (!prepareCorrel(data, normalize, tol))
+        return(TimeSeries<T>(n / interval, 1.0));
+
+      return(lagAverages(correlation::autocorrelation(data, n), n, interval));
+    }
+
+    //! Return the cross-correlation with another time series of the same length
+    /** Lag k is the average of this[t] * other[t+k], and lags are
+     * otherwise as in correl().  If either series is constant, the
+     * normalized cross-correlation is taken to be zero.
+     */
+    TimeSeries<T> crosscorrel(const TimeSeries<T>& other,
+                              const int max_time,
+                              const int interval=1,
+                              const bool normalize=true,
+                              T tol=1.0e-8) const {
 
+      if (_data.size() != other.size())
+        throw(std::runtime_error("mismatched timeseries sizes in crosscorrel"));
+      uint n = abs(max_time);
+      if (n > _data.size()) {
+        throw(std::runtime_error("Can't take correlation time longer than time series"));
       }
 
-      // Divide each value by the number of pairs used to generated it
-      for (uint i = 0; i < n; i++) {
-        c[i] /= num_pairs[i];
+      std::vector<double> x, y;
+      if (!prepareCorrel(x, normalize, tol) || !other.prepareCorrel(y, normalize, tol))
+        return(TimeSeries<T>(n / interval, 0.0));
+
+      return(lagAverages(correlation::crossCorrelation(x, y, n), n, interval));
+    }
+
+#if !defined(SWIG)
+    //! Return the autocorrelations of many time series at once, as with correl()
+    /** The series are divided among \a nthreads threads (0 means one
+     * per core).  They may be of different lengths, but \a max_time
+     * must not be longer than any of them.
+     */
+    static std::vector< TimeSeries<T> > batch_correl(const std::vector< TimeSeries<T> >& series,
+                                                     const int max_time,
+                                                     const int interval=1,
+                                                     const bool normalize=true,
+                                                     T tol=1.0e-8,
+                                                     const uint nthreads=0) {
+      uint n = abs(max_time);
+
+      // Constant series are left as all 1's
+      std::vector< std::vector<double> > data;
+      std::vector<uint> which;
+      for (uint i=0; i<series.size(); ++i) {
+        if (n > series[i].size())
+          throw(std::runtime_error("Can't take correlation time longer than time series"));
+        std::vector<double> d;
+        if (series[i].prepareCorrel(d, normalize, tol)) {
+          data.push_back(d);
+          which.push_back(i);
+        }
       }
 
-      return(c);
+      std::vector< std::vector<double> > c = correlation::autocorrelations(data, n, nthreads);
+
+      // Built in order (rather than assigned into) since TimeSeries
+      // has no copy assignment of its own
+      std::vector< TimeSeries<T> > results;
+      results.reserve(series.size());
+      for (uint i=0, k=0; i<series.size(); ++i)
+        if (k < which.size() && which[k] == i)
+          results.push_back(series[i].lagAverages(c[k++], n, interval));
+        else
+          results.push_back(TimeSeries<T>(n / interval, 1.0));
+
+      return(results);
     }
+#endif // !defined(SWIG)
 
   // Vector interface...
   void push_back(const T& x) { _data.push_back(x); }
@@ -527,6 +575,36 @@ public:
 
 
 private:
+
+    // Copies the data for correlating, normalizing if requested.
+    // Returns false if the normalized series would be constant.
+    bool prepareCorrel(std::vector<double>& data, const bool normalize, const T tol) const {
+      data.assign(_data.begin(), _data.end());
+      if (!normalize)
+        return(true);
+
+      TimeSeries<double> d(data);
+      d -= d.average();
+      double dev = d.stdev();
+      if (dev < tol)
+        return(false);
+
+      d /= dev;
+      data.assign(d.begin(), d.end());
+      return(true);
+    }
+
+    // Divides the raw correlation sums at every interval'th lag by the
+    // number of pairs in each
+    TimeSeries<T> lagAverages(const std::vector<double>& sums, const uint n, const int interval) const {
+      TimeSeries<T> c(n / interval, 0.0);
+      for (uint i=0; i<c.size(); ++i) {
+        uint lag = i * interval;
+        c[i] = sums[lag] / (_data.size() - lag);
+      }
+      return(c);
+    }
+
     std::vector<T> _data;
 };
 
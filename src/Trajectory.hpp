@@ -22,6 +22,7 @@
 #if !defined(LOOS_TRAJECTORY_HPP)
 #define LOOS_TRAJECTORY_HPP
 
+#include <algorithm>
 #include <istream>
 #include <string>
 #include <stdexcept>
@@ -32,8 +33,8 @@
 
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
-
-#include <AtomicGroup.hpp>
+#include <CoordinateArena.hpp>
+#include <CompressedStream.hpp>
 
 
 namespace loos {
@@ -83,7 +84,8 @@ namespace loos {
 		}
 
 
-		Trajectory(const Trajectory& t) : ifs(t.ifs), cached_first(t.cached_first), _filename(t._filename), _current_frame(t._current_frame)
+		Trajectory(const Trajectory& t) : ifs(t.ifs), cached_first(t.cached_first), _filename(t._filename), _current_frame(t._current_frame),
+		                                  _atom_subset(t._atom_subset)
 		{
 		}
 
@@ -174,6 +176,30 @@ namespace loos {
 
 
 
+		//! Copy the current frame's coordinates into caller-provided arrays
+		/** The arrays are in structure-of-arrays form and must each
+		 * hold at least natoms() elements.  Unlike coords(), this does
+		 * not build a temporary vector, and formats that store their
+		 * frames de-interleaved (such as DCDs) copy straight from their
+		 * internal frame buffer.
+		 */
+		void copyCoords(greal* x, greal* y, greal* z) const {
+			copyCoordsImpl(x, y, z);
+		}
+
+
+		//! Update a CoordinateArena with the current frame
+		/** The arena is indexed the same way as the trajectory frame,
+		 * so it will be resized to natoms() if necessary (this only
+		 * happens on the first frame).  The periodic box, if present,
+		 * is also copied.  No memory is allocated once the arena has
+		 * been sized.
+		 */
+		void updateArenaCoords(CoordinateArena& arena) {
+			updateArenaCoordsImpl(arena);
+		}
+
+
 		//! Returns the current frame's velocities as a vector of GCoords
 		/**
 		 * If the trajectory format supports velocities "natively", then those will
@@ -212,6 +238,43 @@ namespace loos {
 		}
 
 
+		//! Only read the atoms in \a g from now on
+		/** Formats that can seek within a frame (DCD and TRR) will then
+		 * only read the parts of each frame holding these atoms.  For a
+		 * small selection, such as the CA atoms of a solvated protein,
+		 * this reads a small fraction of the file.  The coordinates of
+		 * atoms outside the subset are left unspecified, so only groups
+		 * within the subset should be passed to updateGroupCoords().
+		 * Other formats ignore the subset and read every atom.  An empty
+		 * group goes back to reading every atom.  The subset takes
+		 * effect with the next frame read.
+		 */
+		void setAtomSubset(const AtomicGroup& g) {
+			std::vector<uint> indices(g.size());
+			for (uint i=0; i<g.size(); ++i)
+				indices[i] = g[i]->index();
+			setAtomSubset(indices);
+		}
+
+		//! Only read the atoms with the given indices (see above)
+		/** Throws a LOOSError, leaving the current subset in place, if
+		 * any index is past the end of a frame.
+		 */
+		void setAtomSubset(const std::vector<uint>& indices) {
+			std::vector<uint> subset(indices);
+			std::sort(subset.begin(), subset.end());
+			subset.erase(std::unique(subset.begin(), subset.end()), subset.end());
+			if (!subset.empty() && subset.back() >= natoms())
+				throw(LOOSError("Atom subset is out of range for trajectory '" + _filename + "'"));
+
+			_atom_subset.swap(subset);
+			atomSubsetImpl();
+		}
+
+		//! Indices of the atoms being read (empty if all are)
+		const std::vector<uint>& atomSubset() const { return(_atom_subset); }
+
+
 		//! Seek to the next frame in the sequence (used by readFrame() when
 		//! operating as an iterator).
 		void seekNextFrame(void) {
@@ -280,9 +343,7 @@ namespace loos {
 		void setInputStream(const std::string& fname) throw(FileOpenError)
 		{
 			_filename = fname;
-			ifs = pStream(new std::fstream(fname.c_str(), std::ios_base::in | std::ios_base::binary));
-			if (!ifs->good())
-				throw(FileOpenError(fname));
+			ifs = openInputStream(fname);     // Decompresses, if necessary
 		}
 
 
@@ -293,6 +354,29 @@ namespace loos {
 		}
 
 
+		// A contiguous run of atoms [first, first+count) in a frame
+		struct AtomRun {
+			AtomRun(const uint f, const uint n) : first(f), count(n) { }
+			uint first, count;
+		};
+
+		//! Runs of atoms covering the subset, for formats that read partial frames
+		/** Runs separated by less than \a gap atoms are merged, since
+		 * reading through a small gap is cheaper than seeking past it.
+		 */
+		std::vector<AtomRun> atomRuns(const uint gap) const {
+			std::vector<AtomRun> runs;
+			for (uint i=0; i<_atom_subset.size(); ++i) {
+				uint k = _atom_subset[i];
+				if (!runs.empty() && k - (runs.back().first + runs.back().count) <= gap)
+					runs.back().count = k - runs.back().first + 1;
+				else
+					runs.push_back(AtomRun(k, 1));
+			}
+			return(runs);
+		}
+
+
 
 
 		pStream ifs;
@@ -301,6 +385,7 @@ namespace loos {
 
 		std::string _filename;   // Remember filename (if passed)
 		uint _current_frame;
+		std::vector<uint> _atom_subset;   // Sorted, or empty to read all atoms
 
 	private:
 
@@ -313,9 +398,31 @@ namespace loos {
 		//! NVI implementation of rewind
 		virtual void rewindImpl(void) =0;
 
+		//! Called when the atom subset changes.  Formats that cannot read partial frames ignore it
+		virtual void atomSubsetImpl() { }
+
 		//! NVI implementation of updateGroupCoords() for derived classes to override
 		virtual void updateGroupCoordsImpl(AtomicGroup& g) =0;
 
+		//! NVI implementation of copyCoords().  The default goes through coords()
+		virtual void copyCoordsImpl(greal* x, greal* y, greal* z) const {
+			std::vector<GCoord> crds = coords();
+			for (uint i=0; i<crds.size(); ++i) {
+				x[i] = crds[i].x();
+				y[i] = crds[i].y();
+				z[i] = crds[i].z();
+			}
+		}
+
+		//! NVI implementation of updateArenaCoords()
+		virtual void updateArenaCoordsImpl(CoordinateArena& arena) {
+			if (arena.size() != natoms())
+				arena.resize(natoms());
+			copyCoordsImpl(arena.x(), arena.y(), arena.z());
+			if (hasPeriodicBox())
+				arena.periodicBox(periodicBox());
+		}
+
 		virtual void updateGroupVelocitiesImpl(AtomicGroup& g) {
 			throw(LOOSError("No velocity update implementation defined but trajectory supports it"));
 		}
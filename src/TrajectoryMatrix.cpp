@@ -0,0 +1,92 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <TrajectoryMatrix.hpp>
+#include <exceptions.hpp>
+
+
+namespace loos {
+
+
+  TrajectoryMatrix::TrajectoryMatrix(const AtomicGroup& subset, pTraj traj)
+    : _subset(subset.copy()), _traj(traj)
+  {
+    for (uint i=0; i<traj->nframes(); ++i)
+      _indices.push_back(i);
+  }
+
+
+  TrajectoryMatrix::TrajectoryMatrix(const AtomicGroup& subset, pTraj traj, const std::vector<uint>& indices)
+    : _subset(subset.copy()), _traj(traj), _indices(indices)
+  {
+    checkIndices();
+  }
+
+
+  TrajectoryMatrix::TrajectoryMatrix(const AtomicGroup& subset, pTraj traj, const std::vector<uint>& indices, const std::vector<XForm>& xforms)
+    : _subset(subset.copy()), _traj(traj), _indices(indices), _xforms(xforms)
+  {
+    if (_xforms.size() != _indices.size())
+      throw(LOOSError("Mismatch in number of frames requested and passed transforms for TrajectoryMatrix"));
+    checkIndices();
+  }
+
+
+  void TrajectoryMatrix::checkIndices() const {
+    for (uint i=0; i<_indices.size(); ++i)
+      if (_indices[i] >= _traj->nframes())
+        throw(LOOSError("Frame index exceeds trajectory size"));
+  }
+
+
+  void TrajectoryMatrix::average(const AtomicGroup& avg) {
+    if (avg.size() != _subset.size())
+      throw(LOOSError("Average structure does not match the size of the TrajectoryMatrix"));
+    _avg = avg.coordsAsVector();
+  }
+
+
+  DoubleMatrix TrajectoryMatrix::columns(const uint begin, const uint end) {
+    if (begin > end || end > _indices.size())
+      throw(LOOSError("Invalid range of columns for TrajectoryMatrix"));
+
+    uint n = _subset.size();
+    DoubleMatrix C(3 * n, end - begin);
+
+    for (uint i=begin; i<end; ++i) {
+      _traj->readFrame(_indices[i]);
+      _traj->updateGroupCoords(_subset);
+      if (!_xforms.empty())
+        _subset.applyTransform(_xforms[i]);
+
+      for (uint j=0; j<n; ++j) {
+        const GCoord& c = _subset[j]->coords();
+        for (uint k=0; k<3; ++k)
+          C(3*j+k, i-begin) = _avg.empty() ? c[k] : c[k] - _avg[3*j+k];
+      }
+    }
+
+    return(C);
+  }
+
+
+}
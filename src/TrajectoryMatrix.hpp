@@ -0,0 +1,91 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_TRAJECTORY_MATRIX_HPP)
+#define LOOS_TRAJECTORY_MATRIX_HPP
+
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <MatrixImpl.hpp>
+#include <MatrixOps.hpp>
+#include <AtomicGroup.hpp>
+#include <Trajectory.hpp>
+#include <XForm.hpp>
+
+
+namespace loos {
+
+
+  //! The 3N x T coordinate matrix of a trajectory, read on demand
+  /**
+   * Each column holds the (x,y,z) coordinates of the atoms in \a subset
+   * for one of the requested frames, optionally transformed (e.g. by
+   * the result of an iterative alignment) and with an average
+   * structure subtracted.  Only the frames for the block of columns
+   * being requested are read, so the whole matrix never has to be in
+   * memory.  This is the source the truncated SVDs (see
+   * Math::svd(Math::ColumnSource&, ...) and Math::IncrementalSVD) use to
+   * compute a PCA of a trajectory.
+   *
+   * Example:
+   * \code
+   *   TrajectoryMatrix A(subset, traj, indices, xforms);
+   *   A.average(averageStructure(subset, xforms, traj, indices));
+   *   boost::tuple<DoubleMatrix, DoubleMatrix, DoubleMatrix> res = Math::svd(A, 20);
+   * \endcode
+   */
+  class TrajectoryMatrix : public Math::ColumnSource {
+  public:
+    //! Uses all frames in \a traj
+    TrajectoryMatrix(const AtomicGroup& subset, pTraj traj);
+
+    TrajectoryMatrix(const AtomicGroup& subset, pTraj traj, const std::vector<uint>& indices);
+
+    //! Each frame is transformed by the corresponding element of \a xforms
+    TrajectoryMatrix(const AtomicGroup& subset, pTraj traj, const std::vector<uint>& indices, const std::vector<XForm>& xforms);
+
+    //! Subtract the coordinates of \a avg from every column
+    void average(const AtomicGroup& avg);
+
+    uint rows() const { return(3 * _subset.size()); }
+    uint cols() const { return(_indices.size()); }
+
+    DoubleMatrix columns(const uint begin, const uint end);
+
+  private:
+    void checkIndices() const;
+
+  private:
+    AtomicGroup _subset;
+    pTraj _traj;
+    std::vector<uint> _indices;
+    std::vector<XForm> _xforms;
+    std::vector<double> _avg;
+  };
+
+
+}
+
+
+#endif
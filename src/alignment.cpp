@@ -5,6 +5,7 @@
 
 #include <ensembles.hpp>
 #include <alignment.hpp>
+#include <CoordinateEnsemble.hpp>
 
 #include <cmath>
 
@@ -16,6 +17,315 @@ namespace loos {
   namespace alignment {
 
 
+    namespace {
+
+      SuperpositionMethod superposition_method = QCPSuperposition;
+
+      // Convergence criteria for the QCP eigenvalue and eigenvector,
+      // and the smallest eigenvalue gap (all relative to E0) before the
+      // input is treated as degenerate
+      const double qcp_eval_precision = 1e-11;
+      const double qcp_evec_precision = 1e-6;
+      const double qcp_gap_precision = 1e-6;
+
+
+      GCoord coordCenter(const vecDouble& v) {
+        GCoord c;
+
+        for (uint i=0; i<v.size(); i += 3) {
+          c.x() += v[i];
+          c.y() += v[i+1];
+          c.z() += v[i+2];
+        }
+
+        for (uint i=0; i<3; ++i)
+          c[i] = 3*c[i]/v.size();
+
+        return c;
+      }
+
+
+      // Accumulates the inner products needed by QCP in a single pass
+      // over the (centered) coordinates.  A[i*3+j] is the correlation
+      // between the ith component of V and the jth component of U.
+      // Returns E0, half the sum of the squared coordinates.
+      double qcpInnerProducts(const vecDouble& U, const vecDouble& V, double* A) {
+        double a0 = 0.0, a1 = 0.0, a2 = 0.0, a3 = 0.0, a4 = 0.0, a5 = 0.0, a6 = 0.0, a7 = 0.0, a8 = 0.0;
+        double g = 0.0;
+
+        const double* u = &(U[0]);
+        const double* v = &(V[0]);
+        uint n = U.size();
+        for (uint k=0; k<n; k += 3) {
+          double ux = u[k], uy = u[k+1], uz = u[k+2];
+          double vx = v[k], vy = v[k+1], vz = v[k+2];
+
+          g += ux*ux + uy*uy + uz*uz + vx*vx + vy*vy + vz*vz;
+          a0 += vx * ux;  a1 += vx * uy;  a2 += vx * uz;
+          a3 += vy * ux;  a4 += vy * uy;  a5 += vy * uz;
+          a6 += vz * ux;  a7 += vz * uy;  a8 += vz * uz;
+        }
+
+        A[0] = a0;  A[1] = a1;  A[2] = a2;
+        A[3] = a3;  A[4] = a4;  A[5] = a5;
+        A[6] = a6;  A[7] = a7;  A[8] = a8;
+
+        return(0.5 * g);
+      }
+
+
+      // As above, but subtracts the centers of U and V along the way
+      // rather than requiring centered copies
+      double qcpInnerProducts(const vecDouble& U, const vecDouble& V, const GCoord& cu, const GCoord& cv, double* A) {
+        double a0 = 0.0, a1 = 0.0, a2 = 0.0, a3 = 0.0, a4 = 0.0, a5 = 0.0, a6 = 0.0, a7 = 0.0, a8 = 0.0;
+        double g = 0.0;
+
+        const double* u = &(U[0]);
+        const double* v = &(V[0]);
+        uint n = U.size();
+        for (uint k=0; k<n; k += 3) {
+          double ux = u[k] - cu[0], uy = u[k+1] - cu[1], uz = u[k+2] - cu[2];
+          double vx = v[k] - cv[0], vy = v[k+1] - cv[1], vz = v[k+2] - cv[2];
+
+          g += ux*ux + uy*uy + uz*uz + vx*vx + vy*vy + vz*vz;
+          a0 += vx * ux;  a1 += vx * uy;  a2 += vx * uz;
+          a3 += vy * ux;  a4 += vy * uy;  a5 += vy * uz;
+          a6 += vz * ux;  a7 += vz * uy;  a8 += vz * uz;
+        }
+
+        A[0] = a0;  A[1] = a1;  A[2] = a2;
+        A[3] = a3;  A[4] = a4;  A[5] = a5;
+        A[6] = a6;  A[7] = a7;  A[8] = a8;
+
+        return(0.5 * g);
+      }
+
+
+      // Finds the largest eigenvalue of the QCP key matrix by
+      // Newton-Raphson on its characteristic polynomial, starting
+      // from the upper bound E0.  See Theobald, Acta Cryst. A61:478
+      // (2005) and Liu et al, J. Comput. Chem. 31:1561 (2010).
+      //
+      // The polynomial is solved in units of E0 so the tolerances are
+      // relative.  Returns false if the largest root is (nearly)
+      // repeated, as with collinear coordinates, where Newton-Raphson
+      // stalls in roundoff and the eigenvector is not unique.
+      bool qcpMaxEigenvalue(const double* A, const double E0, double& lambda) {
+        lambda = E0;
+        if (!(E0 > 0.0))
+          return(false);
+
+        double s = 1.0 / E0;
+        double Sxx = A[0] * s, Sxy = A[1] * s, Sxz = A[2] * s;
+        double Syx = A[3] * s, Syy = A[4] * s, Syz = A[5] * s;
+        double Szx = A[6] * s, Szy = A[7] * s, Szz = A[8] * s;
+
+        double Sxx2 = Sxx * Sxx, Syy2 = Syy * Syy, Szz2 = Szz * Szz;
+        double Sxy2 = Sxy * Sxy, Syz2 = Syz * Syz, Sxz2 = Sxz * Sxz;
+        double Syx2 = Syx * Syx, Szy2 = Szy * Szy, Szx2 = Szx * Szx;
+
+        double SyzSzymSyySzz2 = 2.0 * (Syz*Szy - Syy*Szz);
+        double Sxx2Syy2Szz2Syz2Szy2 = Syy2 + Szz2 - Sxx2 + Syz2 + Szy2;
+
+        double C2 = -2.0 * (Sxx2 + Syy2 + Szz2 + Sxy2 + Syx2 + Sxz2 + Szx2 + Syz2 + Szy2);
+        double C1 = 8.0 * (Sxx*Syz*Szy + Syy*Szx*Sxz + Szz*Sxy*Syx - Sxx*Syy*Szz - Syz*Szx*Sxy - Szy*Syx*Sxz);
+
+        double SxzpSzx = Sxz + Szx, SyzpSzy = Syz + Szy, SxypSyx = Sxy + Syx;
+        double SyzmSzy = Syz - Szy, SxzmSzx = Sxz - Szx, SxymSyx = Sxy - Syx;
+        double SxxpSyy = Sxx + Syy, SxxmSyy = Sxx - Syy;
+        double Sxy2Sxz2Syx2Szx2 = Sxy2 + Sxz2 - Syx2 - Szx2;
+
+        double C0 = Sxy2Sxz2Syx2Szx2 * Sxy2Sxz2Syx2Szx2
+          + (Sxx2Syy2Szz2Syz2Szy2 + SyzSzymSyySzz2) * (Sxx2Syy2Szz2Syz2Szy2 - SyzSzymSyySzz2)
+          + (-SxzpSzx*SyzmSzy + SxymSyx*(SxxmSyy - Szz)) * (-SxzmSzx*SyzpSzy + SxymSyx*(SxxmSyy + Szz))
+          + (-SxzpSzx*SyzpSzy - SxypSyx*(SxxpSyy - Szz)) * (-SxzmSzx*SyzmSzy - SxypSyx*(SxxpSyy + Szz))
+          + (SxypSyx*SyzpSzy + SxzpSzx*(SxxmSyy + Szz)) * (-SxymSyx*SyzmSzy + SxzpSzx*(SxxpSyy + Szz))
+          + (SxypSyx*SyzmSzy + SxzmSzx*(SxxmSyy - Szz)) * (-SxymSyx*SyzpSzy + SxzmSzx*(SxxpSyy - Szz));
+
+        // Starting above the largest root, the steps are positive and
+        // shrink monotonically, so anything else is roundoff
+        double x = 1.0;
+        double last = 1.0;
+        bool converged = false;
+        for (uint i=0; i<50; ++i) {
+          double x2 = x * x;
+          double b = (x2 + C2) * x;
+          double a = b + C1;
+          double slope = 2.0 * x2 * x + b + a;
+          double delta = (a * x + C0) / slope;
+
+          if (std::fabs(delta) < qcp_eval_precision * x) {
+            x -= delta;
+            converged = std::fabs(slope) > qcp_gap_precision;
+            break;
+          }
+          if (!(delta > 0.0 && delta <= last))
+            break;
+
+          x -= delta;
+          last = delta;
+        }
+
+        lambda = x * E0;
+        return(converged);
+      }
+
+
+      // Largest eigenvalue of the QCP key matrix from the SVD of A,
+      // for when QCP cannot resolve it
+      double svdMaxEigenvalue(const double* A) {
+        vecDouble u(A, A + 9);
+        vecDouble v(9, 0.0);
+        v[0] = v[4] = v[8] = 1.0;
+
+        vecDouble S(boost::get<1>(kabschCore(u, v)));
+        return(S[0] + S[1] + S[2]);
+      }
+
+
+      double maxEigenvalue(const double* A, const double E0) {
+        double lambda;
+        if (!qcpMaxEigenvalue(A, E0, lambda))
+          lambda = svdMaxEigenvalue(A);
+        return(lambda);
+      }
+
+
+      // Rotation (from the eigenvector of the key matrix with
+      // eigenvalue lambda) that superimposes U onto V.  The
+      // eigenvector is a column of the adjoint of (K - lambda I),
+      // scaled by E0; if one column is too small, the next is tried.
+      // Returns false if every column is too small.
+      bool qcpRotation(const double* A, const double E0, const double lambda, GMatrix& R) {
+        double s = 1.0 / E0;
+        double Sxx = A[0] * s, Sxy = A[1] * s, Sxz = A[2] * s;
+        double Syx = A[3] * s, Syy = A[4] * s, Syz = A[5] * s;
+        double Szx = A[6] * s, Szy = A[7] * s, Szz = A[8] * s;
+
+        double SxzpSzx = Sxz + Szx, SyzpSzy = Syz + Szy, SxypSyx = Sxy + Syx;
+        double SyzmSzy = Syz - Szy, SxzmSzx = Sxz - Szx, SxymSyx = Sxy - Syx;
+        double SxxpSyy = Sxx + Syy, SxxmSyy = Sxx - Syy;
+
+        double x = lambda * s;
+        double a11 = SxxpSyy + Szz - x, a12 = SyzmSzy, a13 = -SxzmSzx, a14 = SxymSyx;
+        double a21 = SyzmSzy, a22 = SxxmSyy - Szz - x, a23 = SxypSyx, a24 = SxzpSzx;
+        double a31 = a13, a32 = a23, a33 = Syy - Sxx - Szz - x, a34 = SyzpSzy;
+        double a41 = a14, a42 = a24, a43 = a34, a44 = Szz - SxxpSyy - x;
+
+        double a3344_4334 = a33 * a44 - a43 * a34, a3244_4234 = a32 * a44 - a42 * a34;
+        double a3243_4233 = a32 * a43 - a42 * a33, a3143_4133 = a31 * a43 - a41 * a33;
+        double a3144_4134 = a31 * a44 - a41 * a34, a3142_4132 = a31 * a42 - a41 * a32;
+
+        double q1 =  a22*a3344_4334 - a23*a3244_4234 + a24*a3243_4233;
+        double q2 = -a21*a3344_4334 + a23*a3144_4134 - a24*a3143_4133;
+        double q3 =  a21*a3244_4234 - a22*a3144_4134 + a24*a3142_4132;
+        double q4 = -a21*a3243_4233 + a22*a3143_4133 - a23*a3142_4132;
+        double qsqr = q1*q1 + q2*q2 + q3*q3 + q4*q4;
+
+        if (!(qsqr >= qcp_evec_precision)) {
+          q1 =  a12*a3344_4334 - a13*a3244_4234 + a14*a3243_4233;
+          q2 = -a11*a3344_4334 + a13*a3144_4134 - a14*a3143_4133;
+          q3 =  a11*a3244_4234 - a12*a3144_4134 + a14*a3142_4132;
+          q4 = -a11*a3243_4233 + a12*a3143_4133 - a13*a3142_4132;
+          qsqr = q1*q1 + q2*q2 + q3*q3 + q4*q4;
+
+          if (!(qsqr >= qcp_evec_precision)) {
+            double a1324_1423 = a13 * a24 - a14 * a23, a1224_1422 = a12 * a24 - a14 * a22;
+            double a1223_1322 = a12 * a23 - a13 * a22, a1124_1421 = a11 * a24 - a14 * a21;
+            double a1123_1321 = a11 * a23 - a13 * a21, a1122_1221 = a11 * a22 - a12 * a21;
+
+            q1 =  a42 * a1324_1423 - a43 * a1224_1422 + a44 * a1223_1322;
+            q2 = -a41 * a1324_1423 + a43 * a1124_1421 - a44 * a1123_1321;
+            q3 =  a41 * a1224_1422 - a42 * a1124_1421 + a44 * a1122_1221;
+            q4 = -a41 * a1223_1322 + a42 * a1123_1321 - a43 * a1122_1221;
+            qsqr = q1*q1 + q2*q2 + q3*q3 + q4*q4;
+
+            if (!(qsqr >= qcp_evec_precision)) {
+              q1 =  a32 * a1324_1423 - a33 * a1224_1422 + a34 * a1223_1322;
+              q2 = -a31 * a1324_1423 + a33 * a1124_1421 - a34 * a1123_1321;
+              q3 =  a31 * a1224_1422 - a32 * a1124_1421 + a34 * a1122_1221;
+              q4 = -a31 * a1223_1322 + a32 * a1123_1321 - a33 * a1122_1221;
+              qsqr = q1*q1 + q2*q2 + q3*q3 + q4*q4;
+
+              if (!(qsqr >= qcp_evec_precision))
+                return(false);
+            }
+          }
+        }
+
+        double normq = std::sqrt(qsqr);
+        q1 /= normq;
+        q2 /= normq;
+        q3 /= normq;
+        q4 /= normq;
+
+        double a2 = q1 * q1, x2 = q2 * q2, y2 = q3 * q3, z2 = q4 * q4;
+        double xy = q2 * q3, az = q1 * q4, zx = q4 * q2;
+        double ay = q1 * q3, yz = q3 * q4, ax = q1 * q2;
+
+        R = GMatrix();
+        R(0,0) = a2 + x2 - y2 - z2;
+        R(0,1) = 2 * (xy + az);
+        R(0,2) = 2 * (zx - ay);
+        R(1,0) = 2 * (xy - az);
+        R(1,1) = a2 - x2 + y2 - z2;
+        R(1,2) = 2 * (yz + ax);
+        R(2,0) = 2 * (zx + ay);
+        R(2,1) = 2 * (yz - ax);
+        R(2,2) = a2 - x2 - y2 + z2;
+
+        return(true);
+      }
+
+    }
+
+
+    void superpositionMethod(const SuperpositionMethod method) { superposition_method = method; }
+
+    SuperpositionMethod superpositionMethod() { return(superposition_method); }
+
+
+
+    double qcpRMSD(const double* A, const double E0, const uint n) {
+      double lambda = maxEigenvalue(A, E0);
+
+      return(std::sqrt(std::abs(2.0 * (E0 - lambda)) / n));
+    }
+
+
+    double qcpCenteredRMSD(const vecDouble& U, const vecDouble& V) {
+      double A[9];
+
+      double E0 = qcpInnerProducts(U, V, A);
+      return(qcpRMSD(A, E0, U.size() / 3));
+    }
+
+
+    double qcpAlignedRMSD(const vecDouble& U, const vecDouble& V) {
+      double A[9];
+
+      double E0 = qcpInnerProducts(U, V, coordCenter(U), coordCenter(V), A);
+      return(qcpRMSD(A, E0, U.size() / 3));
+    }
+
+
+    GMatrix qcpCentered(const vecDouble& U, const vecDouble& V) {
+      double A[9];
+
+      double E0 = qcpInnerProducts(U, V, A);
+      double lambda;
+      GMatrix R;
+
+      // Degenerate input (e.g. collinear) has no unique rotation, so
+      // let the SVD pick one
+      if (!qcpMaxEigenvalue(A, E0, lambda) || !qcpRotation(A, E0, lambda, R))
+        return(svdCentered(U, V));
+
+      return(R);
+    }
+
+
+
     // Core aligmnent routine.  Assumes input coord vectors are already centered.
     // Returns the SVD results as a tuple
     SVDTupleVec kabschCore(const vecDouble& u, const vecDouble& v) {
@@ -112,7 +422,7 @@ namespace loos {
 
     // Return the RMSD only for a kabsch alignment between U and V assuming
     // both are centered
-    double centeredRMSD(const vecDouble& U, const vecDouble& V) {
+    double svdCenteredRMSD(const vecDouble& U, const vecDouble& V) {
 
       int n = U.size();
 
@@ -143,7 +453,7 @@ namespace loos {
 
     // Return the RMSD only for a kabsch alignment between U and V
     // Both will be centered first.
-    double alignedRMSD(const vecDouble& U, const vecDouble& V) {
+    double svdAlignedRMSD(const vecDouble& U, const vecDouble& V) {
 
       int n = U.size();
 
@@ -180,7 +490,7 @@ namespace loos {
 
     // Kabsch alignment between U and V, assuming both are centered.
     // Returns the tranformation matrix to align U onto V.
-    GMatrix kabschCentered(const vecDouble& U, const vecDouble& V) {
+    GMatrix svdCentered(const vecDouble& U, const vecDouble& V) {
       SVDTupleVec svd = kabschCore(U, V);
 
       vecDouble R(boost::get<0>(svd));
@@ -214,6 +524,27 @@ namespace loos {
     }
 
 
+    double centeredRMSD(const vecDouble& U, const vecDouble& V) {
+      if (superposition_method == QCPSuperposition)
+        return(qcpCenteredRMSD(U, V));
+      return(svdCenteredRMSD(U, V));
+    }
+
+
+    double alignedRMSD(const vecDouble& U, const vecDouble& V) {
+      if (superposition_method == QCPSuperposition)
+        return(qcpAlignedRMSD(U, V));
+      return(svdAlignedRMSD(U, V));
+    }
+
+
+    GMatrix kabschCentered(const vecDouble& U, const vecDouble& V) {
+      if (superposition_method == QCPSuperposition)
+        return(qcpCentered(U, V));
+      return(svdCentered(U, V));
+    }
+
+
     GMatrix kabsch(const vecDouble& U, const vecDouble& V) {
 
       vecDouble cU(U);
@@ -350,6 +681,44 @@ namespace loos {
   }
 
 
+  boost::tuple<std::vector<XForm>,greal,int> iterativeAlignment(CoordinateEnsemble& ensemble,
+                                                                greal threshold, int maxiter) {
+    using namespace alignment;
+
+    int n = ensemble.size();
+    std::vector<XForm> xforms(n);
+
+    // Start by aligning against the first structure in the ensemble
+    vecDouble target = ensemble.coordsAsVector(0);
+    centerAtOrigin(target);
+
+    double rms;
+    int iter = 0;
+    do {
+      vecDouble avg(target.size(), 0.0);
+      for (int i = 0; i<n; i++) {
+        vecDouble frame = ensemble.coordsAsVector(i);
+        GMatrix M = kabsch(frame, target);
+        applyTransform(M, frame);
+        ensemble.coords(i, frame);
+        xforms[i].premult(M);
+
+        for (uint k=0; k<frame.size(); ++k)
+          avg[k] += frame[k];
+      }
+
+      for (uint k=0; k<avg.size(); ++k)
+        avg[k] /= n;
+      rms = rmsd(target, avg);
+      target = avg;
+      ++iter;
+    } while (rms > threshold && iter <= maxiter );
+
+    boost::tuple<std::vector<XForm>, greal, int> res(xforms, rms, iter);
+    return(res);
+  }
+
+
 
 
   boost::tuple<std::vector<XForm>, greal, int> iterativeAlignment(const AtomicGroup& g,
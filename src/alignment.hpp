@@ -44,11 +44,56 @@ namespace loos {
                 typedef boost::tuple<vecDouble, vecDouble, vecDouble>   SVDTupleVec;
         
         
+                //! Algorithms for finding the optimal superposition
+                /**
+                 * QCP (quaternion characteristic polynomial) solves for the
+                 * optimal rotation in closed form from the inner products of
+                 * the coordinates, avoiding the LAPACK calls (and their
+                 * overhead) of the SVD-based Kabsch method.  Both give the
+                 * same superposition to within numerical precision.
+                 */
+                enum SuperpositionMethod { SVDSuperposition, QCPSuperposition };
+
+                //! Selects the method used by kabsch(), kabschCentered(), centeredRMSD() and alignedRMSD()
+                /**
+                 * The default is QCPSuperposition.  This is a global setting,
+                 * so it should only be changed before any threads are started.
+                 */
+                void superpositionMethod(const SuperpositionMethod method);
+                SuperpositionMethod superpositionMethod();
+
                 SVDTupleVec kabschCore(const vecDouble& u, const vecDouble& v);
                 GCoord centerAtOrigin(vecDouble& v);
                 double alignedRMSD(const vecDouble& U, const vecDouble& V);
                 double centeredRMSD(const vecDouble& U, const vecDouble& V);
+                GMatrix kabschCentered(const vecDouble& U, const vecDouble& V);
                 GMatrix kabsch(const vecDouble& U, const vecDouble& V);
+
+                // Explicit versions of the above, regardless of the selected method
+                double svdAlignedRMSD(const vecDouble& U, const vecDouble& V);
+                double svdCenteredRMSD(const vecDouble& U, const vecDouble& V);
+                GMatrix svdCentered(const vecDouble& U, const vecDouble& V);
+
+                //! RMSD after optimal superposition of U and V (both centered) using QCP
+                /**
+                 * Only the largest eigenvalue of the QCP key matrix is found; the
+                 * rotation itself is never constructed.
+                 */
+                double qcpCenteredRMSD(const vecDouble& U, const vecDouble& V);
+                double qcpAlignedRMSD(const vecDouble& U, const vecDouble& V);
+                //! Rotation that superimposes U onto V (both centered) using QCP
+                GMatrix qcpCentered(const vecDouble& U, const vecDouble& V);
+
+                //! RMSD from precomputed QCP inner products
+                /**
+                 * \a A is the 3x3 correlation matrix between the n centered
+                 * coordinates of V and U (row-major, A[i*3+j] = sum of v_i * u_j)
+                 * and \a E0 is half the sum of the squared coordinates of both.
+                 * This lets callers that precenter their structures (and cache
+                 * the sums of squares) use their own inner-product loops.
+                 */
+                double qcpRMSD(const double* A, const double E0, const uint n);
+
                 void applyTransform(const GMatrix& M, vecDouble& v);
                 vecDouble averageCoords(const vecMatrix& ensemble);
                 double rmsd(const vecDouble& u, const vecDouble& v);
@@ -65,6 +110,18 @@ namespace loos {
                                                                       greal threshold=1e-6,
                                                                       int maxiter=1000);
 
+        class CoordinateEnsemble;
+
+        //! Iterative superposition of a CoordinateEnsemble
+        /**
+         * Each pass over the frames both aligns them and accumulates the
+         * next average, so an out-of-core ensemble is only read (and
+         * written) once per iteration.
+         */
+        boost::tuple<std::vector<XForm>,greal,int> iterativeAlignment(CoordinateEnsemble& ensemble,
+                                                                      greal threshold=1e-6,
+                                                                      int maxiter=1000);
+
         //! Compute an iterative superposition by reading in frames from the Trajectory.
         /**
          * The iterativeAlignment() functions that take a trajectory as an argument do
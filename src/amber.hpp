@@ -38,6 +38,7 @@
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
 #include <LineReader.hpp>
+#include <CompressedStream.hpp>
 
 
 namespace loos {
@@ -90,12 +91,10 @@ namespace loos {
     //! Read in a parmtop file
     explicit Amber(const std::string& fname)
       : natoms(0), nres(0), nbonh(0), mbona(0) {
-      std::ifstream ifs(fname.c_str());
-      if (!ifs)
-	throw(FileOpenError(fname));
-      reader.stream(ifs);
+      boost::shared_ptr<std::istream> ifs = openInputStream(fname);
+      reader.stream(*ifs);
       reader.name(fname);
-      read(ifs);
+      read(*ifs);
     }
 
     explicit Amber(std::istream& ifs)
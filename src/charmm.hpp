@@ -33,6 +33,7 @@
 
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
+#include <CompressedStream.hpp>
 
 
 namespace loos {
@@ -51,11 +52,8 @@ namespace loos {
     virtual ~CHARMM() {}
 
     explicit CHARMM(const std::string fname) : _max_index(0), _filename(fname) {
-      std::ifstream ifs(fname.c_str());
-      if (!ifs) {
-        throw(FileOpenError(fname));
-      }
-      read(ifs);
+      boost::shared_ptr<std::istream> ifs = openInputStream(fname);
+      read(*ifs);
     }
 
     explicit CHARMM(std::istream &ifs) : _max_index(0), _filename("stream") {
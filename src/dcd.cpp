@@ -267,18 +267,21 @@ namespace loos {
 
 
   bool DCD::readCrystalParams(void) {
-    unsigned int len;
-    DataOverlay* o;
+    double dp[6];
 
-    o = readF77Line(&len);
-    if (!o)
+    unsigned int len = readRecordLen();
+    if (len == 0)
       return(false);
 
-    if (len != 48)
+    if (len != sizeof(dp))
       throw(FileReadError(_filename, "Cannot read crystal parameters"));
 
-    double* dp = reinterpret_cast<double*>(o);
-    
+    ifs->read(reinterpret_cast<char*>(dp), len);
+    if (ifs->fail())
+      throw(FileReadError(_filename, "Error reading data record from DCD"));
+    if (readRecordLen() != len)
+      throw(FileReadError(_filename, "Mismatch in record length while reading from DCD"));
+
     qcrys[0] = dp[0];
     qcrys[1] = dp[2];
     qcrys[2] = dp[5];
@@ -290,42 +293,67 @@ namespace loos {
         for (int i=0; i<6; ++i)
             qcrys[i] = swab(qcrys[i]);
 
-    delete[] o;
-
     return(true);
   }
 
 
 
-  // Read a line of coordinates into the specified vector.
+  // Read a line of coordinates into the specified vector.  The record
+  // is read directly into the vector (which is already sized for the
+  // frame), so no memory is allocated per frame.  With an atom
+  // subset, only the runs of atoms covering it are read and the rest
+  // of the record is seeked past.
 
   bool DCD::readCoordLine(std::vector<dcd_real>& v) {
-    DataOverlay *op;
-    int n = _natoms * sizeof(dcd_real);
-    unsigned int len;
-
+    unsigned int n = _natoms * sizeof(dcd_real);
 
-    op = readF77Line(&len);
-    if (!op)
+    unsigned int len = readRecordLen();
+    if (len == 0)
       return(false);
     
-    if (len != (unsigned int)n)
+    if (len != n)
       throw(FileReadError(_filename, "Size of coords stored in frame does not match model size"));
 
-    // Recast the values as floats and store them...
-    uint i;
-    for (i=0; i<_natoms; i++)
+    if (_runs.empty()) {
+      ifs->read(reinterpret_cast<char*>(&(v[0])), n);
+
       if (swabbing)
-        v[i] = swab(op[i].f);
-      else
-        v[i] = op[i].f;
+        for (uint i=0; i<_natoms; ++i)
+          v[i] = swab(v[i]);
+
+    } else {
+      std::streampos start = ifs->tellg();
+      for (std::vector<AtomRun>::const_iterator r = _runs.begin(); r != _runs.end(); ++r) {
+        ifs->seekg(start + static_cast<std::streamoff>(r->first * sizeof(dcd_real)));
+        ifs->read(reinterpret_cast<char*>(&(v[r->first])), r->count * sizeof(dcd_real));
+
+        if (swabbing)
+          for (uint i=r->first; i<r->first + r->count; ++i)
+            v[i] = swab(v[i]);
+      }
+      ifs->seekg(start + static_cast<std::streamoff>(n));
+    }
 
-    delete[] op;
+    if (ifs->fail())
+      throw(FileReadError(_filename, "Error reading data record from DCD"));
+    if (readRecordLen() != len)
+      throw(FileReadError(_filename, "Mismatch in record length while reading from DCD"));
 
     return(true);
   }
 
 
+  void DCD::atomSubsetImpl() {
+    // Gaps smaller than a typical stream buffer are read through.
+    // Trajectory::setAtomSubset() has already checked the indices, so
+    // this is only a guard against reading past the coordinate buffer.
+    std::vector<AtomRun> runs = atomRuns(8192 / sizeof(dcd_real));
+    if (!runs.empty() && runs.back().first + runs.back().count > _natoms)
+      throw(LOOSError("Atom subset is out of range for DCD '" + _filename + "'"));
+    _runs.swap(runs);
+  }
+
+
   void DCD::seekFrameImpl(const uint i) {
   
     if (first_frame_pos == 0)
@@ -394,6 +422,15 @@ namespace loos {
     return(crds);
   }
 
+  void DCD::copyCoordsImpl(greal* x, greal* y, greal* z) const {
+    for (uint i=0; i<_natoms; ++i) {
+      x[i] = xcrds[i];
+      y[i] = ycrds[i];
+      z[i] = zcrds[i];
+    }
+  }
+
+
   std::vector<GCoord> DCD::mappedCoords(const std::vector<int>& indices) {
     std::vector<int>::const_iterator iter;
     std::vector<GCoord> crds(indices.size());
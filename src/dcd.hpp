@@ -136,7 +136,10 @@ namespace loos {
         bool nativeFormat(void) const;
 
         //! Auto-interleave the coords into a vector of GCoord()'s.
-        /*!  This can be a pretty slow operation, so be careful. */
+        /*!  This can be a pretty slow operation, so be careful.  Use
+         *   Trajectory::copyCoords() or Trajectory::updateArenaCoords()
+         *   to avoid building a new vector every frame.
+         */
 		virtual std::vector<GCoord> coords(void) const;
 
         //! Interleave coords, selecting entries indexed by map
@@ -170,6 +173,12 @@ namespace loos {
         //! Update an AtomicGroup coordinates with the currently-read frame.
         virtual void updateGroupCoordsImpl(AtomicGroup& g);
 
+        //! Copy the currently-read frame straight from the x, y, z buffers
+        virtual void copyCoordsImpl(greal* x, greal* y, greal* z) const;
+
+        //! Work out which parts of each coordinate record to read
+        virtual void atomSubsetImpl();
+
 
 
         void allocateSpace(const int n);
@@ -198,6 +207,7 @@ namespace loos {
         bool swabbing;            // DCD being read is not in native format...
 
         std::vector<dcd_real> xcrds, ycrds, zcrds;
+        std::vector<AtomRun> _runs;   // Parts of each record to read (empty = all)
 
     };
 
@@ -23,6 +23,8 @@
 
 
 
+#include <cstring>
+
 #include <ensembles.hpp>
 #include <XForm.hpp>
 #include <AtomicGroup.hpp>
@@ -175,6 +177,68 @@ namespace loos {
 
 
 
+  void readTrajectory(CoordinateEnsemble& ensemble, const AtomicGroup& model, pTraj trajectory) {
+    AtomicGroup clone = model.copy();
+    ensemble = CoordinateEnsemble(model, trajectory->nframes(), ensemble.scratchDirectory());
+
+    uint n = 0;
+    while (n < ensemble.size() && trajectory->readFrame()) {
+      trajectory->updateGroupCoords(clone);
+      ensemble.coords(n++, clone);
+    }
+
+    if (n < ensemble.size())
+      ensemble = ensemble.frames(0, n);
+  }
+
+
+  void readTrajectory(CoordinateEnsemble& ensemble, const AtomicGroup& model, pTraj trajectory, const std::vector<uint>& frames) {
+    AtomicGroup clone = model.copy();
+    ensemble = CoordinateEnsemble(model, frames.size(), ensemble.scratchDirectory());
+
+    for (uint i=0; i<frames.size(); ++i) {
+      if (frames[i] >= trajectory->nframes())
+        throw(std::runtime_error("Frame index exceeds trajectory size in readTrajectory()"));
+      trajectory->readFrame(frames[i]);
+      trajectory->updateGroupCoords(clone);
+      ensemble.coords(i, clone);
+    }
+  }
+
+
+  AtomicGroup averageStructure(const CoordinateEnsemble& ensemble) {
+    uint m = 3 * ensemble.atoms();
+    std::vector<double> avg(m, 0.0);
+
+    for (uint j=0; j<ensemble.size(); ++j) {
+      const float* p = ensemble.frame(j);
+      for (uint i=0; i<m; ++i)
+        avg[i] += p[i];
+    }
+
+    AtomicGroup result = ensemble.model().copy();
+    for (uint i=0; i<result.size(); ++i)
+      result[i]->coords(GCoord(avg[3*i], avg[3*i+1], avg[3*i+2]) / ensemble.size());
+
+    result.removePeriodicBox();
+    return(result);
+  }
+
+
+  RealMatrix extractCoords(const CoordinateEnsemble& ensemble) {
+    uint n = ensemble.size();
+    uint m = 3 * ensemble.atoms();
+    RealMatrix M(m, n);
+
+    // The ensemble is already stored column-major...
+    if (n)
+      memcpy(M.get(), ensemble.frame(0), static_cast<ulong>(m) * n * sizeof(float));
+
+    return(M);
+  }
+
+
+
   RealMatrix extractCoords(const std::vector<AtomicGroup>& ensemble) {
     uint n = ensemble.size();
     uint m = ensemble[0].size();
@@ -36,6 +36,7 @@
 
 #include <AtomicGroup.hpp>
 #include <Trajectory.hpp>
+#include <CoordinateEnsemble.hpp>
 
 namespace loos {
   class XForm;
@@ -89,6 +90,23 @@ namespace loos {
 
 
 
+  //! Read an entire trajectory into a CoordinateEnsemble
+  /**
+   * The ensemble's storage is replaced, but its scratch directory (if
+   * any) is kept, so the frames are read straight into the scratch
+   * file rather than memory.
+   */
+  void readTrajectory(CoordinateEnsemble& ensemble, const AtomicGroup& model, pTraj trajectory);
+  void readTrajectory(CoordinateEnsemble& ensemble, const AtomicGroup& model, pTraj trajectory, const std::vector<uint>& frames);
+
+  //! Average structure of a CoordinateEnsemble (as a copy of its model)
+  AtomicGroup averageStructure(const CoordinateEnsemble& ensemble);
+
+  //! Each frame of the ensemble as a column
+  RealMatrix extractCoords(const CoordinateEnsemble& ensemble);
+
+
+
 #endif   // !defined(SWIG)
 
 
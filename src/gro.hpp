@@ -32,6 +32,7 @@
 
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
+#include <CompressedStream.hpp>
 
 namespace loos {
 
@@ -42,10 +43,8 @@ namespace loos {
     Gromacs() { }
 
     explicit Gromacs(const std::string& fname) : _filename(fname), _max_index(0), _has_velocities(false) {
-      std::ifstream ifs(fname.c_str());
-      if (!ifs)
-        throw(FileOpenError(fname));
-      read(ifs);
+      boost::shared_ptr<std::istream> ifs = openInputStream(fname);
+      read(*ifs);
     }
 
     explicit Gromacs(std::istream& ifs) : _filename("stream"), _max_index(0), _has_velocities(false) { read(ifs); }
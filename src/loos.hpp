@@ -58,6 +58,16 @@
 #include <Kernel.hpp>
 #include <Parser.hpp>
 #include <Selectors.hpp>
+#include <CompiledSelection.hpp>
+#include <CellList.hpp>
+#include <PairwiseRMSD.hpp>
+#include <CoordinateEnsemble.hpp>
+#include <TrajectoryMatrix.hpp>
+#include <RDFEngine.hpp>
+#include <BatchDistance.hpp>
+#include <CompressedStream.hpp>
+#include <OccupancyMatrix.hpp>
+#include <Correlation.hpp>
 
 
 #include <Matrix44.hpp>
@@ -65,8 +75,10 @@
 #include <Matrix.hpp>
 
 #include <AtomicNumberDeducer.hpp>
+#include <InternedString.hpp>
 #include <Atom.hpp>
 #include <AtomicGroup.hpp>
+#include <CoordinateArena.hpp>
 #include <pdb.hpp>
 #include <psf.hpp>
 #include <amber.hpp>
@@ -74,8 +86,11 @@
 
 #include <Trajectory.hpp>
 #include <dcd.hpp>
+#include <mapped_dcd.hpp>
 #include <dcd_utils.hpp>
 #include <MultiTraj.hpp>
+#include <PrefetchingTrajectory.hpp>
+#include <ParallelFrameDriver.hpp>
 
 #include <trajwriter.hpp>
 #include <dcdwriter.hpp>
@@ -66,6 +66,8 @@ extern "C" {
               const double* const, const double* const, const int* const, const double* const,
               const int* const, const double* const, double* consnt, const int* const);
   void dggev_(char*, char*, int*, double*, int*, double*, int*, double*, double*, double*, double*, int*, double*, int*, double*, int*, int*);
+  void dgeqrf_(int*, int*, double*, int*, double*, double*, int*, int*);
+  void dorgqr_(int*, int*, int*, double*, int*, double*, double*, int*, int*);
 
   void sgesvd_(char*, char*, int*, int*, float*, int*, float*, float*, int*, float*, int*, float*, int*, int*);
   void sgemm_(char*, char*, int*, int*, int*, float*, float*, int*, float*, int*, float*, float*, int*);
@@ -130,6 +132,7 @@ namespace loos {
   class Atom;
   class Trajectory;
   class DCD;
+  class MappedDCD;
   class AmberTraj;
 #if defined(HAS_NETCDF)
   class AmberNetcdf;
@@ -144,6 +147,7 @@ namespace loos {
   typedef boost::shared_ptr<Atom> pAtom;
   typedef boost::shared_ptr<Trajectory> pTraj;
   typedef boost::shared_ptr<DCD> pDCD;
+  typedef boost::shared_ptr<MappedDCD> pMappedDCD;
   typedef boost::shared_ptr<AmberTraj> pAmberTraj;
 #if defined(HAS_NETCDF)
   typedef boost::shared_ptr<AmberNetcdf> pAmberNetcdf;
@@ -174,6 +178,10 @@ namespace loos {
   typedef boost::shared_ptr<Gromacs> pGromacs;
   typedef boost::shared_ptr<CHARMM> pCHARMM;
 
+  // Contiguous coordinate storage
+  class CoordinateArena;
+  typedef boost::shared_ptr<CoordinateArena> pCoordinateArena;
+
 
   // Misc
   class Remarks;
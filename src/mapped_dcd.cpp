@@ -0,0 +1,390 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cassert>
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <mapped_dcd.hpp>
+#include <dcd.hpp>
+#include <AtomicGroup.hpp>
+#include <CompressedStream.hpp>
+
+
+namespace loos {
+
+  namespace {
+
+    // Written with shifts and masks (rather than through swab()) so
+    // the compiler can vectorize the loops that use it
+    inline uint32_t bswap32(const uint32_t u) {
+      return( (u >> 24) | ((u >> 8) & 0x0000ff00u) | ((u << 8) & 0x00ff0000u) | (u << 24) );
+    }
+
+
+    // Copies n floats from a mapped DCD record into dst, converting to
+    // greal and swabbing if necessary.  Records start on a 4-byte
+    // boundary relative to the (page-aligned) mapping.
+    void copyRecord(const unsigned char* src, greal* dst, const uint n, const bool swabbing) {
+      const uint32_t* p = reinterpret_cast<const uint32_t*>(src);
+
+      if (swabbing)
+        for (uint i=0; i<n; ++i) {
+          uint32_t u = bswap32(p[i]);
+          float f;
+          memcpy(&f, &u, sizeof(f));
+          dst[i] = f;
+        }
+      else {
+        const float* fp = reinterpret_cast<const float*>(src);
+        for (uint i=0; i<n; ++i)
+          dst[i] = fp[i];
+      }
+    }
+
+  }
+
+
+  float MappedDCD::FrameView::value(const unsigned char* p, const uint i) const {
+    uint32_t u;
+    memcpy(&u, p + i*sizeof(float), sizeof(u));
+    if (_swabbing)
+      u = bswap32(u);
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return(f);
+  }
+
+
+  void MappedDCD::FrameView::copy(greal* x, greal* y, greal* z) const {
+    copyRecord(_x, x, _n, _swabbing);
+    copyRecord(_y, y, _n, _swabbing);
+    copyRecord(_z, z, _n, _swabbing);
+  }
+
+
+  std::vector<GCoord> MappedDCD::FrameView::coords() const {
+    std::vector<GCoord> crds(_n);
+    for (uint i=0; i<_n; ++i)
+      crds[i] = coords(i);
+    return(crds);
+  }
+
+
+  // Crystal data is stored as doubles in the order a, gamma, b, beta,
+  // alpha, c.  As in DCD::readCrystalParams(), this is reordered to
+  // a, b, c, alpha, beta, gamma
+  std::vector<double> MappedDCD::FrameView::crystalParams() const {
+    std::vector<double> qcrys(6, 0.0);
+    if (!_crystal)
+      return(qcrys);
+
+    double dp[6];
+    memcpy(dp, _crystal, sizeof(dp));    // Not necessarily 8-byte aligned
+    if (_swabbing)
+      for (int i=0; i<6; ++i)
+        dp[i] = swab(dp[i]);
+
+    qcrys[0] = dp[0];
+    qcrys[1] = dp[2];
+    qcrys[2] = dp[5];
+    qcrys[3] = dp[1];
+    qcrys[4] = dp[3];
+    qcrys[5] = dp[4];
+
+    return(qcrys);
+  }
+
+
+  GCoord MappedDCD::FrameView::periodicBox() const {
+    std::vector<double> qcrys = crystalParams();
+    return(GCoord(qcrys[0], qcrys[1], qcrys[2]));
+  }
+
+
+
+  // ----------------------------------------------------------------------
+
+
+  pTraj MappedDCD::create(const std::string& fname, const AtomicGroup&) {
+    if (detectCompression(fname) != Uncompressed)
+      return(pTraj(new DCD(fname)));
+    return(pTraj(new MappedDCD(fname)));
+  }
+
+
+  MappedDCD::MappedDCD(const std::string& fname)
+    : Trajectory(), _fd(-1), _map(0), _size(0), _natoms(0), _nframes(0), _delta(0.0),
+      _swabbing(false), _first_frame_pos(0), _frame_size(0)
+  {
+    _filename = fname;
+
+    // The destructor won't run if construction fails, so release the
+    // mapping and descriptor here before passing the error along
+    try {
+      mapFile();
+      readHeader();
+
+      if (_nframes == 0)
+        throw(FileOpenError(_filename, "DCD appears empty"));
+
+      if (!parseFrame())
+        throw(LOOSError("Cannot read first frame of DCD during initialization"));
+    }
+    catch (...) {
+      unmapFile();
+      throw;
+    }
+    cached_first = true;
+  }
+
+
+  MappedDCD::~MappedDCD() {
+    unmapFile();
+  }
+
+
+  void MappedDCD::unmapFile() {
+    if (_map)
+      munmap(const_cast<unsigned char*>(_map), _size);
+    _map = 0;
+    if (_fd >= 0)
+      close(_fd);
+    _fd = -1;
+  }
+
+
+  void MappedDCD::mapFile() {
+    _fd = open(_filename.c_str(), O_RDONLY);
+    if (_fd < 0)
+      throw(FileOpenError(_filename, strerror(errno), errno));
+
+    struct stat st;
+    if (fstat(_fd, &st) < 0)
+      throw(FileOpenError(_filename, strerror(errno), errno));
+    _size = st.st_size;
+    if (_size == 0)
+      throw(FileOpenError(_filename, "DCD file is empty"));
+
+    void* p = mmap(0, _size, PROT_READ, MAP_SHARED, _fd, 0);
+    if (p == MAP_FAILED)
+      throw(FileOpenError(_filename, std::string("Unable to map DCD: ") + strerror(errno), errno));
+    _map = static_cast<const unsigned char*>(p);
+  }
+
+
+  // Returns the F77 record length stored at offset, throwing if the
+  // record would run past the end of the file
+  uint MappedDCD::readRecordLen(const size_t offset) const {
+    if (offset + sizeof(uint32_t) > _size)
+      throw(FileReadError(_filename, "Unexpected end of file while reading DCD"));
+
+    uint32_t u;
+    memcpy(&u, _map + offset, sizeof(u));
+    if (_swabbing)
+      u = bswap32(u);
+    if (offset + 2*sizeof(uint32_t) + u > _size)
+      throw(FileReadError(_filename, "Unexpected end of file while reading DCD"));
+
+    uint32_t v;
+    memcpy(&v, _map + offset + sizeof(u) + u, sizeof(v));
+    if (_swabbing)
+      v = bswap32(v);
+    if (u != v)
+      throw(FileReadError(_filename, "Mismatch in record length while reading from DCD"));
+
+    return(u);
+  }
+
+
+  // As above, but for the header records, which must also hold at least
+  // minlen bytes.  A header that is cut short means the file can't be
+  // opened at all.
+  uint MappedDCD::readHeaderRecordLen(const size_t offset, const uint minlen) const {
+    if (offset + 2*sizeof(uint32_t) > _size)
+      throw(FileOpenError(_filename, "DCD header is truncated"));
+
+    uint32_t u;
+    memcpy(&u, _map + offset, sizeof(u));
+    if (_swabbing)
+      u = bswap32(u);
+    if (offset + 2*sizeof(uint32_t) + u > _size)
+      throw(FileOpenError(_filename, "DCD header is truncated"));
+    if (u < minlen)
+      throw(FileOpenError(_filename, "Malformed DCD header record"));
+
+    return(readRecordLen(offset));
+  }
+
+
+  void MappedDCD::readHeader() {
+    uint32_t datum;
+    if (_size < sizeof(datum))
+      throw(FileOpenError(_filename, "DCD header is truncated"));
+    memcpy(&datum, _map, sizeof(datum));
+    if (datum == 84)
+      _swabbing = false;
+    else if (bswap32(datum) == 84)
+      _swabbing = true;
+    else
+      throw(FileReadError(_filename, "Unable to determine endian-ness of DCD file"));
+
+    // ICNTRL record...
+    size_t pos = 0;
+    uint len = readHeaderRecordLen(pos, 84);
+    const unsigned char* rec = _map + pos + 4;
+    if (memcmp(rec, "CORD", 4) != 0)
+      throw(FileReadError(_filename, "DCD is missing CORD magic marker"));
+
+    for (int i=0; i<20; ++i) {
+      int32_t v;
+      memcpy(&v, rec + 4 + i*4, sizeof(v));
+      _icntrl[i] = _swabbing ? swab(v) : v;
+    }
+    memcpy(&_delta, rec + 4 + 9*4, sizeof(_delta));
+    if (_swabbing)
+      _delta = swab(_delta);
+    if (_icntrl[8] != 0)
+      throw(LOOSError("Fixed atoms not yet supported by LOOS DCD reader"));
+    pos += len + 8;
+
+    // TITLE record...
+    len = readHeaderRecordLen(pos, 4);
+    rec = _map + pos + 4;
+    int32_t ntitle;
+    memcpy(&ntitle, rec, sizeof(ntitle));
+    if (_swabbing)
+      ntitle = swab(ntitle);
+    if (ntitle < 0 || static_cast<uint>(4 + 80*ntitle) > len)
+      throw(FileReadError(_filename, "Malformed DCD TITLE record"));
+    for (int i=0; i<ntitle; ++i) {
+      std::string s(reinterpret_cast<const char*>(rec + 4 + 80*i), 80);
+      _titles.push_back(s.substr(0, s.find('\0')));
+    }
+    pos += len + 8;
+
+    // NATOMS record...
+    len = readHeaderRecordLen(pos, 4);
+    if (len != 4)
+      throw(FileReadError(_filename, "Error reading number of atoms from DCD"));
+    int32_t n;
+    memcpy(&n, _map + pos + 4, sizeof(n));
+    _natoms = _swabbing ? swab(n) : n;
+    pos += len + 8;
+
+    _first_frame_pos = pos;
+    _frame_size = 3 * (_natoms * sizeof(float) + 8);
+    if (hasPeriodicBox())
+      _frame_size += 6 * sizeof(double) + 8;
+
+    // Only trust the header frame count if the file is actually that large
+    size_t available = (_size - _first_frame_pos) / _frame_size;
+    _nframes = _icntrl[0];
+    if (_nframes == 0 || _nframes > available) {
+      if (_nframes != 0)
+        std::cerr << "Warning- DCD '" << _filename << "' is shorter than its header claims; using "
+                  << available << " frames" << std::endl;
+      _nframes = available;
+    }
+  }
+
+
+  int MappedDCD::icntrl(const int i) const {
+    assert(i>=0 && i<20);
+    return(_icntrl[i]);
+  }
+
+
+  MappedDCD::FrameView MappedDCD::frame(const uint i) const {
+    if (i >= _nframes)
+      throw(FileError(_filename, "Requested DCD frame is out of range"));
+
+    size_t pos = _first_frame_pos + i * _frame_size;
+    const unsigned char* crystal = 0;
+    if (hasPeriodicBox()) {
+      if (readRecordLen(pos) != 6 * sizeof(double))
+        throw(FileReadError(_filename, "Cannot read crystal parameters"));
+      crystal = _map + pos + 4;
+      pos += 6 * sizeof(double) + 8;
+    }
+
+    const unsigned char* ptrs[3];
+    for (int k=0; k<3; ++k) {
+      if (readRecordLen(pos) != _natoms * sizeof(float))
+        throw(FileReadError(_filename, "Size of coords stored in frame does not match model size"));
+      ptrs[k] = _map + pos + 4;
+      pos += _natoms * sizeof(float) + 8;
+    }
+
+    return(FrameView(ptrs[0], ptrs[1], ptrs[2], crystal, _natoms, _swabbing));
+  }
+
+
+  void MappedDCD::adviseSequential() {
+    madvise(const_cast<unsigned char*>(_map), _size, MADV_SEQUENTIAL);
+  }
+
+
+  void MappedDCD::adviseRandom() {
+    madvise(const_cast<unsigned char*>(_map), _size, MADV_RANDOM);
+  }
+
+
+  bool MappedDCD::parseFrame(void) {
+    if (_current_frame >= _nframes)
+      return(false);
+    _current = frame(_current_frame);
+    return(true);
+  }
+
+
+  void MappedDCD::seekFrameImpl(const uint i) {
+    if (i >= _nframes)
+      throw(FileError(_filename, "Requested DCD frame is out of range"));
+  }
+
+
+  void MappedDCD::updateGroupCoordsImpl(AtomicGroup& g) {
+    for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
+      uint idx = (*i)->index();
+      if (idx >= _natoms)
+        throw(LOOSError(**i, "Atom index into the trajectory frame is out of bounds"));
+      (*i)->coords(_current.coords(idx));
+    }
+
+    if (hasPeriodicBox())
+      g.periodicBox(periodicBox());
+  }
+
+
+  void MappedDCD::copyCoordsImpl(greal* x, greal* y, greal* z) const {
+    _current.copy(x, y, z);
+  }
+
+}
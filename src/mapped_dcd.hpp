@@ -0,0 +1,190 @@
+/*
+  This file is part of LOOS.
+
+  LOOS (Lightweight Object-Oriented Structure library)
+  Copyright (c) 2017, Tod D. Romo, Alan Grossfield
+  Department of Biochemistry and Biophysics
+  School of Medicine & Dentistry, University of Rochester
+
+  This package (LOOS) is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation under version 3 of the License.
+
+  This package is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#if !defined(LOOS_MAPPED_DCD_HPP)
+#define LOOS_MAPPED_DCD_HPP
+
+
+#include <string>
+#include <vector>
+
+#include <loos_defs.hpp>
+#include <Trajectory.hpp>
+
+
+namespace loos {
+
+
+  //! Class for reading DCD files via a memory-mapping
+  /**
+   * DCD frames are all the same size, so a frame can be located by
+   * simple arithmetic.  Rather than reading frames through a stream,
+   * MappedDCD maps the entire file into memory and exposes each frame
+   * as a read-only MappedDCD::FrameView pointing directly into the
+   * mapping.  Only the pages for frames that are actually touched are
+   * read from disk, and the OS page cache is shared between all
+   * processes reading the same file (e.g. several analysis jobs on the
+   * same node).
+   *
+   * This is a drop-in replacement for the DCD class (select it with
+   * the "mdcd" trajectory type in createTrajectory(), or --trajtype=mdcd
+   * for tools that support it).  The same restrictions as DCD apply
+   * (no fixed atoms).  If the DCD is not in native byte-order, the
+   * coordinates are swabbed as they are copied out of the view.
+   *
+   * Random access does not disturb the readFrame() iterator:
+   * \code
+   *   MappedDCD dcd("sim.dcd");
+   *   MappedDCD::FrameView f = dcd.frame(1000);
+   *   GCoord c = f.coords(42);
+   * \endcode
+   */
+  class MappedDCD : public Trajectory {
+  public:
+
+    //! Read-only view of a single frame inside the mapped DCD
+    /**
+     * A view is only valid for as long as the MappedDCD it came from
+     * exists.
+     */
+    class FrameView {
+    public:
+      FrameView() : _x(0), _y(0), _z(0), _crystal(0), _n(0), _swabbing(false) { }
+
+      FrameView(const unsigned char* x, const unsigned char* y, const unsigned char* z,
+                const unsigned char* crystal, const uint n, const bool swabbing)
+        : _x(x), _y(y), _z(z), _crystal(crystal), _n(n), _swabbing(swabbing)
+      { }
+
+      //! Number of atoms in the frame
+      uint size() const { return(_n); }
+
+      //! Coordinates of the ith atom
+      GCoord coords(const uint i) const {
+        return(GCoord(value(_x, i), value(_y, i), value(_z, i)));
+      }
+
+      float x(const uint i) const { return(value(_x, i)); }
+      float y(const uint i) const { return(value(_y, i)); }
+      float z(const uint i) const { return(value(_z, i)); }
+
+      //! Copy the frame into structure-of-arrays buffers (each must hold size() elements)
+      void copy(greal* x, greal* y, greal* z) const;
+
+      //! Copy the frame into a vector of GCoords
+      std::vector<GCoord> coords() const;
+
+      bool hasPeriodicBox() const { return(_crystal != 0); }
+
+      //! Crystal parameters in the same order as DCD::crystalParams()
+      std::vector<double> crystalParams() const;
+
+      GCoord periodicBox() const;
+
+    private:
+      float value(const unsigned char* p, const uint i) const;
+
+      const unsigned char *_x, *_y, *_z, *_crystal;
+      uint _n;
+      bool _swabbing;
+    };
+
+
+    //! Map the DCD named \a fname
+    explicit MappedDCD(const std::string& fname);
+
+    virtual ~MappedDCD();
+
+    //! Compressed files cannot be mapped, so they are read as a DCD instead
+    static pTraj create(const std::string& fname, const AtomicGroup& model);
+
+    std::string description() const { return("CHARMM/NAMD DCD (memory-mapped)"); }
+
+    virtual uint natoms(void) const { return(_natoms); }
+    virtual uint nframes(void) const { return(_nframes); }
+    virtual float timestep(void) const { return(_delta); }
+
+    virtual bool hasPeriodicBox(void) const { return(_icntrl[10] == 1); }
+    virtual GCoord periodicBox(void) const { return(_current.periodicBox()); }
+
+    virtual bool hasVelocities() const { return(false); }
+    virtual double velocityConversionFactor() const { return(20.45482706); }
+
+    virtual std::vector<GCoord> coords(void) const { return(_current.coords()); }
+
+    std::vector<std::string> titles(void) const { return(_titles); }
+    int icntrl(const int i) const;
+    bool nativeFormat(void) const { return(!_swabbing); }
+
+    //! Returns a view of the ith frame without changing the current frame
+    FrameView frame(const uint i) const;
+
+    //! Returns a view of the most recently read frame
+    FrameView currentFrameView() const { return(_current); }
+
+    //! Hint to the OS that frames will be read in order
+    void adviseSequential();
+
+    //! Hint to the OS that frames will be read in a random order
+    void adviseRandom();
+
+    virtual bool parseFrame(void);
+
+  private:
+    // Not copyable (the mapping is owned)
+    MappedDCD(const MappedDCD&);
+    MappedDCD& operator=(const MappedDCD&);
+
+    void mapFile();
+    void unmapFile();
+    void readHeader();
+    uint readRecordLen(const size_t offset) const;
+    uint readHeaderRecordLen(const size_t offset, const uint minlen) const;
+
+    virtual void seekNextFrameImpl(void) { }
+    virtual void seekFrameImpl(const uint);
+    virtual void rewindImpl(void) { }
+    virtual void updateGroupCoordsImpl(AtomicGroup& g);
+    virtual void copyCoordsImpl(greal* x, greal* y, greal* z) const;
+
+
+    int _fd;
+    const unsigned char* _map;
+    size_t _size;
+
+    int _icntrl[20];
+    uint _natoms, _nframes;
+    float _delta;
+    std::vector<std::string> _titles;
+    bool _swabbing;
+
+    size_t _first_frame_pos;
+    size_t _frame_size;
+
+    FrameView _current;
+  };
+
+}
+
+
+#endif
@@ -41,6 +41,7 @@
 #include <cryst.hpp>
 #include <utils.hpp>
 #include <utils_structural.hpp>
+#include <CompressedStream.hpp>
 
 
 
@@ -80,10 +81,8 @@ namespace loos {
               _missing_q(false), _missing_b(false), _missing_segid(false),
               _fname(fname)
         {
-            std::ifstream ifs(fname.c_str());
-            if (!ifs)
-                throw(FileOpenError(fname));
-            read(ifs);
+            boost::shared_ptr<std::istream> ifs = openInputStream(fname);
+            read(*ifs);
         }
       
         //! Read in a PDB from an ifstream
@@ -30,6 +30,7 @@
 
 #include <loos_defs.hpp>
 #include <AtomicGroup.hpp>
+#include <CompressedStream.hpp>
 
 
 namespace loos {
@@ -63,10 +64,8 @@ namespace loos {
     virtual ~PSF() {}
 
     explicit PSF(const std::string& fname) : _max_index(0), _filename(fname) {
-      std::ifstream ifs(fname.c_str());
-      if (!ifs)
-        throw(FileOpenError(fname));
-      read(ifs);
+      boost::shared_ptr<std::istream> ifs = openInputStream(fname);
+      read(*ifs);
     }
 
     explicit PSF(std::fstream &ifs) : _max_index(0), _filename("stream") {
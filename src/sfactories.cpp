@@ -33,8 +33,10 @@
 #include <psf.hpp>
 #include <amber.hpp>
 
+#include <CompressedStream.hpp>
 #include <Trajectory.hpp>
 #include <dcd.hpp>
+#include <mapped_dcd.hpp>
 #include <amber_traj.hpp>
 
 #if defined(HAS_NETCDF)
@@ -59,6 +61,22 @@ namespace loos {
 
 
   namespace internal {
+
+    // The suffix giving the type of a file, skipping over any suffix
+    // for compression (e.g. foo.dcd.gz is a DCD)
+    std::string typeSuffix(const std::string& filename) {
+      boost::tuple<std::string, std::string> names = splitFilename(filename);
+      std::string suffix = boost::get<1>(names);
+      boost::to_lower(suffix);
+      if (isCompressedSuffix(suffix)) {
+        names = splitFilename(boost::get<0>(names));
+        suffix = boost::get<1>(names);
+        boost::to_lower(suffix);
+      }
+      return(suffix);
+    }
+
+
     struct SystemNameBindingType {
       std::string suffix;
       std::string type;
@@ -102,12 +120,10 @@ namespace loos {
 
   pAtomicGroup createSystemPtr(const std::string& filename) {
 
-    boost::tuple<std::string, std::string> names = splitFilename(filename);
-    std::string suffix = boost::get<1>(names);
+    std::string suffix = internal::typeSuffix(filename);
     if (suffix.empty())
       throw(std::runtime_error("Error- system filename must end in an extension or the filetype must be explicitly specified"));
 
-    boost::to_lower(suffix);
     return(createSystemPtr(filename, suffix));
   }
 
@@ -142,6 +158,7 @@ namespace loos {
       { "rst", "Amber Restart", &AmberRst::create},
       { "rst7", "Amber Restart", &AmberRst::create},
       { "dcd", "CHARMM/NAMD DCD", &DCD::create},
+      { "mdcd", "CHARMM/NAMD DCD (memory-mapped)", &MappedDCD::create},
       { "pdb", "Concatenated PDB", &CCPDB::create},
       { "trr", "Gromacs TRR", &TRR::create},
       { "xtc", "Gromacs XTC", &XTC::create},
@@ -182,13 +199,10 @@ namespace loos {
 
 
   pTraj createTrajectory(const std::string& filename, const AtomicGroup& g) {
-    boost::tuple<std::string, std::string> names = splitFilename(filename);
-    std::string suffix = boost::get<1>(names);
-
+    std::string suffix = internal::typeSuffix(filename);
     if (suffix.empty())
       throw(std::runtime_error("Error- trajectory filename must end in an extension or the filetype must be explicitly specified"));
 
-    boost::to_lower(suffix);
     return(createTrajectory(filename, suffix, g));
   }
 
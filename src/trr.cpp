@@ -160,6 +160,9 @@ namespace loos {
 
 	void TRR::updateGroupCoordsImpl(AtomicGroup& g) {
 
+		if (!hasCoords())
+			throw(FileReadError(_filename, "TRR frame has no coordinates"));
+
 		for (AtomicGroup::iterator i = g.begin(); i != g.end(); ++i) {
 			uint idx = (*i)->index();
 			if (static_cast<uint>(idx) >= natoms())
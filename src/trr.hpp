@@ -188,18 +188,41 @@ namespace loos {
 		// into GCoords, scaling from nm to Angstroms along the way...
 		template<typename T>
 		void readBlock(std::vector<GCoord>& v, const uint n, const std::string& msg) {
-			T* buf = new T[n];
-			if (buf == 0)
-				throw(std::runtime_error("Out of memory"));
+			// The raw buffer is kept between frames to avoid allocating...
+			if (rawbuf_.size() < n * sizeof(T))
+				rawbuf_.resize(n * sizeof(T));
+			T* buf = reinterpret_cast<T*>(&(rawbuf_[0]));
 
-			if (xdr_file.read(buf, n) != n) {
-				delete[] buf;
+			if (xdr_file.read(buf, n) != n)
 				throw(FileReadError(_filename, "Unable to read " + msg));
-			}
 			for (uint i=0; i<n; i += DIM)
 				v.push_back(GCoord(buf[i], buf[i+1], buf[i+2]) * 10.0);
+		}
 
-			delete[] buf;
+
+		// As above, but only reads the atoms in the current subset,
+		// seeking past the rest.  Entries in v for other atoms are left
+		// as they were.
+		template<typename T>
+		void readBlockSubset(std::vector<GCoord>& v, const uint natoms, const std::string& msg) {
+			std::istream* is = xdr_file.get();
+			std::streampos start = is->tellg();
+			v.resize(natoms);
+
+			for (std::vector<AtomRun>::const_iterator r = _runs.begin(); r != _runs.end() && r->first < natoms; ++r) {
+				uint n = std::min(r->count, natoms - r->first) * DIM;
+				if (rawbuf_.size() < n * sizeof(T))
+					rawbuf_.resize(n * sizeof(T));
+				T* buf = reinterpret_cast<T*>(&(rawbuf_[0]));
+
+				is->seekg(start + static_cast<std::streamoff>(r->first * DIM * sizeof(T)));
+				if (xdr_file.read(buf, n) != n)
+					throw(FileReadError(_filename, "Unable to read " + msg));
+				for (uint i=0; i<n; i += DIM)
+					v[r->first + i/DIM] = GCoord(buf[i], buf[i+1], buf[i+2]) * 10.0;
+			}
+
+			is->seekg(start + static_cast<std::streamoff>(natoms * DIM * sizeof(T)));
 		}
 
 
@@ -211,9 +234,11 @@ namespace loos {
 			box_.clear();
 			vir_.clear();
 			pres_.clear();
-			velo_.clear();
-			forc_.clear();
-			coords_.clear();
+			if (_runs.empty()) {
+				velo_.clear();
+				forc_.clear();
+				coords_.clear();
+			}
 
 			if (hdr_.box_size) {
 				readBlock<T>(box_, DIM*DIM, "box");
@@ -226,14 +251,33 @@ namespace loos {
 			if (hdr_.pres_size)
 				readBlock<T>(pres_, DIM*DIM, "pressure");
 
-			if (hdr_.x_size)
-				readBlock<T>(coords_, hdr_.natoms * DIM, "Coordinates");
-
-			if (hdr_.v_size)
-				readBlock<T>(velo_, hdr_.natoms * DIM, "Velocities");
-
-			if (hdr_.f_size)
-				readBlock<T>(forc_, hdr_.natoms * DIM, "Forces");
+			if (_runs.empty()) {
+				if (hdr_.x_size)
+					readBlock<T>(coords_, hdr_.natoms * DIM, "Coordinates");
+
+				if (hdr_.v_size)
+					readBlock<T>(velo_, hdr_.natoms * DIM, "Velocities");
+
+				if (hdr_.f_size)
+					readBlock<T>(forc_, hdr_.natoms * DIM, "Forces");
+			} else {
+				// The blocks are kept between frames, so drop any this
+				// frame does not have
+				if (hdr_.x_size)
+					readBlockSubset<T>(coords_, hdr_.natoms, "Coordinates");
+				else
+					coords_.clear();
+
+				if (hdr_.v_size)
+					readBlockSubset<T>(velo_, hdr_.natoms, "Velocities");
+				else
+					velo_.clear();
+
+				if (hdr_.f_size)
+					readBlockSubset<T>(forc_, hdr_.natoms, "Forces");
+				else
+					forc_.clear();
+			}
 
 
 			return(! ((xdr_file.get())->fail() || (xdr_file.get())->eof()) );
@@ -244,8 +288,19 @@ namespace loos {
 		void seekFrameImpl(uint);
 		void updateGroupCoordsImpl(AtomicGroup& g);
 		void updateGroupVelocitiesImpl(AtomicGroup& g);
+
+		// Gaps smaller than a typical stream buffer are read through
+		void atomSubsetImpl() { _runs = atomRuns(8192 / (DIM * sizeof(float))); }
 		std::vector<GCoord> velocitiesImpl() const { return(velo_); }
 
+		void copyCoordsImpl(greal* x, greal* y, greal* z) const {
+			for (uint i=0; i<coords_.size(); ++i) {
+				x[i] = coords_[i].x();
+				y[i] = coords_[i].y();
+				z[i] = coords_[i].z();
+			}
+		}
+
 
 	private:
 		internal::XDRReader xdr_file;
@@ -259,6 +314,8 @@ namespace loos {
 		std::vector<double> pres_;
 		std::vector<GCoord> velo_;
 		std::vector<GCoord> forc_;
+		std::vector<char> rawbuf_;        // Scratch space reused between frames
+		std::vector<AtomRun> _runs;       // Parts of each frame to read (empty = all)
 
 		Header hdr_;
 	};
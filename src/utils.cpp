@@ -42,6 +42,7 @@
 
 #include <Selectors.hpp>
 #include <Parser.hpp>
+#include <CompiledSelection.hpp>
 
 #include <utils.hpp>
 
@@ -203,8 +204,8 @@ namespace loos {
       throw(ParseError("Error in parsing '" + selection + "' ... " + e.what()));
     }
 
-    KernelSelector selector(parser.kernel());
-    AtomicGroup subset = source.select(selector);
+    CompiledSelection selector(parser.kernel());
+    AtomicGroup subset = selector.select(source);
 
     return(subset);
   }
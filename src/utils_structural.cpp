@@ -24,6 +24,8 @@
 #include <sstream>
 #include <iomanip>
 #include <vector>
+#include <map>
+#include <algorithm>
 
 
 #include <utils_structural.hpp>
@@ -124,4 +126,34 @@ namespace loos {
 
 
 
+  namespace {
+    // The atoms of a group, in a canonical order
+    std::vector<const Atom*> groupKey(const AtomicGroup& g) {
+      std::vector<const Atom*> key(g.size());
+      for (uint i=0; i<g.size(); ++i)
+        key[i] = g[i].get();
+      std::sort(key.begin(), key.end());
+      return(key);
+    }
+  }
+
+
+  std::vector< std::vector<uint> > findIdenticalGroups(const std::vector<AtomicGroup>& a, const std::vector<AtomicGroup>& b) {
+    typedef std::map< std::vector<const Atom*>, std::vector<uint> >   KeyMap;
+
+    KeyMap keys;
+    for (uint i=0; i<b.size(); ++i)
+      keys[groupKey(b[i])].push_back(i);
+
+    std::vector< std::vector<uint> > matches(a.size());
+    for (uint i=0; i<a.size(); ++i) {
+      KeyMap::const_iterator k = keys.find(groupKey(a[i]));
+      if (k != keys.end())
+        matches[i] = k->second;
+    }
+
+    return(matches);
+  }
+
+
 };
@@ -48,6 +48,17 @@ namespace loos {
   //! Builds a list of trajectory indices (frame_index_spec supercedes skip)
   std::vector<uint> assignTrajectoryFrames(const pTraj& traj, const std::string& frame_index_spec, uint skip = 0, uint stride = 1);
 
+  //! Finds the groups in \a b that contain the same atoms as each group in \a a
+  /**
+   * Returns a vector with one entry per group in \a a, listing (in
+   * ascending order) the indices of the groups in \a b that are
+   * equal to it (i.e. AtomicGroup::operator==).  Groups are looked
+   * up in a map keyed on their atoms rather than comparing every
+   * pair, so this is fast even with many thousands of groups, e.g.
+   * when skipping self-pairs in tools with overlapping selections.
+   */
+  std::vector< std::vector<uint> > findIdenticalGroups(const std::vector<AtomicGroup>& a, const std::vector<AtomicGroup>& b);
+
 };
 
 #endif
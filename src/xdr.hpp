@@ -95,9 +95,32 @@ namespace loos {
 
 
       //! Read an n-array of data
+      /**
+       * Data that are the same size as the external block are read
+       * with a single call to the stream and then swabbed in-place.
+       */
       template<typename T> uint read(T* ary, const uint n) {
 	uint i;
-	for (i=0; i<n && read(ary+i); ++i) ;
+	if (sizeof(T) != sizeof(block_type)) {
+	  for (i=0; i<n && read(ary+i); ++i) ;
+	  return(i);
+	}
+
+	stream->read(reinterpret_cast<char*>(ary), n * sizeof(T));
+	i = stream->gcount() / sizeof(T);
+	if (need_to_swab)
+	  for (uint j=0; j<i; ++j)
+	    ary[j] = swab(ary[j]);
+	return(i);
+      }
+
+      //! Read an n-array of doubles
+      uint read(double* ary, const uint n) {
+	stream->read(reinterpret_cast<char*>(ary), n * sizeof(double));
+	uint i = stream->gcount() / sizeof(double);
+	if (need_to_swab)
+	  for (uint j=0; j<i; ++j)
+	    ary[j] = swab(ary[j]);
 	return(i);
       }
 
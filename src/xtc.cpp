@@ -28,6 +28,16 @@
 */
 
 
+#include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include <xtc.hpp>
 
 
@@ -98,51 +108,132 @@ namespace loos {
   }
 
   
-  int XTC::decodebits(int* buf, uint nbits) {
+  // The compressed coordinate stream is a sequence of bit-fields,
+  // most-significant bit first.  Rather than pulling one byte at a
+  // time, the reader keeps up to 64 bits buffered and refills from 8
+  // bytes at once.  The byte buffer must be padded with at least 8
+  // bytes past the end of the data.
+  class XTC::BitReader {
+  public:
+    explicit BitReader(const unsigned char* p) : p_(p), acc_(0), avail_(0) { }
+
+    // Read nbits <= 32
+    uint32_t bits(const uint nbits) {
+      if (avail_ < nbits)
+        refill();
+      avail_ -= nbits;
+      return(static_cast<uint32_t>((acc_ >> avail_) & ((static_cast<uint64_t>(1) << nbits) - 1)));
+    }
 
-    int mask = (1 << nbits) -1;
+    // Read nbits <= 64
+    uint64_t wideBits(const uint nbits) {
+      if (nbits <= 32)
+        return(bits(nbits));
+      uint64_t hi = bits(nbits - 32);
+      return( (hi << 32) | bits(32) );
+    }
 
-    unsigned char *cbuf = reinterpret_cast<unsigned char*>(buf) + 3*sizeof(*buf);
-    int cnt = buf[0];
-    uint lastbits = static_cast<uint>(buf[1]);
-    uint lastbyte = static_cast<uint>(buf[2]);
-    
-    int num = 0;
-    while (nbits >= 8) {
-      lastbyte = ( lastbyte << 8 ) | cbuf[cnt++];
-      num |=  (lastbyte >> lastbits) << (nbits - 8);
-      nbits -=8;
+  private:
+    void refill() {
+      uint64_t w = (static_cast<uint64_t>(p_[0]) << 56) | (static_cast<uint64_t>(p_[1]) << 48)
+        | (static_cast<uint64_t>(p_[2]) << 40) | (static_cast<uint64_t>(p_[3]) << 32)
+        | (static_cast<uint64_t>(p_[4]) << 24) | (static_cast<uint64_t>(p_[5]) << 16)
+        | (static_cast<uint64_t>(p_[6]) << 8) | static_cast<uint64_t>(p_[7]);
+      uint nbytes = (63 - avail_) >> 3;
+      acc_ = (acc_ << (nbytes * 8)) | (w >> (64 - nbytes * 8));
+      p_ += nbytes;
+      avail_ += nbytes * 8;
     }
-    if (nbits > 0) {
-      if (lastbits < nbits) {
-        lastbits += 8;
-        lastbyte = (lastbyte << 8) | cbuf[cnt++];
+
+    const unsigned char* p_;
+    uint64_t acc_;
+    uint avail_;
+  };
+
+
+  namespace {
+
+    // A packed integer triplet is stored as a little-endian sequence
+    // of bytes, with each byte written MSB-first.  Given the bits in
+    // the order they were read, this returns the integer they encode.
+    inline uint64_t bitsToInteger(uint64_t v, const uint nbits) {
+      uint rem = nbits & 7;
+      uint nfull = nbits >> 3;
+      uint64_t partial = v & ((1u << rem) - 1);
+      v >>= rem;
+
+      uint64_t n = 0;
+      for (uint k=0; k<nfull; ++k) {
+        n = (n << 8) | (v & 0xff);
+        v >>= 8;
       }
-      lastbits -= nbits;
-      num |= (lastbyte >> lastbits) & ((1 << nbits) -1);
+      if (rem)
+        n |= partial << (nfull * 8);
+      return(n);
     }
-    num &= mask;
-    buf[0] = cnt;
-    buf[1] = static_cast<int>(lastbits);
-    buf[2] = static_cast<int>(lastbyte);
 
-    return(num);
+
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 uint128_t;
+#endif
+
+    // Division of a 32-bit number by a fixed divisor (the current
+    // magicint), using a precomputed reciprocal where the compiler
+    // supports 128-bit products.  With m = ceil(2^64 / d), the
+    // quotient is exact for all n < 2^32 and d < 2^32.
+    struct FixedDivisor {
+      FixedDivisor() : d(1), m(0) { }
+
+      void set(const uint32_t divisor) {
+        d = divisor;
+        m = ~static_cast<uint64_t>(0) / d + 1;
+      }
+
+      uint32_t divide(const uint32_t n) const {
+#if defined(__SIZEOF_INT128__)
+        return(static_cast<uint32_t>((static_cast<uint128_t>(n) * m) >> 64));
+#else
+        return(n / d);
+#endif
+      }
+
+      uint32_t d;
+      uint64_t m;
+    };
+
   }
 
 
-  void XTC::decodeints(int* buf, const int nints, int nbits,
-                       uint* sizes, int* nums) {
+  // Unpacks nints integers packed into nbits using the mixed-radix
+  // sizes.  When the packed value fits in 64 bits it is decoded with
+  // ordinary integer division, otherwise the original byte-wise long
+  // division is used.
+  void XTC::decodeints(BitReader& bits, const int nints, const uint nbits,
+                       const uint* sizes, int* nums) {
+
+    if (nbits <= 64) {
+      uint64_t n = bitsToInteger(bits.wideBits(nbits), nbits);
+      for (int i = nints-1; i > 0; --i) {
+        uint64_t q = n / sizes[i];
+        nums[i] = static_cast<int>(n - q * sizes[i]);
+        n = q;
+      }
+      nums[0] = static_cast<int>(static_cast<uint32_t>(n));
+      return;
+    }
+
     int bytes[32];
     int i, j, num_of_bytes, p, num;
-  
+    uint nb = nbits;
+
     bytes[1] = bytes[2] = bytes[3] = 0;
     num_of_bytes = 0;
-    while (nbits > 8) {
-      bytes[num_of_bytes++] = decodebits(buf, 8);
-      nbits -= 8;
+    while (nb > 8) {
+      bytes[num_of_bytes++] = bits.bits(8);
+      nb -= 8;
     }
-    if (nbits > 0) {
-      bytes[num_of_bytes++] = decodebits(buf, nbits);
+    if (nb > 0) {
+      bytes[num_of_bytes++] = bits.bits(nb);
     }
     for (i = nints-1; i > 0; i--) {
       num = 0;
@@ -160,17 +251,24 @@ namespace loos {
 
 
   // Coordinates are converted into GCoords and stored in the object's
-  // coords_ vector
+  // coords_ vector.
+  //
+  // The integer coordinates are first decoded into intbuf_ (in output
+  // order), then scaled to Angstroms in a separate pass so that the
+  // conversion loop can be vectorized.  The arithmetic is kept
+  // exactly as in the xdrfile library (int -> float, scaled by the
+  // single precision inverse, then to double) so results are
+  // bit-for-bit identical.
 
   bool XTC::readCompressedCoords(void)
   {
-    int minint[3], maxint[3], *lip;
+    int minint[3], maxint[3];
     int smallidx;
     uint sizeint[3], sizesmall[3], bitsizeint[3] = {0,0,0}, size3;
-    int k, *buf1, *buf2, lsize, flag;
+    int lsize;
     int smallnum, smaller, i, is_smaller, run;
     xtc_t precision, inv_precision;
-    int tmp, *thiscoord,  prevcoord[3];
+    int thiscoord[3], prevcoord[3];
     unsigned int bitsize;
   
      
@@ -181,11 +279,12 @@ namespace loos {
 
     /* Dont bother with compression for three atoms or less */
     if(lsize<=9) {
-      float* tmp = new xtc_t[size3];
+      if (rawbuf_.size() < size3)
+        rawbuf_.resize(size3);
+      xtc_t* tmp = &(rawbuf_[0]);
       xdr_file.read(tmp, size3);
       for (uint i=0; i<size3; i += 3)
         coords_.push_back(GCoord(tmp[i], tmp[i+1], tmp[i+2]) * 10.0);
-      delete[] tmp;
       return(true);
     }
 
@@ -193,11 +292,6 @@ namespace loos {
     xdr_file.read(precision);
     precision_ = precision;
   
-    int size3padded = static_cast<int>(size3 * 1.2);
-    buf1 = new int[size3padded];
-    buf2 = new int[size3padded];
-    /* buf2[0-2] are special and do not contain actual data */
-    buf2[0] = buf2[1] = buf2[2] = 0;
     xdr_file.read(minint, 3);
     xdr_file.read(maxint, 3);
   
@@ -215,47 +309,47 @@ namespace loos {
       bitsize = sizeofints(sizeint, 3);
     }
 	
-    if (!xdr_file.read(smallidx)) {
-      delete[] buf1;
-      delete[] buf2;
+    if (!xdr_file.read(smallidx))
       return(false);
-    }
+    if (smallidx < firstidx || smallidx >= lastidx)
+      throw(FileReadError(_filename, "Corrupted XTC frame (bad smallidx)"));
 
-    tmp=smallidx+8;
-    tmp = smallidx-1;
-    tmp = (firstidx>tmp) ? firstidx : tmp;
-    smaller = magicints[tmp] / 2;
+    smaller = magicints[std::max(firstidx, smallidx - 1)] / 2;
     smallnum = magicints[smallidx] / 2;
     sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx] ;
 
-    /* buf2[0] holds the length in bytes */
-  
-    if (!xdr_file.read(buf2, 1)) {
-      delete[] buf1;
-      delete[] buf2;
+    // Compressed data is kept in a buffer reused between frames, with
+    // padding so the BitReader can always fetch 8 bytes at a time...
+    uint nbytes;
+    if (!xdr_file.read(nbytes))
       return(false);
-    }
 
-    if (!xdr_file.read(reinterpret_cast<char*>(&(buf2[3])), static_cast<uint>(buf2[0]))) {
-      delete[] buf1;
-      delete[] buf2;
+    uint nblocks = (nbytes + sizeof(internal::XDRReader::block_type) - 1) / sizeof(internal::XDRReader::block_type);
+    uint padded = nblocks * sizeof(internal::XDRReader::block_type) + 8;
+    if (bytebuf_.size() < padded)
+      bytebuf_.resize(padded);
+    if (!xdr_file.read(reinterpret_cast<char*>(&(bytebuf_[0])), nbytes))
       return(false);
-    }
-    buf2[0] = buf2[1] = buf2[2] = 0;
-  
-    inv_precision = 1.0 / precision;
+    memset(&(bytebuf_[nbytes]), 0, padded - nbytes);
+
+    if (intbuf_.size() < size3)
+      intbuf_.resize(size3);
+    int* out = &(intbuf_[0]);
+    int* const out_end = out + size3;
+
+    BitReader bits(&(bytebuf_[0]));
+    FixedDivisor divisor;
+    divisor.set(sizesmall[0]);
+
     run = 0;
     i = 0;
-    lip = buf1;
     while ( i < lsize ) {
-      thiscoord = (int *)(lip) + i * 3;
-    
       if (bitsize == 0) {
-        thiscoord[0] = decodebits(buf2, bitsizeint[0]);
-        thiscoord[1] = decodebits(buf2, bitsizeint[1]);
-        thiscoord[2] = decodebits(buf2, bitsizeint[2]);
+        thiscoord[0] = bits.bits(bitsizeint[0]);
+        thiscoord[1] = bits.bits(bitsizeint[1]);
+        thiscoord[2] = bits.bits(bitsizeint[2]);
       } else {
-        decodeints(buf2, 3, bitsize, sizeint, thiscoord);
+        decodeints(bits, 3, bitsize, sizeint, thiscoord);
       }
     
       i++;
@@ -267,18 +361,31 @@ namespace loos {
       prevcoord[1] = thiscoord[1];
       prevcoord[2] = thiscoord[2];
     
-      flag = decodebits(buf2, 1);
       is_smaller = 0;
-      if (flag == 1) {
-        run = decodebits(buf2, 5);
+      if (bits.bits(1)) {
+        run = bits.bits(5);
         is_smaller = run % 3;
         run -= is_smaller;
         is_smaller--;
       }
+
+      if (out + 3 + run > out_end)
+        throw(FileReadError(_filename, "Corrupted XTC frame (too many atoms)"));
+
       if (run > 0) {
-        thiscoord += 3;
-        for (k = 0; k < run; k+=3) {
-          decodeints(buf2, 3, smallidx, sizesmall, thiscoord);
+        // Fast path for runs of small differences: the packed triplet
+        // fits in 32 bits whenever smallidx does, so it can be split
+        // with two reciprocal multiplies instead of long division
+        for (int k = 0; k < run; k+=3) {
+          if (smallidx <= 32) {
+            uint32_t n = static_cast<uint32_t>(bitsToInteger(bits.bits(smallidx), smallidx));
+            uint32_t q = divisor.divide(n);
+            thiscoord[2] = n - q * divisor.d;
+            n = divisor.divide(q);
+            thiscoord[1] = q - n * divisor.d;
+            thiscoord[0] = n;
+          } else
+            decodeints(bits, 3, smallidx, sizesmall, thiscoord);
           i++;
           thiscoord[0] += prevcoord[0] - smallnum;
           thiscoord[1] += prevcoord[1] - smallnum;
@@ -287,47 +394,57 @@ namespace loos {
             /* interchange first with second atom for better
              * compression of water molecules
              */
-            tmp = thiscoord[0]; thiscoord[0] = prevcoord[0];
-            prevcoord[0] = tmp;
-            tmp = thiscoord[1]; thiscoord[1] = prevcoord[1];
-            prevcoord[1] = tmp;
-            tmp = thiscoord[2]; thiscoord[2] = prevcoord[2];
-            prevcoord[2] = tmp;
-
-            coords_.push_back(GCoord(prevcoord[0] * inv_precision,
-                                prevcoord[1] * inv_precision,
-                                prevcoord[2] * inv_precision) * 10.0);
+            *out++ = thiscoord[0];
+            *out++ = thiscoord[1];
+            *out++ = thiscoord[2];
+            std::swap(thiscoord[0], prevcoord[0]);
+            std::swap(thiscoord[1], prevcoord[1]);
+            std::swap(thiscoord[2], prevcoord[2]);
           } else {
             prevcoord[0] = thiscoord[0];
             prevcoord[1] = thiscoord[1];
             prevcoord[2] = thiscoord[2];
           }
-          coords_.push_back(GCoord(thiscoord[0] * inv_precision,
-                              thiscoord[1] * inv_precision,
-                              thiscoord[2] * inv_precision) * 10.0);
+          *out++ = thiscoord[0];
+          *out++ = thiscoord[1];
+          *out++ = thiscoord[2];
         }
       } else {
-        coords_.push_back(GCoord(thiscoord[0] * inv_precision,
-                            thiscoord[1] * inv_precision,
-                            thiscoord[2] * inv_precision) * 10.0);
+        *out++ = thiscoord[0];
+        *out++ = thiscoord[1];
+        *out++ = thiscoord[2];
       }
+
       smallidx += is_smaller;
-      if (is_smaller < 0) {
-        smallnum = smaller;
-        if (smallidx > firstidx) {
-          smaller = magicints[smallidx - 1] /2;
+      if (is_smaller != 0) {
+        if (smallidx < firstidx || smallidx >= lastidx)
+          throw(FileReadError(_filename, "Corrupted XTC frame (bad smallidx)"));
+        if (is_smaller < 0) {
+          smallnum = smaller;
+          if (smallidx > firstidx) {
+            smaller = magicints[smallidx - 1] /2;
+          } else {
+            smaller = 0;
+          }
         } else {
-          smaller = 0;
+          smaller = smallnum;
+          smallnum = magicints[smallidx] / 2;
         }
-      } else if (is_smaller > 0) {
-        smaller = smallnum;
-        smallnum = magicints[smallidx] / 2;
+        sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx] ;
+        divisor.set(sizesmall[0]);
       }
-      sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx] ;
     }
 
-    delete[] buf1;
-    delete[] buf2;
+    // Scale everything at once...
+    uint n = (out - &(intbuf_[0])) / 3;
+    coords_.resize(n);
+    const int* ip = &(intbuf_[0]);
+    inv_precision = 1.0 / precision;
+    for (uint j=0; j<n; ++j, ip += 3)
+      coords_[j] = GCoord(static_cast<xtc_t>(ip[0]) * inv_precision * 10.0,
+                          static_cast<xtc_t>(ip[1]) * inv_precision * 10.0,
+                          static_cast<xtc_t>(ip[2]) * inv_precision * 10.0);
+
     return(true);
   }
 
@@ -341,8 +458,10 @@ namespace loos {
 	  return(false);
       
       uint size3 = lsize * 3;
-      coords_ = std::vector<GCoord>(lsize);
-      float* tmp_coords = new float[size3];
+      coords_.resize(lsize);
+      if (rawbuf_.size() < size3)
+        rawbuf_.resize(size3);
+      xtc_t* tmp_coords = &(rawbuf_[0]);
       uint n = xdr_file.read(tmp_coords, size3);
       if (n != size3)
 	throw(FileReadError(_filename, "XTC Error: number of uncompressed coords read did not match number expected"));
@@ -351,7 +470,6 @@ namespace loos {
       for (uint j=0; j<lsize; ++j, i += 3)
 	  coords_[j] = GCoord(tmp_coords[i], tmp_coords[i+1], tmp_coords[i+2]) * 10.0;
       
-      delete[] tmp_coords;
       return(true);
   }
     
@@ -371,6 +489,15 @@ namespace loos {
   }
 
 
+  void XTC::copyCoordsImpl(greal* x, greal* y, greal* z) const {
+    for (uint i=0; i<coords_.size(); ++i) {
+      x[i] = coords_[i].x();
+      y[i] = coords_[i].y();
+      z[i] = coords_[i].z();
+    }
+  }
+
+
   bool XTC::parseFrame(void) {
     if (ifs->eof())
       return(false);
@@ -418,11 +545,31 @@ namespace loos {
 
   // Scan the trajectory file, skipping each compressed frame.  In the
   // process, we build up an index relating file-pos to frame index.
-  // This permits fast seeking of indivual frames.
+  // This permits fast seeking of indivual frames.  If a sidecar index
+  // exists, only the frames past what it covers are scanned.
   void XTC::scanFrames(void) {
     frame_indices.clear();
-    
-    rewindImpl();
+    frame_info_.clear();
+    ncomplete_ = 0;
+    scanned_end_ = 0;
+
+    bool use_index = indexable_ && use_index_files_;
+    bool exact = false;
+    if (use_index)
+      readFrameIndex(exact);
+
+    scanFramesFrom(scanned_end_);
+
+    if (use_index && !exact)
+      writeFrameIndex();
+  }
+
+
+  void XTC::scanFramesFrom(const size_t start) {
+    ifs->clear();
+    ifs->seekg(0, std::ios_base::end);
+    size_t file_size = ifs->tellg();
+    ifs->seekg(start, std::ios_base::beg);
 
     Header h;
     
@@ -441,6 +588,14 @@ namespace loos {
       else if (natoms_ != h.natoms)
         throw(FileOpenError(_filename, "XTC frames have differing numbers of atoms"));
 
+      FrameInfo info;
+      info.step = h.step;
+      info.time = h.time;
+      info.box[0] = h.box[0];
+      info.box[1] = h.box[4];
+      info.box[2] = h.box[8];
+      frame_info_.push_back(info);
+
       uint block_size = sizeof(internal::XDRReader::block_type);
 
       // Always update estimated timestep...
@@ -468,6 +623,14 @@ namespace loos {
         ++nblocks;   // round up
       offset = nblocks * block_size;
       ifs->seekg(offset, std::ios_base::cur);
+
+      // Track the last frame that is entirely in the file so a
+      // partially written frame is rescanned the next time around
+      size_t frame_end = ifs->tellg();
+      if (ifs->good() && frame_end <= file_size && ncomplete_ == frame_indices.size() - 1) {
+        ++ncomplete_;
+        scanned_end_ = frame_end;
+      }
     }
 
     // Catch-all for I/O errors
@@ -477,6 +640,176 @@ namespace loos {
   }
 
 
+
+  // --------------------------------------------------------------------------------
+  // Frame index sidecar files...
+  //
+  // The sidecar is written in native byte-order and consists of a
+  // fixed header, followed by the file offset of each frame (as
+  // 64-bit ints), followed by a FrameInfo for each frame.  The
+  // endian marker and record size guard against reading an index
+  // written on an incompatible machine; anything that doesn't check
+  // out is simply ignored and the trajectory is rescanned.
+
+  bool XTC::use_index_files_ = true;
+
+  namespace {
+
+    const char xtc_index_magic[8] = { 'L', 'O', 'O', 'S', 'X', 'T', 'C', 'I' };
+    const uint32_t xtc_index_version = 1;
+    const uint32_t xtc_index_endian = 0x01020304;
+
+    struct XTCIndexHeader {
+      char magic[8];
+      uint32_t version;
+      uint32_t endian;
+      uint64_t file_size;       // Size and mtime of the XTC when the index was written
+      int64_t mtime;
+      uint32_t natoms;
+      uint32_t nframes;
+      uint64_t scanned_end;     // File position just past the last indexed frame
+      uint32_t info_size;
+      uint32_t pad;
+    };
+
+
+    bool statFile(const std::string& fname, uint64_t& size, int64_t& mtime) {
+      struct stat st;
+      if (stat(fname.c_str(), &st) != 0)
+        return(false);
+      size = st.st_size;
+      mtime = st.st_mtime;
+      return(true);
+    }
+
+  }
+
+
+  std::string XTC::frameIndexFilename(const std::string& fname) {
+    std::string::size_type i = fname.rfind('/');
+    if (i == std::string::npos)
+      return("." + fname + ".lidx");
+    return(fname.substr(0, i+1) + "." + fname.substr(i+1) + ".lidx");
+  }
+
+
+  // Loads the sidecar index (if it exists and is valid), setting
+  // exact if it matches the XTC as it is now.  If the XTC has grown,
+  // the last indexed frame is checked to make sure the file was
+  // appended to rather than rewritten.
+  bool XTC::readFrameIndex(bool& exact) {
+    exact = false;
+
+    uint64_t file_size;
+    int64_t mtime;
+    if (!statFile(_filename, file_size, mtime))
+      return(false);
+
+    std::string index_name = frameIndexFilename(_filename);
+    uint64_t index_size;
+    int64_t index_mtime;
+    if (!statFile(index_name, index_size, index_mtime) || index_size < sizeof(XTCIndexHeader))
+      return(false);
+
+    std::ifstream ifx(index_name.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!ifx)
+      return(false);
+
+    XTCIndexHeader hdr;
+    if (!ifx.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)))
+      return(false);
+    if (memcmp(hdr.magic, xtc_index_magic, sizeof(xtc_index_magic)) != 0
+        || hdr.version != xtc_index_version
+        || hdr.endian != xtc_index_endian
+        || hdr.info_size != sizeof(FrameInfo))
+      return(false);
+
+    bool unchanged = (hdr.file_size == file_size && hdr.mtime == mtime);
+    if (!unchanged && hdr.file_size >= file_size)
+      return(false);
+
+    // A truncated or corrupt index must not size the vectors below
+    uint64_t expected = sizeof(hdr) + static_cast<uint64_t>(hdr.nframes) * (sizeof(uint64_t) + sizeof(FrameInfo));
+    if (expected != index_size)
+      return(false);
+
+    std::vector<uint64_t> offsets(hdr.nframes);
+    std::vector<FrameInfo> info(hdr.nframes);
+    if (hdr.nframes > 0) {
+      ifx.read(reinterpret_cast<char*>(&offsets[0]), hdr.nframes * sizeof(uint64_t));
+      ifx.read(reinterpret_cast<char*>(&info[0]), hdr.nframes * sizeof(FrameInfo));
+      if (!ifx)
+        return(false);
+    }
+
+    if (!unchanged && hdr.nframes > 0) {
+      ifs->clear();
+      ifs->seekg(offsets.back(), std::ios_base::beg);
+      Header h;
+      try {
+        if (!readFrameHeader(h) || h.natoms != hdr.natoms || h.step != info.back().step || h.time != info.back().time)
+          return(false);
+      }
+      catch (FileReadError&) {
+        return(false);
+      }
+    }
+
+    natoms_ = hdr.natoms;
+    frame_indices.assign(offsets.begin(), offsets.end());
+    frame_info_.swap(info);
+    ncomplete_ = hdr.nframes;
+    scanned_end_ = hdr.scanned_end;
+
+    for (std::vector<FrameInfo>::const_reverse_iterator i = frame_info_.rbegin(); i != frame_info_.rend(); ++i)
+      if (i->step != 0) {
+        timestep_ = i->time / i->step;
+        break;
+      }
+
+    exact = unchanged;
+    return(true);
+  }
+
+
+  // Writes only the complete frames.  The sidecar is written to a
+  // temporary file first and renamed so another process never sees a
+  // partial index.  Failure to write is not an error.
+  void XTC::writeFrameIndex(void) const {
+    XTCIndexHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    if (!statFile(_filename, hdr.file_size, hdr.mtime))
+      return;
+
+    memcpy(hdr.magic, xtc_index_magic, sizeof(xtc_index_magic));
+    hdr.version = xtc_index_version;
+    hdr.endian = xtc_index_endian;
+    hdr.natoms = natoms_;
+    hdr.nframes = ncomplete_;
+    hdr.scanned_end = scanned_end_;
+    hdr.info_size = sizeof(FrameInfo);
+
+    std::vector<uint64_t> offsets(frame_indices.begin(), frame_indices.begin() + ncomplete_);
+
+    std::string fname = frameIndexFilename(_filename);
+    std::ostringstream tmpname;
+    tmpname << fname << ".tmp" << getpid();
+
+    std::ofstream ofx(tmpname.str().c_str(), std::ios_base::out | std::ios_base::binary);
+    if (!ofx)
+      return;
+    ofx.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    if (ncomplete_ > 0) {
+      ofx.write(reinterpret_cast<const char*>(&offsets[0]), ncomplete_ * sizeof(uint64_t));
+      ofx.write(reinterpret_cast<const char*>(&frame_info_[0]), ncomplete_ * sizeof(FrameInfo));
+    }
+    ofx.close();
+
+    if (!ofx || rename(tmpname.str().c_str(), fname.c_str()) != 0)
+      unlink(tmpname.str().c_str());
+  }
+
+
   void XTC::seekFrameImpl(const uint i) {
     if (i >= frame_indices.size())
       throw(FileError(_filename, "Requested XTC frame is out of range"));
@@ -57,6 +57,18 @@ namespace loos {
    * frames.  This is done by reading only enough of each frame header
    * to permit building the index, so it should be a pretty fast
    * operation.
+   *
+   * For very large trajectories, even this scan can take minutes, so
+   * when an XTC is opened by name the index (along with the step,
+   * time, and box for each frame) is saved to a small sidecar file
+   * next to the trajectory (e.g. ".traj.xtc.lidx" for "traj.xtc").
+   * The sidecar is only reused if the trajectory's size and
+   * modification time match.  If the trajectory has grown since the
+   * sidecar was written (e.g. a simulation that is still running),
+   * only the newly appended frames are scanned.  The sidecar is
+   * written on a best-effort basis, so a read-only directory simply
+   * means the trajectory is scanned every time.  Sidecar files can be
+   * disabled with XTC::useFrameIndexFiles(false).
    */
   class XTC : public Trajectory {
 
@@ -71,6 +83,13 @@ namespace loos {
       float time, box[9];
     };
 
+    // Per-frame metadata kept alongside the frame index
+    struct FrameInfo {
+      uint step;
+      float time;
+      float box[3];
+    };
+
     // Globals required by the decoding routines...
     static const int magicints[];
     static const int firstidx, lastidx;
@@ -82,11 +101,11 @@ namespace loos {
     typedef float    xtc_t;
 
   public:
-    explicit XTC(const std::string& s) : Trajectory(s), xdr_file(ifs.get()),natoms_(0) {
+    explicit XTC(const std::string& s) : Trajectory(s), xdr_file(ifs.get()),natoms_(0), indexable_(true) {
       init();
     }
 
-    explicit XTC(std::istream& is) : Trajectory(is), xdr_file(ifs.get()), natoms_(0) {
+    explicit XTC(std::istream& is) : Trajectory(is), xdr_file(ifs.get()), natoms_(0), indexable_(false) {
       init();
     }
 
@@ -104,6 +123,25 @@ namespace loos {
     uint currentStep(void) const { return(current_header_.step); }
     double currentTime(void) const { return(current_header_.time); }
 
+    //! Step for the ith frame (taken from the index, so no I/O is required)
+    uint frameStep(const uint i) const { return(frame_info_.at(i).step); }
+
+    //! Time for the ith frame (taken from the index)
+    double frameTime(const uint i) const { return(frame_info_.at(i).time); }
+
+    //! Periodic box for the ith frame in Angstroms (taken from the index)
+    GCoord frameBox(const uint i) const {
+      const FrameInfo& f = frame_info_.at(i);
+      return(GCoord(f.box[0], f.box[1], f.box[2]) * 10.0);
+    }
+
+    //! Name of the sidecar file used to cache the frame index for \a fname
+    static std::string frameIndexFilename(const std::string& fname);
+
+    //! Globally enable or disable reading/writing frame index sidecar files
+    static void useFrameIndexFiles(const bool b) { use_index_files_ = b; }
+    static bool usingFrameIndexFiles() { return(use_index_files_); }
+
 
 	std::vector<GCoord> coords(void) const { return(coords_); }
 
@@ -122,10 +160,17 @@ namespace loos {
 
     internal::XDRReader xdr_file;
     std::vector<size_t> frame_indices;
+    std::vector<FrameInfo> frame_info_;
     uint natoms_;
+    bool indexable_;                          // True if we know the filename
+    uint ncomplete_;                          // Frames that lie entirely within the file
+    size_t scanned_end_;                      // File position just past the last complete frame
     GCoord box;
     double precision_;
     std::vector<GCoord> coords_;
+    std::vector<xtc_t> rawbuf_;               // Scratch space reused between frames
+    std::vector<int> intbuf_;
+    std::vector<unsigned char> bytebuf_;
     double timestep_;
     Header current_header_;
     
@@ -135,15 +180,21 @@ namespace loos {
 
     int sizeofint(int);
     int sizeofints(uint*, const uint);
-    int decodebits(int*, uint);
-    void decodeints(int*, const int, int, uint*, int*);
+    class BitReader;
+    void decodeints(BitReader&, const int, const uint, const uint*, int*);
     bool readFrameHeader(Header&);
     void scanFrames(void);
+    void scanFramesFrom(const size_t pos);
+    bool readFrameIndex(bool& exact);
+    void writeFrameIndex(void) const;
+
+    static bool use_index_files_;
     
     void seekNextFrameImpl(void) { }
     void seekFrameImpl(uint);
     void rewindImpl(void) { ifs->clear(); ifs->seekg(0); }
     void updateGroupCoordsImpl(AtomicGroup& g);
+    void copyCoordsImpl(greal* x, greal* y, greal* z) const;
     bool readCompressedCoords(void);
     bool readUncompressedCoords(void);
   };